@@ -40,6 +40,9 @@ void benchmark::ConsolePrinter::result(const State& state)
 
     std::cout << std::setprecision(6);
     std::cout << state.m_name << ", " << state.m_num_evals << ", " << state.m_num_iters << ", " << total << ", " << front << ", " << back << ", " << median << std::endl;
+    for (const auto& counter : state.m_counters) {
+        std::cout << "#   " << state.m_name << " " << counter.first << ": " << counter.second << std::endl;
+    }
 }
 
 void benchmark::ConsolePrinter::footer() {}
@@ -60,6 +60,8 @@ public:
     const uint64_t m_num_evals;
     std::vector<double> m_elapsed_results;
     time_point m_start_time;
+    // what the benchmark measured besides the time, by name, printed with its results
+    std::map<std::string, double> m_counters;
 
     bool UpdateTimer(time_point finish_time);
 
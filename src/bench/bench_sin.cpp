@@ -4,6 +4,7 @@
 
 #include <bench/bench.h>
 
+#include <chainparams.h>
 #include <crypto/sha256.h>
 #include <key.h>
 #include <random.h>
@@ -68,6 +69,8 @@ int main(int argc, char** argv)
     RandomInit();
     ECC_Start();
     SetupEnvironment();
+    // the default chain, for the benches which do not select their own
+    SelectParams(CBaseChainParams::MAIN);
 
     int64_t evaluations = gArgs.GetArg("-evals", DEFAULT_BENCH_EVALUATIONS);
     std::string regex_filter = gArgs.GetArg("-filter", DEFAULT_BENCH_FILTER);
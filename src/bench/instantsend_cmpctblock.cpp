@@ -0,0 +1,138 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <arith_uint256.h>
+#include <blockencodings.h>
+#include <consensus/merkle.h>
+#include <instantx.h>
+#include <net_processing.h>
+#include <txmempool.h>
+
+#include <assert.h>
+#include <set>
+
+// Locks a transaction like a lock candidate which got enough votes,
+// CreateTxLockCandidate then LockTransactionInputs, without masternodes.
+struct CInstantSendBenchSetup
+{
+    static void Lock(CInstantSend& is, const CTxLockRequest& txLockRequest)
+    {
+        LOCK(is.cs_instantsend);
+        uint256 txHash = txLockRequest.GetHash();
+        if (is.mapTxLockCandidates.count(txHash)) return;
+        CTxLockCandidate txLockCandidate(txLockRequest);
+        for (const auto& txin : txLockRequest.tx->vin) {
+            txLockCandidate.AddOutPointLock(txin.prevout);
+        }
+        is.mapTxLockCandidates.insert(std::make_pair(txHash, txLockCandidate));
+        is.mapLockCandidateOutpoints.Set(txHash, txLockCandidate.GetOutPoints());
+        for (const COutPoint& outpoint : txLockCandidate.GetOutPoints()) {
+            is.mapLockedOutpoints.Insert(outpoint, txHash);
+        }
+    }
+};
+
+// A block of nTxes transactions like in blockencodings_tests. The locked ones
+// in setLocked lost a conflict race on both sides: the mempools do not have
+// them, instantsend has their lock requests as rejected and then locked.
+static const size_t nTxes = 500;
+static const std::set<size_t> setLocked = {7, 42, 43, 150, 151, 152, 300, 499};
+
+static CBlock BuildBlock()
+{
+    CBlock block;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig.resize(10);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 42;
+
+    block.vtx.resize(nTxes);
+    block.vtx[0] = MakeTransactionRef(tx);
+    block.nVersion = 42;
+    block.nBits = 0x207fffff;
+    for (size_t i = 1; i < nTxes; i++) {
+        tx.vin[0].prevout.hash = ArithToUint256(arith_uint256(i));
+        tx.vin[0].prevout.n = 0;
+        block.vtx[i] = MakeTransactionRef(tx);
+    }
+    bool mutated;
+    block.hashMerkleRoot = BlockMerkleRoot(block, &mutated);
+    assert(!mutated);
+    return block;
+}
+
+static void Setup(const CBlock& block, CTxMemPool& pool)
+{
+    LOCK(pool.cs);
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        if (setLocked.count(i)) {
+            CTxLockRequest txLockRequest(block.vtx[i]);
+            instantsend.RejectLockRequest(txLockRequest);
+            CInstantSendBenchSetup::Lock(instantsend, txLockRequest);
+            continue;
+        }
+        LockPoints lp;
+        pool.addUnchecked(block.vtx[i]->GetHash(), CTxMemPoolEntry(block.vtx[i], 1000, 0, 1, false, 4, lp));
+    }
+}
+
+// Transactions the receiver has to request with GETBLOCKTXN, one round trip for all of them
+static size_t MissingTxes(const CBlockHeaderAndShortTxIDs& cmpctblock, CTxMemPool& pool, const std::vector<std::pair<uint256, CTransactionRef>>& vExtraTxn)
+{
+    PartiallyDownloadedBlock partialBlock(&pool);
+    assert(partialBlock.InitData(cmpctblock, vExtraTxn) == READ_STATUS_OK);
+    size_t nMissing = 0;
+    for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++) {
+        if (!partialBlock.IsTxAvailable(i)) nMissing++;
+    }
+    return nMissing;
+}
+
+static void ReportRoundTrips(benchmark::State& state, size_t nMissingBefore, size_t nMissingAfter)
+{
+    state.m_counters["missing txes without lock requests"] = nMissingBefore;
+    state.m_counters["missing txes"] = nMissingAfter;
+    state.m_counters["getblocktxn round trips saved per block"] = (nMissingBefore > 0) - (nMissingAfter > 0);
+}
+
+// Receiver side: the lock requests are an extra reconstruction source
+static void CmpctBlockInstantSendExtraTxn(benchmark::State& state)
+{
+    CBlock block(BuildBlock());
+    CTxMemPool pool;
+    Setup(block, pool);
+
+    CBlockHeaderAndShortTxIDs cmpctblock(block, true);
+    size_t nMissingBefore = MissingTxes(cmpctblock, pool, {});
+
+    size_t nMissing = 0;
+    while (state.KeepRunning()) {
+        std::vector<std::pair<uint256, CTransactionRef>> vExtraTxn;
+        instantsend.GetCompactBlockExtraTxes(vExtraTxn);
+        nMissing = MissingTxes(cmpctblock, pool, vExtraTxn);
+    }
+    ReportRoundTrips(state, nMissingBefore, nMissing);
+}
+
+// Sender side: the locked transactions the peer may miss are prefilled
+static void CmpctBlockInstantSendPrefill(benchmark::State& state)
+{
+    CBlock block(BuildBlock());
+    CTxMemPool pool;
+    Setup(block, pool);
+
+    size_t nMissingBefore = MissingTxes(CBlockHeaderAndShortTxIDs(block, true), pool, {});
+
+    size_t nMissing = 0;
+    while (state.KeepRunning()) {
+        CBlockHeaderAndShortTxIDs cmpctblock(block, true, IsLockedTxPeerMayMiss);
+        nMissing = MissingTxes(cmpctblock, pool, {});
+    }
+    ReportRoundTrips(state, nMissingBefore, nMissing);
+}
+
+BENCHMARK(CmpctBlockInstantSendExtraTxn, 500);
+BENCHMARK(CmpctBlockInstantSendPrefill, 500);
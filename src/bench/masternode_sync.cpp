@@ -0,0 +1,176 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <masternode-sync.h>
+#include <netbase.h>
+#include <netfulfilledman.h>
+#include <netmessagemaker.h>
+#include <protocol.h>
+#include <util.h>
+#include <utiltime.h>
+#include <validation.h>
+
+#include <assert.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// net.h has CConnmanTest as a friend, for the peers of the simulated network
+struct CConnmanTest
+{
+    static void AddNode(CConnman& connman, CNode* pnode)
+    {
+        LOCK(connman.cs_vNodes);
+        connman.vNodes.push_back(pnode);
+    }
+
+    // there is no message processor to finalize them, CConnman::Stop can't delete them
+    static void ClearNodes(CConnman& connman)
+    {
+        LOCK(connman.cs_vNodes);
+        for (CNode* pnode : connman.vNodes) {
+            delete pnode;
+        }
+        connman.vNodes.clear();
+    }
+};
+
+// A network of peers which connect over the first seconds, answer a request
+// with their inventory count (SYNCSTATUSCOUNT) after their latency and then
+// send one batch of items per second.
+struct SimPeer
+{
+    int64_t nConnect;
+    int64_t nLatency;
+    int nBatches;
+};
+
+static const std::vector<SimPeer> vSimPeers = {
+    {0, 1, 8}, {0, 2, 8}, {1, 9, 8}, {1, 1, 6},
+    {2, 3, 8}, {3, 40, 8}, {4, 2, 7}, {6, 1, 8},
+};
+
+/** Messages the engine sent to pnode with strCommand */
+static uint64_t SentBytes(CNode* pnode, const std::string& strCommand)
+{
+    CNodeStats stats;
+    pnode->copyStats(stats);
+    auto it = stats.mapSendBytesPerMsgCmd.find(strCommand);
+    return it == stats.mapSendBytesPerMsgCmd.end() ? 0 : it->second;
+}
+
+// Run the real CMasternodeSync from the start of the masternode list to
+// synced, ticking once per simulated second like the masternode thread,
+// and return the simulated seconds it took.
+static int64_t SimulateSync(const std::vector<SimPeer>& vPeers, int64_t nTimeStart)
+{
+    CConnman connman(0x1337, 0x1337);
+    std::vector<CNode*> vNodes;
+    // time each peer was asked for each asset
+    std::map<std::pair<int, int>, int64_t> mapAskedAt;
+
+    SetMockTime(nTimeStart);
+    // forget which peers the last run asked
+    netfulfilledman.Clear();
+    masternodeSync.Reset();
+    masternodeSync.SwitchToNextAsset(connman); // waiting for the blockchain
+    masternodeSync.SwitchToNextAsset(connman); // at the tip, masternode list
+
+    int64_t nNow = 0;
+    for (; !masternodeSync.IsSynced(); nNow++) {
+        assert(nNow < 20 * MASTERNODE_SYNC_TIMEOUT_SECONDS && !masternodeSync.IsFailed());
+        SetMockTime(nTimeStart + nNow);
+
+        for (size_t i = vNodes.size(); i < vPeers.size() && vPeers[i].nConnect <= nNow; i++) {
+            // private addresses, DsegUpdate does not hold back asking again on the next run
+            CAddress addr(LookupNumeric(strprintf("10.0.0.%d", i + 1).c_str(), Params().GetDefaultPort()), NODE_NONE);
+            CNode* pnode = new CNode(i, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", false);
+            pnode->nVersion = PROTOCOL_VERSION;
+            pnode->SetSendVersion(PROTOCOL_VERSION);
+            pnode->fSuccessfullyConnected = true;
+            CConnmanTest::AddNode(connman, pnode);
+            vNodes.push_back(pnode);
+        }
+
+        // what the peers asked before send now
+        for (const auto& pair : mapAskedAt) {
+            const SimPeer& peer = vPeers[pair.first.first];
+            int64_t nAnswer = pair.second + peer.nLatency;
+            if (nNow == nAnswer) {
+                CDataStream vRecv(SER_NETWORK, PROTOCOL_VERSION);
+                vRecv << pair.first.second << peer.nBatches;
+                masternodeSync.ProcessMessage(vNodes[pair.first.first], NetMsgType::SYNCSTATUSCOUNT, vRecv);
+            }
+            // a new masternode or payment vote, what CMasternodeMan and CMasternodePayments report
+            if (nNow > nAnswer && nNow <= nAnswer + peer.nBatches) masternodeSync.BumpAssetLastTime("SimulateSync");
+        }
+
+        masternodeSync.ProcessTick(connman);
+
+        for (CNode* pnode : vNodes) {
+            if (SentBytes(pnode, NetMsgType::DSEG)) mapAskedAt.emplace(std::make_pair(pnode->GetId(), MASTERNODE_SYNC_LIST), nNow);
+            if (SentBytes(pnode, NetMsgType::MASTERNODEPAYMENTSYNC)) mapAskedAt.emplace(std::make_pair(pnode->GetId(), MASTERNODE_SYNC_MNW), nNow);
+        }
+    }
+    CConnmanTest::ClearNodes(connman);
+    SetMockTime(0);
+    return nNow;
+}
+
+/** Mainnet params while in scope, regtest skips the assets; the chain selected before is restored after. */
+struct MainParamsScope
+{
+    const std::string strPrevious;
+    MainParamsScope() : strPrevious(Params().NetworkIDString()) { SelectParams(CBaseChainParams::MAIN); }
+    ~MainParamsScope() { SelectParams(strPrevious); }
+};
+
+static void RunMasternodeSync(benchmark::State& state, int nParallelPeers)
+{
+    MainParamsScope params;
+    gArgs.ForceSetArg("-masternodesyncpeers", std::to_string(nParallelPeers));
+
+    // the payment votes are requested back from the tip
+    static uint256 hashGenesis;
+    CBlockIndex indexGenesis;
+    indexGenesis.phashBlock = &hashGenesis;
+    bool fSetTip;
+    {
+        LOCK(cs_main);
+        fSetTip = chainActive.Tip() == nullptr;
+        if (fSetTip) chainActive.SetTip(&indexGenesis);
+    }
+
+    int64_t nTimeStart = GetTime();
+    int64_t nTimeToSynced = 0;
+    while (state.KeepRunning()) {
+        nTimeToSynced = SimulateSync(vSimPeers, nTimeStart);
+    }
+    state.m_counters["simulated seconds to synced"] = nTimeToSynced;
+
+    masternodeSync.Reset();
+    netfulfilledman.Clear();
+    gArgs.ForceSetArg("-masternodesyncpeers", std::to_string(MASTERNODE_SYNC_PARALLEL_PEERS));
+    if (fSetTip) {
+        LOCK(cs_main);
+        chainActive.SetTip(nullptr);
+    }
+}
+
+// Each asset requested from one peer at a time
+static void MasternodeSyncSequential(benchmark::State& state)
+{
+    RunMasternodeSync(state, 1);
+}
+
+// Each asset requested from up to MASTERNODE_SYNC_PARALLEL_PEERS peers at once
+static void MasternodeSyncPipelined(benchmark::State& state)
+{
+    RunMasternodeSync(state, MASTERNODE_SYNC_PARALLEL_PEERS);
+}
+
+BENCHMARK(MasternodeSyncSequential, 20);
+BENCHMARK(MasternodeSyncPipelined, 20);
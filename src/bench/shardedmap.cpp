@@ -0,0 +1,96 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <arith_uint256.h>
+#include <coins.h>
+#include <random.h>
+#include <shardedmap.h>
+
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+static const int LOOKUP_THREADS = 8;
+static const int LOOKUPS_PER_THREAD = 20000;
+static const uint32_t LOOKUP_OUTPOINTS = 4096;
+
+// the index the sharded map replaces, one lock for everything like cs_instantsend
+class SingleLockMap
+{
+private:
+    std::mutex mutex;
+    std::unordered_map<COutPoint, uint256, SaltedOutpointHasher> map;
+
+public:
+    bool Get(const COutPoint& key, uint256& valueRet)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = map.find(key);
+        if (it == map.end()) return false;
+        valueRet = it->second;
+        return true;
+    }
+    bool Insert(const COutPoint& key, const uint256& value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return map.emplace(key, value).second;
+    }
+    bool Erase(const COutPoint& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return map.erase(key) != 0;
+    }
+};
+
+// Mempool acceptance looking up the inputs of transactions from several
+// threads while locks come and go: every thread checks LOOKUPS_PER_THREAD
+// outpoints, half of them locked, and locks or unlocks one outpoint of its
+// own every 64 lookups.
+template <typename Map>
+static void RunLookups(benchmark::State& state)
+{
+    std::vector<COutPoint> vOutpoints;
+    for (uint32_t n = 0; n < LOOKUP_OUTPOINTS; n++) {
+        vOutpoints.emplace_back(ArithToUint256(arith_uint256(n)), n);
+    }
+    Map map;
+    for (uint32_t n = 0; n < LOOKUP_OUTPOINTS / 2; n++) {
+        map.Insert(vOutpoints[n], vOutpoints[n].hash);
+    }
+
+    while (state.KeepRunning()) {
+        std::vector<std::thread> vThreads;
+        for (int t = 0; t < LOOKUP_THREADS; t++) {
+            vThreads.emplace_back([&, t] {
+                uint256 hashOwn = ArithToUint256(arith_uint256(LOOKUP_OUTPOINTS + t));
+                for (int i = 0; i < LOOKUPS_PER_THREAD; i++) {
+                    uint256 hashLocked;
+                    map.Get(vOutpoints[(i * 7919 + t) % vOutpoints.size()], hashLocked);
+                    if (i % 64 == 0) {
+                        COutPoint outpointOwn(hashOwn, i / 64 % 16);
+                        if (!map.Erase(outpointOwn)) map.Insert(outpointOwn, hashOwn);
+                    }
+                }
+            });
+        }
+        for (auto& thread : vThreads) {
+            thread.join();
+        }
+    }
+}
+
+static void ShardedMapLookupsSingleLock(benchmark::State& state)
+{
+    RunLookups<SingleLockMap>(state);
+}
+
+static void ShardedMapLookups(benchmark::State& state)
+{
+    RunLookups<shardedmap<COutPoint, uint256, SaltedOutpointHasher> >(state);
+}
+
+BENCHMARK(ShardedMapLookupsSingleLock, 20);
+BENCHMARK(ShardedMapLookups, 20);
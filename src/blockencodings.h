@@ -7,10 +7,14 @@
 
 #include <primitives/block.h>
 
+#include <functional>
 #include <memory>
 
 class CTxMemPool;
 
+/** Transactions besides the coinbase the sender may prefill in a compact block */
+static const unsigned int MAX_CMPCTBLOCK_PREDICTED_PREFILL = 32;
+
 // Dumb helper to handle CTransaction compression at serialize-time
 struct TransactionCompressor {
 private:
@@ -148,7 +152,11 @@ public:
     // Dummy for deserialization
     CBlockHeaderAndShortTxIDs() {}
 
-    CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID);
+    /**
+     * fnPrefill picks transactions the peer is likely to miss, these are sent
+     * in full (up to MAX_CMPCTBLOCK_PREDICTED_PREFILL) instead of as short ids
+     */
+    CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID, const std::function<bool(const CTransaction&)>& fnPrefill = nullptr);
 
     uint64_t GetShortID(const uint256& txhash) const;
 
@@ -0,0 +1,188 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QSTEES_BLOCKSCANNER_H
+#define QSTEES_BLOCKSCANNER_H
+
+#include <chain.h>
+#include <chainparams.h>
+#include <primitives/block.h>
+#include <shutdown.h>
+#include <util.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** -blockscanthreads default, 0 = one thread per core */
+static const int DEFAULT_BLOCKSCAN_THREADS = 0;
+/** Results waiting for the committer, per worker thread */
+static const int BLOCKSCAN_WINDOW_PER_THREAD = 16;
+
+/** Number of threads used to scan the chain, from -blockscanthreads */
+inline int GetBlockScanThreads()
+{
+    int nThreads = gArgs.GetArg("-blockscanthreads", DEFAULT_BLOCKSCAN_THREADS);
+    if (nThreads <= 0)
+        nThreads += GetNumCores();
+    return std::max(1, nThreads);
+}
+
+/**
+ * Scan a range of blocks of one chain on several threads.
+ *
+ * Worker threads read and deserialize the blocks in height order and run
+ * the extractor on each of them, producing a T per block. The calling
+ * thread commits the results one by one in scan order (ascending or
+ * descending height), so the committed state is the same as with a serial
+ * scan whatever the number of threads.
+ *
+ * The extractor must be thread-safe, must not touch the state the committer
+ * writes and must not take cs_main: the caller may hold it while waiting.
+ * Anything needing cs_main (like GetTransaction) belongs to the committer.
+ * A false from the extractor or the committer, a block that can not be
+ * read, or a shutdown request stops the scan after the blocks before it
+ * were committed.
+ */
+template <typename T>
+class CBlockScanner
+{
+public:
+    typedef std::function<bool(const CBlock& block, const CBlockIndex* pindex, T& result)> Extractor;
+    typedef std::function<bool(const CBlockIndex* pindex, T& result)> Committer;
+
+private:
+    enum SlotState { SLOT_EMPTY, SLOT_READY, SLOT_FAILED };
+
+    struct Slot
+    {
+        SlotState state = SLOT_EMPTY;
+        T result;
+    };
+
+    const CBlockIndex* pindexTip;
+    int nLowHeight;
+    bool fDescending;
+    int nThreads;
+    // blocks in scan order with their position on disk, filled under cs_main before starting
+    std::vector<std::pair<const CBlockIndex*, CDiskBlockPos>> vBlocks;
+
+    std::mutex mutex;
+    std::condition_variable condWorker;
+    std::condition_variable condCommitter;
+    // ring of results indexed by position in the scan
+    std::vector<Slot> vSlots;
+    // next position handed to a worker
+    int nNextPos;
+    // next position to commit
+    int nCommitPos;
+    bool fAbort;
+
+    int Count() const { return (int)vBlocks.size(); }
+
+    void Work(const Extractor& extract)
+    {
+        while (true) {
+            int nPos;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condWorker.wait(lock, [this] { return fAbort || nNextPos >= Count() || nNextPos < nCommitPos + (int)vSlots.size(); });
+                if (fAbort || nNextPos >= Count()) return;
+                nPos = nNextPos++;
+            }
+
+            const CBlockIndex* pindex = vBlocks[nPos].first;
+            T result;
+            CBlock block;
+            bool fOk = ReadBlockFromDisk(block, vBlocks[nPos].second, pindex->nHeight, Params().GetConsensus()) &&
+                       block.GetHash() == pindex->GetBlockHash();
+            if (!fOk) {
+                LogPrint(BCLog::INFINITYNODE, "CBlockScanner -- can not read block %d from disk\n", pindex->nHeight);
+            } else {
+                fOk = extract(block, pindex, result);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                Slot& slot = vSlots[nPos % vSlots.size()];
+                slot.result = std::move(result);
+                slot.state = fOk ? SLOT_READY : SLOT_FAILED;
+            }
+            condCommitter.notify_one();
+        }
+    }
+
+public:
+    /**
+     * Scan from pindexTipIn down to nLowHeightIn when fDescendingIn is set,
+     * from nLowHeightIn up to pindexTipIn otherwise.
+     */
+    CBlockScanner(const CBlockIndex* pindexTipIn, int nLowHeightIn, bool fDescendingIn, int nThreadsIn = GetBlockScanThreads()) :
+        pindexTip(pindexTipIn),
+        nLowHeight(std::max(0, nLowHeightIn)),
+        fDescending(fDescendingIn),
+        nThreads(std::max(1, nThreadsIn)),
+        vSlots(std::max(1, nThreadsIn) * BLOCKSCAN_WINDOW_PER_THREAD),
+        nNextPos(0),
+        nCommitPos(0),
+        fAbort(false)
+    {}
+
+    /** Returns true when every block of the range was committed */
+    bool Run(const Extractor& extract, const Committer& commit)
+    {
+        if (pindexTip == nullptr || pindexTip->nHeight < nLowHeight) return true;
+
+        {
+            LOCK(cs_main);
+            vBlocks.reserve(pindexTip->nHeight - nLowHeight + 1);
+            for (const CBlockIndex* pindex = pindexTip; pindex != nullptr && pindex->nHeight >= nLowHeight; pindex = pindex->pprev) {
+                vBlocks.emplace_back(pindex, pindex->GetBlockPos());
+            }
+        }
+        if (!fDescending) std::reverse(vBlocks.begin(), vBlocks.end());
+
+        std::vector<std::thread> vWorkers;
+        for (int i = 0; i < std::min(nThreads, Count()); i++) {
+            vWorkers.emplace_back([this, &extract] {
+                RenameThread("qstees-blockscan");
+                Work(extract);
+            });
+        }
+
+        bool fOk = true;
+        while (nCommitPos < Count()) {
+            T result;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                Slot& slot = vSlots[nCommitPos % vSlots.size()];
+                condCommitter.wait(lock, [&slot] { return slot.state != SLOT_EMPTY; });
+                fOk = slot.state == SLOT_READY;
+                result = std::move(slot.result);
+                slot.state = SLOT_EMPTY;
+            }
+            if (fOk) fOk = !ShutdownRequested() && commit(vBlocks[nCommitPos].first, result);
+            if (!fOk) break;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                nCommitPos++;
+            }
+            condWorker.notify_all();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            fAbort = true;
+        }
+        condWorker.notify_all();
+        for (std::thread& worker : vWorkers) worker.join();
+        return fOk;
+    }
+};
+
+#endif // QSTEES_BLOCKSCANNER_H
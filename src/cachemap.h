@@ -143,6 +143,16 @@ public:
         return true;
     }
 
+    /// Make an item the most recently added one, so it is pruned last
+    void Touch(const K& key)
+    {
+        map_it it = mapIndex.find(key);
+        if(it == mapIndex.end()) {
+            return;
+        }
+        listItems.splice(listItems.begin(), listItems, it->second);
+    }
+
     void Erase(const K& key)
     {
         map_it it = mapIndex.find(key);
@@ -563,3 +563,11 @@ void UpdateVersionBitsParameters(Consensus::DeploymentPos d, int64_t nStartTime,
 {
     globalChainParams->UpdateVersionBitsParameters(d, nStartTime, nTimeout);
 }
+
+void UpdateGovernanceAddressParameters(const std::string& strAddress)
+{
+    // the consensus parameters keep a pointer to it
+    static std::string strGovernanceAddress;
+    strGovernanceAddress = strAddress;
+    globalChainParams->UpdateGovernanceAddressParameters(strGovernanceAddress.c_str());
+}
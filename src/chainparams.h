@@ -87,6 +87,7 @@ public:
     int FulfilledRequestExpireTime() const { return nFulfilledRequestExpireTime; }
     const ChainTxData& TxData() const { return chainTxData; }
     void UpdateVersionBitsParameters(Consensus::DeploymentPos d, int64_t nStartTime, int64_t nTimeout);
+    void UpdateGovernanceAddressParameters(const char* pszAddress) { consensus.cGovernanceAddress = pszAddress; }
     std::string SporkPubKey() const { return strSporkPubKey; }
     int MaxReorganizationDepth() const { return nMaxReorganizationDepth; }
     int MinReorganizationPeers() const { return nMinReorganizationPeers; }
@@ -142,4 +143,9 @@ void SelectParams(const std::string& chain);
  */
 void UpdateVersionBitsParameters(Consensus::DeploymentPos d, int64_t nStartTime, int64_t nTimeout);
 
+/**
+ * Allows modifying the governance vote address of the regtest parameters.
+ */
+void UpdateGovernanceAddressParameters(const std::string& strAddress);
+
 #endif // BITCOIN_CHAINPARAMS_H
@@ -9,8 +9,10 @@
 #include <instantx.h>
 #include <masternodeman.h>
 #include <infinitynodeman.h>
+#include <infinitynodersv.h>
 #include <masternode-payments.h>
 #include <masternode-sync.h>
+#include <masternodejobs.h>
 
 void CDSNotificationInterface::InitializeCurrentBlockTip()
 {
@@ -38,13 +40,42 @@ void CDSNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, con
     if (fInitialDownload)
         return;
 
+    instantsend.UpdatedBlockTip(pindexNew);
+    if (!fCachesLoaded)
+        return;
+
     mnodeman.UpdatedBlockTip(pindexNew);
     infnodeman.UpdatedBlockTip(pindexNew);
-    instantsend.UpdatedBlockTip(pindexNew);
     mnpayments.UpdatedBlockTip(pindexNew, connman);
+    mnjobs.UpdatedBlockTip();
 }
 
 void CDSNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlockIndex *pindex, int posInBlock)
 {
     instantsend.SyncTransaction(tx, pindex, posInBlock);
 }
+
+void CDSNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock> &block, const CBlockIndex *pindex, const std::vector<CTransactionRef> &txnConflicted)
+{
+    if (!fCachesLoaded)
+        return;
+
+    mnodeman.BlockConnected(*block, pindex);
+    infnodeman.BlockConnected(*block, pindex);
+    infnodersv.BlockConnected(*block, pindex);
+}
+
+void CDSNotificationInterface::BlockDisconnected(const std::shared_ptr<const CBlock> &block)
+{
+    if (!fCachesLoaded)
+        return;
+
+    const CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        pindex = LookupBlockIndex(block->GetHash());
+    }
+    mnodeman.BlockDisconnected(*block, pindex);
+    infnodeman.BlockDisconnected(*block, pindex);
+    infnodersv.BlockDisconnected(*block, pindex);
+}
@@ -9,14 +9,19 @@
 
 #include <validationinterface.h>
 
+#include <atomic>
+
 class CDSNotificationInterface : public CValidationInterface
 {
 public:
-    CDSNotificationInterface(CConnman& connmanIn): connman(connmanIn) {}
+    CDSNotificationInterface(CConnman& connmanIn): connman(connmanIn), fCachesLoaded(false) {}
     virtual ~CDSNotificationInterface() = default;
 
     // a small helper to initialize current block height in sub-modules on startup
     void InitializeCurrentBlockTip();
+    // the masternode and infinitynode managers get the block notifications once their caches are loaded,
+    // what they missed before is caught up by the caller
+    void SetCachesLoaded() { fCachesLoaded = true; }
 
 protected:
     // CValidationInterface
@@ -25,9 +30,12 @@ protected:
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
     //void SyncTransaction(const CTransaction &tx, const CBlock *pblock) override;
     void SyncTransaction(const CTransaction &tx, const CBlockIndex *pindex, int posInBlock) override;
+    void BlockConnected(const std::shared_ptr<const CBlock> &block, const CBlockIndex *pindex, const std::vector<CTransactionRef> &txnConflicted) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock> &block) override;
 
 private:
     CConnman& connman;
+    std::atomic<bool> fCachesLoaded;
 };
 
 #endif // FXTC_DSNOTIFICATIONINTERFACE_H
@@ -0,0 +1,268 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QSTEES_EXPIRYMAP_H
+#define QSTEES_EXPIRYMAP_H
+
+#include <serialize.h>
+
+#include <array>
+#include <functional>
+#include <list>
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * Hash map whose entries expire at a time given when they are added.
+ *
+ * The expiry times are kept in a hierarchical timing wheel of WHEEL_LEVELS
+ * levels of WHEEL_SLOTS slots, one tick per time unit (seconds, or block
+ * heights, the map does not care): level 0 has a slot per tick, every next
+ * level a slot per WHEEL_SLOTS slots of the previous one, which is moved down
+ * when its time comes. Adding, changing and removing an entry is O(1) and so
+ * is expiring it, Expire only visits the slots of the ticks which passed.
+ *
+ * An entry expires once the time given to Expire is past its expiry time,
+ * like the "nExpireTime < GetTime()" checks of the sweeps it replaces.
+ * Entries are only removed by Expire, the owner still checks the expiry time
+ * where it matters between two calls.
+ */
+template <typename K, typename V, typename Hash = std::hash<K> >
+class expirymap
+{
+private:
+    static const int WHEEL_BITS = 6;
+    static const int WHEEL_SLOTS = 1 << WHEEL_BITS;
+    static const int WHEEL_LEVELS = 4;
+    // entries further away than that are put in the last slot and moved down until their time comes
+    static const int64_t WHEEL_SPAN = int64_t(1) << (WHEEL_BITS * WHEEL_LEVELS);
+    // entries added with a time already expired, they go with the next call to Expire
+    static const int OVERDUE_SLOT = WHEEL_SLOTS * WHEEL_LEVELS;
+
+    typedef std::list<K> slot_t;
+
+    struct Entry
+    {
+        V value;
+        int64_t nExpireTime;
+        int nSlot;
+        typename slot_t::iterator itSlot;
+    };
+
+    std::unordered_map<K, Entry, Hash> mapEntries;
+    std::array<slot_t, WHEEL_SLOTS * WHEEL_LEVELS + 1> arrSlots;
+    // last tick expired, Expire goes on from the next one
+    int64_t nCurrentTime;
+
+    void Schedule(const K& key, Entry& entry)
+    {
+        int64_t nTime = entry.nExpireTime;
+        if (nTime <= nCurrentTime) {
+            entry.nSlot = OVERDUE_SLOT;
+            entry.itSlot = arrSlots[OVERDUE_SLOT].insert(arrSlots[OVERDUE_SLOT].end(), key);
+            return;
+        }
+        if (nTime - nCurrentTime >= WHEEL_SPAN) nTime = nCurrentTime + WHEEL_SPAN - 1;
+
+        int nLevel = 0;
+        while (nLevel < WHEEL_LEVELS - 1 && nTime - nCurrentTime - 1 >= (int64_t(1) << (WHEEL_BITS * (nLevel + 1)))) {
+            nLevel++;
+        }
+        entry.nSlot = nLevel * WHEEL_SLOTS + ((nTime >> (WHEEL_BITS * nLevel)) & (WHEEL_SLOTS - 1));
+        entry.itSlot = arrSlots[entry.nSlot].insert(arrSlots[entry.nSlot].end(), key);
+    }
+
+    void Unschedule(Entry& entry)
+    {
+        arrSlots[entry.nSlot].erase(entry.itSlot);
+    }
+
+    /** Schedule again the entries of a slot, one level down now that its time came */
+    void Cascade(int nSlot)
+    {
+        slot_t slot;
+        slot.swap(arrSlots[nSlot]);
+        for (const K& key : slot) {
+            Schedule(key, mapEntries.find(key)->second);
+        }
+    }
+
+    /** Remove the entries of keys which expired before nNow, schedule again the others */
+    template <typename Callable>
+    size_t ExpireKeys(const slot_t& keys, int64_t nNow, Callable& fnExpired)
+    {
+        size_t nExpired = 0;
+        for (const K& key : keys) {
+            auto it = mapEntries.find(key);
+            if (it->second.nExpireTime >= nNow) {
+                Schedule(key, it->second);
+                continue;
+            }
+            V value = std::move(it->second.value);
+            mapEntries.erase(it);
+            fnExpired(key, value);
+            nExpired++;
+        }
+        return nExpired;
+    }
+
+public:
+    expirymap() : nCurrentTime(0) {}
+
+    expirymap(const expirymap& other) : nCurrentTime(0) { *this = other; }
+
+    expirymap& operator=(const expirymap& other)
+    {
+        if (this == &other) return *this;
+        Clear();
+        nCurrentTime = other.nCurrentTime;
+        for (const auto& pair : other.mapEntries) {
+            Set(pair.first, pair.second.value, pair.second.nExpireTime);
+        }
+        return *this;
+    }
+
+    V* Find(const K& key)
+    {
+        auto it = mapEntries.find(key);
+        return it == mapEntries.end() ? nullptr : &it->second.value;
+    }
+
+    const V* Find(const K& key) const
+    {
+        auto it = mapEntries.find(key);
+        return it == mapEntries.end() ? nullptr : &it->second.value;
+    }
+
+    bool Contains(const K& key) const { return mapEntries.count(key) != 0; }
+
+    /** Expiry time of key, 0 if there is none */
+    int64_t GetExpireTime(const K& key) const
+    {
+        auto it = mapEntries.find(key);
+        return it == mapEntries.end() ? 0 : it->second.nExpireTime;
+    }
+
+    /** Add key unless it is there already, like std::map::insert */
+    bool Insert(const K& key, const V& value, int64_t nExpireTime)
+    {
+        auto ret = mapEntries.emplace(key, Entry{value, nExpireTime, 0, typename slot_t::iterator()});
+        if (!ret.second) return false;
+        Schedule(ret.first->first, ret.first->second);
+        return true;
+    }
+
+    /** Add key or replace its value and expiry time */
+    void Set(const K& key, const V& value, int64_t nExpireTime)
+    {
+        auto it = mapEntries.find(key);
+        if (it == mapEntries.end()) {
+            Insert(key, value, nExpireTime);
+            return;
+        }
+        it->second.value = value;
+        if (it->second.nExpireTime == nExpireTime) return;
+        Unschedule(it->second);
+        it->second.nExpireTime = nExpireTime;
+        Schedule(it->first, it->second);
+    }
+
+    bool Erase(const K& key)
+    {
+        auto it = mapEntries.find(key);
+        if (it == mapEntries.end()) return false;
+        Unschedule(it->second);
+        mapEntries.erase(it);
+        return true;
+    }
+
+    /**
+     * Remove the entries which expired before nNow, calling fnExpired(key, value)
+     * for each of them once it is out of the map. fnExpired must not change the map.
+     */
+    template <typename Callable>
+    size_t Expire(int64_t nNow, Callable fnExpired)
+    {
+        size_t nExpired = 0;
+        slot_t keys;
+        if (nNow - 1 > nCurrentTime && mapEntries.empty()) {
+            nCurrentTime = nNow - 1;
+        } else if (nNow - 1 - nCurrentTime >= WHEEL_SPAN) {
+            // a whole turn of the wheel passed (first call or a long pause), start over
+            for (auto& slot : arrSlots) {
+                keys.splice(keys.end(), slot);
+            }
+            nCurrentTime = nNow - 1;
+            nExpired += ExpireKeys(keys, nNow, fnExpired);
+        } else {
+            while (nCurrentTime < nNow - 1) {
+                int64_t nTick = nCurrentTime + 1;
+                // higher levels first, what they move down can be due in a lower level right away
+                for (int nLevel = WHEEL_LEVELS - 1; nLevel > 0; nLevel--) {
+                    if ((nTick & ((int64_t(1) << (WHEEL_BITS * nLevel)) - 1)) != 0) continue;
+                    Cascade(nLevel * WHEEL_SLOTS + ((nTick >> (WHEEL_BITS * nLevel)) & (WHEEL_SLOTS - 1)));
+                }
+                nCurrentTime = nTick;
+                keys.clear();
+                keys.swap(arrSlots[nTick & (WHEEL_SLOTS - 1)]);
+                nExpired += ExpireKeys(keys, nTick + 1, fnExpired);
+            }
+        }
+        keys.clear();
+        keys.swap(arrSlots[OVERDUE_SLOT]);
+        nExpired += ExpireKeys(keys, nNow, fnExpired);
+        return nExpired;
+    }
+
+    size_t Expire(int64_t nNow)
+    {
+        return Expire(nNow, [](const K&, V&) {});
+    }
+
+    /** Call fn(key, value, nExpireTime) for every entry, in no particular order */
+    template <typename Callable>
+    void ForEach(Callable fn) const
+    {
+        for (const auto& pair : mapEntries) {
+            fn(pair.first, pair.second.value, pair.second.nExpireTime);
+        }
+    }
+
+    size_t size() const { return mapEntries.size(); }
+    bool empty() const { return mapEntries.empty(); }
+
+    void Clear()
+    {
+        mapEntries.clear();
+        for (auto& slot : arrSlots) {
+            slot.clear();
+        }
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        WriteCompactSize(s, mapEntries.size());
+        for (const auto& pair : mapEntries) {
+            s << pair.first << pair.second.value << pair.second.nExpireTime;
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        Clear();
+        uint64_t nSize = ReadCompactSize(s);
+        for (uint64_t i = 0; i < nSize; i++) {
+            K key;
+            V value;
+            int64_t nExpireTime;
+            s >> key >> value >> nExpireTime;
+            Set(key, value, nExpireTime);
+        }
+    }
+};
+
+#endif // QSTEES_EXPIRYMAP_H
@@ -9,6 +9,7 @@
 
 #include <chainparams.h>
 #include <clientversion.h>
+#include <flatdbwriter.h>
 #include <hash.h>
 #include <streams.h>
 #include <util.h>
@@ -45,28 +46,29 @@ private:
 
         int64_t nStart = GetTimeMillis();
 
-        // serialize, checksum data up to that point, then append checksum
-        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-        ssObj << strMagicMessage; // specific magic message for this type of object
-        ssObj << Params().MessageStart(); // network specific magic number
-        ssObj << objToSave;
-        uint256 hash = Hash(ssObj.begin(), ssObj.end());
-        ssObj << hash;
-
-        // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
-        CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+        // open the temporary file, and associate with CAutoFile
+        boost::filesystem::path pathTmp = GetFlatDBTempPath(pathDB);
+        CAutoFile fileout(fsbridge::fopen(pathTmp, "wb"), SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
-        // Write and commit header, data
+        // serialize straight to the file, checksum data up to that point, then append checksum
         try {
-            fileout << ssObj;
+            CHashedFileWriter writer(fileout);
+            writer << strMagicMessage; // specific magic message for this type of object
+            writer << Params().MessageStart(); // network specific magic number
+            writer << objToSave;
+            fileout << writer.GetHash();
         }
         catch (std::exception &e) {
+            fileout.fclose();
+            boost::filesystem::remove(pathTmp);
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
-        fileout.fclose();
+
+        // fsync and replace the file, a crash leaves either the old or the new one
+        if (!CommitFlatDBFile(fileout, pathTmp, pathDB))
+            return false;
 
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
@@ -74,6 +76,56 @@ private:
         return true;
     }
 
+    /** Check the file header only, enough to know whether it can be overwritten */
+    ReadResult ReadHeader()
+    {
+        FILE *file = fopen(pathDB.string().c_str(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return FileError;
+
+        unsigned char pchMsgTmp[4];
+        std::string strMagicMessageTmp;
+        try {
+            filein >> strMagicMessageTmp;
+            if (strMagicMessage != strMagicMessageTmp)
+            {
+                error("%s: Invalid magic message", __func__);
+                return IncorrectMagicMessage;
+            }
+            filein >> pchMsgTmp;
+            if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+            {
+                error("%s: Invalid network magic number", __func__);
+                return IncorrectMagicNumber;
+            }
+        }
+        catch (std::exception &e) {
+            return IncorrectFormat;
+        }
+        return Ok;
+    }
+
+    /** Whether a file read with readResult can be replaced */
+    bool CanOverwrite(ReadResult readResult)
+    {
+        // there was an error and it was not an error on file opening => do not proceed
+        if (readResult == FileError)
+            LogPrintf("Missing file %s, will try to recreate\n", strFilename);
+        else if (readResult != Ok)
+        {
+            LogPrintf("Error reading %s: ", strFilename);
+            if(readResult == IncorrectFormat)
+                LogPrintf("%s: Magic is ok but data has invalid format, will try to recreate\n", __func__);
+            else
+            {
+                LogPrintf("%s: File format is unknown or invalid, please fix it manually\n", __func__);
+                return false;
+            }
+        }
+        return true;
+    }
+
     ReadResult Read(T& objToLoad, bool fDryRun = false)
     {
         //LOCK(objToLoad.cs);
@@ -201,22 +253,8 @@ public:
 
         LogPrintf("Verifying %s format...\n", strFilename);
         T tmpObjToLoad;
-        ReadResult readResult = Read(tmpObjToLoad, true);
-
-        // there was an error and it was not an error on file opening => do not proceed
-        if (readResult == FileError)
-            LogPrintf("Missing file %s, will try to recreate\n", strFilename);
-        else if (readResult != Ok)
-        {
-            LogPrintf("Error reading %s: ", strFilename);
-            if(readResult == IncorrectFormat)
-                LogPrintf("%s: Magic is ok but data has invalid format, will try to recreate\n", __func__);
-            else
-            {
-                LogPrintf("%s: File format is unknown or invalid, please fix it manually\n", __func__);
-                return false;
-            }
-        }
+        if (!CanOverwrite(Read(tmpObjToLoad, true)))
+            return false;
 
         LogPrintf("Writing info to %s...\n", strFilename);
         Write(objToSave);
@@ -225,6 +263,33 @@ public:
         return true;
     }
 
+    /**
+     * Serialize objToSave into memory and leave hashing, writing and fsyncing
+     * the file to flatdbwriter. Only the file header is verified, the whole
+     * file is read back by Dump at shutdown.
+     */
+    bool DumpAsync(T& objToSave)
+    {
+        int64_t nStart = GetTimeMillis();
+
+        if (!CanOverwrite(ReadHeader()))
+            return false;
+
+        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
+        try {
+            ssObj << strMagicMessage; // specific magic message for this type of object
+            ssObj << Params().MessageStart(); // network specific magic number
+            ssObj << objToSave;
+        }
+        catch (std::exception &e) {
+            return error("%s: Serialize error - %s", __func__, e.what());
+        }
+        LogPrint(BCLog::MASTERNODE, "%s snapshot taken  %dms\n", strFilename, GetTimeMillis() - nStart);
+
+        flatdbwriter.Write(pathDB, strFilename, std::move(ssObj), objToSave.ToString());
+        return true;
+    }
+
 };
 
 
@@ -0,0 +1,129 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <flatdbwriter.h>
+
+#include <clientversion.h>
+#include <util.h>
+#include <utiltime.h>
+
+CFlatDBWriter flatdbwriter;
+
+fs::path GetFlatDBTempPath(const fs::path& pathDB)
+{
+    return pathDB.string() + ".new";
+}
+
+bool CommitFlatDBFile(CAutoFile& file, const fs::path& pathTmp, const fs::path& pathDB)
+{
+    if (fflush(file.Get()) != 0 || !FileCommit(file.Get())) {
+        file.fclose();
+        fs::remove(pathTmp);
+        return error("%s: Failed to commit file %s", __func__, pathTmp.string());
+    }
+    file.fclose();
+    if (!RenameOver(pathTmp, pathDB)) {
+        fs::remove(pathTmp);
+        return error("%s: Failed to rename %s to %s", __func__, pathTmp.string(), pathDB.string());
+    }
+    return true;
+}
+
+bool CFlatDBWriter::WriteSnapshot(const fs::path& pathDB, const Snapshot& snapshot)
+{
+    int64_t nStart = GetTimeMillis();
+
+    fs::path pathTmp = GetFlatDBTempPath(pathDB);
+    CAutoFile fileout(fsbridge::fopen(pathTmp, "wb"), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s: Failed to open file %s", __func__, pathTmp.string());
+
+    try {
+        fileout.write(snapshot.ssData.data(), snapshot.ssData.size());
+        fileout << Hash(snapshot.ssData.begin(), snapshot.ssData.end());
+    }
+    catch (std::exception &e) {
+        fileout.fclose();
+        fs::remove(pathTmp);
+        return error("%s: I/O error - %s", __func__, e.what());
+    }
+    if (!CommitFlatDBFile(fileout, pathTmp, pathDB))
+        return false;
+
+    LogPrintf("Written info to %s  %dms\n", snapshot.strFilename, GetTimeMillis() - nStart);
+    LogPrintf("     %s\n", snapshot.strSummary);
+    return true;
+}
+
+void CFlatDBWriter::ThreadWrite()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cond.wait(lock, [this] { return fStopping || !mapPending.empty(); });
+        if (mapPending.empty()) return;
+
+        fs::path pathDB = mapPending.begin()->first;
+        Snapshot snapshot(std::move(mapPending.begin()->second));
+        mapPending.erase(mapPending.begin());
+        fWriting = true;
+        lock.unlock();
+        WriteSnapshot(pathDB, snapshot);
+        lock.lock();
+        fWriting = false;
+        condIdle.notify_all();
+    }
+}
+
+void CFlatDBWriter::Start()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fRunning) return;
+    fRunning = true;
+    fStopping = false;
+    thread = std::thread([this] {
+        RenameThread("qstees-flatdb");
+        ThreadWrite();
+    });
+}
+
+void CFlatDBWriter::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!fRunning) return;
+        fStopping = true;
+    }
+    cond.notify_all();
+    // the thread writes what is still waiting before it returns
+    thread.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    fRunning = false;
+    condIdle.notify_all();
+}
+
+void CFlatDBWriter::Write(const fs::path& pathDB, const std::string& strFilename, CDataStream&& ssData, const std::string& strSummary)
+{
+    Snapshot snapshot{strFilename, std::move(ssData), strSummary};
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fRunning && !fStopping) {
+            auto it = mapPending.find(pathDB.string());
+            if (it != mapPending.end()) {
+                LogPrint(BCLog::MASTERNODE, "CFlatDBWriter::Write -- %s: dropping the snapshot not written yet\n", strFilename);
+                mapPending.erase(it);
+            }
+            mapPending.emplace(pathDB.string(), std::move(snapshot));
+            cond.notify_one();
+            return;
+        }
+    }
+    WriteSnapshot(pathDB, snapshot);
+}
+
+void CFlatDBWriter::Flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    condIdle.wait(lock, [this] { return !fRunning || (mapPending.empty() && !fWriting); });
+}
@@ -0,0 +1,104 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QSTEES_FLATDBWRITER_H
+#define QSTEES_FLATDBWRITER_H
+
+#include <fs.h>
+#include <hash.h>
+#include <streams.h>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/** Writes to a file and hashes what it wrote, for the checksum closing a flat database file */
+class CHashedFileWriter : public CHashWriter
+{
+private:
+    CAutoFile& file;
+    size_t nWritten;
+
+public:
+    explicit CHashedFileWriter(CAutoFile& fileIn) : CHashWriter(fileIn.GetType(), fileIn.GetVersion()), file(fileIn), nWritten(0) {}
+
+    void write(const char* pch, size_t nSize)
+    {
+        file.write(pch, nSize);
+        CHashWriter::write(pch, nSize);
+        nWritten += nSize;
+    }
+
+    /** Bytes written so far */
+    size_t size() const { return nWritten; }
+
+    template<typename T>
+    CHashedFileWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+};
+
+/** Temporary file a flat database file is written to before it is renamed over it */
+fs::path GetFlatDBTempPath(const fs::path& pathDB);
+
+/** Flush, fsync and close file, the temporary file at pathTmp, then rename it over pathDB */
+bool CommitFlatDBFile(CAutoFile& file, const fs::path& pathTmp, const fs::path& pathDB);
+
+/**
+ * Background writer for the flat database files (CFlatDB::DumpAsync).
+ *
+ * The caller serializes the object into memory, which is all it does under
+ * the object's lock, and the writer thread hashes the data, writes it to the
+ * temporary file, fsyncs it and renames it over the file. A file keeps only
+ * its most recent snapshot waiting, an older one not written yet is dropped.
+ * When the writer is not started, Write writes the file right away.
+ */
+class CFlatDBWriter
+{
+private:
+    struct Snapshot
+    {
+        std::string strFilename;
+        CDataStream ssData;
+        std::string strSummary;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::condition_variable condIdle;
+    // snapshots waiting by file path
+    std::map<std::string, Snapshot> mapPending;
+    bool fRunning;
+    bool fStopping;
+    bool fWriting;
+    std::thread thread;
+
+    void ThreadWrite();
+    static bool WriteSnapshot(const fs::path& pathDB, const Snapshot& snapshot);
+
+public:
+    CFlatDBWriter() : fRunning(false), fStopping(false), fWriting(false) {}
+    ~CFlatDBWriter() { Stop(); }
+
+    void Start();
+    /** Write the snapshots still waiting and join the thread */
+    void Stop();
+
+    /**
+     * Write the serialized data ssData (magic message, network magic and
+     * object, the checksum is added here) to pathDB, strSummary is logged.
+     */
+    void Write(const fs::path& pathDB, const std::string& strFilename, CDataStream&& ssData, const std::string& strSummary);
+
+    /** Wait until the snapshots waiting are written */
+    void Flush();
+};
+
+extern CFlatDBWriter flatdbwriter;
+
+#endif // QSTEES_FLATDBWRITER_H
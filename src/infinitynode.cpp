@@ -30,7 +30,7 @@ CInfinitynode::CInfinitynode(int nProtocolVersionIn, COutPoint outpointBurnFund)
     infinitynode_info_t{nProtocolVersionIn, GetAdjustedTime(), outpointBurnFund}
 {}
 
-infinitynode_info_t CInfinitynode::GetInfo()
+infinitynode_info_t CInfinitynode::GetInfo() const
 {
     infinitynode_info_t info{*this};
     return info;
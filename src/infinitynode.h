@@ -94,17 +94,17 @@ public:
     void setService(CService addrNew) { metadataService = addrNew;}
     void setMetadataHeight(int nHeight) { nMetadataHeight = nHeight;}
 
-    infinitynode_info_t GetInfo();
-    std::string getCollateralAddress(){return collateralAddress;}
-    std::string getBackupAddress(){return backupAddress;}
-    CScript getScriptPublicKey(){return scriptPubKey;}
-    int getHeight(){return nHeight;}
-    int getExpireHeight(){return nExpireHeight ;}
-    int getRoundBurnValue(){CAmount nBurnAmount = nBurnValue / COIN + 1; return nBurnAmount;}
-    int getQSTEESType(){return nQSTEESType;}
-    int getLastRewardHeight(){return nLastRewardHeight;}
-    int getRank(){return nRank;}
-    int getMetadataHeight(){return nMetadataHeight;}
+    infinitynode_info_t GetInfo() const;
+    std::string getCollateralAddress() const {return collateralAddress;}
+    std::string getBackupAddress() const {return backupAddress;}
+    CScript getScriptPublicKey() const {return scriptPubKey;}
+    int getHeight() const {return nHeight;}
+    int getExpireHeight() const {return nExpireHeight ;}
+    int getRoundBurnValue() const {CAmount nBurnAmount = nBurnValue / COIN + 1; return nBurnAmount;}
+    int getQSTEESType() const {return nQSTEESType;}
+    int getLastRewardHeight() const {return nLastRewardHeight;}
+    int getRank() const {return nRank;}
+    int getMetadataHeight() const {return nMetadataHeight;}
 
     CInfinitynode& operator=(CInfinitynode const& from)
     {
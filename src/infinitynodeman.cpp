@@ -12,11 +12,14 @@
 #include <flat-database.h>
 #include <utilstrencodings.h>
 #include <netbase.h>
+#include <blockscanner.h>
+#include <ui_interface.h>
+#include <masternodejobs.h>
 
 
 CInfinitynodeMan infnodeman;
 
-const std::string CInfinitynodeMan::SERIALIZATION_VERSION_STRING = "CInfinitynodeMan-Version-1";
+const std::string CInfinitynodeMan::SERIALIZATION_VERSION_STRING = "CInfinitynodeMan-Version-2";
 
 struct CompareIntValue
 {
@@ -39,15 +42,164 @@ struct CompareUnit256Value
 CInfinitynodeMan::CInfinitynodeMan()
 : cs(),
   mapInfinitynodes(),
+  nBIGLastStmHeight(0),
+  nMIDLastStmHeight(0),
+  nLILLastStmHeight(0),
+  nBIGLastStmSize(0),
+  nMIDLastStmSize(0),
+  nLILLastStmSize(0),
+  nLastPaidHeight(0),
+  hashLastPaidBlock(),
+  pindexLastPaidTip(nullptr),
+  fLastPaidCatchUpScheduled(false),
+  stateSnapshot(std::make_shared<const State>()),
+  nListVersion(0),
+  pindexScheduleTip(nullptr),
+  scheduleSnapshot(std::make_shared<const Schedule>()),
+  nStatsHeight(0),
+  statsSnapshot(std::make_shared<const Stats>()),
   nLastScanHeight(0)
 {}
 
+const std::map<int, int>& CInfinitynodeMan::State::getStatementMap(int nSinType) const
+{
+    static const std::map<int, int> nullmap = {{0,0}};
+    if(nSinType == 10) return mapStatementBIG;
+    else if(nSinType == 5) return mapStatementMID;
+    else if(nSinType == 1) return mapStatementLIL;
+    else return nullmap;
+}
+
+void CInfinitynodeMan::PublishSnapshot()
+{
+    AssertLockHeld(cs);
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->mapInfinitynodes = mapInfinitynodes;
+    state->mapInfinitynodesNonMatured = mapInfinitynodesNonMatured;
+    {
+        LOCK(cs_LastPaid);
+        state->mapLastPaid = mapLastPaid;
+    }
+    state->mapStatementBIG = mapStatementBIG;
+    state->mapStatementMID = mapStatementMID;
+    state->mapStatementLIL = mapStatementLIL;
+    state->nLastScanHeight = nLastScanHeight;
+    std::atomic_store(&stateSnapshot, StateRef(state));
+    infnodersv.UpdateNodeWeights(state->mapInfinitynodes);
+    UpdateStatementRanks();
+    PublishStats(*state);
+}
+
+void CInfinitynodeMan::PublishStats(const State& state)
+{
+    AssertLockHeld(cs);
+    std::shared_ptr<Stats> stats = std::make_shared<Stats>();
+    for (int nSinType : {10, 5, 1}) {
+        stats->mapTiers[nSinType].nLastStatement = getLastStatementBySinType(nSinType).first;
+    }
+    for (auto& infpair : state.mapInfinitynodes) {
+        auto it = stats->mapTiers.find(infpair.second.getQSTEESType());
+        if (it != stats->mapTiers.end()) it->second.nCount++;
+    }
+    for (auto& infpair : state.mapInfinitynodesNonMatured) {
+        auto it = stats->mapTiers.find(infpair.second.getQSTEESType());
+        if (it != stats->mapTiers.end()) it->second.nCountNonMatured++;
+    }
+    stats->nTotal = state.mapInfinitynodes.size() + state.mapInfinitynodesNonMatured.size();
+    stats->nLastScanHeight = state.nLastScanHeight + INF_MATURED_LIMIT;
+
+    bool fChanged;
+    {
+        LOCK(cs_Stats);
+        fChanged = StoreStats(stats);
+    }
+    if (fChanged) uiInterface.NotifyInfinitynodeStatsChanged();
+}
+
+bool CInfinitynodeMan::StoreStats(std::shared_ptr<Stats> stats)
+{
+    AssertLockHeld(cs_Stats);
+    for (auto& pair : stats->mapTiers) {
+        pair.second.nRoiDays = CalculateRoi(pair.first, pair.second.nCount, nStatsHeight);
+    }
+    if (*stats == *std::atomic_load(&statsSnapshot)) return false;
+    std::atomic_store(&statsSnapshot, StatsRef(stats));
+    return true;
+}
+
+bool CInfinitynodeMan::Schedule::GetPayee(int nBlockHeight, int nSinType, CInfinitynode& infinitynodeRet) const
+{
+    auto it = mapTiers.find(nSinType);
+    if (it == mapTiers.end()) return false;
+    const Tier& tier = it->second;
+    int nIndex = nBlockHeight - nTipHeight - 1;
+    if (nIndex < 0 || nIndex >= tier.nSize) return false;
+    infinitynodeRet = (*tier.vRanks)[nTipHeight - tier.nStatementHeight + nIndex];
+    return true;
+}
+
+void CInfinitynodeMan::UpdateStatementRanks()
+{
+    AssertLockHeld(cs);
+    LOCK(cs_Schedule);
+    for (int nSinType : {10, 5, 1}) {
+        std::pair<int, int> stm = getLastStatementBySinType(nSinType);
+        StatementRanks& ranks = mapStatementRanks[nSinType];
+        const CBlockIndex* pindexStm = pindexScheduleTip && stm.first > 0 ? pindexScheduleTip->GetAncestor(stm.first) : nullptr;
+        uint256 hashBlock = pindexStm ? pindexStm->GetBlockHash() : uint256();
+        if (ranks.nHeight == stm.first && ranks.nSize == stm.second && ranks.nListVersion == nListVersion && ranks.hashBlock == hashBlock) continue;
+
+        ranks.nHeight = stm.first;
+        ranks.nSize = stm.second;
+        ranks.nListVersion = nListVersion;
+        ranks.hashBlock = hashBlock;
+        std::shared_ptr<std::vector<CInfinitynode>> vPayees = std::make_shared<std::vector<CInfinitynode>>();
+        if (stm.first > 0) {
+            //ranks start at 1 and follow each other
+            for (auto& rank : calculInfinityNodeRank(stm.first, nSinType, false)) {
+                if (rank.first > stm.second) break;
+                vPayees->push_back(rank.second);
+            }
+        }
+        ranks.vPayees = vPayees;
+        LogPrint(BCLog::INFINITYNODE, "CInfinitynodeMan::UpdateStatementRanks -- SinType %d statement %d: %d payees\n",
+                    nSinType, stm.first, vPayees->size());
+    }
+    PublishSchedule(nCachedBlockHeight);
+}
+
+void CInfinitynodeMan::PublishSchedule(int nTipHeight)
+{
+    AssertLockHeld(cs_Schedule);
+    int nScheduleSize = gArgs.GetArg("-infinitynodeschedule", DEFAULT_INFINITYNODE_SCHEDULE_SIZE);
+    std::shared_ptr<Schedule> schedule = std::make_shared<Schedule>();
+    schedule->nTipHeight = nTipHeight;
+    for (auto& pair : mapStatementRanks) {
+        const StatementRanks& ranks = pair.second;
+        //tip is before the statement (reorg), the payees following the tip are not known
+        if (!ranks.vPayees || nTipHeight < ranks.nHeight) continue;
+        Schedule::Tier& tier = schedule->mapTiers[pair.first];
+        tier.vRanks = ranks.vPayees;
+        tier.nStatementHeight = ranks.nHeight;
+        tier.nSize = std::max(0, std::min((int)ranks.vPayees->size() - (nTipHeight - ranks.nHeight), nScheduleSize));
+    }
+    std::atomic_store(&scheduleSnapshot, ScheduleRef(schedule));
+}
+
 void CInfinitynodeMan::Clear()
 {
     LOCK(cs);
     mapInfinitynodes.clear();
-    mapLastPaid.clear();
+    ++nListVersion;
+    {
+        LOCK(cs_LastPaid);
+        mapLastPaid.clear();
+        mapLastPaidUndo.clear();
+        nLastPaidHeight = 0;
+        hashLastPaidBlock.SetNull();
+    }
     nLastScanHeight = 0;
+    PublishSnapshot();
 }
 
 bool CInfinitynodeMan::Add(CInfinitynode &inf)
@@ -55,20 +207,7 @@ bool CInfinitynodeMan::Add(CInfinitynode &inf)
     LOCK(cs);
     if (Has(inf.vinBurnFund.prevout)) return false;
     mapInfinitynodes[inf.vinBurnFund.prevout] = inf;
-    return true;
-}
-
-bool CInfinitynodeMan::AddUpdateLastPaid(CScript scriptPubKey, int nHeightLastPaid)
-{
-    LOCK(cs_LastPaid);
-    auto it = mapLastPaid.find(scriptPubKey);
-    if (it != mapLastPaid.end()) {
-        if (mapLastPaid[scriptPubKey] < nHeightLastPaid) {
-            mapLastPaid[scriptPubKey] = nHeightLastPaid;
-        }
-        return true;
-    }
-    mapLastPaid[scriptPubKey] = nHeightLastPaid;
+    ++nListVersion;
     return true;
 }
 
@@ -123,6 +262,39 @@ std::string CInfinitynodeMan::ToString() const
 void CInfinitynodeMan::UpdatedBlockTip(const CBlockIndex *pindex)
 {
     nCachedBlockHeight = pindex->nHeight;
+    bool fStale = false;
+    {
+        LOCK(cs_Schedule);
+        pindexScheduleTip = pindex;
+        for (auto& pair : mapStatementRanks) {
+            StatementRanks& ranks = pair.second;
+            //no statement yet, nothing ranked
+            if (!ranks.vPayees || ranks.nHeight <= 0) continue;
+            const CBlockIndex* pindexStm = pindex->GetAncestor(ranks.nHeight);
+            if (pindexStm && pindexStm->GetBlockHash() == ranks.hashBlock) continue;
+            //the statement block was reorganized away, nobody reads these ranks until they are computed again
+            ranks.vPayees.reset();
+            fStale = true;
+        }
+        PublishSchedule(pindex->nHeight);
+    }
+    if (fStale) {
+        //a list build in progress ranks again when it is done
+        TRY_LOCK(cs, lockList);
+        if (lockList) UpdateStatementRanks();
+    }
+    // the reward, and so the ROIs, follow the tip
+    bool fStatsChanged;
+    {
+        LOCK(cs_Stats);
+        nStatsHeight = pindex->nHeight;
+        fStatsChanged = StoreStats(std::make_shared<Stats>(*std::atomic_load(&statsSnapshot)));
+    }
+    if (fStatsChanged) uiInterface.NotifyInfinitynodeStatsChanged();
+    {
+        LOCK(cs_LastPaid);
+        PruneLastPaid();
+    }
     if(fMasterNode) {
         // normal wallet does not need to update this every block, doing update on rpc call should be enough
         /* QSTEES::TODO - update last paid for all infinitynode */
@@ -135,7 +307,7 @@ void CInfinitynodeMan::CheckAndRemove(CConnman& connman)
     /*this function is called in InfinityNode thread and after sync of node*/
     LOCK(cs);
 
-    LogPrintf("CInfinitynodeMan::CheckAndRemove -- at Height: %d, last build height: %d nodes\n", nCachedBlockHeight, nLastScanHeight);
+    LogPrint(BCLog::INFINITYNODE, "CInfinitynodeMan::CheckAndRemove -- at Height: %d, last build height: %d nodes\n", nCachedBlockHeight, nLastScanHeight);
     //first scan -- normaly, list is built in init.cpp
     if (nLastScanHeight == 0 && nCachedBlockHeight > Params().GetConsensus().nInfinityNodeBeginHeight) {
         buildInfinitynodeList(nCachedBlockHeight, Params().GetConsensus().nInfinityNodeBeginHeight);
@@ -165,18 +337,26 @@ void CInfinitynodeMan::CheckAndRemove(CConnman& connman)
         calculInfinityNodeRank(nLILLastStmHeight, 1, true);
     }
 
+    PublishSnapshot();
     return;
 }
 
 int CInfinitynodeMan::getRoi(int nSinType, int totalNode)
 {
      LOCK(cs);
+     return CalculateRoi(nSinType, totalNode, nCachedBlockHeight);
+}
+
+int CInfinitynodeMan::CalculateRoi(int nSinType, int totalNode, int nHeight)
+{
      int nBurnAmount = 0;
      if (nSinType == 10) nBurnAmount = Params().GetConsensus().nMasternodeBurnQSTEESNODE_10;
      if (nSinType == 5) nBurnAmount = Params().GetConsensus().nMasternodeBurnQSTEESNODE_5;
      if (nSinType == 1) nBurnAmount = Params().GetConsensus().nMasternodeBurnQSTEESNODE_1;
 
-     float nReward = GetMasternodePayment(nCachedBlockHeight, nSinType) / COIN;
+     float nReward = GetMasternodePayment(nHeight, nSinType) / COIN;
+     // an empty tier, or no reward yet (e.g. before the first tip), has no ROI
+     if (totalNode <= 0 || nReward <= 0) return 0;
      float roi = nBurnAmount / ((720 / (float)totalNode) * nReward) ;
      return (int) roi;
 }
@@ -202,20 +382,174 @@ bool CInfinitynodeMan::updateInfinitynodeList(int nBlockHeight)
     return buildInfinitynodeList(nBlockHeight, nLastScanHeight);
 }
 
+/** New node or metadata update found in a block, the owner is resolved when applied */
+struct CInfinitynodeBlockEvent
+{
+    bool fMetadata = false;
+    CInfinitynode inf;
+    std::string nodeAddress;
+    CService service;
+    COutPoint prevoutBurnFund;
+};
+
+/** What one block changes in the list, in the order of its outputs */
+struct CInfinitynodeBlockData
+{
+    std::vector<CInfinitynodeBlockEvent> vEvents;
+};
+
+/**
+ * Find burn and metadata outputs of a block.
+ * Does not touch any shared state, it runs on the block scanner threads.
+ */
+static void ExtractInfinitynodeBlockData(const CBlock& block, int nHeight, CInfinitynodeBlockData& data)
+{
+    for (const CTransactionRef& tx : block.vtx) {
+        //Not coinbase
+        if (!tx->IsCoinBase()) {
+            for (unsigned int i = 0; i < tx->vout.size(); i++) {
+                const CTxOut& out = tx->vout[i];
+                std::vector<std::vector<unsigned char>> vSolutions;
+                txnouttype whichType;
+                const CScript& prevScript = out.scriptPubKey;
+                Solver(prevScript, whichType, vSolutions);
+                //Send to BurnAddress
+                if (whichType == TX_BURN_DATA && Params().GetConsensus().cBurnAddress == EncodeDestination(CKeyID(uint160(vSolutions[0]))))
+                {
+                    //Amount for InfnityNode
+                    if (
+                    ((Params().GetConsensus().nMasternodeBurnQSTEESNODE_1 - 1) * COIN < out.nValue && out.nValue <= Params().GetConsensus().nMasternodeBurnQSTEESNODE_1 * COIN) ||
+                    ((Params().GetConsensus().nMasternodeBurnQSTEESNODE_5 - 1) * COIN < out.nValue && out.nValue <= Params().GetConsensus().nMasternodeBurnQSTEESNODE_5 * COIN) ||
+                    ((Params().GetConsensus().nMasternodeBurnQSTEESNODE_10 - 1) * COIN < out.nValue && out.nValue <= Params().GetConsensus().nMasternodeBurnQSTEESNODE_10 * COIN)
+                    ) {
+                        COutPoint outpoint(tx->GetHash(), i);
+                        CInfinitynodeBlockEvent event;
+                        event.inf = CInfinitynode(PROTOCOL_VERSION, outpoint);
+                        event.inf.setHeight(nHeight);
+                        event.inf.setBurnValue(out.nValue);
+                        event.inf.setScriptPublicKey(prevScript);
+                        if (vSolutions.size() == 2){
+                            std::string backupAddress(vSolutions[1].begin(), vSolutions[1].end());
+                            CTxDestination NodeAddress = DecodeDestination(backupAddress);
+                            if (IsValidDestination(NodeAddress)) {
+                                event.inf.setBackupAddress(backupAddress);
+                            }
+                        }
+                        //QSTEESType
+                        CAmount nBurnAmount = out.nValue / COIN + 1; //automaticaly round
+                        event.inf.setQSTEESType(nBurnAmount / 100000);
+                        //Address payee: we known that there is only 1 input
+                        event.prevoutBurnFund = tx->vin[0].prevout;
+                        data.vEvents.push_back(event);
+                    }
+                }
+                //Amount to update Metadata
+                if (whichType == TX_BURN_DATA && Params().GetConsensus().cMetadataAddress == EncodeDestination(CKeyID(uint160(vSolutions[0]))))
+                {
+                    //Amount for UpdateMeta
+                    if (( Params().GetConsensus().nMasternodeBurnQSTEESNODE_1 - 1) * COIN < out.nValue
+                        && out.nValue <= Params().GetConsensus().nMasternodeBurnQSTEESNODE_1 * COIN){
+                        if (vSolutions.size() == 2){
+                            std::string metadata(vSolutions[1].begin(), vSolutions[1].end());
+                            string s;
+                            stringstream ss(metadata);
+                            int i=0;
+                            int check=0;
+                            while (getline(ss, s,' ')) {
+                                CTxDestination NodeAddress;
+                                CService service;
+                                //1st position: Node Address
+                                if (i==0) {
+                                    NodeAddress = DecodeDestination(s);
+                                    if (IsValidDestination(NodeAddress)) {check++;}
+                                }
+                                //2nd position: Node IP
+                                if (i==1 && Lookup(s.c_str(), service, 0, false)) {check++;}
+
+                                //Update node metadata if nHeight is bigger
+                                if (check == 2){
+                                    CInfinitynodeBlockEvent event;
+                                    event.fMetadata = true;
+                                    event.nodeAddress = EncodeDestination(NodeAddress);
+                                    event.service = service;
+                                    event.prevoutBurnFund = tx->vin[0].prevout;
+                                    data.vEvents.push_back(event);
+                                }
+                                i++;
+                            }
+                        }
+                    }
+                }
+            } //end loop for all output
+        }
+    }
+}
+
+/** Payees of the Infinity Nodes paid by the coinbase of a block at nHeight */
+static void FindPaidPayees(const CBlock& block, int nHeight, std::vector<CScript>& vPayeesRet)
+{
+    if (block.vtx.empty() || !block.vtx[0]->IsCoinBase()) return;
+    //no infinitynode is paid before the beginning, except in testnet where the list starts at block 1
+    if (nHeight < Params().GetConsensus().nInfinityNodeBeginHeight && Params().NetworkIDString() != CBaseChainParams::TESTNET) return;
+    //block payment value
+    CAmount nNodePaymentQSTEESNODE_1 = GetMasternodePayment(nHeight, 1);
+    CAmount nNodePaymentQSTEESNODE_5 = GetMasternodePayment(nHeight, 5);
+    CAmount nNodePaymentQSTEESNODE_10 = GetMasternodePayment(nHeight, 10);
+    for (const CTxOut& txout : block.vtx[0]->vout)
+    {
+        if (txout.nValue == nNodePaymentQSTEESNODE_1 || txout.nValue == nNodePaymentQSTEESNODE_5 ||
+            txout.nValue == nNodePaymentQSTEESNODE_10)
+        {
+            vPayeesRet.push_back(txout.scriptPubKey);
+        }
+    }
+}
+
+/** Number of blocks behind the tip in which every node in rotation was paid at least once */
+static int GetLastPaidScanDepth(int nHeight)
+{
+    int nLastPaidScanDeepth = max(Params().GetConsensus().nLimitQSTEESNODE_1, max(Params().GetConsensus().nLimitQSTEESNODE_5, Params().GetConsensus().nLimitQSTEESNODE_10));
+    //at fork heigh, scan limit will change to 800 - each tier of QSTEES network will never go to this limit
+    if (nHeight >= 350000){nLastPaidScanDeepth=800;}
+    //at begin of network
+    if (nLastPaidScanDeepth > nHeight) {nLastPaidScanDeepth = nHeight - 1;}
+    return nLastPaidScanDeepth;
+}
+
+/** Address which funded a burn transaction, from the output spent by its first input */
+static bool GetBurnFundOwner(const COutPoint& prevout, std::string& strOwnerRet)
+{
+    CTransactionRef prevtx;
+    uint256 hashblock;
+    if(!GetTransaction(prevout.hash, prevtx, Params().GetConsensus(), hashblock, false)) {
+        LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- PrevBurnFund tx is not in block.\n");
+        return false;
+    }
+
+    CTxDestination addressBurnFund;
+    if(!ExtractDestination(prevtx->vout[prevout.n].scriptPubKey, addressBurnFund)){
+        LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- False when extract payee from BurnFund tx.\n");
+        return false;
+    }
+    strOwnerRet = EncodeDestination(addressBurnFund);
+    return true;
+}
+
 bool CInfinitynodeMan::buildInfinitynodeList(int nBlockHeight, int nLowHeight)
 {
     if(nBlockHeight < Params().GetConsensus().nInfinityNodeBeginHeight){
         Clear();
-        infnodersv.Clear();
         return true;
     }
     AssertLockHeld(cs);
     mapInfinitynodesNonMatured.clear();
 
     //first run, make sure that all variable is clear
+    //readers keep the previous snapshot until the new list is complete
     if (nLowHeight == Params().GetConsensus().nInfinityNodeBeginHeight){
-        Clear();
-        infnodersv.Clear();
+        mapInfinitynodes.clear();
+        ++nListVersion;
+        nLastScanHeight = 0;
         //first run in testnet, scan to block number 1
         if (Params().NetworkIDString() == CBaseChainParams::TESTNET) {nLowHeight = 1;}
     } else {
@@ -230,234 +564,50 @@ bool CInfinitynodeMan::buildInfinitynodeList(int nBlockHeight, int nLowHeight)
 
     CBlockIndex* pindex;
     pindex = LookupBlockIndex(blockHash);
-    CBlockIndex* prevBlockIndex = pindex;
-
-    int nLastPaidScanDeepth = max(Params().GetConsensus().nLimitQSTEESNODE_1, max(Params().GetConsensus().nLimitQSTEESNODE_5, Params().GetConsensus().nLimitQSTEESNODE_10));
-    //at fork heigh, scan limit will change to 800 - each tier of QSTEES network will never go to this limit
-    if (nBlockHeight >= 350000){nLastPaidScanDeepth=800;}
-    //at begin of network
-    if (nLastPaidScanDeepth > nBlockHeight) {nLastPaidScanDeepth = nBlockHeight - 1;}
-
-    while (prevBlockIndex->nHeight >= nLowHeight)
-    {
-        CBlock blockReadFromDisk;
-        if (ReadBlockFromDisk(blockReadFromDisk, prevBlockIndex, Params().GetConsensus()))
-        {
-LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- read block number: %d, end at: %d.\n", prevBlockIndex->nHeight, nLowHeight);
-            for (const CTransactionRef& tx : blockReadFromDisk.vtx) {
-                //Not coinbase
-                if (!tx->IsCoinBase()) {
-                    for (unsigned int i = 0; i < tx->vout.size(); i++) {
-                        const CTxOut& out = tx->vout[i];
-                        std::vector<std::vector<unsigned char>> vSolutions;
-                        txnouttype whichType;
-                        const CScript& prevScript = out.scriptPubKey;
-                        Solver(prevScript, whichType, vSolutions);
-                        //Send to BurnAddress
-                        if (whichType == TX_BURN_DATA && Params().GetConsensus().cBurnAddress == EncodeDestination(CKeyID(uint160(vSolutions[0]))))
-                        {
-                            //Amount for InfnityNode
-                            if (
-                            ((Params().GetConsensus().nMasternodeBurnQSTEESNODE_1 - 1) * COIN < out.nValue && out.nValue <= Params().GetConsensus().nMasternodeBurnQSTEESNODE_1 * COIN) ||
-                            ((Params().GetConsensus().nMasternodeBurnQSTEESNODE_5 - 1) * COIN < out.nValue && out.nValue <= Params().GetConsensus().nMasternodeBurnQSTEESNODE_5 * COIN) ||
-                            ((Params().GetConsensus().nMasternodeBurnQSTEESNODE_10 - 1) * COIN < out.nValue && out.nValue <= Params().GetConsensus().nMasternodeBurnQSTEESNODE_10 * COIN)
-                            ) {
-                                COutPoint outpoint(tx->GetHash(), i);
-                                CInfinitynode inf(PROTOCOL_VERSION, outpoint);
-                                inf.setHeight(prevBlockIndex->nHeight);
-                                inf.setBurnValue(out.nValue);
-                                inf.setScriptPublicKey(prevScript);
-                                if (vSolutions.size() == 2){
-                                    std::string backupAddress(vSolutions[1].begin(), vSolutions[1].end());
-                                    CTxDestination NodeAddress = DecodeDestination(backupAddress);
-                                    if (IsValidDestination(NodeAddress)) {
-                                        inf.setBackupAddress(backupAddress);
-                                    }
-                                }
-                                //QSTEESType
-                                CAmount nBurnAmount = out.nValue / COIN + 1; //automaticaly round
-                                inf.setQSTEESType(nBurnAmount / 100000);
-                                //Address payee: we known that there is only 1 input
-                                const CTxIn& txin = tx->vin[0];
-                                int index = txin.prevout.n;
-
-                                CTransactionRef prevtx;
-                                uint256 hashblock;
-                                if(!GetTransaction(txin.prevout.hash, prevtx, Params().GetConsensus(), hashblock, false)) {
-                                    LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- PrevBurnFund tx is not in block.\n");
-                                    return false;
-                                }
 
-                                CTxDestination addressBurnFund;
-                                if(!ExtractDestination(prevtx->vout[index].scriptPubKey, addressBurnFund)){
-                                    LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- False when extract payee from BurnFund tx.\n");
-                                    return false;
-                                }
-                                inf.setCollateralAddress(EncodeDestination(addressBurnFund));
-                                //we have all infos. Then add in map
-                                if(prevBlockIndex->nHeight < pindex->nHeight - INF_MATURED_LIMIT) {
-                                    //matured
-                                    Add(inf);
-                                } else {
-                                    //non matured
-                                    mapInfinitynodesNonMatured[inf.vinBurnFund.prevout] = inf;
-                                }
-                            }
-                            //Amount for vote
-                            if (out.nValue == Params().GetConsensus().nInfinityNodeVoteValue * COIN){
-                                if (vSolutions.size() == 2){
-                                    std::string voteOpinion(vSolutions[1].begin(), vSolutions[1].end());
-                                    if(voteOpinion.length() == 9){
-                                        std::string proposalID = voteOpinion.substr(0, 8);
-                                        bool opinion = false;
-                                        if( voteOpinion.substr(8, 1) == "1" ){opinion = true;}
-                                        //Address payee: we known that there is only 1 input
-                                        const CTxIn& txin = tx->vin[0];
-                                        int index = txin.prevout.n;
-
-                                        CTransactionRef prevtx;
-                                        uint256 hashblock;
-                                        if(!GetTransaction(txin.prevout.hash, prevtx, Params().GetConsensus(), hashblock, false)) {
-                                            LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- PrevBurnFund tx is not in block.\n");
-                                            return false;
-                                        }
-
-                                        CTxDestination addressBurnFund;
-                                        if(!ExtractDestination(prevtx->vout[index].scriptPubKey, addressBurnFund)){
-                                            LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- False when extract payee from BurnFund tx.\n");
-                                            return false;
-                                        }
-
-                                        CVote vote = CVote(proposalID, prevtx->vout[index].scriptPubKey, prevBlockIndex->nHeight, opinion);
-                                        infnodersv.Add(vote);
-                                    }
-                                }
-                            }
-                        }
-                        //Governance Vote Address
-                        if (whichType == TX_BURN_DATA && Params().GetConsensus().cGovernanceAddress == EncodeDestination(CKeyID(uint160(vSolutions[0]))))
-                        {
-                            //Amount for vote
-                            if (out.nValue == Params().GetConsensus().nInfinityNodeVoteValue * COIN){
-                                if (vSolutions.size() == 2){
-                                    std::string voteOpinion(vSolutions[1].begin(), vSolutions[1].end());
-                                    LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- Extract vote at height: %d.\n", prevBlockIndex->nHeight);
-                                    if(voteOpinion.length() == 9){
-                                        std::string proposalID = voteOpinion.substr(0, 8);
-                                        bool opinion = false;
-                                        if( voteOpinion.substr(8, 1) == "1" ){opinion = true;}
-                                        //Address payee: we known that there is only 1 input
-                                        const CTxIn& txin = tx->vin[0];
-                                        int index = txin.prevout.n;
-
-                                        CTransactionRef prevtx;
-                                        uint256 hashblock;
-                                        if(!GetTransaction(txin.prevout.hash, prevtx, Params().GetConsensus(), hashblock, false)) {
-                                            LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- PrevBurnFund tx is not in block.\n");
-                                            return false;
-                                        }
-                                        CTxDestination addressBurnFund;
-                                        if(!ExtractDestination(prevtx->vout[index].scriptPubKey, addressBurnFund)){
-                                            LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- False when extract payee from BurnFund tx.\n");
-                                            return false;
-                                        }
-                                        //we have all infos. Then add in map
-                                        if(prevBlockIndex->nHeight < pindex->nHeight - INF_MATURED_LIMIT) {
-                                            //matured
-	                                        LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- Voter: %s, proposal: %s.\n", EncodeDestination(addressBurnFund), voteOpinion);
-                                            CVote vote = CVote(proposalID, prevtx->vout[index].scriptPubKey, prevBlockIndex->nHeight, opinion);
-                                            infnodersv.Add(vote);
-                                        } else {
-                                            //non matured
-                                            LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- Non matured vote.\n");
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                        //Amount to update Metadata
-                        if (whichType == TX_BURN_DATA && Params().GetConsensus().cMetadataAddress == EncodeDestination(CKeyID(uint160(vSolutions[0]))))
-                        {
-                            //Amount for UpdateMeta
-                            if (( Params().GetConsensus().nMasternodeBurnQSTEESNODE_1 - 1) * COIN < out.nValue 
-                                && out.nValue <= Params().GetConsensus().nMasternodeBurnQSTEESNODE_1 * COIN){
-                                if (vSolutions.size() == 2){
-                                    std::string metadata(vSolutions[1].begin(), vSolutions[1].end());
-                                    string s;
-                                    stringstream ss(metadata);
-                                    int i=0;
-                                    int check=0;
-                                    while (getline(ss, s,' ')) {
-                                        CTxDestination NodeAddress;
-                                        CService service;
-                                        //1st position: Node Address
-                                        if (i==0) {
-                                            NodeAddress = DecodeDestination(s);
-                                            if (IsValidDestination(NodeAddress)) {check++;}
-                                        }
-                                        //2nd position: Node IP
-                                        if (i==1 && Lookup(s.c_str(), service, 0, false)) {check++;}
-
-                                        //Update node metadata if nHeight is bigger
-                                        if (check == 2){
-                                            //prevBlockIndex->nHeight
-                                            const CTxIn& txin = tx->vin[0];
-                                            int index = txin.prevout.n;
-
-                                            CTransactionRef prevtx;
-                                            uint256 hashblock;
-                                            if(!GetTransaction(txin.prevout.hash, prevtx, Params().GetConsensus(), hashblock, false)) {
-                                                LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- PrevBurnFund tx is not in block.\n");
-                                                return false;
-                                            }
-
-                                            CTxDestination addressBurnFund;
-                                            if(!ExtractDestination(prevtx->vout[index].scriptPubKey, addressBurnFund)){
-                                                LogPrintf("CInfinitynodeMan::updateInfinityNodeInfo -- False when extract payee from BurnFund tx.\n");
-                                                return false;
-                                            }
-                                            updateMetadata(EncodeDestination(addressBurnFund), EncodeDestination(NodeAddress), service, prevBlockIndex->nHeight);
-                                        }
-                                        i++;
-                                    }
-                                }
-                            }
-                        }
-                    } //end loop for all output
-                } else { //Coinbase tx => update mapLastPaid
-                    if (prevBlockIndex->nHeight >= pindex->nHeight - nLastPaidScanDeepth){
-                        //block payment value
-                        CAmount nNodePaymentQSTEESNODE_1 = GetMasternodePayment(prevBlockIndex->nHeight, 1);
-                        CAmount nNodePaymentQSTEESNODE_5 = GetMasternodePayment(prevBlockIndex->nHeight, 5);
-                        CAmount nNodePaymentQSTEESNODE_10 = GetMasternodePayment(prevBlockIndex->nHeight, 10);
-                        //compare and update map
-                        for (auto txout : blockReadFromDisk.vtx[0]->vout)
-                        {
-                            if (txout.nValue == nNodePaymentQSTEESNODE_1 || txout.nValue == nNodePaymentQSTEESNODE_5 ||
-                                txout.nValue == nNodePaymentQSTEESNODE_10)
-                            {
-                                AddUpdateLastPaid(txout.scriptPubKey, prevBlockIndex->nHeight);
-                            }
-                        }
-                    }
+    //blocks are read and parsed on several threads, then applied here from the newest to the oldest
+    int64_t nStart = GetTimeMillis();
+    CBlockScanner<CInfinitynodeBlockData> scanner(pindex, nLowHeight, true);
+    bool fScanned = scanner.Run(
+        [&](const CBlock& block, const CBlockIndex* pindexBlock, CInfinitynodeBlockData& data) {
+            ExtractInfinitynodeBlockData(block, pindexBlock->nHeight, data);
+            return true;
+        },
+        [&](const CBlockIndex* pindexBlock, CInfinitynodeBlockData& data) {
+            for (CInfinitynodeBlockEvent& event : data.vEvents) {
+                std::string strOwner;
+                if (!GetBurnFundOwner(event.prevoutBurnFund, strOwner)) return false;
+                if (event.fMetadata) {
+                    updateMetadata(strOwner, event.nodeAddress, event.service, pindexBlock->nHeight);
+                    continue;
+                }
+                event.inf.setCollateralAddress(strOwner);
+                //we have all infos. Then add in map
+                if(pindexBlock->nHeight < pindex->nHeight - INF_MATURED_LIMIT) {
+                    //matured
+                    Add(event.inf);
+                } else {
+                    //non matured
+                    mapInfinitynodesNonMatured[event.inf.vinBurnFund.prevout] = event.inf;
                 }
             }
-        } else {
-            LogPrint(BCLog::INFINITYNODE, "CInfinitynodeMan::buildInfinitynodeList -- can not read block from disk\n");
-            return false;
-        }
-        // continue with previous block
-        prevBlockIndex = prevBlockIndex->pprev;
+            return true;
+        });
+    if (!fScanned) {
+        LogPrint(BCLog::INFINITYNODE, "CInfinitynodeMan::buildInfinitynodeList -- scan from %d to %d failed\n", nBlockHeight, nLowHeight);
+        return false;
     }
+    LogPrintf("CInfinitynodeMan::buildInfinitynodeList -- scanned %d blocks in %dms\n", nBlockHeight - nLowHeight + 1, GetTimeMillis() - nStart);
 
     nLastScanHeight = nBlockHeight - INF_MATURED_LIMIT;
     updateLastPaid();
+    PublishSnapshot();
 
     CFlatDB<CInfinitynodeMan> flatdb5("infinitynode.dat", "magicInfinityNodeCache");
-    flatdb5.Dump(infnodeman);
+    flatdb5.DumpAsync(infnodeman);
 
     CFlatDB<CInfinitynodersv> flatdb6("infinitynodersv.dat", "magicInfinityRSV");
-    flatdb6.Dump(infnodersv);
+    flatdb6.DumpAsync(infnodersv);
 
     LogPrintf("CInfinitynodeMan::buildInfinitynodeList -- list infinity node was built from blockchain at Height: %s\n", nBlockHeight);
     return true;
@@ -486,6 +636,156 @@ bool CInfinitynodeMan::GetInfinitynodeInfo(const COutPoint& outpoint, infinityno
     return true;
 }
 
+void CInfinitynodeMan::ConnectLastPaid(const std::vector<CScript>& vPayees, const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_LastPaid);
+    std::vector<std::pair<CScript, int>> vUndo;
+    for (const CScript& payee : vPayees) {
+        auto it = mapLastPaid.find(payee);
+        vUndo.emplace_back(payee, it == mapLastPaid.end() ? 0 : it->second);
+        mapLastPaid[payee] = pindex->nHeight;
+    }
+    mapLastPaidUndo[pindex->nHeight] = std::make_pair(pindex->GetBlockHash(), std::move(vUndo));
+    mapLastPaidUndo.erase(mapLastPaidUndo.begin(), mapLastPaidUndo.lower_bound(pindex->nHeight - INFINITYNODE_LASTPAID_UNDO_DEPTH));
+    nLastPaidHeight = pindex->nHeight;
+    hashLastPaidBlock = pindex->GetBlockHash();
+}
+
+void CInfinitynodeMan::PruneLastPaid()
+{
+    AssertLockHeld(cs_LastPaid);
+    int nLowHeight = nLastPaidHeight - GetLastPaidScanDepth(nLastPaidHeight);
+    for (auto it = mapLastPaid.begin(); it != mapLastPaid.end();) {
+        if (it->second < nLowHeight) it = mapLastPaid.erase(it);
+        else ++it;
+    }
+}
+
+/**
+ * Bring mapLastPaid to pindex, reading the missing blocks from disk. Start again from
+ * the last paid scan depth when the last applied block is not an ancestor of pindex
+ * or is older than that depth. The blocks are listed under cs_main and read without
+ * cs_LastPaid, their payees are then applied unless a block was connected meanwhile.
+ */
+bool CInfinitynodeMan::CatchUpLastPaid(const CBlockIndex* pindex)
+{
+    if (pindex == nullptr) return true;
+    while (true) {
+        int nLowHeight = std::max(1, pindex->nHeight - GetLastPaidScanDepth(pindex->nHeight));
+        bool fRebuild;
+        uint256 hashFrom;
+        {
+            LOCK(cs_LastPaid);
+            if (pindex->GetBlockHash() == hashLastPaidBlock) return true;
+            const CBlockIndex* pindexLast = nLastPaidHeight > 0 ? pindex->GetAncestor(nLastPaidHeight) : nullptr;
+            fRebuild = pindexLast == nullptr || pindexLast->GetBlockHash() != hashLastPaidBlock || nLastPaidHeight < nLowHeight;
+            if (fRebuild && nLastPaidHeight > 0) {
+                LogPrint(BCLog::INFINITYNODE, "CInfinitynodeMan::CatchUpLastPaid -- last paid block %s is not in chain or too old, rebuild\n", hashLastPaidBlock.ToString());
+            }
+            if (!fRebuild) nLowHeight = nLastPaidHeight + 1;
+            hashFrom = hashLastPaidBlock;
+        }
+
+        //blocks are read and parsed on several threads, payees are collected here in height order
+        std::vector<std::pair<const CBlockIndex*, std::vector<CScript>>> vPaid;
+        CBlockScanner<std::vector<CScript>> scanner(pindex, nLowHeight, false);
+        bool fScanned = scanner.Run(
+            [](const CBlock& block, const CBlockIndex* pindexBlock, std::vector<CScript>& vPayees) {
+                FindPaidPayees(block, pindexBlock->nHeight, vPayees);
+                return true;
+            },
+            [&vPaid](const CBlockIndex* pindexBlock, std::vector<CScript>& vPayees) {
+                vPaid.emplace_back(pindexBlock, std::move(vPayees));
+                return true;
+            });
+
+        LOCK(cs_LastPaid);
+        if (hashLastPaidBlock != hashFrom) continue;
+        if (fRebuild) {
+            mapLastPaid.clear();
+            mapLastPaidUndo.clear();
+            nLastPaidHeight = 0;
+            hashLastPaidBlock.SetNull();
+        }
+        for (const auto& pair : vPaid) ConnectLastPaid(pair.second, pair.first);
+        PruneLastPaid();
+        return fScanned;
+    }
+}
+
+void CInfinitynodeMan::ScheduleCatchUpLastPaid()
+{
+    auto job = [this] {
+        const CBlockIndex* pindex;
+        {
+            LOCK(cs_LastPaid);
+            pindex = pindexLastPaidTip;
+            fLastPaidCatchUpScheduled = false;
+        }
+        if (!CatchUpLastPaid(pindex)) return;
+        TRY_LOCK(cs, lockList);
+        if (lockList) {
+            updateLastPaid();
+            PublishSnapshot();
+        }
+    };
+    // without the job threads (lite mode, or before they start) on this thread, still without holding cs_LastPaid
+    if (!mnjobs.Schedule("infinitynodelastpaid", job)) job();
+}
+
+void CInfinitynodeMan::BlockConnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    bool fCatchUp = false;
+    {
+        LOCK(cs_LastPaid);
+        pindexLastPaidTip = pindex;
+        if (pindex->pprev != nullptr && pindex->pprev->GetBlockHash() != hashLastPaidBlock) {
+            //blocks are missing, a catch up reads them with this one
+            if (fLastPaidCatchUpScheduled) return;
+            fLastPaidCatchUpScheduled = fCatchUp = true;
+        } else {
+            std::vector<CScript> vPayees;
+            FindPaidPayees(block, pindex->nHeight, vPayees);
+            ConnectLastPaid(vPayees, pindex);
+        }
+    }
+    if (fCatchUp) {
+        ScheduleCatchUpLastPaid();
+        return;
+    }
+    //a list build in progress publishes the new last paid when it is done
+    TRY_LOCK(cs, lockList);
+    if (lockList) {
+        updateLastPaid();
+        PublishSnapshot();
+    }
+}
+
+void CInfinitynodeMan::BlockDisconnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    LOCK(cs_LastPaid);
+    if (pindex == nullptr) return;
+    pindexLastPaidTip = pindex->pprev;
+    if (block.GetHash() != hashLastPaidBlock) return;
+
+    auto it = mapLastPaidUndo.find(pindex->nHeight);
+    if (it == mapLastPaidUndo.end() || it->second.first != hashLastPaidBlock) {
+        //undo data is gone, next connected block will rebuild
+        LogPrintf("CInfinitynodeMan::BlockDisconnected -- no last paid undo data at height %d\n", pindex->nHeight);
+        nLastPaidHeight = 0;
+        hashLastPaidBlock.SetNull();
+        return;
+    }
+    const std::vector<std::pair<CScript, int>>& vUndo = it->second.second;
+    for (auto itUndo = vUndo.rbegin(); itUndo != vUndo.rend(); ++itUndo) {
+        if (itUndo->second == 0) mapLastPaid.erase(itUndo->first);
+        else mapLastPaid[itUndo->first] = itUndo->second;
+    }
+    mapLastPaidUndo.erase(it);
+    nLastPaidHeight = pindex->nHeight - 1;
+    hashLastPaidBlock = block.hashPrevBlock;
+}
+
 void CInfinitynodeMan::updateMetadata(std::string nodeowner, std::string nodeAddress, CService nodeService, int nHeightUpdate)
 {
     AssertLockHeld(cs);
@@ -507,22 +807,23 @@ void CInfinitynodeMan::updateLastPaid()
     if (mapInfinitynodes.empty())
         return;
 
+    LOCK(cs_LastPaid);
     for (auto& infpair : mapInfinitynodes) {
         auto it = mapLastPaid.find(infpair.second.getScriptPublicKey());
         if (it != mapLastPaid.end()) {
-            infpair.second.setLastRewardHeight(mapLastPaid[infpair.second.getScriptPublicKey()]);
+            infpair.second.setLastRewardHeight(it->second);
         }
     }
 }
 
 bool CInfinitynodeMan::deterministicRewardStatement(int nSinType)
 {
+    LOCK(cs);
     int stm_height_temp = Params().GetConsensus().nInfinityNodeGenesisStatement;
     if (nSinType == 10) mapStatementBIG.clear();
     if (nSinType == 5) mapStatementMID.clear();
     if (nSinType == 1) mapStatementLIL.clear();
 
-    LOCK(cs);
     while (stm_height_temp < nCachedBlockHeight)
     {
         std::map<COutPoint, CInfinitynode> mapInfinitynodesCopy;
@@ -562,6 +863,7 @@ bool CInfinitynodeMan::deterministicRewardStatement(int nSinType)
         //loop
         stm_height_temp = stm_height_temp + totalSinType;
     }
+    PublishSnapshot();
     return true;
 }
 
@@ -599,7 +901,7 @@ std::map<int, CInfinitynode> CInfinitynodeMan::calculInfinityNodeRank(int nBlock
     for (auto& infpair : mapInfinitynodes) {
         CInfinitynode inf = infpair.second;
         //reinitial Rank to 0 all nodes of nSinType
-        if (inf.getQSTEESType() == nSinType) infpair.second.setRank(0);
+        if (updateList && inf.getQSTEESType() == nSinType) infpair.second.setRank(0);
         //put valid node in vector
         if (inf.getQSTEESType() == nSinType && inf.getExpireHeight() >= nBlockHeight && inf.getHeight() < nBlockHeight)
         {
@@ -630,13 +932,18 @@ void CInfinitynodeMan::calculAllInfinityNodesRankAtLastStm()
         calculInfinityNodeRank(nBIGLastStmHeight, 10, true);
         calculInfinityNodeRank(nMIDLastStmHeight, 5, true);
         calculInfinityNodeRank(nLILLastStmHeight, 1, true);
+        PublishSnapshot();
 }
 
 bool CInfinitynodeMan::deterministicRewardAtHeight(int nBlockHeight, int nSinType, CInfinitynode& infinitynodeRet)
 {
     assert(nBlockHeight >= Params().GetConsensus().nInfinityNodeGenesisStatement);
-    //step1: copy mapStatement for nSinType
-    std::map<int, int> mapStatementSinType = getStatementMap(nSinType);
+    //upcoming payees are already ranked
+    if (GetSchedule()->GetPayee(nBlockHeight, nSinType, infinitynodeRet)) return true;
+
+    //step1: take mapStatement for nSinType from the published state
+    StateRef state = GetSnapshot();
+    const std::map<int, int>& mapStatementSinType = state->getStatementMap(nSinType);
 
     LOCK(cs);
     //step2: find last Statement for nBlockHeight;
@@ -657,3 +964,36 @@ bool CInfinitynodeMan::deterministicRewardAtHeight(int nBlockHeight, int nSinTyp
     infinitynodeRet = rankOfStatement[nBlockHeight - lastStatement];
     return true;
 }
+
+std::map<int, CInfinitynode> CInfinitynodeMan::getScheduleForRange(int nFromHeight, int nToHeight, int nSinType)
+{
+    std::map<int, CInfinitynode> mapPayees;
+    ScheduleRef schedule = GetSchedule();
+    StateRef state = GetSnapshot();
+    const std::map<int, int>& mapStatementSinType = state->getStatementMap(nSinType);
+    //ranks of the statements not in the schedule, computed once for the whole range
+    std::map<int, std::map<int, CInfinitynode>> mapRanks;
+
+    for (int nHeight = max(nFromHeight, Params().GetConsensus().nInfinityNodeGenesisStatement); nHeight <= nToHeight; nHeight++) {
+        CInfinitynode inf;
+        if (schedule->GetPayee(nHeight, nSinType, inf)) {
+            mapPayees[nHeight] = inf;
+            continue;
+        }
+
+        //last statement before nHeight, it must still cover nHeight
+        auto itStm = mapStatementSinType.lower_bound(nHeight);
+        if (itStm == mapStatementSinType.begin()) continue;
+        --itStm;
+        if (nHeight - itStm->first > itStm->second) continue;
+
+        auto itRanks = mapRanks.find(itStm->first);
+        if (itRanks == mapRanks.end()) {
+            LOCK(cs);
+            itRanks = mapRanks.emplace(itStm->first, calculInfinityNodeRank(itStm->first, nSinType, false)).first;
+        }
+        auto itPayee = itRanks->second.find(nHeight - itStm->first);
+        if (itPayee != itRanks->second.end()) mapPayees[nHeight] = itPayee->second;
+    }
+    return mapPayees;
+}
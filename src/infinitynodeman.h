@@ -7,7 +7,7 @@
 
 #include <infinitynode.h>
 
-
+#include <memory>
 
 using namespace std;
 
@@ -16,8 +16,93 @@ class CConnman;
 
 extern CInfinitynodeMan infnodeman;
 
+/** Default number of upcoming payees kept in the schedule of each tier */
+static const int DEFAULT_INFINITYNODE_SCHEDULE_SIZE = 720;
+/** Maximum number of heights returned by one schedule request */
+static const int MAX_INFINITYNODE_SCHEDULE_RANGE = 1440;
+/** Blocks below the last paid tip which can be disconnected without reading the chain again */
+static const int INFINITYNODE_LASTPAID_UNDO_DEPTH = 100;
+
 class CInfinitynodeMan
 {
+public:
+    /**
+     * Immutable view of the manager, published after every update.
+     * Readers hold a reference to it instead of copying the maps under cs.
+     */
+    struct State
+    {
+        std::map<COutPoint, CInfinitynode> mapInfinitynodes;
+        std::map<COutPoint, CInfinitynode> mapInfinitynodesNonMatured;
+        std::map<CScript, int> mapLastPaid;
+        std::map<int, int> mapStatementBIG;
+        std::map<int, int> mapStatementMID;
+        std::map<int, int> mapStatementLIL;
+        int64_t nLastScanHeight = 0;
+
+        const std::map<int, int>& getStatementMap(int nSinType) const;
+    };
+    typedef std::shared_ptr<const State> StateRef;
+
+    /**
+     * Upcoming payees of each tier after nTipHeight, up to -infinitynodeschedule
+     * of them. Advanced at each new tip from the ranks of the last statement,
+     * ranks are only computed again when a statement boundary is crossed or
+     * the node list changes. The ranks are shared with the manager and the
+     * previous schedules, advancing to a new tip copies no node.
+     */
+    struct Schedule
+    {
+        struct Tier
+        {
+            // ranks of the last statement, payee of nStatementHeight + 1 + i at i
+            std::shared_ptr<const std::vector<CInfinitynode>> vRanks;
+            int nStatementHeight = 0;
+            // payees of nTipHeight + 1 ... nTipHeight + nSize
+            int nSize = 0;
+        };
+        int nTipHeight = 0;
+        // per SinType
+        std::map<int, Tier> mapTiers;
+
+        bool GetPayee(int nBlockHeight, int nSinType, CInfinitynode& infinitynodeRet) const;
+    };
+    typedef std::shared_ptr<const Schedule> ScheduleRef;
+
+    /**
+     * Figures of each tier shown by the GUI overview, published with every
+     * State and at every new tip. NotifyInfinitynodeStatsChanged fires when
+     * they change, readers never walk the maps nor take cs.
+     */
+    struct Stats
+    {
+        struct Tier
+        {
+            int nCount = 0;
+            int nCountNonMatured = 0;
+            int nRoiDays = 0;
+            int nLastStatement = 0;
+
+            bool operator==(const Tier& other) const
+            {
+                return nCount == other.nCount && nCountNonMatured == other.nCountNonMatured &&
+                       nRoiDays == other.nRoiDays && nLastStatement == other.nLastStatement;
+            }
+        };
+        // by SinType, 10, 5 and 1
+        std::map<int, Tier> mapTiers;
+        // nodes of every tier, matured or not
+        int nTotal = 0;
+        // last scan height plus the maturity limit
+        int64_t nLastScanHeight = 0;
+
+        bool operator==(const Stats& other) const
+        {
+            return mapTiers == other.mapTiers && nTotal == other.nTotal && nLastScanHeight == other.nLastScanHeight;
+        }
+    };
+    typedef std::shared_ptr<const Stats> StatsRef;
+
 private:
     static const std::string SERIALIZATION_VERSION_STRING;
 
@@ -44,10 +129,63 @@ private:
     int nMIDLastStmSize;
     int nLILLastStmSize;
 
-    // map to hold payee and lastPaid Height
+    // map to hold payee and lastPaid Height, kept up to date from the coinbase of connected blocks
     std::map<CScript, int> mapLastPaid;
+    // last block applied to mapLastPaid and, for recent blocks, the previous last paid of their payees (0 = none)
+    int nLastPaidHeight;
+    uint256 hashLastPaidBlock;
+    std::map<int, std::pair<uint256, std::vector<std::pair<CScript, int>>>> mapLastPaidUndo;
+    // last tip connected, what a scheduled catch up reads the blocks to
+    const CBlockIndex* pindexLastPaidTip;
+    bool fLastPaidCatchUpScheduled;
+    // taken after cs and cs_main, never held while reading blocks
     mutable CCriticalSection cs_LastPaid;
 
+    // last published State, only accessed through std::atomic_load/atomic_store
+    StateRef stateSnapshot;
+
+    // ranks of the last statement of a tier, payee of nHeight + 1 + i at i
+    struct StatementRanks
+    {
+        int nHeight = 0;
+        int nSize = 0;
+        int nListVersion = -1;
+        // block of the statement on the chain the ranks were computed with
+        uint256 hashBlock;
+        std::shared_ptr<const std::vector<CInfinitynode>> vPayees;
+    };
+    // bumped when matured nodes are added or cleared, cs must be held
+    int nListVersion;
+    // protects mapStatementRanks, taken last: never held while taking cs or cs_main
+    mutable CCriticalSection cs_Schedule;
+    std::map<int, StatementRanks> mapStatementRanks;
+    // last tip notified, what the ranks are checked against
+    const CBlockIndex* pindexScheduleTip;
+    // last published Schedule, only accessed through std::atomic_load/atomic_store
+    ScheduleRef scheduleSnapshot;
+    // protects nStatsHeight and the publishing of statsSnapshot, taken last
+    mutable CCriticalSection cs_Stats;
+    // tip the ROIs of the published Stats are computed at
+    int nStatsHeight;
+    // last published Stats, only accessed through std::atomic_load/atomic_store
+    StatsRef statsSnapshot;
+
+    /// Publish a new State from the current maps, cs must be held
+    void PublishSnapshot();
+    /// Rank again the statements which changed since last call, cs must be held
+    void UpdateStatementRanks();
+    /// Publish the payees following nTipHeight, cs_Schedule must be held
+    void PublishSchedule(int nTipHeight);
+    /// Publish the Stats of state, cs must be held
+    void PublishStats(const State& state);
+    /// Compute the ROIs of stats at nStatsHeight and publish it if it changed, cs_Stats must be held
+    bool StoreStats(std::shared_ptr<Stats> stats);
+    /// Record the payees paid at pindex, cs_LastPaid must be held
+    void ConnectLastPaid(const std::vector<CScript>& vPayees, const CBlockIndex* pindex);
+    /// Forget the payees not paid within the last paid scan depth, cs_LastPaid must be held
+    void PruneLastPaid();
+    /// Catch up to the last connected tip on the job threads, then publish the last paid heights
+    void ScheduleCatchUpLastPaid();
 
 public:
 
@@ -59,7 +197,7 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
-        LOCK(cs);
+        LOCK2(cs, cs_LastPaid);
         std::string strVersion;
         if(ser_action.ForRead()) {
             READWRITE(strVersion);
@@ -81,7 +219,13 @@ public:
         READWRITE(nBIGLastStmSize);
         READWRITE(nMIDLastStmSize);
         READWRITE(nLILLastStmSize);
+        READWRITE(nLastPaidHeight);
+        READWRITE(hashLastPaidBlock);
+        READWRITE(mapLastPaidUndo);
 
+        if(ser_action.ForRead()) {
+            ++nListVersion;
+        }
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
@@ -90,7 +234,6 @@ public:
     std::string ToString() const;
 
     bool Add(CInfinitynode &mn);
-    bool AddUpdateLastPaid(CScript scriptPubKey, int nHeightLastPaid);
     /// Find an entry
     CInfinitynode* Find(const COutPoint& outpoint);
 
@@ -104,16 +247,12 @@ public:
     bool Has(const COutPoint& outpoint);
     bool HasPayee(CScript scriptPubKey);
     int Count();
-    std::map<COutPoint, CInfinitynode> GetFullInfinitynodeMap() { LOCK(cs); return mapInfinitynodes; }
-    std::map<COutPoint, CInfinitynode> GetFullInfinitynodeNonMaturedMap() { LOCK(cs); return mapInfinitynodesNonMatured; }
-    std::map<int, int> getStatementMap(int nSinType){
-        LOCK(cs);
-        std::map<int, int> nullmap = {{0,0}};
-        if(nSinType == 10) return mapStatementBIG;
-        else if(nSinType == 5) return mapStatementMID;
-        else if(nSinType == 1) return mapStatementLIL;
-        else return nullmap;
-    }
+    /// Last published State, never null. Safe to call from any thread without cs
+    StateRef GetSnapshot() const { return std::atomic_load(&stateSnapshot); }
+    /// Last published Schedule, never null. Safe to call from any thread without cs
+    ScheduleRef GetSchedule() const { return std::atomic_load(&scheduleSnapshot); }
+    /// Last published Stats, never null. Safe to call from any thread without cs
+    StatsRef GetStats() const { return std::atomic_load(&statsSnapshot); }
     int getLastStatement(int nSinType){
         LOCK(cs);
         if(nSinType == 10) return nBIGLastStmHeight;
@@ -127,7 +266,6 @@ public:
         if(nSinType == 1) return nLILLastStmSize;
     }
 
-    std::map<CScript, int> GetFullLastPaidMap() { return mapLastPaid; }
     int64_t getLastScan(){return nLastScanHeight;}
     int64_t getLastScanWithLimit(){return nLastScanHeight + INF_MATURED_LIMIT;}
 
@@ -140,15 +278,23 @@ public:
 
     bool deterministicRewardStatement(int nSinType);
     bool deterministicRewardAtHeight(int nBlockHeight, int nSinType, CInfinitynode& infinitynodeRet);
+    /// Payees of nSinType from nFromHeight to nToHeight, heights without known statement are left out
+    std::map<int, CInfinitynode> getScheduleForRange(int nFromHeight, int nToHeight, int nSinType);
     std::map<int, CInfinitynode> calculInfinityNodeRank(int nBlockHeight, int nSinType, bool updateList=false);
     void calculAllInfinityNodesRankAtLastStm();
     std::pair<int, int> getLastStatementBySinType(int nSinType);
     std::string getLastStatementString() const;
     int getRoi(int nSinType, int totalNode);
+    /// Days for totalNode nodes of nSinType to earn back their burn at the reward of nHeight, 0 without nodes or reward
+    static int CalculateRoi(int nSinType, int totalNode, int nHeight);
 
     void CheckAndRemove(CConnman& connman);
-    /// This is dummy overload to be used for dumping/loading mncache.dat
-    void CheckAndRemove() {}
+    /// Called after loading infinitynode.dat, publish what was loaded
+    void CheckAndRemove() { LOCK(cs); PublishSnapshot(); }
     void UpdatedBlockTip(const CBlockIndex *pindex);
+    /// Bring the last paid heights up to pindex, reading from disk only the blocks not seen yet
+    bool CatchUpLastPaid(const CBlockIndex* pindex);
+    void BlockConnected(const CBlock& block, const CBlockIndex* pindex);
+    void BlockDisconnected(const CBlock& block, const CBlockIndex* pindex);
 };
 #endif // QSTEES_INFINITYNODEMAN_H
@@ -6,27 +6,42 @@
 #include <infinitynodeman.h>
 #include <util.h> //fMasterNode variable
 #include <flat-database.h>
+#include <blockscanner.h>
+#include <masternodejobs.h>
 
 CInfinitynodersv infnodersv;
 
-const std::string CInfinitynodersv::SERIALIZATION_VERSION_STRING = "CInfinitynodeRSV-Version-1";
+const std::string CInfinitynodersv::SERIALIZATION_VERSION_STRING = "CInfinitynodeRSV-Version-3";
 
 CInfinitynodersv::CInfinitynodersv()
 : cs(),
-  mapProposalVotes()
+  nBestHeight(0),
+  hashBestBlock(),
+  mapProposalVotes(),
+  mapBlockUndo(),
+  mapNodeWeight(),
+  mapPendingVotes(),
+  pindexLastTip(nullptr),
+  fCatchingUp(false)
 {}
 
 void CInfinitynodersv::Clear()
 {
     LOCK(cs);
     mapProposalVotes.clear();
+    mapBlockUndo.clear();
+    nBestHeight = 0;
+    hashBestBlock.SetNull();
 }
 
-std::vector<CVote>* CInfinitynodersv::Find(std::string proposal)
+int CInfinitynodersv::GetBeginHeight()
 {
-    LOCK(cs);
-    auto it = mapProposalVotes.find(proposal);
-    return it == mapProposalVotes.end() ? NULL : &(it->second);
+    return std::min(INFINITYNODE_RSV_BEGIN, Params().GetConsensus().nInfinityNodeBeginHeight);
+}
+
+int CInfinitynodersv::GetMatureHeight(int nTipHeight)
+{
+    return std::max(0, nTipHeight - Params().MaxReorganizationDepth() - 1);
 }
 
 bool CInfinitynodersv::Has(std::string proposal)
@@ -35,37 +50,373 @@ bool CInfinitynodersv::Has(std::string proposal)
     return mapProposalVotes.find(proposal) != mapProposalVotes.end();
 }
 
-bool CInfinitynodersv::Add(CVote &vote)
+int CInfinitynodersv::getVoteCount(std::string proposal)
+{
+    LOCK(cs);
+    auto it = mapProposalVotes.find(proposal);
+    return it == mapProposalVotes.end() ? 0 : (int)it->second.mapVotes.size();
+}
+
+std::map<CScript, CVote> CInfinitynodersv::GetProposalVotes(std::string proposal)
 {
     LOCK(cs);
-    LogPrintf("CInfinitynodersv::new vote from %s %d\n", vote.getVoter().ToString(), vote.getHeight());
-    auto it = mapProposalVotes.find(vote.getProposalId());
-    if(it == mapProposalVotes.end()){
-        LogPrintf("CInfinitynodersv::1st vote from %s\n", vote.getVoter().ToString());
-        mapProposalVotes[vote.getProposalId()].push_back(vote);
+    auto it = mapProposalVotes.find(proposal);
+    if (it == mapProposalVotes.end()) return std::map<CScript, CVote>();
+    return it->second.mapVotes;
+}
+
+std::map<std::string, int> CInfinitynodersv::GetProposalVoteCounts()
+{
+    LOCK(cs);
+    std::map<std::string, int> mapCounts;
+    for (auto& pair : mapProposalVotes) {
+        mapCounts[pair.first] = (int)pair.second.mapVotes.size();
+    }
+    return mapCounts;
+}
+
+int CInfinitynodersv::GetNodeWeight(const CScript& voter) const
+{
+    AssertLockHeld(cs);
+    auto it = mapNodeWeight.find(voter);
+    return it == mapNodeWeight.end() ? 0 : it->second;
+}
+
+void CInfinitynodersv::AddToTally(CProposal& proposal, const CVote& vote, int nSign)
+{
+    int nWeight = GetNodeWeight(vote.getVoter());
+    if (vote.getOpinion()) {
+        proposal.nPublicYes += nSign;
+        proposal.nNodeYes += nSign * nWeight;
     } else {
-        int i=0;
-        for (auto& v : it->second){
-            //added
-            if(v.getVoter() == vote.getVoter()){
-                if(v.getHeight() >= vote.getHeight()){
-                    LogPrintf("CInfinitynodersv::same voter from with low height %s\n", v.getVoter().ToString());
-                    return false;
-                }else{
-                    LogPrintf("CInfinitynodersv::new vote from higher height %s\n", vote.getVoter().ToString());
-                    mapProposalVotes[vote.getProposalId()].erase (mapProposalVotes[vote.getProposalId()].begin()+i);
-                    mapProposalVotes[vote.getProposalId()].push_back(vote);
-                    return true;
-                }
-            }
-            i++;
+        proposal.nPublicNo += nSign;
+        proposal.nNodeNo += nSign * nWeight;
+    }
+}
+
+void CInfinitynodersv::RecalculateTally()
+{
+    AssertLockHeld(cs);
+    for (auto& pair : mapProposalVotes) {
+        CProposal& proposal = pair.second;
+        proposal.nPublicYes = proposal.nPublicNo = proposal.nNodeYes = proposal.nNodeNo = 0;
+        for (auto& v : proposal.mapVotes) {
+            AddToTally(proposal, v.second, 1);
+        }
+    }
+}
+
+void CInfinitynodersv::UpdateNodeWeights(const std::map<COutPoint, CInfinitynode>& mapInfinitynodes)
+{
+    std::map<CScript, int> mapWeight;
+    for (auto& infpair : mapInfinitynodes) {
+        CTxDestination dest = DecodeDestination(infpair.second.getCollateralAddress());
+        if (!IsValidDestination(dest)) continue;
+        int nQSTEESType = infpair.second.getQSTEESType();
+        int nWeight = 0;
+        if (nQSTEESType == 1) nWeight = 2;
+        if (nQSTEESType == 5) nWeight = 10;
+        if (nQSTEESType == 10) nWeight = 20;
+        mapWeight[GetScriptForDestination(dest)] = nWeight;
+    }
+
+    LOCK(cs);
+    if (mapWeight == mapNodeWeight) return;
+    mapNodeWeight.swap(mapWeight);
+    RecalculateTally();
+}
+
+/**
+ * Keep only the highest vote of each voter, on the same height the first one wins
+ */
+bool CInfinitynodersv::ApplyVote(const CVote& vote, std::vector<CVoteUndo>& vUndo)
+{
+    AssertLockHeld(cs);
+    CProposal& proposal = mapProposalVotes[vote.getProposalId()];
+    CVoteUndo undo;
+    undo.proposalId = vote.getProposalId();
+    undo.voter = vote.getVoter();
+
+    auto it = proposal.mapVotes.find(vote.getVoter());
+    if (it != proposal.mapVotes.end()) {
+        if (it->second.getHeight() >= vote.getHeight()) {
+            LogPrint(BCLog::INFINITYNODE, "CInfinitynodersv::ApplyVote -- same voter with low height %s\n", vote.getVoter().ToString());
+            return false;
+        }
+        undo.fHadPrevious = true;
+        undo.prevVote = it->second;
+        AddToTally(proposal, it->second, -1);
+        it->second = vote;
+    } else {
+        proposal.mapVotes.emplace(vote.getVoter(), vote);
+    }
+    AddToTally(proposal, vote, 1);
+    vUndo.push_back(undo);
+    LogPrint(BCLog::INFINITYNODE, "CInfinitynodersv::ApplyVote -- vote from %s for proposal %s at %d\n",
+              vote.getVoter().ToString(), vote.getProposalId(), vote.getHeight());
+    return true;
+}
+
+void CInfinitynodersv::UndoVote(const CVoteUndo& undo)
+{
+    AssertLockHeld(cs);
+    auto itProposal = mapProposalVotes.find(undo.proposalId);
+    if (itProposal == mapProposalVotes.end()) return;
+    CProposal& proposal = itProposal->second;
+
+    auto it = proposal.mapVotes.find(undo.voter);
+    if (it != proposal.mapVotes.end()) {
+        AddToTally(proposal, it->second, -1);
+        proposal.mapVotes.erase(it);
+    }
+    if (undo.fHadPrevious) {
+        proposal.mapVotes.emplace(undo.voter, undo.prevVote);
+        AddToTally(proposal, undo.prevVote, 1);
+    }
+    if (proposal.mapVotes.empty()) mapProposalVotes.erase(itProposal);
+}
+
+void CInfinitynodersv::FindVotes(const CBlock& block, int nHeight, std::vector<std::pair<CVote, COutPoint>>& vVotesRet)
+{
+    for (const CTransactionRef& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+
+        for (unsigned int i = 0; i < tx->vout.size(); i++) {
+            const CTxOut& out = tx->vout[i];
+            if (out.nValue != Params().GetConsensus().nInfinityNodeVoteValue * COIN) continue;
+
+            std::vector<std::vector<unsigned char>> vSolutions;
+            txnouttype whichType;
+            if (!Solver(out.scriptPubKey, whichType, vSolutions) || whichType != TX_BURN_DATA || vSolutions.size() != 2) continue;
+
+            //vote is sent to Governance Vote Address
+            if (EncodeDestination(CKeyID(uint160(vSolutions[0]))) != Params().GetConsensus().cGovernanceAddress) continue;
+
+            std::string voteOpinion(vSolutions[1].begin(), vSolutions[1].end());
+            if (voteOpinion.length() != 9) continue;
+            std::string proposalID = voteOpinion.substr(0, 8);
+            bool opinion = false;
+            if (voteOpinion.substr(8, 1) == "1") {opinion = true;}
+
+            //Address payee: we known that there is only 1 input
+            vVotesRet.push_back(std::make_pair(CVote(proposalID, CScript(), nHeight, opinion), tx->vin[0].prevout));
+        }
+    }
+}
+
+bool CInfinitynodersv::GetVoter(const COutPoint& prevout, CScript& voterRet)
+{
+    CTransactionRef prevtx;
+    uint256 hashblock;
+    if (!GetTransaction(prevout.hash, prevtx, Params().GetConsensus(), hashblock, false)) {
+        LogPrintf("CInfinitynodersv::GetVoter -- PrevBurnFund tx is not in block.\n");
+        return false;
+    }
+
+    CTxDestination addressBurnFund;
+    if (!ExtractDestination(prevtx->vout[prevout.n].scriptPubKey, addressBurnFund)) {
+        LogPrintf("CInfinitynodersv::GetVoter -- False when extract payee from BurnFund tx.\n");
+        return false;
+    }
+    voterRet = prevtx->vout[prevout.n].scriptPubKey;
+    return true;
+}
+
+bool CInfinitynodersv::ConnectVotes(const std::vector<std::pair<CVote, COutPoint>>& vVotes, const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs);
+    std::vector<CVoteUndo> vUndo;
+    for (const auto& pair : vVotes) {
+        CScript voter;
+        if (!GetVoter(pair.second, voter)) {
+            // put back what was already applied from this block
+            for (auto it = vUndo.rbegin(); it != vUndo.rend(); ++it) UndoVote(*it);
+            return false;
         }
-        //not found the same voter ==> add
-        LogPrintf("CInfinitynodersv::new vote from %s for proposal %s\n", vote.getVoter().ToString(), vote.getProposalId());
-        mapProposalVotes[vote.getProposalId()].push_back(vote);
+        const CVote& found = pair.first;
+        ApplyVote(CVote(found.getProposalId(), voter, found.getHeight(), found.getOpinion()), vUndo);
+    }
+
+    if (pindex->nHeight >= GetBeginHeight()) {
+        mapBlockUndo[pindex->nHeight] = std::make_pair(pindex->GetBlockHash(), std::move(vUndo));
     }
+    mapBlockUndo.erase(mapBlockUndo.begin(), mapBlockUndo.lower_bound(pindex->nHeight - INFINITYNODE_RSV_UNDO_DEPTH));
+    nBestHeight = pindex->nHeight;
+    hashBestBlock = pindex->GetBlockHash();
     return true;
 }
+
+/**
+ * Bring the tally to pindex, reading the missing blocks from disk.
+ * Rebuild from the beginning when the last applied block is not an ancestor of pindex.
+ */
+bool CInfinitynodersv::CatchUp(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs);
+    const CBlockIndex* pindexBest = pindex->GetAncestor(nBestHeight);
+    if (pindexBest == nullptr || pindexBest->GetBlockHash() != hashBestBlock) {
+        if (nBestHeight > 0) {
+            LogPrintf("CInfinitynodersv::CatchUp -- last vote block %s is not in chain, rebuild\n", hashBestBlock.ToString());
+        }
+        mapProposalVotes.clear();
+        mapBlockUndo.clear();
+        nBestHeight = std::min(GetBeginHeight() - 1, pindex->nHeight);
+        hashBestBlock = pindex->GetAncestor(nBestHeight)->GetBlockHash();
+    }
+
+    //blocks below the beginning carry no vote
+    int nLowHeight = std::max(nBestHeight + 1, GetBeginHeight());
+    if (nLowHeight > pindex->nHeight) {
+        nBestHeight = pindex->nHeight;
+        hashBestBlock = pindex->GetBlockHash();
+        return true;
+    }
+
+    //blocks are read and parsed on several threads, votes are applied here in height order
+    CBlockScanner<std::vector<std::pair<CVote, COutPoint>>> scanner(pindex, nLowHeight, false);
+    return scanner.Run(
+        [](const CBlock& block, const CBlockIndex* pindexBlock, std::vector<std::pair<CVote, COutPoint>>& vVotes) {
+            FindVotes(block, pindexBlock->nHeight, vVotes);
+            return true;
+        },
+        [this](const CBlockIndex* pindexBlock, std::vector<std::pair<CVote, COutPoint>>& vVotes) {
+            return ConnectVotes(vVotes, pindexBlock);
+        });
+}
+
+/**
+ * Move the tally to the mature ancestor of pindexTip with the votes found when
+ * the blocks were connected and the undo data, without reading any block.
+ * False when blocks have to be read, the tally is then left on a block of the chain.
+ */
+bool CInfinitynodersv::SyncToTip(const CBlockIndex* pindexTip)
+{
+    AssertLockHeld(cs);
+    int nMatureHeight = GetMatureHeight(pindexTip->nHeight);
+    const CBlockIndex* pindexBest = pindexTip->GetAncestor(nBestHeight);
+    if (pindexBest == nullptr || pindexBest->GetBlockHash() != hashBestBlock) return false;
+
+    // votes which are not mature any more after blocks were disconnected
+    while (nBestHeight > nMatureHeight) {
+        if (nBestHeight >= GetBeginHeight()) {
+            auto it = mapBlockUndo.find(nBestHeight);
+            if (it == mapBlockUndo.end() || it->second.first != hashBestBlock) return false;
+            const std::vector<CVoteUndo>& vUndo = it->second.second;
+            for (auto itUndo = vUndo.rbegin(); itUndo != vUndo.rend(); ++itUndo) UndoVote(*itUndo);
+            mapBlockUndo.erase(it);
+        }
+        pindexBest = pindexBest->pprev;
+        nBestHeight = pindexBest->nHeight;
+        hashBestBlock = pindexBest->GetBlockHash();
+    }
+
+    //blocks below the beginning carry no vote
+    if (nBestHeight < GetBeginHeight() - 1 && nBestHeight < nMatureHeight) {
+        nBestHeight = std::min(GetBeginHeight() - 1, nMatureHeight);
+        hashBestBlock = pindexTip->GetAncestor(nBestHeight)->GetBlockHash();
+    }
+
+    while (nBestHeight < nMatureHeight) {
+        const CBlockIndex* pindexNext = pindexTip->GetAncestor(nBestHeight + 1);
+        auto it = mapPendingVotes.find(pindexNext->nHeight);
+        if (it == mapPendingVotes.end() || it->second.first != pindexNext->GetBlockHash()) return false;
+        if (!ConnectVotes(it->second.second, pindexNext)) return false;
+    }
+    return true;
+}
+
+/**
+ * Bring the tally to the last notified tip. The blocks are read into a copy
+ * of the tally without holding cs, the copy is then swapped in, until no
+ * block is missing any more.
+ */
+void CInfinitynodersv::CatchUpTip()
+{
+    LOCK(cs_catchup);
+    while (true) {
+        CInfinitynodersv tally;
+        const CBlockIndex* pindexMature;
+        {
+            LOCK(cs);
+            if (pindexLastTip == nullptr || SyncToTip(pindexLastTip)) {
+                fCatchingUp = false;
+                return;
+            }
+            pindexMature = pindexLastTip->GetAncestor(GetMatureHeight(pindexLastTip->nHeight));
+            tally.mapProposalVotes = mapProposalVotes;
+            tally.mapBlockUndo = mapBlockUndo;
+            tally.mapNodeWeight = mapNodeWeight;
+            tally.nBestHeight = nBestHeight;
+            tally.hashBestBlock = hashBestBlock;
+        }
+
+        bool fResult;
+        {
+            LOCK(tally.cs);
+            fResult = tally.CatchUp(pindexMature);
+        }
+
+        LOCK(cs);
+        if (!fResult) {
+            // the next tip tries again
+            LogPrintf("CInfinitynodersv::CatchUpTip -- failed to catch up to %s\n", pindexMature->GetBlockHash().ToString());
+            fCatchingUp = false;
+            return;
+        }
+        mapProposalVotes.swap(tally.mapProposalVotes);
+        mapBlockUndo.swap(tally.mapBlockUndo);
+        nBestHeight = tally.nBestHeight;
+        hashBestBlock = tally.hashBestBlock;
+        // the weights changed while the blocks were read
+        if (tally.mapNodeWeight != mapNodeWeight) RecalculateTally();
+    }
+}
+
+void CInfinitynodersv::ScheduleCatchUp()
+{
+    // without the job threads (lite mode, or before they start) on this thread, still without holding cs
+    if (!mnjobs.Schedule("infinitynodersv", [this] { CatchUpTip(); })) CatchUpTip();
+}
+
+void CInfinitynodersv::BlockConnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    std::vector<std::pair<CVote, COutPoint>> vVotes;
+    if (pindex->nHeight >= GetBeginHeight()) FindVotes(block, pindex->nHeight, vVotes);
+    {
+        LOCK(cs);
+        pindexLastTip = pindex;
+        mapPendingVotes[pindex->nHeight] = std::make_pair(pindex->GetBlockHash(), std::move(vVotes));
+        // keep what reconnecting the blocks of a short reorganization needs
+        mapPendingVotes.erase(mapPendingVotes.begin(), mapPendingVotes.lower_bound(GetMatureHeight(pindex->nHeight) - INFINITYNODE_RSV_UNDO_DEPTH));
+        if (fCatchingUp || SyncToTip(pindex)) return;
+        fCatchingUp = true;
+    }
+    ScheduleCatchUp();
+}
+
+void CInfinitynodersv::BlockDisconnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    if (pindex == nullptr || pindex->pprev == nullptr) return;
+    {
+        LOCK(cs);
+        pindexLastTip = pindex->pprev;
+        if (fCatchingUp || SyncToTip(pindexLastTip)) return;
+        fCatchingUp = true;
+    }
+    ScheduleCatchUp();
+}
+
+void CInfinitynodersv::UpdatedBlockTip(const CBlockIndex* pindex)
+{
+    {
+        LOCK(cs);
+        pindexLastTip = pindex;
+        if (SyncToTip(pindex)) return;
+        fCatchingUp = true;
+    }
+    CatchUpTip();
+}
+
 /**
  * @param {String } proposal 8 digits number
  * @param {boolean} opinion
@@ -73,123 +424,40 @@ bool CInfinitynodersv::Add(CVote &vote)
  */
 int CInfinitynodersv::getResult(std::string proposal, bool opinion, int mode)
 {
-    LogPrintf("CInfinitynodersv::result --%s %d\n", proposal, mode);
     LOCK(cs);
-    std::map<COutPoint, CInfinitynode> mapInfinitynodesCopy = infnodeman.GetFullInfinitynodeMap();
-    int result = 0;
     auto it = mapProposalVotes.find(proposal);
-    if(it == mapProposalVotes.end()){
+    if (it == mapProposalVotes.end()) {
         return 0;
-    }else{
-        for (auto& v : it->second){
-            if(v.getOpinion() == opinion){
-                int value = 0;
-                if (mode == 0){value = 1;}
-                if (mode == 1 || mode == 2){
-                    if (mode == 1){value = 0;}
-                    CTxDestination voter;
-                    ExtractDestination(v.getVoter(), voter);
-                    for (auto& infpair : mapInfinitynodesCopy) {
-                        if (infpair.second.getCollateralAddress() == EncodeDestination(voter)) {
-                            infinitynode_info_t infnode = infpair.second.GetInfo();
-                            if(infnode.nQSTEESType == 1){value=2;}
-                            if(infnode.nQSTEESType == 5){value=10;}
-                            if(infnode.nQSTEESType == 10){value=20;}
-                        }
-                    }
-                }
-                result += value;
-            }
-        }
-        return result;
     }
+    const CProposal& result = it->second;
+    if (mode == 0) return opinion ? result.nPublicYes : result.nPublicNo;
+    if (mode == 1 || mode == 2) return opinion ? result.nNodeYes : result.nNodeNo;
+    return 0;
 }
 
 bool CInfinitynodersv::rsvScan(int nBlockHeight)
 {
     Clear();
     LogPrintf("CInfinitynodersv::rsvScan -- Cleared map. Size is %d\n", (int)mapProposalVotes.size());
-    if (nBlockHeight <= INFINITYNODE_RSV_BEGIN) return false;
-    uint256 blockHash;
-    if(!GetBlockHash(blockHash, nBlockHeight)) {
-        LogPrint(BCLog::INFINITYNODE, "CInfinitynodeMan::buildInfinitynodeList -- can not read block hash\n");
-        return false;
-    }
+    if (nBlockHeight <= GetBeginHeight()) return false;
 
-    CBlockIndex* pindex;
-    pindex = LookupBlockIndex(blockHash);
-    CBlockIndex* prevBlockIndex = pindex;
-
-    while (prevBlockIndex->nHeight >= INFINITYNODE_RSV_BEGIN)
+    const CBlockIndex* pindex;
     {
-        CBlock blockReadFromDisk;
-        if (ReadBlockFromDisk(blockReadFromDisk, prevBlockIndex, Params().GetConsensus()))
-        {
-            for (const CTransactionRef& tx : blockReadFromDisk.vtx) {
-                //Not coinbase
-                if (!tx->IsCoinBase()) {
-                   for (unsigned int i = 0; i < tx->vout.size(); i++) {
-                        const CTxOut& out = tx->vout[i];
-                        std::vector<std::vector<unsigned char>> vSolutions;
-                        txnouttype whichType;
-                        const CScript& prevScript = out.scriptPubKey;
-                        Solver(prevScript, whichType, vSolutions);
-                        //Send to BurnAddress
-                        if (whichType == TX_BURN_DATA && Params().GetConsensus().cGovernanceAddress == EncodeDestination(CKeyID(uint160(vSolutions[0]))))
-                        {
-                            //Amount for vote
-                            if (out.nValue == Params().GetConsensus().nInfinityNodeVoteValue * COIN){
-                                if (vSolutions.size() == 2){
-                                    std::string voteOpinion(vSolutions[1].begin(), vSolutions[1].end());
-                                    if(voteOpinion.length() == 9){
-                                        std::string proposalID = voteOpinion.substr(0, 8);
-                                        bool opinion = false;
-                                        if( voteOpinion.substr(8, 1) == "1" ){opinion = true;}
-                                        //Address payee: we known that there is only 1 input
-                                        const CTxIn& txin = tx->vin[0];
-                                        int index = txin.prevout.n;
-
-                                        CTransactionRef prevtx;
-                                        uint256 hashblock;
-                                        if(!GetTransaction(txin.prevout.hash, prevtx, Params().GetConsensus(), hashblock, false)) {
-                                            LogPrintf("CInfinitynodersv::rsvScan -- PrevBurnFund tx is not in block.\n");
-                                            return false;
-                                        }
-
-                                        CTxDestination addressBurnFund;
-                                        if(!ExtractDestination(prevtx->vout[index].scriptPubKey, addressBurnFund)){
-                                            LogPrintf("CInfinitynodersv::rsvScan -- False when extract payee from BurnFund tx.\n");
-                                            return false;
-                                        }
-                                        //we have all infos. Then add in map
-                                        if(prevBlockIndex->nHeight < pindex->nHeight - Params().MaxReorganizationDepth()) {
-                                            LogPrintf("CInfinitynodeMan::rsvScan -- Voter: %s, Heigh: %d, proposal: %s.\n", 
-                                                     EncodeDestination(addressBurnFund), prevBlockIndex->nHeight, voteOpinion);
-                                            CVote vote = CVote(proposalID, prevtx->vout[index].scriptPubKey, prevBlockIndex->nHeight, opinion);
-                                            Add(vote);
-                                        } else {
-                                            //non matured
-                                            LogPrintf("CInfinitynodeMan::rsvScan -- Non matured vote.\n");
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        } else {
-            LogPrint(BCLog::INFINITYNODE, "CInfinitynodersv::rsvScan -- can not read block from disk\n");
-            return false;
-        }
-        // continue with previous block
-        prevBlockIndex = prevBlockIndex->pprev;
+        LOCK(cs_main);
+        pindex = chainActive[nBlockHeight];
+    }
+    if (pindex == nullptr) {
+        LogPrint(BCLog::INFINITYNODE, "CInfinitynodersv::rsvScan -- can not read block hash\n");
+        return false;
     }
 
+    UpdatedBlockTip(pindex);
+
     CFlatDB<CInfinitynodersv> flatdb6("infinitynodersv.dat", "magicInfinityRSV");
-    flatdb6.Dump(infnodersv);
+    flatdb6.DumpAsync(infnodersv);
 
-    return true;
+    LOCK(cs);
+    return hashBestBlock == pindex->GetAncestor(GetMatureHeight(nBlockHeight))->GetBlockHash();
 }
 
 std::string CInfinitynodersv::ToString() const
@@ -198,9 +466,8 @@ std::string CInfinitynodersv::ToString() const
     LOCK(cs);
     info << "Proposal: " << (int)mapProposalVotes.size();
     for (auto& infpair : mapProposalVotes) {
-        info << " Id: " << infpair.first << " Votes: " << infpair.second.size();
+        info << " Id: " << infpair.first << " Votes: " << infpair.second.mapVotes.size();
     }
 
     return info.str();
 }
-
@@ -9,6 +9,7 @@
 #include <validation.h>
 #include <script/standard.h>
 #include <key_io.h>
+#include <infinitynode.h>
 
 using namespace std;
 
@@ -19,6 +20,8 @@ extern CInfinitynodersv infnodersv;
 
 
 static const int INFINITYNODE_RSV_BEGIN = 300000;
+// keep undo data for this many blocks below the tip, deeper reorgs trigger a rescan
+static const int INFINITYNODE_RSV_UNDO_DEPTH = 100;
 
 class CVote
 {
@@ -35,7 +38,7 @@ public:
         opinion()
         {}
 
-    CVote(std::string proposalId, CScript voter, int& height, bool& opinion) :
+    CVote(std::string proposalId, CScript voter, int height, bool opinion) :
         proposalId(proposalId),
         voter(voter),
         nHeight(height),
@@ -51,10 +54,55 @@ public:
         READWRITE(opinion);
     }
 
-    std::string getProposalId(){return proposalId;}
-    CScript getVoter(){return voter;}
-    bool getOpinion(){return opinion;}
-    int getHeight(){return nHeight;}
+    std::string getProposalId() const {return proposalId;}
+    CScript getVoter() const {return voter;}
+    bool getOpinion() const {return opinion;}
+    int getHeight() const {return nHeight;}
+};
+
+/**
+ * Votes of one proposal, one per voter, with running totals for each
+ * weighting mode so that results are read without recounting.
+ */
+class CProposal
+{
+public:
+    std::map<CScript, CVote> mapVotes;
+    // mode 0: one per voter
+    int nPublicYes = 0;
+    int nPublicNo = 0;
+    // mode 1 and 2: weighted by the tier of the voter's infinitynode
+    int nNodeYes = 0;
+    int nNodeNo = 0;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(mapVotes);
+    }
+};
+
+/** What a connected block changed, so that disconnecting it restores the previous votes */
+class CVoteUndo
+{
+public:
+    std::string proposalId;
+    CScript voter;
+    bool fHadPrevious;
+    CVote prevVote;
+
+    CVoteUndo() : proposalId(), voter(), fHadPrevious(false), prevVote() {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(proposalId);
+        READWRITE(*(CScriptBase*)(&voter));
+        READWRITE(fHadPrevious);
+        READWRITE(prevVote);
+    }
 };
 
 class CInfinitynodersv
@@ -63,11 +111,37 @@ private:
     static const std::string SERIALIZATION_VERSION_STRING;
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
-    // Keep track of current block height
-    int nCachedBlockHeight;
-public:
-    std::map<std::string, std::vector<CVote>> mapProposalVotes;
+    // last block applied to the tally
+    int nBestHeight;
+    uint256 hashBestBlock;
+
+    std::map<std::string, CProposal> mapProposalVotes;
+    // undo data of recent blocks: height -> (block hash, changes in apply order)
+    std::map<int, std::pair<uint256, std::vector<CVoteUndo>>> mapBlockUndo;
+    // collateral script of each infinitynode -> vote weight, refreshed with the node list
+    std::map<CScript, int> mapNodeWeight;
+    // votes found in the recently connected blocks, applied once they are mature:
+    // height -> (block hash, votes)
+    std::map<int, std::pair<uint256, std::vector<std::pair<CVote, COutPoint>>>> mapPendingVotes;
+    // last tip notified
+    const CBlockIndex* pindexLastTip;
+    // a catch up reading blocks from disk is scheduled or running, the tip changes only record their votes
+    bool fCatchingUp;
+    // one catch up at a time, taken before cs
+    CCriticalSection cs_catchup;
+
+    int GetNodeWeight(const CScript& voter) const;
+    void AddToTally(CProposal& proposal, const CVote& vote, int nSign);
+    bool ApplyVote(const CVote& vote, std::vector<CVoteUndo>& vUndo);
+    void UndoVote(const CVoteUndo& undo);
+    bool ConnectVotes(const std::vector<std::pair<CVote, COutPoint>>& vVotes, const CBlockIndex* pindex);
+    bool CatchUp(const CBlockIndex* pindex);
+    bool SyncToTip(const CBlockIndex* pindexTip);
+    void CatchUpTip();
+    void ScheduleCatchUp();
+    void RecalculateTally();
 
+public:
     CInfinitynodersv();
 
     ADD_SERIALIZE_METHODS;
@@ -83,21 +157,43 @@ public:
             strVersion = SERIALIZATION_VERSION_STRING;
             READWRITE(strVersion);
         }
+        if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
+            Clear();
+            return;
+        }
         READWRITE(mapProposalVotes);
+        READWRITE(mapBlockUndo);
+        READWRITE(nBestHeight);
+        READWRITE(hashBestBlock);
     }
 
+    static int GetBeginHeight();
+    /// Highest block whose votes count with the tip at nTipHeight, the ones deeper than a reorganization
+    static int GetMatureHeight(int nTipHeight);
+    /// Find the votes of a block mined at nHeight, with the outpoint funding each of them
+    static void FindVotes(const CBlock& block, int nHeight, std::vector<std::pair<CVote, COutPoint>>& vVotesRet);
+    /// Script of the voter who funded a vote
+    static bool GetVoter(const COutPoint& prevout, CScript& voterRet);
+
     void Clear();
-    bool Add(CVote &vote);
     bool Has(std::string proposal);
-    std::vector<CVote>* Find(std::string proposal);
-    std::map<std::string, std::vector<CVote>> GetFullProposalVotesMap() { return mapProposalVotes; }
+    int getVoteCount(std::string proposal);
+    std::map<CScript, CVote> GetProposalVotes(std::string proposal);
+    std::map<std::string, int> GetProposalVoteCounts();
 
     int getResult(std::string proposal, bool opinion, int mode = 0);
     bool rsvScan(int nHeight);
 
+    /// Refresh vote weights after the infinitynode list changed
+    void UpdateNodeWeights(const std::map<COutPoint, CInfinitynode>& mapInfinitynodes);
+    /// Bring the tally to the tip pindex, reading the missing blocks from disk on this thread
+    void UpdatedBlockTip(const CBlockIndex* pindex);
+    void BlockConnected(const CBlock& block, const CBlockIndex* pindex);
+    void BlockDisconnected(const CBlock& block, const CBlockIndex* pindex);
+
     std::string ToString() const;
-    /// This is dummy overload to be used for dumping/loading mncache.dat
-    void CheckAndRemove() {}
+    /// Called after loading infinitynodersv.dat, rebuild the running totals
+    void CheckAndRemove() { LOCK(cs); RecalculateTally(); }
 
 };
-#endif // QSTEES_INFINITYNODERSV_H
\ No newline at end of file
+#endif // QSTEES_INFINITYNODERSV_H
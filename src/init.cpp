@@ -53,6 +53,8 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include <future>
+
 // Dasg
 #include <activemasternode.h>
 #include <dsnotificationinterface.h>
@@ -73,6 +75,9 @@
 //qsteesovate
 #include <infinitynodeman.h>
 #include <infinitynodersv.h>
+#include <blockscanner.h>
+#include <masternodejobs.h>
+#include <sigverifyqueue.h>
 //
 
 #ifndef WIN32
@@ -236,6 +241,10 @@ void Shutdown()
     // Because these depend on each-other, we make sure that neither can be
     // using the other before destroying them.
     if (peerLogic) UnregisterValidationInterface(peerLogic.get());
+    // masternode jobs use the connection manager and the managers flushed below
+    mnjobs.Stop();
+    // messages waiting for their signatures hold references to peers
+    sigverifyqueue.Stop();
     if (g_connman) g_connman->Stop();
     if (g_txindex) g_txindex->Stop();
 
@@ -256,6 +265,9 @@ void Shutdown()
         DumpMempool();
     }
 
+    // snapshots still waiting are written before the final dumps replace them
+    flatdbwriter.Stop();
+
     // Dash
     // STORE DATA CACHES INTO SERIALIZED DAT FILES
     CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
@@ -415,6 +427,7 @@ void SetupServerArgs()
     gArgs.AddArg("-blocksdir=<dir>", "Specify blocks directory (default: <datadir>/blocks)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockscanthreads=<n>", strprintf("Set the number of threads reading blocks when building the infinitynode list and vote tally (0 = auto, <0 = leave that many cores free, default: %d)", DEFAULT_BLOCKSCAN_THREADS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksonly", strprintf("Whether to operate in a blocks only mode (default: %u)", DEFAULT_BLOCKSONLY), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-conf=<file>", strprintf("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)", BITCOIN_CONF_FILENAME), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-datadir=<dir>", "Specify data directory", false, OptionsCategory::OPTIONS);
@@ -423,6 +436,7 @@ void SetupServerArgs()
     gArgs.AddArg("-debuglogfile=<file>", strprintf("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (-nodebuglogfile to disable; default: %s)", DEFAULT_DEBUGLOGFILE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-infinitynodeschedule=<n>", strprintf("Keep the next <n> payees of each infinitynode tier ranked in advance (default: %d)", DEFAULT_INFINITYNODE_SCHEDULE_SIZE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-loadblock=<file>", "Imports blocks from external blk000??.dat file on startup", false, OptionsCategory::OPTIONS);
 	gArgs.AddArg("-maxreorg=<n>", strprintf(_("Set the Maximum reorg depth (default: %u)"), defaultChainParams->MaxReorganizationDepth()), false, OptionsCategory::BLOCK_CREATION);
     gArgs.AddArg("-minreorgpeers=<n>", strprintf(_("Set the Minimum amount of peers required to not allow reorgs. Peers must be greater than. (default: %u)"), defaultChainParams->MinReorganizationPeers()), false, OptionsCategory::BLOCK_CREATION);
@@ -430,6 +444,8 @@ void SetupServerArgs()
     gArgs.AddArg("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-mnsigcachesize=<n>", strprintf("Limit the cache of verified masternode message signatures to <n> MiB (default: %u)", DEFAULT_MNSIG_CACHE_SIZE), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-mnsigthreads=<n>", strprintf("Set the number of threads verifying masternode message signatures (up to %d, 0 = auto, <0 = leave that many cores free, default: %d)", MAX_MNSIG_THREADS, DEFAULT_MNSIG_THREADS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()), true, OptionsCategory::OPTIONS);
     gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), false, OptionsCategory::OPTIONS);
@@ -500,11 +516,13 @@ void SetupServerArgs()
     gArgs.AddArg("-zmqpubhashtx=<address>", "Enable publish hash transaction in <address>", false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawblock=<address>", "Enable publish raw block in <address>", false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawtx=<address>", "Enable publish raw transaction in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubrawtxlocktiming=<address>", "Enable publish the timing and votes of completed InstantSend locks in <address>", false, OptionsCategory::ZMQ);
 #else
     hidden_args.emplace_back("-zmqpubhashblock=<address>");
     hidden_args.emplace_back("-zmqpubhashtx=<address>");
     hidden_args.emplace_back("-zmqpubrawblock=<address>");
     hidden_args.emplace_back("-zmqpubrawtx=<address>");
+    hidden_args.emplace_back("-zmqpubrawtxlocktiming=<address>");
 #endif
 
     gArgs.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), true, OptionsCategory::DEBUG_TEST);
@@ -514,6 +532,7 @@ void SetupServerArgs()
     gArgs.AddArg("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-deprecatedrpc=<method>", "Allows deprecated RPC method(s) to be used", true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-dropmessagestest=<n>", "Randomly drop 1 of every <n> network messages", true, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-masternodesyncpeers=<n>", strprintf("Request each masternode sync asset from up to <n> peers at once (default: %u)", MASTERNODE_SYNC_PARALLEL_PEERS), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-stopafterblockimport", strprintf("Stop running after importing blocks from disk (default: %u)", DEFAULT_STOPAFTERBLOCKIMPORT), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-stopatheight", strprintf("Stop running after reaching the given height in the main chain (default: %u)", DEFAULT_STOPATHEIGHT), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-limitancestorcount=<n>", strprintf("Do not accept transactions if number of in-mempool ancestors is <n> or more (default: %u)", DEFAULT_ANCESTOR_LIMIT), true, OptionsCategory::DEBUG_TEST);
@@ -762,6 +781,56 @@ static void ThreadImport(std::vector<fs::path> vImportFiles)
     g_is_mempool_loaded = !ShutdownRequested();
 }
 
+/** Load the flat database cache strDBName into objToLoad */
+template <typename T>
+static bool LoadCache(const std::string& strDBName, const std::string& strMagicMessage, T& objToLoad)
+{
+    CFlatDB<T> flatdb(strDBName, strMagicMessage);
+    if (!flatdb.Load(objToLoad))
+        return false;
+    return true;
+}
+
+/**
+ * Load the masternode and infinitynode caches, one thread per group of
+ * caches which depend on each other: the payments cache is sized by the
+ * masternode list and the infinitynode list sets the RSV vote weights.
+ * None of them needs the block index, they load while it does.
+ * Each future returns the name of the cache which failed to load, or an
+ * empty string.
+ */
+static std::vector<std::future<std::string> > StartLoadingCaches()
+{
+    std::vector<std::future<std::string> > vLoads;
+    vLoads.push_back(std::async(std::launch::async, [] {
+        RenameThread("qstees-loadmn");
+        if (!LoadCache("mncache.dat", "magicMasternodeCache", mnodeman))
+            return std::string("mncache.dat");
+        if (mnodeman.size() == 0) {
+            LogPrintf("Masternode cache is empty, skipping payments cache...\n");
+            return std::string();
+        }
+        if (!LoadCache("mnpayments.dat", "magicMasternodePaymentsCache", mnpayments))
+            return std::string("mnpayments.dat");
+        return std::string();
+    }));
+    vLoads.push_back(std::async(std::launch::async, [] {
+        RenameThread("qstees-loadnf");
+        if (!LoadCache("netfulfilled.dat", "magicFulfilledCache", netfulfilledman))
+            return std::string("netfulfilled.dat");
+        return std::string();
+    }));
+    vLoads.push_back(std::async(std::launch::async, [] {
+        RenameThread("qstees-loadinf");
+        if (!LoadCache("infinitynode.dat", "magicInfinityNodeCache", infnodeman))
+            return std::string("infinitynode.dat");
+        if (!LoadCache("infinitynodersv.dat", "magicInfinityRSV", infnodersv))
+            return std::string("infinitynodersv.dat");
+        return std::string();
+    }));
+    return vLoads;
+}
+
 /** Sanity checks
  *  Ensure that QSTEES is running in a usable environment with all
  *  necessary library support.
@@ -1279,59 +1348,6 @@ bool AppInitLockDataDirectory()
     return true;
 }
 
-//TODO: Rename/move to core
-void ThreadCheckInfinityNode(CConnman& connman)
-{
-    if(fLiteMode) return; // disable all Dash specific functionality
-
-    static bool fOneThread;
-    if(fOneThread) return;
-    fOneThread = true;
-
-    RenameThread("qsteesovate-ps");
-
-    unsigned int nTick = 0;
-
-    while (true)
-    {
-        MilliSleep(1000);
-
-        // try to sync from all available nodes, one step at a time
-        masternodeSync.ProcessTick(connman);
-        if(masternodeSync.IsBlockchainSynced() && !ShutdownRequested() && masternodeSync.IsSynced()) {
-
-            nTick++;
-            LogPrintf("nTick: %d\n",nTick);
-
-            // make sure to check all masternodes first
-            mnodeman.Check();
-
-            // check if we should activate or ping every few minutes,
-            // slightly postpone first run to give net thread a chance to connect to some peers
-            if(nTick % MASTERNODE_MIN_MNP_SECONDS == 15)
-                activeMasternode.ManageState(connman);
-            if(nTick % 60 == 0) {
-                netfulfilledman.CheckAndRemove();
-                mnodeman.ProcessMasternodeConnections(connman);
-                mnodeman.CheckAndRemove(connman);
-                mnpayments.CheckAndRemove();
-                instantsend.CheckAndRemove();
-            }
-            if(fMasterNode && (nTick % (60 * 5) == 0)) {
-                mnodeman.DoFullVerificationStep(connman);
-            }
-            if(nTick % (60 * 5) == 0) {
-                infnodeman.CheckAndRemove(connman);
-                mnodeman.CheckAndRemoveBurnFundNotUniqueNode(connman);
-                mnodeman.CheckAndRemoveLimitNumberNode(connman, 1, Params().GetConsensus().nLimitQSTEESNODE_1);
-                mnodeman.CheckAndRemoveLimitNumberNode(connman, 5, Params().GetConsensus().nLimitQSTEESNODE_5);
-                mnodeman.CheckAndRemoveLimitNumberNode(connman, 10, Params().GetConsensus().nLimitQSTEESNODE_10);
-            }
-        }
-    }
-}
-
-
 bool AppInitMain()
 {
     const CChainParams& chainparams = Params();
@@ -1368,6 +1384,7 @@ bool AppInitMain()
     }
 
     InitSignatureCache();
+    CHashSigner::InitSignatureCache();
     InitScriptExecutionCache();
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
@@ -1565,6 +1582,12 @@ bool AppInitMain()
         nMaxOutboundLimit = gArgs.GetArg("-maxuploadtarget", DEFAULT_MAX_UPLOAD_TARGET)*1024*1024;
     }
 
+    // ********************************************************* Step 6b: start loading cache data
+
+    // the futures wait for the loads when they go out of scope, also on the early returns below.
+    // pdsNotificationInterface leaves the managers alone until step 11b, they load meanwhile
+    std::vector<std::future<std::string> > vCacheLoads = StartLoadingCaches();
+
     // ********************************************************* Step 7: load block chain
 
     fReindex = gArgs.GetBoolArg("-reindex", false);
@@ -1909,46 +1932,47 @@ bool AppInitMain()
 
     // LOAD SERIALIZED DAT FILES INTO DATA CACHES FOR INTERNAL USE
 
-    boost::filesystem::path pathDB = GetDataDir();
-    std::string strDBName;
-
-    strDBName = "mncache.dat";
-    uiInterface.InitMessage(_("Loading masternode cache..."));
-    CFlatDB<CMasternodeMan> flatdb1(strDBName, "magicMasternodeCache");
-    if(!flatdb1.Load(mnodeman)) {
-        return InitError(_("Failed to load masternode cache from") + "\n" + (pathDB / strDBName).string());
+    uiInterface.InitMessage(_("Loading masternode and infinitynode caches..."));
+    int64_t nCacheWaitStart = GetTimeMillis();
+    std::string strFailedCache;
+    for (auto& load : vCacheLoads) {
+        std::string strDBName = load.get();
+        if (strFailedCache.empty()) strFailedCache = strDBName;
+    }
+    vCacheLoads.clear();
+    LogPrintf("Waited %dms for the cache data\n", GetTimeMillis() - nCacheWaitStart);
+
+    if (!strFailedCache.empty()) {
+        std::string strError;
+        if (strFailedCache == "mncache.dat")
+            strError = _("Failed to load masternode cache from");
+        else if (strFailedCache == "mnpayments.dat")
+            strError = _("Failed to load masternode payments cache from");
+        else if (strFailedCache == "netfulfilled.dat")
+            strError = _("Failed to load fulfilled requests cache from");
+        else if (strFailedCache == "infinitynode.dat")
+            strError = _("Failed to load infinitynode cache from");
+        else
+            strError = _("Failed to load RSV vote cache from");
+        return InitError(strError + "\n" + (GetDataDir() / strFailedCache).string());
     }
 
-    if(mnodeman.size()) {
-        strDBName = "mnpayments.dat";
-        uiInterface.InitMessage(_("Loading masternode payment cache..."));
-        CFlatDB<CMasternodePayments> flatdb2(strDBName, "magicMasternodePaymentsCache");
-        if(!flatdb2.Load(mnpayments)) {
-            return InitError(_("Failed to load masternode payments cache from") + "\n" + (pathDB / strDBName).string());
+    // the blocks connected while the caches loaded were not notified to the managers, catch up to the tip
+    pdsNotificationInterface->SetCachesLoaded();
+    {
+        const CBlockIndex* pindexTip;
+        {
+            LOCK(cs_main);
+            pindexTip = chainActive.Tip();
+        }
+        if (pindexTip != nullptr) {
+            uiInterface.InitMessage(_("Update infinitynode RSV..."));
+            infnodersv.UpdatedBlockTip(pindexTip);
+            uiInterface.InitMessage(_("Update infinitynode last paid..."));
+            infnodeman.CatchUpLastPaid(pindexTip);
+            uiInterface.InitMessage(_("Update masternode last paid..."));
+            mnodeman.CatchUpLastPaid(pindexTip);
         }
-    } else {
-        uiInterface.InitMessage(_("Masternode cache is empty, skipping payments cache..."));
-    }
-
-    strDBName = "netfulfilled.dat";
-    uiInterface.InitMessage(_("Loading fulfilled requests cache..."));
-    CFlatDB<CNetFulfilledRequestManager> flatdb4(strDBName, "magicFulfilledCache");
-    if(!flatdb4.Load(netfulfilledman)) {
-        return InitError(_("Failed to load fulfilled requests cache from") + "\n" + (pathDB / strDBName).string());
-    }
-
-    strDBName = "infinitynode.dat";
-    uiInterface.InitMessage(_("Loading on-chain infinitynode list..."));
-    CFlatDB<CInfinitynodeMan> flatdb5(strDBName, "magicInfinityNodeCache");
-    if(!flatdb5.Load(infnodeman)) {
-        return InitError(_("Failed to load infinitynode cache from") + "\n" + (pathDB / strDBName).string());
-    }
-
-    strDBName = "infinitynodersv.dat";
-    uiInterface.InitMessage(_("Loading infinitynode RSV..."));
-    CFlatDB<CInfinitynodersv> flatdb6(strDBName, "magicInfinityRSV");
-    if(!flatdb6.Load(infnodersv)) {
-        return InitError(_("Failed to load RSV vote cache from") + "\n" + (pathDB / strDBName).string());
     }
 
     LogPrintf("InfinityNode last scan height: %d and active Height: %d\n", infnodeman.getLastScan(), chainActive.Height());
@@ -1976,7 +2000,11 @@ bool AppInitMain()
 
     // ********************************************************* Step 11d: start dash-ps-<smth> threads
 
-    threadGroup.create_thread(boost::bind(&ThreadCheckInfinityNode, boost::ref(*g_connman)));
+    flatdbwriter.Start();
+    if (!fLiteMode) {
+        mnjobs.Start(*g_connman);
+        sigverifyqueue.Start(GetSigVerifyThreads());
+    }
 
 	// ********************************************************* Step 12: start node
 
@@ -0,0 +1,193 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <instantsendstats.h>
+
+#include <utiltime.h>
+
+#include <algorithm>
+#include <vector>
+
+int64_t CTxLockTiming::GetLastEventTime() const
+{
+    return std::max({nTimeFirstSeen, nTimeRequest, nTimeLastVote, nTimeLocked, nTimeMempool});
+}
+
+UniValue CTxLockTiming::ToJSON() const
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("txid", txHash.ToString()));
+    obj.push_back(Pair("firstseen", nTimeFirstSeen));
+    obj.push_back(Pair("request", nTimeRequest));
+    obj.push_back(Pair("firstvote", nTimeFirstVote));
+    obj.push_back(Pair("lastvote", nTimeLastVote));
+    obj.push_back(Pair("locked", nTimeLocked));
+    obj.push_back(Pair("mempool", nTimeMempool));
+    obj.push_back(Pair("votes", nVotes));
+    obj.push_back(Pair("orphanvotes", nOrphanVotes));
+    return obj;
+}
+
+CTxLockTiming& CInstantSendStats::GetTiming(const uint256& txHash, int64_t nNow)
+{
+    AssertLockHeld(cs);
+    CTxLockTiming& timing = mapTimings[txHash];
+    if (timing.nTimeFirstSeen == 0) {
+        timing.txHash = txHash;
+        timing.nTimeFirstSeen = nNow;
+    }
+    return timing;
+}
+
+void CInstantSendStats::AddSample(std::deque<int64_t>& deque, int64_t nLatency)
+{
+    deque.push_back(std::max<int64_t>(nLatency, 0));
+    if (deque.size() > INSTANTSEND_STATS_MAX_SAMPLES) deque.pop_front();
+}
+
+UniValue CInstantSendStats::LatencyToJSON(const std::deque<int64_t>& deque)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("samples", (int64_t)deque.size()));
+    if (deque.empty()) return obj;
+
+    std::vector<int64_t> vSorted(deque.begin(), deque.end());
+    std::sort(vSorted.begin(), vSorted.end());
+    auto percentile = [&vSorted](int nPercent) {
+        return vSorted[(vSorted.size() - 1) * nPercent / 100] / 1000.0;
+    };
+    obj.push_back(Pair("p50", percentile(50)));
+    obj.push_back(Pair("p90", percentile(90)));
+    obj.push_back(Pair("p99", percentile(99)));
+    obj.push_back(Pair("max", vSorted.back() / 1000.0));
+    return obj;
+}
+
+static UniValue DistributionToJSON(const std::map<int, int64_t>& mapDistribution)
+{
+    UniValue obj(UniValue::VOBJ);
+    for (const auto& pair : mapDistribution) {
+        obj.push_back(Pair(std::to_string(pair.first), pair.second));
+    }
+    return obj;
+}
+
+void CInstantSendStats::RequestReceived(const uint256& txHash)
+{
+    int64_t nNow = GetTimeMicros();
+    LOCK(cs);
+    CTxLockTiming& timing = GetTiming(txHash, nNow);
+    // the request is processed again once its orphan votes show up
+    if (timing.nTimeRequest != 0) return;
+    timing.nTimeRequest = nNow;
+    nRequests++;
+    // votes counted before the request were there right away
+    if (timing.nTimeFirstVote != 0) AddSample(dequeFirstVoteLatency, 0);
+}
+
+void CInstantSendStats::VoteOrphaned(const uint256& txHash)
+{
+    int64_t nNow = GetTimeMicros();
+    LOCK(cs);
+    nOrphanVotes++;
+    GetTiming(txHash, nNow);
+}
+
+void CInstantSendStats::VoteCounted(const uint256& txHash, bool fWasOrphan)
+{
+    int64_t nNow = GetTimeMicros();
+    LOCK(cs);
+    nVotes++;
+    CTxLockTiming& timing = GetTiming(txHash, nNow);
+    if (timing.nTimeFirstVote == 0) {
+        timing.nTimeFirstVote = nNow;
+        if (timing.nTimeRequest != 0) AddSample(dequeFirstVoteLatency, nNow - timing.nTimeRequest);
+    }
+    timing.nTimeLastVote = nNow;
+    timing.nVotes++;
+    if (fWasOrphan) timing.nOrphanVotes++;
+}
+
+void CInstantSendStats::MempoolAccepted(const uint256& txHash)
+{
+    int64_t nNow = GetTimeMicros();
+    LOCK(cs);
+    auto it = mapTimings.find(txHash);
+    if (it == mapTimings.end() || it->second.nTimeMempool != 0) return;
+    it->second.nTimeMempool = nNow;
+    if (it->second.nTimeRequest != 0) AddSample(dequeMempoolLatency, nNow - it->second.nTimeRequest);
+}
+
+bool CInstantSendStats::LockCompleted(const uint256& txHash, CTxLockTiming& timingRet)
+{
+    int64_t nNow = GetTimeMicros();
+    LOCK(cs);
+    auto it = mapTimings.find(txHash);
+    if (it == mapTimings.end() || it->second.nTimeLocked != 0) return false;
+    CTxLockTiming& timing = it->second;
+    timing.nTimeLocked = nNow;
+    nLocks++;
+    if (timing.nTimeRequest != 0) AddSample(dequeLockLatency, nNow - timing.nTimeRequest);
+    mapVotesPerLock[timing.nVotes]++;
+    mapOrphanVotesPerLock[timing.nOrphanVotes]++;
+    timingRet = timing;
+    return true;
+}
+
+void CInstantSendStats::CandidateRemoved(const uint256& txHash)
+{
+    LOCK(cs);
+    auto it = mapTimings.find(txHash);
+    if (it == mapTimings.end()) return;
+    if (it->second.nTimeRequest != 0 && it->second.nTimeLocked == 0) {
+        nFailed++;
+        mapVotesPerFailedLock[it->second.nVotes]++;
+    }
+    mapTimings.erase(it);
+}
+
+void CInstantSendStats::CheckAndRemove()
+{
+    // orphan votes for transactions which never got a lock candidate end up here
+    int64_t nTimeOldest = GetTimeMicros() - INSTANTSEND_STATS_TIMEOUT_SECONDS * 1000000;
+    LOCK(cs);
+    for (auto it = mapTimings.begin(); it != mapTimings.end();) {
+        if (it->second.GetLastEventTime() < nTimeOldest) {
+            mapTimings.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+size_t CInstantSendStats::size() const
+{
+    LOCK(cs);
+    return mapTimings.size();
+}
+
+UniValue CInstantSendStats::ToJSON() const
+{
+    LOCK(cs);
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("requests", nRequests));
+    obj.push_back(Pair("locks", nLocks));
+    obj.push_back(Pair("failed", nFailed));
+    obj.push_back(Pair("pending", (int64_t)mapTimings.size()));
+    obj.push_back(Pair("votes", nVotes));
+    obj.push_back(Pair("orphanvotes", nOrphanVotes));
+
+    UniValue objLatency(UniValue::VOBJ);
+    objLatency.push_back(Pair("firstvote", LatencyToJSON(dequeFirstVoteLatency)));
+    objLatency.push_back(Pair("lock", LatencyToJSON(dequeLockLatency)));
+    objLatency.push_back(Pair("mempool", LatencyToJSON(dequeMempoolLatency)));
+    obj.push_back(Pair("latency", objLatency));
+
+    UniValue objVotes(UniValue::VOBJ);
+    objVotes.push_back(Pair("locked", DistributionToJSON(mapVotesPerLock)));
+    objVotes.push_back(Pair("failed", DistributionToJSON(mapVotesPerFailedLock)));
+    objVotes.push_back(Pair("orphans", DistributionToJSON(mapOrphanVotesPerLock)));
+    obj.push_back(Pair("votesperlock", objVotes));
+    return obj;
+}
@@ -0,0 +1,120 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QSTEES_INSTANTSENDSTATS_H
+#define QSTEES_INSTANTSENDSTATS_H
+
+#include <serialize.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <univalue.h>
+
+#include <deque>
+#include <map>
+
+/** Latencies kept for the percentiles, the most recent ones */
+static const size_t INSTANTSEND_STATS_MAX_SAMPLES = 1000;
+/** Locks which saw no progress for that long are dropped from the stats */
+static const int64_t INSTANTSEND_STATS_TIMEOUT_SECONDS = 60 * 60;
+
+/**
+ * What happened to one transaction lock and when, times are in microseconds
+ * since the epoch and 0 when it did not happen (yet).
+ */
+struct CTxLockTiming
+{
+    uint256 txHash;
+    // the request or the first vote, whatever came first
+    int64_t nTimeFirstSeen;
+    int64_t nTimeRequest;
+    int64_t nTimeFirstVote;
+    int64_t nTimeLastVote;
+    int64_t nTimeLocked;
+    int64_t nTimeMempool;
+    // votes counted for the lock and how many of them waited as orphans first
+    int32_t nVotes;
+    int32_t nOrphanVotes;
+
+    CTxLockTiming() : nTimeFirstSeen(0), nTimeRequest(0), nTimeFirstVote(0), nTimeLastVote(0), nTimeLocked(0), nTimeMempool(0), nVotes(0), nOrphanVotes(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txHash);
+        READWRITE(nTimeFirstSeen);
+        READWRITE(nTimeRequest);
+        READWRITE(nTimeFirstVote);
+        READWRITE(nTimeLastVote);
+        READWRITE(nTimeLocked);
+        READWRITE(nTimeMempool);
+        READWRITE(nVotes);
+        READWRITE(nOrphanVotes);
+    }
+
+    int64_t GetLastEventTime() const;
+    UniValue ToJSON() const;
+};
+
+/**
+ * InstantSend lock latency and vote flow statistics.
+ *
+ * The engine reports the lock request, the votes, the mempool acceptance and
+ * the lock completion of every transaction lock; the latencies from the
+ * request are kept for the last INSTANTSEND_STATS_MAX_SAMPLES locks and the
+ * votes per lock as distributions. Every report only takes cs, which is
+ * never held while taking another lock, so the vote path pays one map lookup.
+ */
+class CInstantSendStats
+{
+    friend struct CInstantSendStatsTest; // for test access to the samples and the timings
+
+private:
+    mutable CCriticalSection cs;
+
+    std::map<uint256, CTxLockTiming> mapTimings;
+
+    // totals since start
+    int64_t nRequests;
+    int64_t nLocks;
+    int64_t nFailed;
+    int64_t nVotes;
+    int64_t nOrphanVotes;
+
+    // latencies in microseconds of the last locks
+    std::deque<int64_t> dequeFirstVoteLatency;
+    std::deque<int64_t> dequeLockLatency;
+    std::deque<int64_t> dequeMempoolLatency;
+
+    // number of locks by the votes they got
+    std::map<int, int64_t> mapVotesPerLock;
+    std::map<int, int64_t> mapVotesPerFailedLock;
+    std::map<int, int64_t> mapOrphanVotesPerLock;
+
+    CTxLockTiming& GetTiming(const uint256& txHash, int64_t nNow);
+    static void AddSample(std::deque<int64_t>& deque, int64_t nLatency);
+    static UniValue LatencyToJSON(const std::deque<int64_t>& deque);
+
+public:
+    CInstantSendStats() : nRequests(0), nLocks(0), nFailed(0), nVotes(0), nOrphanVotes(0) {}
+
+    void RequestReceived(const uint256& txHash);
+    /// A vote waits as an orphan for its masternode or its lock request
+    void VoteOrphaned(const uint256& txHash);
+    /// A vote was added to the lock, fWasOrphan when it waited as an orphan first
+    void VoteCounted(const uint256& txHash, bool fWasOrphan);
+    void MempoolAccepted(const uint256& txHash);
+    /// The lock completed, its timing is returned for the notifications
+    bool LockCompleted(const uint256& txHash, CTxLockTiming& timingRet);
+    /// The lock candidate was removed, counts as failed if it never completed
+    void CandidateRemoved(const uint256& txHash);
+    /// Drop the locks without progress for INSTANTSEND_STATS_TIMEOUT_SECONDS
+    void CheckAndRemove();
+
+    size_t size() const;
+    UniValue ToJSON() const;
+};
+
+#endif // QSTEES_INSTANTSENDSTATS_H
@@ -14,6 +14,7 @@
 #include <net.h>
 #include <protocol.h>
 #include <reverse_iterator.h>
+#include <sigverifyqueue.h>
 #include <spork.h>
 #include <sync.h>
 #include <txmempool.h>
@@ -68,27 +69,37 @@ void CInstantSend::ProcessMessage(CNode* pfrom, const std::string& strCommand, C
         // Ignore any InstantSend messages until masternode list is synced
         if(!masternodeSync.IsMasternodeListSynced()) return;
 
-        TRY_LOCK(cs_main, lockMain);
-        if(!lockMain) return;
+        {
+            LOCK(cs_instantsend);
+            if(mapTxLockVotes.count(nVoteHash)) return;
+        }
+
+        CSigVerifyQueue::SigChecks vChecks;
+        vChecks.emplace_back(CMessageSigner::GetMessageHash(vote.GetSignatureMessage()), vote.GetMasternodeSignature());
+
+        sigverifyqueue.Push(pfrom, std::move(vChecks), [this, pfrom, vote, nVoteHash, &connman]() mutable {
+            TRY_LOCK(cs_main, lockMain);
+            if(!lockMain) return;
 #ifdef ENABLE_WALLET
-        std::vector<std::shared_ptr<CWallet>> wallets = GetWallets();
-        CWallet * const pwallet = (wallets.size() > 0) ? wallets[0].get() : nullptr;
-        if (pwallet) {
-            TRY_LOCK(pwallet->cs_wallet, lockWallet);
-            if(!lockWallet) {
+            std::vector<std::shared_ptr<CWallet>> wallets = GetWallets();
+            CWallet * const pwallet = (wallets.size() > 0) ? wallets[0].get() : nullptr;
+            if (pwallet) {
+                TRY_LOCK(pwallet->cs_wallet, lockWallet);
+                if(!lockWallet) {
+                    return;
+                }
+            } else {
                 return;
             }
-        } else {
-            return;
-        }
 #endif
-        TRY_LOCK(cs_instantsend, lockInstantsend);
-        if(!lockInstantsend) return;
+            TRY_LOCK(cs_instantsend, lockInstantsend);
+            if(!lockInstantsend) return;
 
-        if(mapTxLockVotes.count(nVoteHash)) return;
-        mapTxLockVotes.insert(std::make_pair(nVoteHash, vote));
+            if(mapTxLockVotes.count(nVoteHash)) return;
+            mapTxLockVotes.insert(std::make_pair(nVoteHash, vote));
 
-        ProcessTxLockVote(pfrom, vote, connman, pwallet);
+            ProcessTxLockVote(pfrom, vote, connman, pwallet, false);
+        });
 
         return;
     }
@@ -102,11 +113,11 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
 
     // Check to see if we conflict with existing completed lock
     for (const auto& txin : txLockRequest.tx->vin) {
-        std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(txin.prevout);
-        if(it != mapLockedOutpoints.end() && it->second != txLockRequest.GetHash()) {
+        uint256 hashLocked;
+        if(mapLockedOutpoints.Get(txin.prevout, hashLocked) && hashLocked != txLockRequest.GetHash()) {
             // Conflicting with complete lock, proceed to see if we should cancel them both
             LogPrintf("CInstantSend::ProcessTxLockRequest -- WARNING: Found conflicting completed Transaction Lock, txid=%s, completed lock txid=%s\n",
-                    txLockRequest.GetHash().ToString(), it->second.ToString());
+                    txLockRequest.GetHash().ToString(), hashLocked.ToString());
         }
     }
 
@@ -137,6 +148,14 @@ bool CInstantSend::ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CCo
         return false;
     }
     LogPrintf("CInstantSend::ProcessTxLockRequest -- accepted, txid=%s\n", txHash.ToString());
+    stats.RequestReceived(txHash);
+
+    // Votes which arrived before the request can be counted now
+    auto itOrphans = mapOrphanVotesByTx.find(txHash);
+    if(itOrphans != mapOrphanVotesByTx.end() && !ProcessOrphanTxLockVotes(itOrphans->second, connman)) {
+        LOCK(cs_orphanPending);
+        setOrphanPendingTxes.insert(txHash);
+    }
 
     // Masternodes will sometimes propagate votes before the transaction is known to the client.
     // If this just happened - lock inputs, resolve conflicting locks, update transaction status
@@ -165,6 +184,7 @@ bool CInstantSend::CreateTxLockCandidate(const CTxLockRequest& txLockRequest)
             txLockCandidate.AddOutPointLock(txin.prevout);
         }
         mapTxLockCandidates.insert(std::make_pair(txHash, txLockCandidate));
+        mapLockCandidateOutpoints.Set(txHash, txLockCandidate.GetOutPoints());
     } else if (!itLockCandidate->second.txLockRequest) {
         // i.e. empty Transaction Lock Candidate was created earlier, let's update it with actual data
         itLockCandidate->second.txLockRequest = txLockRequest;
@@ -178,6 +198,7 @@ bool CInstantSend::CreateTxLockCandidate(const CTxLockRequest& txLockRequest)
         for (const auto& txin : reverse_iterate(txLockRequest.tx->vin)) {
             itLockCandidate->second.AddOutPointLock(txin.prevout);
         }
+        mapLockCandidateOutpoints.Set(txHash, itLockCandidate->second.GetOutPoints());
     } else {
         LogPrint(BCLog::INSTANTSEND, "CInstantSend::CreateTxLockCandidate -- seen, txid=%s\n", txHash.ToString());
     }
@@ -192,6 +213,7 @@ void CInstantSend::CreateEmptyTxLockCandidate(const uint256& txHash)
     LogPrintf("CInstantSend::CreateEmptyTxLockCandidate -- new, txid=%s\n", txHash.ToString());
     const CTxLockRequest txLockRequest = CTxLockRequest();
     mapTxLockCandidates.insert(std::make_pair(txHash, CTxLockCandidate(txLockRequest)));
+    mapLockCandidateOutpoints.Set(txHash, std::vector<COutPoint>());
 }
 
 void CInstantSend::Vote(const uint256& txHash, CConnman& connman)
@@ -308,7 +330,7 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate, CConnman& connman)
 }
 
 //received a consensus vote
-bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman& connman, CWallet* pwallet)
+bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman& connman, CWallet* pwallet, bool fWasOrphan)
 {
     // cs_main, cs_wallet and cs_instantsend should be already locked, but cs_wallet will only be locked if pwallet != nullptr
     AssertLockHeld(cs_main);
@@ -326,6 +348,16 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
 
     uint256 txHash = vote.GetTxHash();
 
+    if(!mnodeman.Has(vote.GetMasternodeOutpoint())) {
+        // the vote can't be checked without its masternode, keep it until the masternode shows up
+        mnodeman.AskForMN(pfrom, vote.GetMasternodeOutpoint(), connman);
+        if(!AddOrphanTxLockVote(vote, true)) return false;
+        if(!fWasOrphan) stats.VoteOrphaned(txHash);
+        LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessTxLockVote -- Orphan vote: txid=%s  masternode=%s unknown masternode\n",
+                txHash.ToString(), vote.GetMasternodeOutpoint().ToStringShort());
+        return true;
+    }
+
     if(!vote.IsValid(pfrom, connman)) {
         // could be because of missing MN
         LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessTxLockVote -- Vote is invalid, txid=%s\n", txHash.ToString());
@@ -340,10 +372,10 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
 
     std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
     if(it == mapTxLockCandidates.end() || !it->second.txLockRequest) {
-        if(!mapTxLockVotesOrphan.count(vote.GetHash())) {
+        if(!mapTxLockVotesOrphan.Contains(vote.GetHash())) {
             // start timeout countdown after the very first vote
             CreateEmptyTxLockCandidate(txHash);
-            mapTxLockVotesOrphan[vote.GetHash()] = vote;
+            if(AddOrphanTxLockVote(vote, false) && !fWasOrphan) stats.VoteOrphaned(txHash);
             LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessTxLockVote -- Orphan vote: txid=%s  masternode=%s new\n",
                     txHash.ToString(), vote.GetMasternodeOutpoint().ToStringShort());
             bool fReprocess = true;
@@ -371,19 +403,16 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
         // TODO: make sure this works good enough for multi-quorum
 
         int nMasternodeOrphanExpireTime = GetTime() + 60*10; // keep time data for 10 minutes
-        if(!mapMasternodeOrphanVotes.count(vote.GetMasternodeOutpoint())) {
-            mapMasternodeOrphanVotes[vote.GetMasternodeOutpoint()] = nMasternodeOrphanExpireTime;
-        } else {
-            int64_t nPrevOrphanVote = mapMasternodeOrphanVotes[vote.GetMasternodeOutpoint()];
-            if(nPrevOrphanVote > GetTime() && nPrevOrphanVote > GetAverageMasternodeOrphanVoteTime()) {
-                LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessTxLockVote -- masternode is spamming orphan Transaction Lock Votes: txid=%s  masternode=%s\n",
-                        txHash.ToString(), vote.GetMasternodeOutpoint().ToStringShort());
-                // Misbehaving(pfrom->id, 1);
-                return false;
-            }
-            // not spamming, refresh
-            mapMasternodeOrphanVotes[vote.GetMasternodeOutpoint()] = nMasternodeOrphanExpireTime;
+        int64_t nPrevOrphanVote = mapMasternodeOrphanVotes.GetExpireTime(vote.GetMasternodeOutpoint());
+        if(nPrevOrphanVote > GetTime() && nPrevOrphanVote > GetAverageMasternodeOrphanVoteTime()) {
+            LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessTxLockVote -- masternode is spamming orphan Transaction Lock Votes: txid=%s  masternode=%s\n",
+                    txHash.ToString(), vote.GetMasternodeOutpoint().ToStringShort());
+            // Misbehaving(pfrom->id, 1);
+            return false;
         }
+        // new or not spamming, refresh
+        mapMasternodeOrphanVotes.Set(vote.GetMasternodeOutpoint(), nMasternodeOrphanExpireTime, nMasternodeOrphanExpireTime);
+        nMasternodeOrphanVoteTimeSum += nMasternodeOrphanExpireTime - nPrevOrphanVote;
 
         return true;
     }
@@ -433,6 +462,7 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
         // this should never happen
         return false;
     }
+    stats.VoteCounted(txHash, fWasOrphan);
 
     int nSignatures = txLockCandidate.CountVotes();
     int nSignaturesMax = txLockCandidate.txLockRequest.GetMaxSignatures();
@@ -444,24 +474,126 @@ bool CInstantSend::ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman&
     return true;
 }
 
-void CInstantSend::ProcessOrphanTxLockVotes(CConnman& connman)
+bool CInstantSend::AddOrphanTxLockVote(const CTxLockVote& vote, bool fMissingMasternode)
 {
-    LOCK(cs_main);
+    AssertLockHeld(cs_instantsend);
+
+    ExpireOrphanTxLockVotes();
+
+    if(fMissingMasternode && mapTxLockVotesOrphan.size() >= (size_t)INSTANTSEND_MAX_MASTERNODE_ORPHAN_VOTES) {
+        LogPrint(BCLog::INSTANTSEND, "CInstantSend::AddOrphanTxLockVote -- too many orphan votes, dropping vote from unknown masternode %s\n",
+                vote.GetMasternodeOutpoint().ToStringShort());
+        return false;
+    }
+
+    uint256 nVoteHash = vote.GetHash();
+    if(!mapTxLockVotesOrphan.Insert(nVoteHash, vote, vote.GetTimeCreated() + INSTANTSEND_LOCK_TIMEOUT_SECONDS)) return false;
+
+    if(fMissingMasternode) {
+        mapOrphanVotesByMasternode[vote.GetMasternodeOutpoint()].insert(nVoteHash);
+    } else {
+        mapOrphanVotesByTx[vote.GetTxHash()].insert(nVoteHash);
+    }
+    return true;
+}
+
+void CInstantSend::UnindexOrphanTxLockVote(const uint256& nVoteHash, const CTxLockVote& vote)
+{
+    AssertLockHeld(cs_instantsend);
+
+    auto itByMasternode = mapOrphanVotesByMasternode.find(vote.GetMasternodeOutpoint());
+    if(itByMasternode != mapOrphanVotesByMasternode.end()) {
+        itByMasternode->second.erase(nVoteHash);
+        if(itByMasternode->second.empty()) mapOrphanVotesByMasternode.erase(itByMasternode);
+    }
+    auto itByTx = mapOrphanVotesByTx.find(vote.GetTxHash());
+    if(itByTx != mapOrphanVotesByTx.end()) {
+        itByTx->second.erase(nVoteHash);
+        if(itByTx->second.empty()) mapOrphanVotesByTx.erase(itByTx);
+    }
+}
+
+void CInstantSend::ExpireOrphanTxLockVotes()
+{
+    AssertLockHeld(cs_instantsend);
+
+    mapTxLockVotesOrphan.Expire(GetTime(), [this](const uint256& nVoteHash, CTxLockVote& vote) {
+        LogPrint(BCLog::INSTANTSEND, "CInstantSend::ExpireOrphanTxLockVotes -- Removing timed out orphan vote: txid=%s  masternode=%s\n",
+                vote.GetTxHash().ToString(), vote.GetMasternodeOutpoint().ToStringShort());
+        mapTxLockVotes.erase(nVoteHash);
+        UnindexOrphanTxLockVote(nVoteHash, vote);
+    });
+}
+
+bool CInstantSend::ProcessOrphanTxLockVotes(std::set<uint256> setVoteHashes, CConnman& connman)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_instantsend);
+
+    CWallet* pwallet = nullptr;
 #ifdef ENABLE_WALLET
     std::vector<std::shared_ptr<CWallet>> wallets = GetWallets();
-    CWallet * const pwallet = (wallets.size() > 0) ? wallets[0].get() : nullptr;
-    if (pwallet)
-        LOCK(pwallet->cs_wallet);
+    pwallet = (wallets.size() > 0) ? wallets[0].get() : nullptr;
+    // like votes from the network, nothing to do without a wallet
+    if(!pwallet) return true;
+    // cs_wallet goes before cs_instantsend, only try it
+    TRY_LOCK(pwallet->cs_wallet, lockWallet);
+    if(!lockWallet) return false;
 #endif
-    LOCK(cs_instantsend);
 
-    std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotesOrphan.begin();
-    while(it != mapTxLockVotesOrphan.end()) {
-        if(ProcessTxLockVote(NULL, it->second, connman, pwallet)) {
-            mapTxLockVotesOrphan.erase(it++);
-        } else {
-            ++it;
-        }
+    for (const auto& nVoteHash : setVoteHashes) {
+        const CTxLockVote* pvote = mapTxLockVotesOrphan.Find(nVoteHash);
+        if(!pvote) continue;
+        CTxLockVote vote = *pvote;
+        UnindexOrphanTxLockVote(nVoteHash, vote);
+        mapTxLockVotesOrphan.Erase(nVoteHash);
+        // it becomes an orphan again if it still misses something
+        ProcessTxLockVote(nullptr, vote, connman, pwallet, true);
+    }
+    return true;
+}
+
+void CInstantSend::NotifyMasternodeAdded(const COutPoint& outpointMasternode)
+{
+    // no votes are processed before the list is synced, don't collect the whole list
+    if(!masternodeSync.IsMasternodeListSynced()) return;
+
+    LOCK(cs_orphanPending);
+    setOrphanPendingMasternodes.insert(outpointMasternode);
+}
+
+void CInstantSend::ProcessPendingOrphanTxLockVotes(CConnman& connman)
+{
+    std::set<COutPoint> setMasternodes;
+    std::set<uint256> setTxes;
+    {
+        LOCK(cs_orphanPending);
+        if(setOrphanPendingMasternodes.empty() && setOrphanPendingTxes.empty()) return;
+        setMasternodes.swap(setOrphanPendingMasternodes);
+        setTxes.swap(setOrphanPendingTxes);
+    }
+
+    LOCK2(cs_main, cs_instantsend);
+
+    std::set<uint256> setVoteHashes;
+    for (const auto& outpoint : setMasternodes) {
+        auto it = mapOrphanVotesByMasternode.find(outpoint);
+        if(it != mapOrphanVotesByMasternode.end()) setVoteHashes.insert(it->second.begin(), it->second.end());
+    }
+    for (const auto& txHash : setTxes) {
+        auto it = mapOrphanVotesByTx.find(txHash);
+        if(it != mapOrphanVotesByTx.end()) setVoteHashes.insert(it->second.begin(), it->second.end());
+    }
+    if(setVoteHashes.empty()) return;
+
+    LogPrint(BCLog::INSTANTSEND, "CInstantSend::ProcessPendingOrphanTxLockVotes -- %d orphan votes for %d masternodes and %d lock requests\n",
+            setVoteHashes.size(), setMasternodes.size(), setTxes.size());
+
+    if(!ProcessOrphanTxLockVotes(setVoteHashes, connman)) {
+        // wallet busy, try again next time
+        LOCK(cs_orphanPending);
+        setOrphanPendingMasternodes.insert(setMasternodes.begin(), setMasternodes.end());
+        setOrphanPendingTxes.insert(setTxes.begin(), setTxes.end());
     }
 }
 
@@ -482,16 +614,16 @@ bool CInstantSend::IsEnoughOrphanVotesForTxAndOutPoint(const uint256& txHash, co
 {
     // Scan orphan votes to check if this outpoint has enough orphan votes to be locked in some tx.
     LOCK2(cs_main, cs_instantsend);
+    auto itByTx = mapOrphanVotesByTx.find(txHash);
+    if(itByTx == mapOrphanVotesByTx.end()) return false;
     int nCountVotes = 0;
-    std::map<uint256, CTxLockVote>::iterator it = mapTxLockVotesOrphan.begin();
-    while(it != mapTxLockVotesOrphan.end()) {
-        if(it->second.GetTxHash() == txHash && it->second.GetOutpoint() == outpoint) {
+    for (const auto& nVoteHash : itByTx->second) {
+        if(mapTxLockVotesOrphan.Find(nVoteHash)->GetOutpoint() == outpoint) {
             nCountVotes++;
             if(nCountVotes >= COutPointLock::SIGNATURES_REQUIRED) {
                 return true;
             }
         }
-        ++it;
     }
     return false;
 }
@@ -519,6 +651,10 @@ void CInstantSend::TryToFinalizeLockCandidate(const CTxLockCandidate& txLockCand
         if(ResolveConflicts(txLockCandidate)) {
             LockTransactionInputs(txLockCandidate);
             UpdateLockedTransaction(txLockCandidate);
+            CTxLockTiming timing;
+            if(IsLockedInstantSendTransaction(txHash) && stats.LockCompleted(txHash, timing)) {
+                GetMainSignals().NotifyTransactionLockTiming(timing);
+            }
         }
     }
 }
@@ -569,7 +705,7 @@ void CInstantSend::LockTransactionInputs(const CTxLockCandidate& txLockCandidate
     std::map<COutPoint, COutPointLock>::const_iterator it = txLockCandidate.mapOutPointLocks.begin();
 
     while(it != txLockCandidate.mapOutPointLocks.end()) {
-        mapLockedOutpoints.insert(std::make_pair(it->first, txHash));
+        mapLockedOutpoints.Insert(it->first, txHash);
         ++it;
     }
     LogPrint(BCLog::INSTANTSEND, "CInstantSend::LockTransactionInputs -- done, txid=%s\n", txHash.ToString());
@@ -577,11 +713,8 @@ void CInstantSend::LockTransactionInputs(const CTxLockCandidate& txLockCandidate
 
 bool CInstantSend::GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet)
 {
-    LOCK(cs_instantsend);
-    std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(outpoint);
-    if(it == mapLockedOutpoints.end()) return false;
-    hashRet = it->second;
-    return true;
+    // no cs_instantsend, called for every input of every transaction
+    return mapLockedOutpoints.Get(outpoint, hashRet);
 }
 
 bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
@@ -669,15 +802,7 @@ int64_t CInstantSend::GetAverageMasternodeOrphanVoteTime()
     // NOTE: should never actually call this function when mapMasternodeOrphanVotes is empty
     if(mapMasternodeOrphanVotes.empty()) return 0;
 
-    std::map<COutPoint, int64_t>::iterator it = mapMasternodeOrphanVotes.begin();
-    int64_t total = 0;
-
-    while(it != mapMasternodeOrphanVotes.end()) {
-        total+= it->second;
-        ++it;
-    }
-
-    return total / mapMasternodeOrphanVotes.size();
+    return nMasternodeOrphanVoteTimeSum / (int64_t)mapMasternodeOrphanVotes.size();
 }
 
 void CInstantSend::CheckAndRemove()
@@ -696,12 +821,14 @@ void CInstantSend::CheckAndRemove()
             LogPrintf("CInstantSend::CheckAndRemove -- Removing expired Transaction Lock Candidate: txid=%s\n", txHash.ToString());
             std::map<COutPoint, COutPointLock>::iterator itOutpointLock = txLockCandidate.mapOutPointLocks.begin();
             while(itOutpointLock != txLockCandidate.mapOutPointLocks.end()) {
-                mapLockedOutpoints.erase(itOutpointLock->first);
+                mapLockedOutpoints.Erase(itOutpointLock->first);
                 mapVotedOutpoints.erase(itOutpointLock->first);
                 ++itOutpointLock;
             }
             mapLockRequestAccepted.erase(txHash);
             mapLockRequestRejected.erase(txHash);
+            mapLockCandidateOutpoints.Erase(txHash);
+            stats.CandidateRemoved(txHash);
             mapTxLockCandidates.erase(itLockCandidate++);
         } else {
             ++itLockCandidate;
@@ -721,17 +848,8 @@ void CInstantSend::CheckAndRemove()
     }
 
     // remove timed out orphan votes
-    std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.begin();
-    while(itOrphanVote != mapTxLockVotesOrphan.end()) {
-        if(itOrphanVote->second.IsTimedOut()) {
-            LogPrint(BCLog::INSTANTSEND, "CInstantSend::CheckAndRemove -- Removing timed out orphan vote: txid=%s  masternode=%s\n",
-                    itOrphanVote->second.GetTxHash().ToString(), itOrphanVote->second.GetMasternodeOutpoint().ToStringShort());
-            mapTxLockVotes.erase(itOrphanVote->first);
-            mapTxLockVotesOrphan.erase(itOrphanVote++);
-        } else {
-            ++itOrphanVote;
-        }
-    }
+    ExpireOrphanTxLockVotes();
+    stats.CheckAndRemove();
 
     // remove invalid votes and votes for failed lock attempts
     itVote = mapTxLockVotes.begin();
@@ -746,16 +864,11 @@ void CInstantSend::CheckAndRemove()
     }
 
     // remove timed out masternode orphan votes (DOS protection)
-    std::map<COutPoint, int64_t>::iterator itMasternodeOrphan = mapMasternodeOrphanVotes.begin();
-    while(itMasternodeOrphan != mapMasternodeOrphanVotes.end()) {
-        if(itMasternodeOrphan->second < GetTime()) {
-            LogPrint(BCLog::INSTANTSEND, "CInstantSend::CheckAndRemove -- Removing timed out orphan masternode vote: masternode=%s\n",
-                    itMasternodeOrphan->first.ToStringShort());
-            mapMasternodeOrphanVotes.erase(itMasternodeOrphan++);
-        } else {
-            ++itMasternodeOrphan;
-        }
-    }
+    mapMasternodeOrphanVotes.Expire(GetTime(), [this](const COutPoint& outpointMasternode, int64_t& nTime) {
+        LogPrint(BCLog::INSTANTSEND, "CInstantSend::CheckAndRemove -- Removing timed out orphan masternode vote: masternode=%s\n",
+                outpointMasternode.ToStringShort());
+        nMasternodeOrphanVoteTimeSum -= nTime;
+    });
     LogPrintf("CInstantSend::CheckAndRemove -- %s\n", ToString());
 }
 
@@ -772,6 +885,8 @@ void CInstantSend::AcceptLockRequest(const CTxLockRequest& txLockRequest)
     LogPrintf("CInstantSend::AcceptLockRequest -- tx hash %s\n", txLockRequest.GetHash().ToString());
     LOCK(cs_instantsend);
     mapLockRequestAccepted.insert(make_pair(txLockRequest.GetHash(), txLockRequest));
+    // lock requests are accepted once the mempool took them
+    stats.MempoolAccepted(txLockRequest.GetHash());
 }
 
 void CInstantSend::RejectLockRequest(const CTxLockRequest& txLockRequest)
@@ -780,11 +895,30 @@ void CInstantSend::RejectLockRequest(const CTxLockRequest& txLockRequest)
     mapLockRequestRejected.insert(make_pair(txLockRequest.GetHash(), txLockRequest));
 }
 
+bool CInstantSend::IsLockRequestAccepted(const uint256& txHash)
+{
+    LOCK(cs_instantsend);
+    return mapLockRequestAccepted.count(txHash);
+}
+
+void CInstantSend::GetCompactBlockExtraTxes(std::vector<std::pair<uint256, CTransactionRef> >& vExtraTxn)
+{
+    LOCK(cs_instantsend);
+    // the mempool has the accepted ones unless they were evicted, the rejected ones
+    // lost a conflict race here but may still be mined
+    for (const auto& pair : mapTxLockCandidates) {
+        const CTxLockRequest& txLockRequest = pair.second.txLockRequest;
+        if (txLockRequest) vExtraTxn.emplace_back(txLockRequest.tx->GetWitnessHash(), txLockRequest.tx);
+    }
+    for (const auto& pair : mapLockRequestRejected) {
+        if (pair.second && !mapTxLockCandidates.count(pair.first)) vExtraTxn.emplace_back(pair.second.tx->GetWitnessHash(), pair.second.tx);
+    }
+}
+
 bool CInstantSend::HasTxLockRequest(const uint256& txHash)
 {
-    LogPrintf("CInstantSend::HasTxLockRequest -- find tx  %s\n", txHash.ToString());
-    CTxLockRequest txLockRequestTmp;
-    return GetTxLockRequest(txHash, txLockRequestTmp);
+    // no cs_instantsend and no copy of the request, called for every transaction
+    return mapLockCandidateOutpoints.Contains(txHash);
 }
 
 bool CInstantSend::GetTxLockRequest(const uint256& txHash, CTxLockRequest& txLockRequestRet)
@@ -794,7 +928,7 @@ bool CInstantSend::GetTxLockRequest(const uint256& txHash, CTxLockRequest& txLoc
     std::map<uint256, CTxLockCandidate>::iterator it = mapTxLockCandidates.find(txHash);
     if(it == mapTxLockCandidates.end()) return false;
     txLockRequestRet = it->second.txLockRequest;
-    LogPrintf("CInstantSend::GetTxLockRequest -- tx return %s\n", txHash.ToString());
+    LogPrint(BCLog::INSTANTSEND, "CInstantSend::GetTxLockRequest -- tx return %s\n", txHash.ToString());
 
     return true;
 }
@@ -827,21 +961,19 @@ bool CInstantSend::IsLockedInstantSendTransaction(const uint256& txHash)
     if(!fEnableInstantSend || fLargeWorkForkFound || fLargeWorkInvalidChainFound ||
         !sporkManager.IsSporkActive(SPORK_3_INSTANTSEND_BLOCK_FILTERING)) return false;
 
-    LOCK(cs_instantsend);
+    // served from the indexes, no cs_instantsend
 
     // there must be a lock candidate
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
-    if(itLockCandidate == mapTxLockCandidates.end()) return false;
+    std::vector<COutPoint> vOutpoints;
+    if(!mapLockCandidateOutpoints.Get(txHash, vOutpoints)) return false;
 
     // which should have outpoints
-    if(itLockCandidate->second.mapOutPointLocks.empty()) return false;
+    if(vOutpoints.empty()) return false;
 
     // and all of these outputs must be included in mapLockedOutpoints with correct hash
-    std::map<COutPoint, COutPointLock>::iterator itOutpointLock = itLockCandidate->second.mapOutPointLocks.begin();
-    while(itOutpointLock != itLockCandidate->second.mapOutPointLocks.end()) {
+    for (const auto& outpoint : vOutpoints) {
         uint256 hashLocked;
-        if(!GetLockedOutPointTxHash(itOutpointLock->first, hashLocked) || hashLocked != txHash) return false;
-        ++itOutpointLock;
+        if(!GetLockedOutPointTxHash(outpoint, hashLocked) || hashLocked != txHash) return false;
     }
 
     return true;
@@ -943,21 +1075,20 @@ void CInstantSend::SyncTransaction(const CTransaction& tx, const CBlockIndex *pb
     }
 
     // check orphan votes
-    std::map<uint256, CTxLockVote>::iterator itOrphanVote = mapTxLockVotesOrphan.begin();
-    while(itOrphanVote != mapTxLockVotesOrphan.end()) {
-        if(itOrphanVote->second.GetTxHash() == txHash) {
+    auto itOrphanVotes = mapOrphanVotesByTx.find(txHash);
+    if(itOrphanVotes != mapOrphanVotesByTx.end()) {
+        for (const auto& nVoteHash : itOrphanVotes->second) {
             LogPrint(BCLog::INSTANTSEND, "CInstantSend::SyncTransaction -- txid=%s nHeightNew=%d vote %s updated\n",
-                    txHash.ToString(), nHeightNew, itOrphanVote->first.ToString());
-            mapTxLockVotes[itOrphanVote->first].SetConfirmedHeight(nHeightNew);
+                    txHash.ToString(), nHeightNew, nVoteHash.ToString());
+            mapTxLockVotes[nVoteHash].SetConfirmedHeight(nHeightNew);
         }
-        ++itOrphanVote;
     }
 }
 
 std::string CInstantSend::ToString()
 {
     LOCK(cs_instantsend);
-    return strprintf("Lock Candidates: %llu, Votes %llu", mapTxLockCandidates.size(), mapTxLockVotes.size());
+    return strprintf("Lock Candidates: %llu, Votes %llu, Orphan votes %llu", mapTxLockCandidates.size(), mapTxLockVotes.size(), mapTxLockVotesOrphan.size());
 }
 
 //
@@ -1080,10 +1211,15 @@ uint256 CTxLockVote::GetHash() const
     return ss.GetHash();
 }
 
+std::string CTxLockVote::GetSignatureMessage() const
+{
+    return txHash.ToString() + outpoint.ToStringShort();
+}
+
 bool CTxLockVote::CheckSignature() const
 {
     std::string strError;
-    std::string strMessage = txHash.ToString() + outpoint.ToStringShort();
+    std::string strMessage = GetSignatureMessage();
 
     masternode_info_t infoMn;
 
@@ -1103,7 +1239,7 @@ bool CTxLockVote::CheckSignature() const
 bool CTxLockVote::Sign()
 {
     std::string strError;
-    std::string strMessage = txHash.ToString() + outpoint.ToStringShort();
+    std::string strMessage = GetSignatureMessage();
 
     if(!CMessageSigner::SignMessage(strMessage, vchMasternodeSignature, activeMasternode.keyMasternode)) {
         LogPrintf("CTxLockVote::Sign -- SignMessage() failed\n");
@@ -1186,6 +1322,16 @@ void CTxLockCandidate::AddOutPointLock(const COutPoint& outpoint)
     mapOutPointLocks.insert(make_pair(outpoint, COutPointLock(outpoint)));
 }
 
+std::vector<COutPoint> CTxLockCandidate::GetOutPoints() const
+{
+    std::vector<COutPoint> vOutpoints;
+    vOutpoints.reserve(mapOutPointLocks.size());
+    for (const auto& pair : mapOutPointLocks) {
+        vOutpoints.push_back(pair.first);
+    }
+    return vOutpoints;
+}
+
 void CTxLockCandidate::MarkOutpointAsAttacked(const COutPoint& outpoint)
 {
     std::map<COutPoint, COutPointLock>::iterator it = mapOutPointLocks.find(outpoint);
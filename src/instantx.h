@@ -8,10 +8,16 @@
 #define FXTC_INSTANTX_H
 
 #include <chain.h>
+#include <coins.h>
+#include <expirymap.h>
+#include <instantsendstats.h>
 #include <net.h>
+#include <shardedmap.h>
+#include <txmempool.h>
 #include <wallet/wallet.h>
 #include <primitives/transaction.h>
 
+
 class CTxLockVote;
 class COutPointLock;
 class CTxLockRequest;
@@ -41,6 +47,9 @@ static const int INSTANTSEND_LOCK_TIMEOUT_SECONDS   = 15;
 // For how long we are going to keep invalid votes and votes for failed lock attempts,
 // must be greater than INSTANTSEND_LOCK_TIMEOUT_SECONDS
 static const int INSTANTSEND_FAILED_TIMEOUT_SECONDS = 60;
+// Votes from unknown masternodes wait for the masternode as orphans, their signatures
+// can't be checked yet so they are dropped once there are that many orphan votes
+static const int INSTANTSEND_MAX_MASTERNODE_ORPHAN_VOTES = 1000;
 
 extern bool fEnableInstantSend;
 extern int nInstantSendDepth;
@@ -48,6 +57,8 @@ extern int nCompleteTXLocks;
 
 class CInstantSend
 {
+    friend struct CInstantSendBenchSetup; // for benchmarks to lock transactions without masternode votes
+
 private:
     // Keep track of current block height
     int nCachedBlockHeight;
@@ -56,23 +67,47 @@ private:
     std::map<uint256, CTxLockRequest> mapLockRequestAccepted; // tx hash - tx
     std::map<uint256, CTxLockRequest> mapLockRequestRejected; // tx hash - tx
     std::map<uint256, CTxLockVote> mapTxLockVotes; // vote hash - vote
-    std::map<uint256, CTxLockVote> mapTxLockVotesOrphan; // vote hash - vote
+    expirymap<uint256, CTxLockVote, SaltedTxidHasher> mapTxLockVotesOrphan; // vote hash - vote, expiring when it times out
+
+    // orphan votes by what they wait for, either their masternode or their lock request
+    std::map<COutPoint, std::set<uint256> > mapOrphanVotesByMasternode; // mn outpoint - vote hash set
+    std::map<uint256, std::set<uint256> > mapOrphanVotesByTx; // tx hash - vote hash set
+
+    // dependencies which showed up while their orphan votes could not be processed right away,
+    // see NotifyMasternodeAdded, protected by cs_orphanPending which is never held while taking another lock
+    CCriticalSection cs_orphanPending;
+    std::set<COutPoint> setOrphanPendingMasternodes;
+    std::set<uint256> setOrphanPendingTxes;
 
     std::map<uint256, CTxLockCandidate> mapTxLockCandidates; // tx hash - lock candidate
 
     std::map<COutPoint, std::set<uint256> > mapVotedOutpoints; // utxo - tx hash set
-    std::map<COutPoint, uint256> mapLockedOutpoints; // utxo - tx hash
+
+    // Read-mostly indexes queried for every input by mempool acceptance, block checks
+    // and the wallet. They have their own per-shard locks and are read without
+    // cs_instantsend, they are only written while holding cs_instantsend.
+    shardedmap<COutPoint, uint256, SaltedOutpointHasher> mapLockedOutpoints; // utxo - tx hash
+    shardedmap<uint256, std::vector<COutPoint>, SaltedTxidHasher> mapLockCandidateOutpoints; // tx hash - outpoints of its lock candidate
 
     //track masternodes who voted with no txreq (for DOS protection)
-    std::map<COutPoint, int64_t> mapMasternodeOrphanVotes; // mn outpoint - time
+    expirymap<COutPoint, int64_t, SaltedOutpointHasher> mapMasternodeOrphanVotes; // mn outpoint - time, expiring then
+    int64_t nMasternodeOrphanVoteTimeSum; // of mapMasternodeOrphanVotes, for GetAverageMasternodeOrphanVoteTime
+
+    // lock latency and vote flow, see getinstantsendstats
+    CInstantSendStats stats;
 
     bool CreateTxLockCandidate(const CTxLockRequest& txLockRequest);
     void CreateEmptyTxLockCandidate(const uint256& txHash);
     void Vote(CTxLockCandidate& txLockCandidate, CConnman& connman);
 
     //process consensus vote message
-    bool ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman& connman, CWallet* pwallet);
-    void ProcessOrphanTxLockVotes(CConnman& connman);
+    bool ProcessTxLockVote(CNode* pfrom, CTxLockVote& vote, CConnman& connman, CWallet* pwallet, bool fWasOrphan);
+    bool AddOrphanTxLockVote(const CTxLockVote& vote, bool fMissingMasternode);
+    /// Remove an orphan vote from the indexes by what it waits for
+    void UnindexOrphanTxLockVote(const uint256& nVoteHash, const CTxLockVote& vote);
+    void ExpireOrphanTxLockVotes();
+    /// Process again the orphan votes setVoteHashes, false when the wallet is busy
+    bool ProcessOrphanTxLockVotes(std::set<uint256> setVoteHashes, CConnman& connman);
     bool IsEnoughOrphanVotesForTx(const CTxLockRequest& txLockRequest);
     bool IsEnoughOrphanVotesForTxAndOutPoint(const uint256& txHash, const COutPoint& outpoint);
     int64_t GetAverageMasternodeOrphanVoteTime();
@@ -88,20 +123,34 @@ private:
 public:
     CCriticalSection cs_instantsend;
 
+    CInstantSend() : nCachedBlockHeight(0), nMasternodeOrphanVoteTimeSum(0) {}
+
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
 
     bool ProcessTxLockRequest(const CTxLockRequest& txLockRequest, CConnman& connman);
+
+    /// A masternode was added to the list, its orphan votes are processed again by ProcessPendingOrphanTxLockVotes
+    void NotifyMasternodeAdded(const COutPoint& outpointMasternode);
+    /// Process the orphan votes whose masternode or lock request showed up
+    void ProcessPendingOrphanTxLockVotes(CConnman& connman);
     void Vote(const uint256& txHash, CConnman& connman);
 
     bool AlreadyHave(const uint256& hash);
 
     void AcceptLockRequest(const CTxLockRequest& txLockRequest);
     void RejectLockRequest(const CTxLockRequest& txLockRequest);
+    /// The mempool accepted the lock request for txHash
+    bool IsLockRequestAccepted(const uint256& txHash);
+    /// Add the lock requests in <witness hash, tx> form, to reconstruct compact blocks from
+    void GetCompactBlockExtraTxes(std::vector<std::pair<uint256, CTransactionRef> >& vExtraTxn);
     bool HasTxLockRequest(const uint256& txHash);
     bool GetTxLockRequest(const uint256& txHash, CTxLockRequest& txLockRequestRet);
 
     bool GetTxLockVote(const uint256& hash, CTxLockVote& txLockVoteRet);
 
+    /// Lock latency percentiles and votes per lock
+    UniValue GetStats() const { return stats.ToJSON(); }
+
     bool GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet);
 
     // verify if transaction is currently locked
@@ -228,8 +277,10 @@ public:
     uint256 GetHash() const;
 
     uint256 GetTxHash() const { return txHash; }
+    int64_t GetTimeCreated() const { return nTimeCreated; }
     COutPoint GetOutpoint() const { return outpoint; }
     COutPoint GetMasternodeOutpoint() const { return outpointMasternode; }
+    const std::vector<unsigned char>& GetMasternodeSignature() const { return vchMasternodeSignature; }
 
     bool IsValid(CNode* pnode, CConnman& connman) const;
     void SetConfirmedHeight(int nConfirmedHeightIn) { nConfirmedHeight = nConfirmedHeightIn; }
@@ -237,6 +288,7 @@ public:
     bool IsTimedOut() const;
     bool IsFailed() const;
 
+    std::string GetSignatureMessage() const;
     bool Sign();
     bool CheckSignature() const;
 
@@ -297,6 +349,7 @@ public:
     uint256 GetHash() const { return txLockRequest.GetHash(); }
 
     void AddOutPointLock(const COutPoint& outpoint);
+    std::vector<COutPoint> GetOutPoints() const;
     void MarkOutpointAsAttacked(const COutPoint& outpoint);
     bool AddVote(const CTxLockVote& vote);
     bool IsAllOutPointsReady() const;
@@ -288,6 +288,14 @@ class NodeImpl : public Node
     {
         return MakeHandler(::uiInterface.NotifyAdditionalDataSyncProgressChanged.connect(fn));
     }
+    std::unique_ptr<Handler> handleNotifyInfinitynodeStatsChanged(NotifyInfinitynodeStatsChangedFn fn) override
+    {
+        return MakeHandler(::uiInterface.NotifyInfinitynodeStatsChanged.connect(fn));
+    }
+    std::unique_ptr<Handler> handleNotifyMasternodeListChanged(NotifyMasternodeListChangedFn fn) override
+    {
+        return MakeHandler(::uiInterface.NotifyMasternodeListChanged.connect(fn));
+    }
     //
 };
 
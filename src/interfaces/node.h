@@ -231,6 +231,14 @@ public:
     using NotifyAdditionalDataSyncProgressChangedFn = std::function<void(double nSyncProgress)>;
     virtual std::unique_ptr<Handler> handleNotifyAdditionalDataSyncProgressChanged(NotifyAdditionalDataSyncProgressChangedFn fn) = 0;
     //
+
+    //! Register handler for infinitynode stats changed messages.
+    using NotifyInfinitynodeStatsChangedFn = std::function<void()>;
+    virtual std::unique_ptr<Handler> handleNotifyInfinitynodeStatsChanged(NotifyInfinitynodeStatsChangedFn fn) = 0;
+
+    //! Register handler for masternode list changed messages.
+    using NotifyMasternodeListChangedFn = std::function<void()>;
+    virtual std::unique_ptr<Handler> handleNotifyMasternodeListChanged(NotifyMasternodeListChangedFn fn) = 0;
 };
 
 //! Return implementation of Node interface.
@@ -11,6 +11,7 @@
 #include <messagesigner.h>
 #include <netfulfilledman.h>
 #include <netmessagemaker.h>
+#include <sigverifyqueue.h>
 #include <spork.h>
 #include <util.h>
 #include <script/standard.h>
@@ -21,7 +22,8 @@
 /** Object for who's going to get paid on which blocks */
 CMasternodePayments mnpayments;
 
-CCriticalSection cs_vecPayees;
+const std::string CMasternodePayments::SERIALIZATION_VERSION_STRING = "CMasternodePayments-Version-1";
+
 CCriticalSection cs_mapMasternodeBlocks;
 CCriticalSection cs_mapMasternodePaymentVotes;
 
@@ -179,8 +181,115 @@ std::string GetRequiredPaymentsString(int nBlockHeight)
 void CMasternodePayments::Clear()
 {
     LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
-    mapMasternodeBlocks.clear();
-    mapMasternodePaymentVotes.clear();
+    vecBlocks.clear();
+    nLowHeight = 0;
+    nBlockCount = 0;
+    mapVoteHeights.clear();
+    payeeScripts.Clear();
+    filterSeenVotes.reset();
+}
+
+uint32_t CPayeeScriptPool::Intern(const CScript& script)
+{
+    auto it = mapIds.find(script);
+    if (it != mapIds.end()) {
+        vRefCount[it->second]++;
+        return it->second;
+    }
+
+    uint32_t nId;
+    if (!vFreeIds.empty()) {
+        nId = vFreeIds.back();
+        vFreeIds.pop_back();
+        vScripts[nId] = script;
+        vRefCount[nId] = 1;
+    } else {
+        nId = vScripts.size();
+        vScripts.push_back(script);
+        vRefCount.push_back(1);
+    }
+    mapIds.emplace(script, nId);
+    return nId;
+}
+
+void CPayeeScriptPool::Release(uint32_t nId)
+{
+    if (--vRefCount[nId] > 0) return;
+    mapIds.erase(vScripts[nId]);
+    vScripts[nId] = CScript();
+    vFreeIds.push_back(nId);
+}
+
+void CPayeeScriptPool::Clear()
+{
+    vScripts.clear();
+    vRefCount.clear();
+    vFreeIds.clear();
+    mapIds.clear();
+}
+
+CMasternodeBlockPayees* CMasternodePayments::GetBlockPayees(int nBlockHeight)
+{
+    AssertLockHeld(cs_mapMasternodeBlocks);
+
+    if (vecBlocks.empty() || nBlockHeight <= 0) return nullptr;
+    CMasternodeBlockPayees& block = vecBlocks[nBlockHeight % vecBlocks.size()];
+    return block.nBlockHeight == nBlockHeight ? &block : nullptr;
+}
+
+void CMasternodePayments::EvictBlock(CMasternodeBlockPayees& block)
+{
+    AssertLockHeld(cs_mapMasternodeBlocks);
+
+    if (block.IsEmpty()) return;
+    for (const auto& vote : block.vecVotes) {
+        mapVoteHeights.erase(vote.hash);
+    }
+    for (const auto& payee : block.vecPayees) {
+        payeeScripts.Release(payee.GetPayeeId());
+    }
+    // reset the slot so that it gives its memory back
+    block = CMasternodeBlockPayees();
+    nBlockCount--;
+}
+
+void CMasternodePayments::UpdateStorage()
+{
+    AssertLockHeld(cs_mapMasternodeBlocks);
+
+    int nLimit = GetStorageLimit();
+    int nSize = nLimit + MNPAYMENTS_FUTURE_BLOCKS + 1;
+    int nLowHeightNew = std::max(1, nCachedBlockHeight - nLimit);
+
+    if ((int)vecBlocks.size() < nSize || (int)vecBlocks.size() > nSize * 5 / 4) {
+        // the limit follows the size of the masternode list, move the blocks to a ring of the new size
+        // when it outgrows the ring or leaves much of it unused
+        std::vector<CMasternodeBlockPayees> vecOld;
+        vecOld.swap(vecBlocks);
+        vecBlocks.resize(nSize);
+        for (auto& block : vecOld) {
+            if (block.IsEmpty()) continue;
+            CMasternodeBlockPayees& slot = vecBlocks[block.nBlockHeight % nSize];
+            if (block.nBlockHeight < nLowHeightNew || slot.nBlockHeight > block.nBlockHeight) {
+                EvictBlock(block);
+                continue;
+            }
+            EvictBlock(slot);
+            slot = std::move(block);
+        }
+        LogPrint(BCLog::MNPAYMENTS, "CMasternodePayments::UpdateStorage -- %d blocks of votes stored\n", nSize);
+    } else {
+        // free the blocks which went below the limit since the last call, usually the one below the new tip
+        int nRingSize = vecBlocks.size();
+        for (int h = std::max(nLowHeight, nLowHeightNew - nRingSize); h < nLowHeightNew; h++) {
+            CMasternodeBlockPayees& block = vecBlocks[h % nRingSize];
+            if (!block.IsEmpty() && block.nBlockHeight < nLowHeightNew) {
+                LogPrint(BCLog::MNPAYMENTS, "CMasternodePayments::UpdateStorage -- Removing old Masternode payment votes: nBlockHeight=%d\n", block.nBlockHeight);
+                EvictBlock(block);
+            }
+        }
+    }
+    nLowHeight = nLowHeightNew;
 }
 
 bool CMasternodePayments::CanVote(COutPoint outMasternode, int nBlockHeight)
@@ -316,14 +425,14 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, const std::string& strCom
         int nCountNeeded;
         vRecv >> nCountNeeded;
 
-        if(netfulfilledman.HasFulfilledRequest(pfrom->addr, NetMsgType::MASTERNODEPAYMENTSYNC)) {
+        if(netfulfilledman.HasFulfilledRequest(pfrom->addr, FULFILLED_MASTERNODE_PAYMENT_VOTES)) {
             LOCK(cs_main);
             // Asking for the payments list multiple times in a short period of time is no good
             LogPrintf("MASTERNODEPAYMENTSYNC -- peer already asked me for the list, peer=%d\n", pfrom->GetId());
             Misbehaving(pfrom->GetId(), 20);
             return;
         }
-        netfulfilledman.AddFulfilledRequest(pfrom->addr, NetMsgType::MASTERNODEPAYMENTSYNC);
+        netfulfilledman.AddFulfilledRequest(pfrom->addr, FULFILLED_MASTERNODE_PAYMENT_VOTES);
 
         Sync(pfrom, connman);
         LogPrintf("MASTERNODEPAYMENTSYNC -- Sent Masternode payment votes to peer %d\n", pfrom->GetId());
@@ -344,84 +453,94 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, const std::string& strCom
         // Ignore any payments messages until masternode list is synced
         if(!masternodeSync.IsMasternodeListSynced()) return;
 
+        if(HasVerifiedPaymentVote(nHash)) return;
         {
             LOCK(cs_mapMasternodePaymentVotes);
-            if(mapMasternodePaymentVotes.count(nHash)) {
+            if(!filterSeenVotes) filterSeenVotes.reset(new CRollingBloomFilter(MNPAYMENTS_SEEN_VOTES, 0.000001));
+            if(filterSeenVotes->contains(nHash)) {
                 //LogPrint(BCLog::MNPAYMENTS, "MASTERNODEPAYMENTVOTE -- hash=%s, nHeight=%d seen\n", nHash.ToString(), nCachedBlockHeight);
                 return;
             }
 
-            // Avoid processing same vote multiple times
-            mapMasternodePaymentVotes[nHash] = vote;
-            // but first mark vote as non-verified,
-            // AddPaymentVote() below should take care of it if vote is actually ok
-            mapMasternodePaymentVotes[nHash].MarkAsNotVerified();
+            // Avoid processing same vote multiple times,
+            // AddPaymentVote() below stores it if vote is actually ok
+            filterSeenVotes->insert(nHash);
         }
 
         int nFirstBlock = nCachedBlockHeight - GetStorageLimit();
-        if(vote.nBlockHeight < nFirstBlock || vote.nBlockHeight > nCachedBlockHeight+20) {
+        if(vote.nBlockHeight < nFirstBlock || vote.nBlockHeight > nCachedBlockHeight + MNPAYMENTS_FUTURE_BLOCKS) {
             //LogPrint(BCLog::MNPAYMENTS, "MASTERNODEPAYMENTVOTE -- vote out of range: nFirstBlock=%d, nBlockHeight=%d, nHeight=%d\n", nFirstBlock, vote.nBlockHeight, nCachedBlockHeight);
             return;
         }
 
-        std::string strError = "";
-        if(!vote.IsValid(pfrom, nCachedBlockHeight, strError, connman)) {
-            LogPrint(BCLog::MNPAYMENTS, "MASTERNODEPAYMENTVOTE -- invalid message, error: %s\n", strError);
-            return;
-        }
+        CSigVerifyQueue::SigChecks vChecks;
+        vChecks.emplace_back(CMessageSigner::GetMessageHash(vote.GetSignatureMessage()), vote.vchSig);
 
-        if(!CanVote(vote.vinMasternode.prevout, vote.nBlockHeight)) {
-            LogPrintf("MASTERNODEPAYMENTVOTE -- masternode already voted, masternode=%s\n", vote.vinMasternode.prevout.ToStringShort());
-            return;
-        }
+        sigverifyqueue.Push(pfrom, std::move(vChecks), [this, pfrom, vote, &connman]() mutable {
+            std::string strError = "";
+            if(!vote.IsValid(pfrom, nCachedBlockHeight, strError, connman)) {
+                LogPrint(BCLog::MNPAYMENTS, "MASTERNODEPAYMENTVOTE -- invalid message, error: %s\n", strError);
+                return;
+            }
 
-        masternode_info_t mnInfo;
-        if(!mnodeman.GetMasternodeInfo(vote.vinMasternode.prevout, mnInfo)) {
-            // mn was not found, so we can't check vote, some info is probably missing
-            LogPrintf("MASTERNODEPAYMENTVOTE -- masternode is missing %s\n", vote.vinMasternode.prevout.ToStringShort());
-            mnodeman.AskForMN(pfrom, vote.vinMasternode.prevout, connman);
-            return;
-        }
+            if(!CanVote(vote.vinMasternode.prevout, vote.nBlockHeight)) {
+                LogPrintf("MASTERNODEPAYMENTVOTE -- masternode already voted, masternode=%s\n", vote.vinMasternode.prevout.ToStringShort());
+                return;
+            }
 
-        int nDos = 0;
-        if(!vote.CheckSignature(mnInfo.pubKeyMasternode, nCachedBlockHeight, nDos)) {
-            if(nDos) {
-                LOCK(cs_main);
-                LogPrintf("MASTERNODEPAYMENTVOTE -- ERROR: invalid signature\n");
-                Misbehaving(pfrom->GetId(), nDos);
-            } else {
-                // only warn about anything non-critical (i.e. nDos == 0) in debug mode
-                LogPrint(BCLog::MNPAYMENTS, "MASTERNODEPAYMENTVOTE -- WARNING: invalid signature\n");
+            masternode_info_t mnInfo;
+            if(!mnodeman.GetMasternodeInfo(vote.vinMasternode.prevout, mnInfo)) {
+                // mn was not found, so we can't check vote, some info is probably missing
+                LogPrintf("MASTERNODEPAYMENTVOTE -- masternode is missing %s\n", vote.vinMasternode.prevout.ToStringShort());
+                mnodeman.AskForMN(pfrom, vote.vinMasternode.prevout, connman);
+                return;
             }
-            // Either our info or vote info could be outdated.
-            // In case our info is outdated, ask for an update,
-            mnodeman.AskForMN(pfrom, vote.vinMasternode.prevout, connman);
-            // but there is nothing we can do if vote info itself is outdated
-            // (i.e. it was signed by a mn which changed its key),
-            // so just quit here.
-            return;
-        }
 
-        CTxDestination address1;
-        ExtractDestination(vote.payee, address1);
-        std::string address2 = EncodeDestination(address1);
+            int nDos = 0;
+            if(!vote.CheckSignature(mnInfo.pubKeyMasternode, nCachedBlockHeight, nDos)) {
+                if(nDos) {
+                    LOCK(cs_main);
+                    LogPrintf("MASTERNODEPAYMENTVOTE -- ERROR: invalid signature\n");
+                    Misbehaving(pfrom->GetId(), nDos);
+                } else {
+                    // only warn about anything non-critical (i.e. nDos == 0) in debug mode
+                    LogPrint(BCLog::MNPAYMENTS, "MASTERNODEPAYMENTVOTE -- WARNING: invalid signature\n");
+                }
+                // Either our info or vote info could be outdated.
+                // In case our info is outdated, ask for an update,
+                mnodeman.AskForMN(pfrom, vote.vinMasternode.prevout, connman);
+                // but there is nothing we can do if vote info itself is outdated
+                // (i.e. it was signed by a mn which changed its key),
+                // so just quit here.
+                return;
+            }
 
-        //LogPrint(BCLog::MNPAYMENTS, "MASTERNODEPAYMENTVOTE -- vote: address=%s, nBlockHeight=%d, nHeight=%d, prevout=%s, hash=%s new\n",
-        //            address2, vote.nBlockHeight, nCachedBlockHeight, vote.vinMasternode.prevout.ToStringShort(), nHash.ToString());
+            CTxDestination address1;
+            ExtractDestination(vote.payee, address1);
+            std::string address2 = EncodeDestination(address1);
 
-        if(AddPaymentVote(vote)){
-            vote.Relay(connman);
-            masternodeSync.BumpAssetLastTime("MASTERNODEPAYMENTVOTE");
-        }
+            //LogPrint(BCLog::MNPAYMENTS, "MASTERNODEPAYMENTVOTE -- vote: address=%s, nBlockHeight=%d, nHeight=%d, prevout=%s, hash=%s new\n",
+            //            address2, vote.nBlockHeight, nCachedBlockHeight, vote.vinMasternode.prevout.ToStringShort(), nHash.ToString());
+
+            if(AddPaymentVote(vote)){
+                vote.Relay(connman);
+                masternodeSync.BumpAssetLastTime("MASTERNODEPAYMENTVOTE");
+            }
+        });
     }
 }
 
-bool CMasternodePaymentVote::Sign()
+std::string CMasternodePaymentVote::GetSignatureMessage() const
 {
-    std::string strError;
-    std::string strMessage = vinMasternode.prevout.ToStringShort() +
+    return vinMasternode.prevout.ToStringShort() +
                 boost::lexical_cast<std::string>(nBlockHeight) +
                 ScriptToAsmStr(payee);
+}
+
+bool CMasternodePaymentVote::Sign()
+{
+    std::string strError;
+    std::string strMessage = GetSignatureMessage();
 
     if(!CMessageSigner::SignMessage(strMessage, vchSig, activeMasternode.keyMasternode)) {
         LogPrintf("CMasternodePaymentVote::Sign -- SignMessage() failed\n");
@@ -438,11 +557,10 @@ bool CMasternodePaymentVote::Sign()
 
 bool CMasternodePayments::GetBlockPayee(int nBlockHeight, int qsteestype, CScript& payee)
 {
-    if(mapMasternodeBlocks.count(nBlockHeight)){
-        return mapMasternodeBlocks[nBlockHeight].GetBestPayee(qsteestype, payee);
-    }
+    LOCK(cs_mapMasternodeBlocks);
 
-    return false;
+    const CMasternodeBlockPayees* pblock = GetBlockPayees(nBlockHeight);
+    return pblock && pblock->GetBestPayee(payeeScripts, qsteestype, payee);
 }
 
 void CMasternodePayments::NetworkDiagnostic(int nBlockHeight, int& nQSTEESNODE_1Ret, int& nQSTEESNODE_5Ret, int& nQSTEESNODE_10Ret)
@@ -450,15 +568,19 @@ void CMasternodePayments::NetworkDiagnostic(int nBlockHeight, int& nQSTEESNODE_1
 	nQSTEESNODE_1Ret = 0; nQSTEESNODE_5Ret = 0; nQSTEESNODE_10Ret = 0;
 	CScript payee;
 
-	if(mapMasternodeBlocks.count(nBlockHeight) && mapMasternodeBlocks[nBlockHeight].GetBestPayee(CMasternode::SinType::QSTEESNODE_1, payee)){
+	LOCK(cs_mapMasternodeBlocks);
+	const CMasternodeBlockPayees* pblock = GetBlockPayees(nBlockHeight);
+	if(!pblock) return;
+
+	if(pblock->GetBestPayee(payeeScripts, CMasternode::SinType::QSTEESNODE_1, payee)){
 		nQSTEESNODE_1Ret = 1;
 	}
 
-	if(mapMasternodeBlocks.count(nBlockHeight) && mapMasternodeBlocks[nBlockHeight].GetBestPayee(CMasternode::SinType::QSTEESNODE_5, payee)){
+	if(pblock->GetBestPayee(payeeScripts, CMasternode::SinType::QSTEESNODE_5, payee)){
 		nQSTEESNODE_5Ret = 1;
 	}
 
-	if(mapMasternodeBlocks.count(nBlockHeight) && mapMasternodeBlocks[nBlockHeight].GetBestPayee(CMasternode::SinType::QSTEESNODE_10, payee)){
+	if(pblock->GetBestPayee(payeeScripts, CMasternode::SinType::QSTEESNODE_10, payee)){
 		nQSTEESNODE_10Ret = 1;
 	}
 }
@@ -478,7 +600,8 @@ bool CMasternodePayments::IsScheduled(CMasternode& mn, int nNotBlockHeight)
     CScript payee;
     for (int64_t h = nCachedBlockHeight; h <= nCachedBlockHeight + 8; h++){
         if(h == nNotBlockHeight) continue;
-        if(mapMasternodeBlocks.count(h) && mapMasternodeBlocks[h].GetBestPayee(mn.GetSinTypeInt() ,payee) && mnpayee == payee) {
+        const CMasternodeBlockPayees* pblock = GetBlockPayees(h);
+        if(pblock && pblock->GetBestPayee(payeeScripts, mn.GetSinTypeInt(), payee) && mnpayee == payee) {
             return true;
         }
     }
@@ -486,6 +609,26 @@ bool CMasternodePayments::IsScheduled(CMasternode& mn, int nNotBlockHeight)
     return false;
 }
 
+void CMasternodePayments::GetScheduledPayees(int nNotBlockHeight, std::set<std::pair<int, CScript> >& setPayeesRet)
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    setPayeesRet.clear();
+    if(!masternodeSync.IsMasternodeListSynced()) return;
+
+    static const int vTypes[] = {CMasternode::SinType::QSTEESNODE_UNKNOWN, CMasternode::SinType::QSTEESNODE_1,
+                                 CMasternode::SinType::QSTEESNODE_5, CMasternode::SinType::QSTEESNODE_10};
+    CScript payee;
+    for (int64_t h = nCachedBlockHeight; h <= nCachedBlockHeight + 8; h++){
+        if(h == nNotBlockHeight) continue;
+        const CMasternodeBlockPayees* pblock = GetBlockPayees(h);
+        if(!pblock) continue;
+        for (int nType : vTypes) {
+            if(pblock->GetBestPayee(payeeScripts, nType, payee)) setPayeesRet.emplace(nType, payee);
+        }
+    }
+}
+
 bool CMasternodePayments::AddPaymentVote(const CMasternodePaymentVote& vote)
 {
     LOCK(cs_main);
@@ -495,90 +638,162 @@ bool CMasternodePayments::AddPaymentVote(const CMasternodePaymentVote& vote)
 
     if(HasVerifiedPaymentVote(vote.GetHash())) return false;
 
+    // the payee gets the type of the masternode which voted for it
+    CMasternode* pmn = mnodeman.Find(vote.vinMasternode.prevout);
+    if(pmn == NULL){
+        LogPrintf("MASTERNODEPAYMENTVOTE -- masternode is unknown %s\n", vote.vinMasternode.prevout.ToStringShort());
+        return false;
+    }
+
+    if (pmn->GetSinTypeInt() == -1){
+        pmn->Check();
+    }
+    int qsteestype = pmn->GetSinTypeInt();
+
     LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
 
-    mapMasternodePaymentVotes[vote.GetHash()] = vote;
+    if(vecBlocks.empty()) UpdateStorage();
+    return StoreVote(vote, qsteestype);
+}
+
+bool CMasternodePayments::StoreVote(const CMasternodePaymentVote& vote, int qsteestype)
+{
+    AssertLockHeld(cs_mapMasternodeBlocks);
+
+    // a vote which does not fit a record can not have a valid signature anyway
+    if(vote.vchSig.size() != CPubKey::COMPACT_SIGNATURE_SIZE) return false;
+
+    if(vecBlocks.empty() || vote.nBlockHeight < nLowHeight) return false;
+    if(nCachedBlockHeight > 0 && vote.nBlockHeight > nCachedBlockHeight + MNPAYMENTS_FUTURE_BLOCKS) return false;
 
-    if(!mapMasternodeBlocks.count(vote.nBlockHeight)) {
-       CMasternodeBlockPayees blockPayees(vote.nBlockHeight);
-       mapMasternodeBlocks[vote.nBlockHeight] = blockPayees;
+    uint256 hash = vote.GetHash();
+    if(mapVoteHeights.count(hash)) return false;
+
+    CMasternodeBlockPayees& block = vecBlocks[vote.nBlockHeight % vecBlocks.size()];
+    if(block.nBlockHeight != vote.nBlockHeight) {
+        // the slot still holds a block out of the window, keep the most recent one
+        if(block.nBlockHeight > vote.nBlockHeight) return false;
+        EvictBlock(block);
+        block.nBlockHeight = vote.nBlockHeight;
+        nBlockCount++;
     }
 
-    mapMasternodeBlocks[vote.nBlockHeight].AddPayee(vote);
+    size_t nPayee = 0;
+    while (nPayee < block.vecPayees.size() && block.vecPayees[nPayee].GetPayee(payeeScripts) != vote.payee) {
+        nPayee++;
+    }
+    if(nPayee == block.vecPayees.size()) {
+        if(nPayee > std::numeric_limits<uint16_t>::max()) return false;
+        block.vecPayees.emplace_back(payeeScripts.Intern(vote.payee), qsteestype);
+    }
+    block.vecPayees[nPayee].AddVote();
+
+    CMasternodePaymentVoteRecord record;
+    record.hash = hash;
+    record.outpointMasternode = vote.vinMasternode.prevout;
+    record.nPayee = nPayee;
+    std::copy(vote.vchSig.begin(), vote.vchSig.end(), record.vchSig.begin());
+    block.vecVotes.push_back(record);
+    mapVoteHeights.emplace(hash, vote.nBlockHeight);
 
     return true;
 }
 
-bool CMasternodePayments::HasVerifiedPaymentVote(uint256 hashIn)
+bool CMasternodePayments::HasVerifiedPaymentVote(const uint256& hashIn)
+{
+    // only verified votes are stored, the others are just remembered as seen
+    LOCK(cs_mapMasternodeBlocks);
+    return mapVoteHeights.count(hashIn);
+}
+
+bool CMasternodePayments::HasSeenPaymentVote(const uint256& hashIn)
 {
+    if(HasVerifiedPaymentVote(hashIn)) return true;
+
     LOCK(cs_mapMasternodePaymentVotes);
-    std::map<uint256, CMasternodePaymentVote>::iterator it = mapMasternodePaymentVotes.find(hashIn);
-    return it != mapMasternodePaymentVotes.end() && it->second.IsVerified();
+    return filterSeenVotes && filterSeenVotes->contains(hashIn);
 }
 
-void CMasternodeBlockPayees::AddPayee(const CMasternodePaymentVote& vote)
+bool CMasternodePayments::GetPaymentVote(const uint256& hashIn, CMasternodePaymentVote& voteRet)
 {
-    LOCK(cs_vecPayees);
+    LOCK(cs_mapMasternodeBlocks);
 
-    for (auto& payee : vecPayees) {
-        if (payee.GetPayee() == vote.payee) {
-            payee.AddVoteHash(vote.GetHash());
-            return;
-        }
-    }
+    auto it = mapVoteHeights.find(hashIn);
+    if(it == mapVoteHeights.end()) return false;
+    const CMasternodeBlockPayees* pblock = GetBlockPayees(it->second);
+    if(!pblock) return false;
 
-    CMasternode* pmn = mnodeman.Find(vote.vinMasternode.prevout);
-    if(pmn == NULL){
-        LogPrintf("MASTERNODEPAYMENTVOTE -- masternode is unknown %s\n", vote.vinMasternode.prevout.ToStringShort());
-        return;
+    for (const auto& record : pblock->vecVotes) {
+        if(record.hash != hashIn) continue;
+        voteRet = CMasternodePaymentVote(record.outpointMasternode, pblock->nBlockHeight, pblock->vecPayees[record.nPayee].GetPayee(payeeScripts));
+        voteRet.vchSig.assign(record.vchSig.begin(), record.vchSig.end());
+        return true;
     }
+    return false;
+}
 
-    if (pmn->GetSinTypeInt() == -1){
-        LOCK(cs_main);
-        pmn->Check();
+bool CMasternodePayments::GetBlockPaymentVotes(int nBlockHeight, std::vector<CMasternodePaymentVote>& vecVotesRet)
+{
+    LOCK(cs_mapMasternodeBlocks);
+
+    vecVotesRet.clear();
+    const CMasternodeBlockPayees* pblock = GetBlockPayees(nBlockHeight);
+    if(!pblock) return false;
+
+    vecVotesRet.reserve(pblock->vecVotes.size());
+    for (const auto& record : pblock->vecVotes) {
+        vecVotesRet.emplace_back(record.outpointMasternode, pblock->nBlockHeight, pblock->vecPayees[record.nPayee].GetPayee(payeeScripts));
+        vecVotesRet.back().vchSig.assign(record.vchSig.begin(), record.vchSig.end());
     }
+    return true;
+}
 
-    CMasternodePayee payeeNew(vote.payee, pmn->GetSinTypeInt(), vote.GetHash());
-    vecPayees.push_back(payeeNew);
+bool CMasternodePayments::HasBlockPayees(int nBlockHeight)
+{
+    LOCK(cs_mapMasternodeBlocks);
+    return GetBlockPayees(nBlockHeight) != nullptr;
 }
 
-bool CMasternodeBlockPayees::GetBestPayee(int qsteestype, CScript& payeeRet)
+bool CMasternodePayments::HasPayeeWithVotes(int nBlockHeight, const CScript& payeeIn, int nVotesReq)
 {
-    LOCK(cs_vecPayees);
+    LOCK(cs_mapMasternodeBlocks);
+
+    const CMasternodeBlockPayees* pblock = GetBlockPayees(nBlockHeight);
+    return pblock && pblock->HasPayeeWithVotes(payeeScripts, payeeIn, nVotesReq);
+}
 
+bool CMasternodeBlockPayees::GetBestPayee(const CPayeeScriptPool& scripts, int qsteestype, CScript& payeeRet) const
+{
     if(!vecPayees.size()) {
         LogPrint(BCLog::MNPAYMENTS, "CMasternodeBlockPayees::GetBestPayee -- ERROR: couldn't find any payee\n");
         return false;
     }
 
     int nVotes = -1;
-    CMasternodePayee payeetmp;
+    const CMasternodePayee* pbest = nullptr;
     for (auto& payee : vecPayees) {
+        if (payee.GetSinType() != qsteestype) continue;
         //first candidate OR not the same vote
-        if (payee.GetVoteCount() > nVotes && payee.GetSinType() == qsteestype) {
+        if (payee.GetVoteCount() > nVotes) {
             nVotes = payee.GetVoteCount();
-
-            payeeRet = payee.GetPayee();
-            payeetmp = payee;
+            pbest = &payee;
         }
         //found someone with the same vote
-        if (payee.GetVoteCount() == nVotes && payee.GetSinType() == qsteestype) {
-            if (UintToArith256(payee.GetHash()) > UintToArith256(payeetmp.GetHash())){
-                 payeeRet = payee.GetPayee();
-                 payeetmp = payee;
+        else if (payee.GetVoteCount() == nVotes) {
+            if (UintToArith256(payee.GetHash(scripts)) > UintToArith256(pbest->GetHash(scripts))){
+                 pbest = &payee;
             }
         }
     }
 
+    if (pbest) payeeRet = pbest->GetPayee(scripts);
     return (nVotes > -1);
 }
 
-bool CMasternodeBlockPayees::HasPayeeWithVotes(const CScript& payeeIn, int nVotesReq)
+bool CMasternodeBlockPayees::HasPayeeWithVotes(const CPayeeScriptPool& scripts, const CScript& payeeIn, int nVotesReq) const
 {
-    LOCK(cs_vecPayees);
-
     for (auto& payee : vecPayees) {
-        if (payee.GetVoteCount() >= nVotesReq && payee.GetPayee() == payeeIn) {
+        if (payee.GetVoteCount() >= nVotesReq && payee.GetPayee(scripts) == payeeIn) {
             return true;
         }
     }
@@ -586,10 +801,8 @@ bool CMasternodeBlockPayees::HasPayeeWithVotes(const CScript& payeeIn, int nVote
     return false;
 }
 
-bool CMasternodeBlockPayees::IsTransactionValid(const CTransactionRef txNew)
+bool CMasternodeBlockPayees::IsTransactionValid(const CPayeeScriptPool& scripts, const CTransactionRef txNew) const
 {
-    LOCK(cs_vecPayees);
-
     int nMaxSignatures = 0;
     std::string strPayeesPossible = "";
 	std::string strPayeesInTx = "";
@@ -617,13 +830,13 @@ bool CMasternodeBlockPayees::IsTransactionValid(const CTransactionRef txNew)
 			} else {
 				for (auto& payee : vecPayees) {
 					CAmount nMasternodePayment = GetMasternodePayment(nBlockHeight, payee.GetSinType());
-					if (payee.GetPayee() == txout.scriptPubKey && (nMasternodePayment == txout.nValue || payee.GetVoteCount() >= (MNPAYMENTS_SIGNATURES_REQUIRED - 1))){
+					if (payee.GetPayee(scripts) == txout.scriptPubKey && (nMasternodePayment == txout.nValue || payee.GetVoteCount() >= (MNPAYMENTS_SIGNATURES_REQUIRED - 1))){
 						LogPrintf("CMasternodeBlockPayees::IsTransactionValid -- Found required payment\n");
 						counterNodePayment ++;
 					}
 
 					CTxDestination address1;
-					ExtractDestination(payee.GetPayee(), address1);
+					ExtractDestination(payee.GetPayee(scripts), address1);
 					std::string address2 = EncodeDestination(address1);
 
 					if(strPayeesPossible == "") {
@@ -655,16 +868,14 @@ bool CMasternodeBlockPayees::IsTransactionValid(const CTransactionRef txNew)
 	}
 }
 
-std::string CMasternodeBlockPayees::GetRequiredPaymentsString()
+std::string CMasternodeBlockPayees::GetRequiredPaymentsString(const CPayeeScriptPool& scripts) const
 {
-    LOCK(cs_vecPayees);
-
     std::string strRequiredPayments = "Unknown";
 
     for (auto& payee : vecPayees)
     {
         CTxDestination address1;
-        ExtractDestination(payee.GetPayee(), address1);
+        ExtractDestination(payee.GetPayee(scripts), address1);
         std::string address2 = EncodeDestination(address1);
 
         if (strRequiredPayments != "Unknown") {
@@ -681,8 +892,9 @@ std::string CMasternodePayments::GetRequiredPaymentsString(int nBlockHeight)
 {
     LOCK(cs_mapMasternodeBlocks);
 
-    if(mapMasternodeBlocks.count(nBlockHeight)){
-        return mapMasternodeBlocks[nBlockHeight].GetRequiredPaymentsString();
+    const CMasternodeBlockPayees* pblock = GetBlockPayees(nBlockHeight);
+    if(pblock){
+        return pblock->GetRequiredPaymentsString(payeeScripts);
     }
 
     return "Unknown";
@@ -692,8 +904,9 @@ bool CMasternodePayments::IsTransactionValid(const CTransactionRef txNew, int nB
 {
     LOCK(cs_mapMasternodeBlocks);
 
-    if(mapMasternodeBlocks.count(nBlockHeight)){
-        return mapMasternodeBlocks[nBlockHeight].IsTransactionValid(txNew);
+    const CMasternodeBlockPayees* pblock = GetBlockPayees(nBlockHeight);
+    if(pblock){
+        return pblock->IsTransactionValid(payeeScripts, txNew);
     }
 
     return true;
@@ -703,22 +916,9 @@ void CMasternodePayments::CheckAndRemove()
 {
     if(!masternodeSync.IsBlockchainSynced()) return;
 
-    LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
-
-    int nLimit = GetStorageLimit();
-
-    std::map<uint256, CMasternodePaymentVote>::iterator it = mapMasternodePaymentVotes.begin();
-    while(it != mapMasternodePaymentVotes.end()) {
-        CMasternodePaymentVote vote = (*it).second;
-
-        if(nCachedBlockHeight - vote.nBlockHeight > nLimit) {
-            LogPrint(BCLog::MNPAYMENTS, "CMasternodePayments::CheckAndRemove -- Removing old Masternode payment: nBlockHeight=%d\n", vote.nBlockHeight);
-            mapMasternodePaymentVotes.erase(it++);
-            mapMasternodeBlocks.erase(vote.nBlockHeight);
-        } else {
-            ++it;
-        }
-    }
+    // blocks are evicted as the tip moves, this only follows changes of the storage limit
+    LOCK(cs_mapMasternodeBlocks);
+    UpdateStorage();
 }
 
 bool CMasternodePaymentVote::IsValid(CNode* pnode, int nValidationHeight, std::string& strError, CConnman& connman)
@@ -869,6 +1069,7 @@ void CMasternodePayments::CheckPreviousBlockVotes(int nPrevBlockHeight)
 
     LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
 
+    const CMasternodeBlockPayees* pblock = GetBlockPayees(nPrevBlockHeight);
     bool voteForSinType1 = false;
     bool voteForSinType5 = false;
     bool voteForSinType10 = false;
@@ -879,24 +1080,17 @@ void CMasternodePayments::CheckPreviousBlockVotes(int nPrevBlockHeight)
         bool found = false;
         int voteSinType = -1;
 
-        if (mapMasternodeBlocks.count(nPrevBlockHeight)) {
-            for (auto &p : mapMasternodeBlocks[nPrevBlockHeight].vecPayees) {
-                for (auto &voteHash : p.GetVoteHashes()) {
-                    if (!mapMasternodePaymentVotes.count(voteHash)) {
-                        debugStr += strprintf("CMasternodePayments::CheckPreviousBlockVotes --   could not find vote %s\n",
-                                              voteHash.ToString());
-                        continue;
-                    }
-                    auto vote = mapMasternodePaymentVotes[voteHash];
-                    if (vote.vinMasternode.prevout == mn.second.vin.prevout) {
-                        payee = vote.payee;
-                        voteSinType = p.GetSinType();
-                        found = true;
-                        if ( voteSinType == 1 ) voteForSinType1 = true;
-                        if ( voteSinType == 5 ) voteForSinType5 = true;
-                        if ( voteSinType == 10 ) voteForSinType10 = true;
-                        break;
-                    }
+        if (pblock) {
+            for (const auto &record : pblock->vecVotes) {
+                if (record.outpointMasternode == mn.second.vin.prevout) {
+                    const CMasternodePayee& p = pblock->vecPayees[record.nPayee];
+                    payee = p.GetPayee(payeeScripts);
+                    voteSinType = p.GetSinType();
+                    found = true;
+                    if ( voteSinType == 1 ) voteForSinType1 = true;
+                    if ( voteSinType == 5 ) voteForSinType5 = true;
+                    if ( voteSinType == 10 ) voteForSinType10 = true;
+                    break;
                 }
             }
         }
@@ -948,9 +1142,7 @@ bool CMasternodePaymentVote::CheckSignature(const CPubKey& pubKeyMasternode, int
     // do not ban by default
     nDos = 0;
 
-    std::string strMessage = vinMasternode.prevout.ToStringShort() +
-                boost::lexical_cast<std::string>(nBlockHeight) +
-                ScriptToAsmStr(payee);
+    std::string strMessage = GetSignatureMessage();
 
     std::string strError = "";
     if (!CMessageSigner::VerifyMessage(pubKeyMasternode, vchSig, strMessage, strError)) {
@@ -987,16 +1179,12 @@ void CMasternodePayments::Sync(CNode* pnode, CConnman& connman)
 
     int nInvCount = 0;
 
-    for (int h = nCachedBlockHeight; h < nCachedBlockHeight + 20; h++) {
-        if(mapMasternodeBlocks.count(h)) {
-            for (auto& payee : mapMasternodeBlocks[h].vecPayees) {
-                std::vector<uint256> vecVoteHashes = payee.GetVoteHashes();
-                for (auto& hash : vecVoteHashes) {
-                    if(!HasVerifiedPaymentVote(hash)) continue;
-                    pnode->PushInventory(CInv(MSG_MASTERNODE_PAYMENT_VOTE, hash));
-                    nInvCount++;
-                }
-            }
+    for (int h = nCachedBlockHeight; h < nCachedBlockHeight + MNPAYMENTS_FUTURE_BLOCKS; h++) {
+        const CMasternodeBlockPayees* pblock = GetBlockPayees(h);
+        if(!pblock) continue;
+        for (const auto& record : pblock->vecVotes) {
+            pnode->PushInventory(CInv(MSG_MASTERNODE_PAYMENT_VOTE, record.hash));
+            nInvCount++;
         }
     }
 
@@ -1017,7 +1205,7 @@ void CMasternodePayments::RequestLowDataPaymentBlocks(CNode* pnode, CConnman& co
     const CBlockIndex *pindex = chainActive.Tip();
 
     while(nCachedBlockHeight - pindex->nHeight < nLimit) {
-        if(!mapMasternodeBlocks.count(pindex->nHeight)) {
+        if(!GetBlockPayees(pindex->nHeight)) {
             // We have no idea about this block height, let's ask
             vToFetch.push_back(CInv(MSG_MASTERNODE_PAYMENT_BLOCK, pindex->GetBlockHash()));
             // We should not violate GETDATA rules
@@ -1032,12 +1220,19 @@ void CMasternodePayments::RequestLowDataPaymentBlocks(CNode* pnode, CConnman& co
         pindex = pindex->pprev;
     }
 
-    std::map<int, CMasternodeBlockPayees>::iterator it = mapMasternodeBlocks.begin();
+    // stored blocks in height order
+    std::vector<const CMasternodeBlockPayees*> vecStored;
+    for (const auto& block : vecBlocks) {
+        if (!block.IsEmpty()) vecStored.push_back(&block);
+    }
+    std::sort(vecStored.begin(), vecStored.end(), [](const CMasternodeBlockPayees* a, const CMasternodeBlockPayees* b) {
+        return a->nBlockHeight < b->nBlockHeight;
+    });
 
-    while(it != mapMasternodeBlocks.end()) {
+    for (const CMasternodeBlockPayees* pblock : vecStored) {
         int nTotalVotes = 0;
         bool fFound = false;
-        for (auto& payee : it->second.vecPayees) {
+        for (auto& payee : pblock->vecPayees) {
             if(payee.GetVoteCount() >= MNPAYMENTS_SIGNATURES_REQUIRED) {
                 fFound = true;
                 break;
@@ -1048,24 +1243,23 @@ void CMasternodePayments::RequestLowDataPaymentBlocks(CNode* pnode, CConnman& co
         // or no clear winner was found but there are at least avg number of votes
         if(fFound || nTotalVotes >= (MNPAYMENTS_SIGNATURES_TOTAL + MNPAYMENTS_SIGNATURES_REQUIRED)/2) {
             // so just move to the next block
-            ++it;
             continue;
         }
         // DEBUG
         DBG (
             // Let's see why this failed
-            for (auto& payee : it->second.vecPayees) {
+            for (auto& payee : pblock->vecPayees) {
                 CTxDestination address1;
-                ExtractDestination(payee.GetPayee(), address1);
+                ExtractDestination(payee.GetPayee(payeeScripts), address1);
                 CBitcoinAddress address2(address1);
                 printf("payee %s votes %d\n", address2.ToString().c_str(), payee.GetVoteCount());
             }
-            printf("block %d votes total %d\n", it->first, nTotalVotes);
+            printf("block %d votes total %d\n", pblock->nBlockHeight, nTotalVotes);
         )
         // END DEBUG
         // Low data block found, let's try to sync it
         uint256 hash;
-        if(GetBlockHash(hash, it->first)) {
+        if(GetBlockHash(hash, pblock->nBlockHeight)) {
             vToFetch.push_back(CInv(MSG_MASTERNODE_PAYMENT_BLOCK, hash));
         }
         // We should not violate GETDATA rules
@@ -1075,7 +1269,6 @@ void CMasternodePayments::RequestLowDataPaymentBlocks(CNode* pnode, CConnman& co
             // Start filling new batch
             vToFetch.clear();
         }
-        ++it;
     }
     // Ask for the rest of it
     if(!vToFetch.empty()) {
@@ -1088,8 +1281,10 @@ std::string CMasternodePayments::ToString() const
 {
     std::ostringstream info;
 
-    info << "Votes: " << (int)mapMasternodePaymentVotes.size() <<
-            ", Blocks: " << (int)mapMasternodeBlocks.size();
+    LOCK(cs_mapMasternodeBlocks);
+    info << "Votes: " << (int)mapVoteHeights.size() <<
+            ", Blocks: " << nBlockCount <<
+            ", Payees: " << (int)payeeScripts.size();
 
     return info.str();
 }
@@ -1110,7 +1305,11 @@ void CMasternodePayments::UpdatedBlockTip(const CBlockIndex *pindex, CConnman& c
 {
     if(!pindex) return;
 
-    nCachedBlockHeight = pindex->nHeight;
+    {
+        LOCK(cs_mapMasternodeBlocks);
+        nCachedBlockHeight = pindex->nHeight;
+        UpdateStorage();
+    }
     LogPrint(BCLog::MNPAYMENTS, "CMasternodePayments::UpdatedBlockTip -- nCachedBlockHeight=%d\n", nCachedBlockHeight);
 
     int nFutureBlock = nCachedBlockHeight + 10;
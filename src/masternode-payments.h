@@ -8,18 +8,27 @@
 #define FXTC_MASTERNODE_PAYMENTS_H
 
 #include <util.h>
+#include <bloom.h>
 #include <core_io.h>
 #include <key.h>
 #include <masternode.h>
+#include <masternodeman.h>
 #include <net_processing.h>
 #include <utilstrencodings.h>
 
+#include <array>
+#include <memory>
+#include <unordered_map>
+
 class CMasternodePayments;
 class CMasternodePaymentVote;
 class CMasternodeBlockPayees;
 
 static const int MNPAYMENTS_SIGNATURES_REQUIRED         = 6;
 static const int MNPAYMENTS_SIGNATURES_TOTAL            = 30; // number of node will vote for block
+static const int MNPAYMENTS_FUTURE_BLOCKS               = 20; // votes are accepted and synced for that many blocks above the tip
+// votes of recent blocks remembered as seen whether they were valid or not
+static const int MNPAYMENTS_SEEN_VOTES                  = 100000;
 
 //! minimum peer version that can receive and send masternode payment messages,
 //  vote for masternode and be elected as a payment winner
@@ -28,7 +37,6 @@ static const int MNPAYMENTS_SIGNATURES_TOTAL            = 30; // number of node
 static const int MIN_MASTERNODE_PAYMENT_PROTO_VERSION_1 = 250000;
 static const int MIN_MASTERNODE_PAYMENT_PROTO_VERSION_2 = 250000;
 
-extern CCriticalSection cs_vecPayees;
 extern CCriticalSection cs_mapMasternodeBlocks;
 extern CCriticalSection cs_mapMasternodePayeeVotes;
 
@@ -40,84 +48,94 @@ bool IsBlockPayeeValid(const CTransactionRef txNew, int nBlockHeight, CAmount bl
 void FillBlockPayments(CMutableTransaction& txNew, int nBlockHeight, CAmount blockReward, std::vector<CTxOut>& txoutMasternodeRet, std::vector<CTxOut>& voutSuperblockRet);
 std::string GetRequiredPaymentsString(int nBlockHeight);
 
+/** Payee scripts of the stored payment votes, each script is kept once however many blocks and votes refer to it */
+class CPayeeScriptPool
+{
+private:
+    std::vector<CScript> vScripts;
+    std::vector<int> vRefCount;
+    std::vector<uint32_t> vFreeIds;
+    std::unordered_map<CScript, uint32_t, SaltedMasternodeKeyHasher> mapIds;
+
+public:
+    /// Id of a script, adding a reference to it
+    uint32_t Intern(const CScript& script);
+    /// Drop a reference taken by Intern, the id is reused once unreferenced
+    void Release(uint32_t nId);
+    const CScript& Get(uint32_t nId) const { return vScripts[nId]; }
+    size_t size() const { return mapIds.size(); }
+    void Clear();
+};
+
 class CMasternodePayee
 {
 private:
-    CScript scriptPubKey;
+    uint32_t nPayeeId;
     int qsteestype;
-    std::vector<uint256> vecVoteHashes;
+    int nVotes;
 
 public:
     CMasternodePayee() :
-        scriptPubKey(),
+        nPayeeId(0),
         qsteestype(),
-        vecVoteHashes()
+        nVotes(0)
         {}
 
-    CMasternodePayee(CScript payee, int qsteestypeIn, uint256 hashIn) :
-        scriptPubKey(payee),
+    CMasternodePayee(uint32_t nPayeeIdIn, int qsteestypeIn) :
+        nPayeeId(nPayeeIdIn),
         qsteestype(qsteestypeIn),
-        vecVoteHashes()
-    {
-        vecVoteHashes.push_back(hashIn);
-    }
-
-    ADD_SERIALIZE_METHODS;
-
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITE(*(CScriptBase*)(&scriptPubKey));
-        READWRITE(qsteestype);
-        READWRITE(vecVoteHashes);
-    }
+        nVotes(0)
+        {}
 
-    uint256 GetHash() const
+    uint256 GetHash(const CPayeeScriptPool& scripts) const
     {
         CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-        ss << scriptPubKey;
+        ss << scripts.Get(nPayeeId);
         ss << qsteestype;
         return ss.GetHash();
     }
 
-    CScript GetPayee() { return scriptPubKey; }
-    int GetSinType() { return qsteestype; }
+    uint32_t GetPayeeId() const { return nPayeeId; }
+    const CScript& GetPayee(const CPayeeScriptPool& scripts) const { return scripts.Get(nPayeeId); }
+    int GetSinType() const { return qsteestype; }
 
-    void AddVoteHash(uint256 hashIn) { vecVoteHashes.push_back(hashIn); }
-    std::vector<uint256> GetVoteHashes() { return vecVoteHashes; }
-    int GetVoteCount() { return vecVoteHashes.size(); }
+    void AddVote() { nVotes++; }
+    int GetVoteCount() const { return nVotes; }
 };
 
-// Keep track of votes for payees from masternodes
+/** A payment vote stored in the slot of its block, the height and payee script are the slot's */
+struct CMasternodePaymentVoteRecord
+{
+    uint256 hash;
+    COutPoint outpointMasternode;
+    // index of the payee in the slot
+    uint16_t nPayee;
+    std::array<unsigned char, CPubKey::COMPACT_SIGNATURE_SIZE> vchSig;
+};
+
+// Keep track of votes for payees from masternodes, one slot of the CMasternodePayments ring
 class CMasternodeBlockPayees
 {
 public:
+    // 0 for a free slot
     int nBlockHeight;
     std::vector<CMasternodePayee> vecPayees;
+    std::vector<CMasternodePaymentVoteRecord> vecVotes;
 
     CMasternodeBlockPayees() :
         nBlockHeight(0),
-        vecPayees()
-        {}
-    CMasternodeBlockPayees(int nBlockHeightIn) :
-        nBlockHeight(nBlockHeightIn),
-        vecPayees()
+        vecPayees(),
+        vecVotes()
         {}
 
-    ADD_SERIALIZE_METHODS;
-
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITE(nBlockHeight);
-        READWRITE(vecPayees);
-    }
+    bool IsEmpty() const { return nBlockHeight == 0; }
 
-    void AddPayee(const CMasternodePaymentVote& vote);
-    bool GetBestPayee(int qsteestype, CScript& payeeRet);
-    bool HasPayeeWithVotes(const CScript& payeeIn, int nVotesReq);
+    bool GetBestPayee(const CPayeeScriptPool& scripts, int qsteestype, CScript& payeeRet) const;
+    bool HasPayeeWithVotes(const CPayeeScriptPool& scripts, const CScript& payeeIn, int nVotesReq) const;
 
-    bool IsTransactionValid(const CTransactionRef txNew);
+    bool IsTransactionValid(const CPayeeScriptPool& scripts, const CTransactionRef txNew) const;
 
-    std::string GetRequiredPaymentsString();
+    std::string GetRequiredPaymentsString(const CPayeeScriptPool& scripts) const;
 };
 
 // vote for the winning payment
@@ -162,6 +180,7 @@ public:
         return ss.GetHash();
     }
 
+    std::string GetSignatureMessage() const;
     bool Sign();
     bool CheckSignature(const CPubKey& pubKeyMasternode, int nValidationHeight, int &nDos);
 
@@ -184,6 +203,8 @@ typedef std::vector<qsteestype_pair_t> qsteestype_pair_vec_t;
 class CMasternodePayments
 {
 private:
+    static const std::string SERIALIZATION_VERSION_STRING;
+
     // masternode count times nStorageCoeff payments blocks should be stored ...
     const float nStorageCoeff;
     // ... but at least nMinBlocksToStore (payments blocks)
@@ -192,26 +213,108 @@ private:
     // Keep track of current block height
     int nCachedBlockHeight;
 
+    // votes by block, a ring indexed by height modulo its size, which covers the
+    // GetStorageLimit() blocks below the tip and the blocks votes are accepted for above it
+    std::vector<CMasternodeBlockPayees> vecBlocks;
+    // lowest height the ring may hold, slots below it were evicted
+    int nLowHeight;
+    int nBlockCount;
+    // height of each stored vote
+    std::unordered_map<uint256, int, SaltedMasternodeKeyHasher> mapVoteHeights;
+    CPayeeScriptPool payeeScripts;
+    // recently seen votes, verified or not, so that none is processed twice
+    std::unique_ptr<CRollingBloomFilter> filterSeenVotes;
+
+    /// Slot of nBlockHeight, NULL if there is none. cs_mapMasternodeBlocks must be held
+    CMasternodeBlockPayees* GetBlockPayees(int nBlockHeight);
+    /// Free a slot and forget its votes. cs_mapMasternodeBlocks must be held
+    void EvictBlock(CMasternodeBlockPayees& block);
+    /// Resize the ring to the storage limit and evict the blocks below it. cs_mapMasternodeBlocks must be held
+    void UpdateStorage();
+    /// Store a verified vote of a masternode of type qsteestype. cs_mapMasternodeBlocks must be held
+    bool StoreVote(const CMasternodePaymentVote& vote, int qsteestype);
+
 public:
-    std::map<uint256, CMasternodePaymentVote> mapMasternodePaymentVotes;
-    std::map<int, CMasternodeBlockPayees> mapMasternodeBlocks;
     std::map<COutPoint, int> mapMasternodesLastVote;
     std::map<COutPoint, int> mapMasternodesDidNotVote;
 
-    CMasternodePayments() : nStorageCoeff(1.25), nMinBlocksToStore(5000) {}
+    CMasternodePayments() : nStorageCoeff(1.25), nMinBlocksToStore(5000), nCachedBlockHeight(0), nLowHeight(0), nBlockCount(0) {}
 
-    ADD_SERIALIZE_METHODS;
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        LOCK(cs_mapMasternodeBlocks);
+        s << SERIALIZATION_VERSION_STRING;
+        WriteCompactSize(s, nBlockCount);
+        for (const auto& block : vecBlocks) {
+            if (block.IsEmpty()) continue;
+            s << block.nBlockHeight;
+            WriteCompactSize(s, block.vecPayees.size());
+            for (const auto& payee : block.vecPayees) {
+                s << *(CScriptBase*)(&payee.GetPayee(payeeScripts));
+                s << payee.GetSinType();
+            }
+            WriteCompactSize(s, block.vecVotes.size());
+            for (const auto& vote : block.vecVotes) {
+                s << vote.outpointMasternode;
+                s << vote.nPayee;
+                s.write((const char*)vote.vchSig.data(), vote.vchSig.size());
+            }
+        }
+    }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITE(mapMasternodePaymentVotes);
-        READWRITE(mapMasternodeBlocks);
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        LOCK(cs_mapMasternodeBlocks);
+        std::string strVersion;
+        s >> strVersion;
+        if (strVersion != SERIALIZATION_VERSION_STRING) {
+            throw std::ios_base::failure("CMasternodePayments: unknown version " + strVersion);
+        }
+
+        Clear();
+        UpdateStorage();
+        uint64_t nBlocks = ReadCompactSize(s);
+        for (uint64_t i = 0; i < nBlocks; i++) {
+            int nBlockHeight;
+            s >> nBlockHeight;
+            std::vector<std::pair<CScript, int> > vPayees(ReadCompactSize(s));
+            for (auto& payee : vPayees) {
+                s >> *(CScriptBase*)(&payee.first);
+                s >> payee.second;
+            }
+            uint64_t nVotes = ReadCompactSize(s);
+            for (uint64_t j = 0; j < nVotes; j++) {
+                CMasternodePaymentVote vote;
+                uint16_t nPayee;
+                std::array<unsigned char, CPubKey::COMPACT_SIGNATURE_SIZE> vchSig;
+                s >> vote.vinMasternode.prevout;
+                s >> nPayee;
+                s.read((char*)vchSig.data(), vchSig.size());
+                if (nPayee >= vPayees.size()) {
+                    throw std::ios_base::failure("CMasternodePayments: vote for an unknown payee");
+                }
+                vote.nBlockHeight = nBlockHeight;
+                vote.payee = vPayees[nPayee].first;
+                vote.vchSig.assign(vchSig.begin(), vchSig.end());
+                StoreVote(vote, vPayees[nPayee].second);
+            }
+        }
     }
 
     void Clear();
 
     bool AddPaymentVote(const CMasternodePaymentVote& vote);
-    bool HasVerifiedPaymentVote(uint256 hashIn);
+    bool HasVerifiedPaymentVote(const uint256& hashIn);
+    /// Whether a vote was already received, valid or not
+    bool HasSeenPaymentVote(const uint256& hashIn);
+    /// Stored vote with hash hashIn
+    bool GetPaymentVote(const uint256& hashIn, CMasternodePaymentVote& voteRet);
+    /// Stored votes for nBlockHeight, false if there is no slot for it
+    bool GetBlockPaymentVotes(int nBlockHeight, std::vector<CMasternodePaymentVote>& vecVotesRet);
+    bool HasBlockPayees(int nBlockHeight);
+    bool HasPayeeWithVotes(int nBlockHeight, const CScript& payeeIn, int nVotesReq);
     bool ProcessBlock(int nBlockHeight, CConnman& connman);//QSTEES: add check can vote or not
     void CheckPreviousBlockVotes(int nPrevBlockHeight);
 
@@ -222,6 +325,8 @@ public:
     bool GetBlockPayee(int nBlockHeight, int qsteestype, CScript& payee);
     bool IsTransactionValid(const CTransactionRef txNew, int nBlockHeight);
     bool IsScheduled(CMasternode& mn, int nNotBlockHeight);
+    /// (qsteestype, payee) pairs IsScheduled would match, computed once for a whole pass over the list
+    void GetScheduledPayees(int nNotBlockHeight, std::set<std::pair<int, CScript> >& setPayeesRet);
 
     bool CanVote(COutPoint outMasternode, int nBlockHeight);//can vote for this MN or not
 
@@ -232,8 +337,8 @@ public:
     void FillNextBlockPayee(CMutableTransaction& txNew, int nBlockHeight, CAmount blockReward, std::vector<CTxOut>& txoutMasternodeRet, qsteestype_pair_vec_t& vSinType);
     std::string ToString() const;
 
-    int GetBlockCount() { return mapMasternodeBlocks.size(); }
-    int GetVoteCount() { return mapMasternodePaymentVotes.size(); }
+    int GetBlockCount() { LOCK(cs_mapMasternodeBlocks); return nBlockCount; }
+    int GetVoteCount() { LOCK(cs_mapMasternodeBlocks); return mapVoteHeights.size(); }
 
     bool IsEnoughData();
     int GetStorageLimit();
@@ -21,6 +21,68 @@
 class CMasternodeSync;
 CMasternodeSync masternodeSync;
 
+bool CMasternodeSyncAsset::NeedMorePeers() const
+{
+    if (IsFinished()) return false;
+    int nAsked = setPeersAsked.size();
+    int nInFlight = nAsked - (int)setPeersAnswered.size();
+    return nAsked < MASTERNODE_SYNC_ENOUGH_PEERS && nInFlight < nParallelPeers;
+}
+
+void CMasternodeSyncAsset::Asked(NodeId nodeid, int64_t nNow)
+{
+    if (setPeersAsked.insert(nodeid).second && setPeersAsked.size() == 1) {
+        // give the first peer the whole timeout to answer
+        nTimeLastProgress = nNow;
+    }
+}
+
+bool CMasternodeSyncAsset::Answered(NodeId nodeid, int nCount, int64_t nNow)
+{
+    if (!WasAsked(nodeid) || !setPeersAnswered.insert(nodeid).second) return false;
+    nItemsAnnounced += std::max(0, nCount);
+    nTimeLastProgress = nNow;
+    return true;
+}
+
+void CMasternodeSyncAsset::Received(int64_t nNow)
+{
+    nItemsReceived++;
+    nTimeLastProgress = nNow;
+}
+
+CMasternodeSyncAsset::Status CMasternodeSyncAsset::GetStatus(int64_t nNow, bool fEnoughData) const
+{
+    int nAnswered = setPeersAnswered.size();
+    bool fEnoughAnswers = nAnswered > 0 && nAnswered >= std::min((int)setPeersAsked.size(), MASTERNODE_SYNC_ENOUGH_ANSWERS);
+
+    if (fEnoughAnswers && (fEnoughData || nNow - nTimeLastProgress >= MASTERNODE_SYNC_QUIET_SECONDS))
+        return SYNC_COMPLETE;
+    if (nNow - nTimeLastProgress > MASTERNODE_SYNC_TIMEOUT_SECONDS)
+        return SYNC_TIMEOUT;
+    return SYNC_PENDING;
+}
+
+double CMasternodeSyncAsset::GetProgress() const
+{
+    if (IsFinished()) return 1;
+    // answers come before the items they announce, leave room for those
+    return double(std::min((int)setPeersAnswered.size(), MASTERNODE_SYNC_ENOUGH_ANSWERS)) / (MASTERNODE_SYNC_ENOUGH_ANSWERS + 1);
+}
+
+UniValue CMasternodeSyncAsset::ToJSON() const
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("AssetName", CMasternodeSync::GetAssetName(nAsset)));
+    obj.push_back(Pair("StartTime", nTimeStarted));
+    obj.push_back(Pair("FinishTime", nTimeFinished));
+    obj.push_back(Pair("PeersAsked", (int)setPeersAsked.size()));
+    obj.push_back(Pair("PeersAnswered", (int)setPeersAnswered.size()));
+    obj.push_back(Pair("ItemsAnnounced", nItemsAnnounced));
+    obj.push_back(Pair("ItemsReceived", nItemsReceived));
+    return obj;
+}
+
 void CMasternodeSync::Fail()
 {
     nTimeLastFailure = GetTime();
@@ -34,18 +96,31 @@ void CMasternodeSync::Reset()
     nTimeAssetSyncStarted = GetTime();
     nTimeLastBumped = GetTime();
     nTimeLastFailure = 0;
+
+    LOCK(cs_assets);
+    mapAssets.clear();
 }
 
 void CMasternodeSync::BumpAssetLastTime(std::string strFuncName)
 {
     if(IsSynced() || IsFailed()) return;
     nTimeLastBumped = GetTime();
+    {
+        LOCK(cs_assets);
+        auto it = mapAssets.find(nRequestedMasternodeAssets);
+        if (it != mapAssets.end() && !it->second.IsFinished()) it->second.Received(nTimeLastBumped);
+    }
     LogPrint(BCLog::MNSYNC, "CMasternodeSync::BumpAssetLastTime -- %s\n", strFuncName);
 }
 
 std::string CMasternodeSync::GetAssetName()
 {
-    switch(nRequestedMasternodeAssets)
+    return GetAssetName(nRequestedMasternodeAssets);
+}
+
+std::string CMasternodeSync::GetAssetName(int nAsset)
+{
+    switch(nAsset)
     {
         case(MASTERNODE_SYNC_INITIAL):      return "MASTERNODE_SYNC_INITIAL";
         case(MASTERNODE_SYNC_WAITING):      return "MASTERNODE_SYNC_WAITING";
@@ -57,8 +132,31 @@ std::string CMasternodeSync::GetAssetName()
     }
 }
 
+UniValue CMasternodeSync::GetAssetsProgress()
+{
+    LOCK(cs_assets);
+    UniValue arr(UniValue::VARR);
+    for (const auto& pair : mapAssets) {
+        arr.push_back(pair.second.ToJSON());
+    }
+    return arr;
+}
+
+void CMasternodeSync::StartAsset(int nAsset)
+{
+    LOCK(cs_assets);
+    int nParallelPeers = std::max<int64_t>(1, gArgs.GetArg("-masternodesyncpeers", MASTERNODE_SYNC_PARALLEL_PEERS));
+    mapAssets[nAsset] = CMasternodeSyncAsset(nAsset, GetTime(), nParallelPeers);
+}
+
 void CMasternodeSync::SwitchToNextAsset(CConnman& connman)
 {
+    {
+        LOCK(cs_assets);
+        auto it = mapAssets.find(nRequestedMasternodeAssets);
+        if (it != mapAssets.end()) it->second.Finish(GetTime());
+    }
+
     switch(nRequestedMasternodeAssets)
     {
         case(MASTERNODE_SYNC_FAILED):
@@ -73,11 +171,13 @@ void CMasternodeSync::SwitchToNextAsset(CConnman& connman)
             ClearFulfilledRequests(connman);
             LogPrintf("CMasternodeSync::SwitchToNextAsset -- Completed %s in %llds\n", GetAssetName(), GetTime() - nTimeAssetSyncStarted);
             nRequestedMasternodeAssets = MASTERNODE_SYNC_LIST;
+            StartAsset(nRequestedMasternodeAssets);
             LogPrintf("CMasternodeSync::SwitchToNextAsset -- Starting %s\n", GetAssetName());
             break;
         case(MASTERNODE_SYNC_LIST):
             LogPrintf("CMasternodeSync::SwitchToNextAsset -- Completed %s in %llds\n", GetAssetName(), GetTime() - nTimeAssetSyncStarted);
             nRequestedMasternodeAssets = MASTERNODE_SYNC_MNW;
+            StartAsset(nRequestedMasternodeAssets);
             LogPrintf("CMasternodeSync::SwitchToNextAsset -- Starting %s\n", GetAssetName());
             break;
         case(MASTERNODE_SYNC_MNW):
@@ -92,7 +192,7 @@ void CMasternodeSync::SwitchToNextAsset(CConnman& connman)
             // if(lockRecv) { ... }
 
             connman.ForEachNode(CConnman::AllNodes, [](CNode* pnode) {
-                netfulfilledman.AddFulfilledRequest(pnode->addr, "full-sync");
+                netfulfilledman.AddFulfilledRequest(pnode->addr, FULFILLED_FULL_SYNC);
             });
             LogPrintf("CMasternodeSync::SwitchToNextAsset -- Sync has finished\n");
 
@@ -127,7 +227,14 @@ void CMasternodeSync::ProcessMessage(CNode* pfrom, const std::string& strCommand
         int nCount;
         vRecv >> nItemID >> nCount;
 
-        LogPrintf("SYNCSTATUSCOUNT -- got inventory count: nItemID=%d  nCount=%d  peer=%d\n", nItemID, nCount, pfrom->GetId());
+        bool fAnswered = false;
+        {
+            LOCK(cs_assets);
+            auto it = mapAssets.find(nItemID);
+            if (it != mapAssets.end() && !it->second.IsFinished()) fAnswered = it->second.Answered(pfrom->GetId(), nCount, GetTime());
+        }
+
+        LogPrintf("SYNCSTATUSCOUNT -- got inventory count: nItemID=%d  nCount=%d  peer=%d%s\n", nItemID, nCount, pfrom->GetId(), fAnswered ? "" : " (unsolicited)");
     }
 }
 
@@ -138,19 +245,56 @@ void CMasternodeSync::ClearFulfilledRequests(CConnman& connman)
     // if(!lockRecv) return;
 
     connman.ForEachNode(CConnman::AllNodes, [](CNode* pnode) {
-        netfulfilledman.RemoveFulfilledRequest(pnode->addr, "spork-sync");
-        netfulfilledman.RemoveFulfilledRequest(pnode->addr, "masternode-list-sync");
-        netfulfilledman.RemoveFulfilledRequest(pnode->addr, "masternode-payment-sync");
-        netfulfilledman.RemoveFulfilledRequest(pnode->addr, "full-sync");
+        netfulfilledman.RemoveFulfilledRequest(pnode->addr, FULFILLED_SPORK_SYNC);
+        netfulfilledman.RemoveFulfilledRequest(pnode->addr, FULFILLED_MASTERNODE_LIST_SYNC);
+        netfulfilledman.RemoveFulfilledRequest(pnode->addr, FULFILLED_MASTERNODE_PAYMENT_SYNC);
+        netfulfilledman.RemoveFulfilledRequest(pnode->addr, FULFILLED_FULL_SYNC);
     });
 }
 
-void CMasternodeSync::ProcessTick(CConnman& connman)
+bool CMasternodeSync::RequestAsset(CNode* pnode, CConnman& connman)
 {
+    int nAsset = nRequestedMasternodeAssets;
+    if (nAsset != MASTERNODE_SYNC_LIST && nAsset != MASTERNODE_SYNC_MNW) return false;
+
+    {
+        LOCK(cs_assets);
+        if (!mapAssets[nAsset].NeedMorePeers()) return false;
+    }
+
+    // only request once from each peer
+    fulfilled_request_t request = nAsset == MASTERNODE_SYNC_LIST ? FULFILLED_MASTERNODE_LIST_SYNC : FULFILLED_MASTERNODE_PAYMENT_SYNC;
+    if (netfulfilledman.HasFulfilledRequest(pnode->addr, request)) return false;
+    netfulfilledman.AddFulfilledRequest(pnode->addr, request);
 
-    static int nTick = 0;
-    if(nTick++ % MASTERNODE_SYNC_TICK_SECONDS != 0) return;
+    if (pnode->nVersion < mnpayments.GetMinMasternodePaymentsProto()) return false;
+
+    // record the request first, the answer can come back before we are done here
+    {
+        LOCK(cs_assets);
+        mapAssets[nAsset].Asked(pnode->GetId(), GetTime());
+    }
+
+    if (nAsset == MASTERNODE_SYNC_LIST) {
+        if (!mnodeman.DsegUpdate(pnode, connman)) {
+            LOCK(cs_assets);
+            mapAssets[nAsset].setPeersAsked.erase(pnode->GetId());
+            return false;
+        }
+    } else {
+        // ask node for all payment votes it has (new nodes will only return votes for future payments)
+        connman.PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::MASTERNODEPAYMENTSYNC, mnpayments.GetStorageLimit()));
+        // ask node for missing pieces only (old nodes will not be asked)
+        mnpayments.RequestLowDataPaymentBlocks(pnode, connman);
+    }
+
+    nRequestedMasternodeAttempt++;
+    LogPrint(BCLog::MNSYNC, "CMasternodeSync::RequestAsset -- requested %s from peer %d\n", GetAssetName(), pnode->GetId());
+    return true;
+}
 
+void CMasternodeSync::ProcessTick(CConnman& connman)
+{
     // reset the sync process if the last call to this function was more than 60 minutes ago (client was in sleep mode)
     static int64_t nTimeLastProcess = GetTime();
     if(GetTime() - nTimeLastProcess > 60*60) {
@@ -173,22 +317,25 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
     }
 
     // Calculate "progress" for LOG reporting / GUI notification
-    double nSyncProgress = double(nRequestedMasternodeAttempt + (nRequestedMasternodeAssets - 1) * 8) / (8*4);
-    uiInterface.NotifyAdditionalDataSyncProgressChanged(nSyncProgress);
+    if(!IsSynced()) {
+        double nAssetProgress = 0;
+        {
+            LOCK(cs_assets);
+            auto it = mapAssets.find(nRequestedMasternodeAssets);
+            if (it != mapAssets.end()) nAssetProgress = it->second.GetProgress();
+        }
+        double nSyncProgress = (std::max(0, nRequestedMasternodeAssets - MASTERNODE_SYNC_WAITING) + nAssetProgress) / (MASTERNODE_SYNC_MNW - MASTERNODE_SYNC_WAITING + 1);
+        uiInterface.NotifyAdditionalDataSyncProgressChanged(nSyncProgress);
+    }
 
-    std::vector<CNode*> vNodesCopy = connman.CopyNodeVector();
-    for (auto* pnode : vNodesCopy)
+    // QUICK MODE (REGTEST ONLY!)
+    if(Params().NetworkIDString() == CBaseChainParams::REGTEST)
     {
-        // Don't try to sync any data from outbound "masternode" connections -
-        // they are temporary and should be considered unreliable for a sync process.
-        // Inbound connection this early is most likely a "masternode" connection
-        // initiated from another node, so skip it too.
-
-        if(pnode->fMasternode || (fMasterNode && pnode->fInbound)) continue;
-
-        // QUICK MODE (REGTEST ONLY!)
-        if(Params().NetworkIDString() == CBaseChainParams::REGTEST)
+        std::vector<CNode*> vNodesCopy = connman.CopyNodeVector();
+        for (auto* pnode : vNodesCopy)
         {
+            if(pnode->fMasternode || (fMasterNode && pnode->fInbound)) continue;
+
             if(nRequestedMasternodeAttempt <= 2) {
                 connman.PushMessage(pnode, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::GETSPORKS)); //get current network sporks
             } else if(nRequestedMasternodeAttempt < 4) {
@@ -200,13 +347,36 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
                 nRequestedMasternodeAssets = MASTERNODE_SYNC_FINISHED;
             }
             nRequestedMasternodeAttempt++;
-            connman.ReleaseNodeVector(vNodesCopy);
-            return;
+            break;
         }
+        connman.ReleaseNodeVector(vNodesCopy);
+        return;
+    }
+
+    // NORMAL NETWORK MODE - TESTNET/MAINNET
+
+    int nBestHeight = 0;
+    {
+        LOCK(cs_main);
+        if (pindexBestHeader) nBestHeight = pindexBestHeader->nHeight;
+    }
 
-        // NORMAL NETWORK MODE - TESTNET/MAINNET
+    // Ask every suitable peer for what it can give us right now, the current asset
+    // is requested from up to -masternodesyncpeers peers at once.
+    bool fHavePeers = false;
+    bool fPeersAhead = false;
+    auto requestFromPeers = [&]() {
+        std::vector<CNode*> vNodesCopy = connman.CopyNodeVector();
+        for (auto* pnode : vNodesCopy)
         {
-            if(masternodeSync.IsSynced() && netfulfilledman.HasFulfilledRequest(pnode->addr, "full-sync")) {
+            // Don't try to sync any data from outbound "masternode" connections -
+            // they are temporary and should be considered unreliable for a sync process.
+            // Inbound connection this early is most likely a "masternode" connection
+            // initiated from another node, so skip it too.
+
+            if(pnode->fMasternode || (fMasterNode && pnode->fInbound)) continue;
+
+            if(IsSynced() && netfulfilledman.HasFulfilledRequest(pnode->addr, FULFILLED_FULL_SYNC)) {
                 // We already fully synced from this node recently,
                 // disconnect to free this connection slot for another peer.
                 pnode->fDisconnect = true;
@@ -216,111 +386,74 @@ void CMasternodeSync::ProcessTick(CConnman& connman)
 
             // SPORK : ALWAYS ASK FOR SPORKS AS WE SYNC
 
-            if(!netfulfilledman.HasFulfilledRequest(pnode->addr, "spork-sync")) {
+            if(!netfulfilledman.HasFulfilledRequest(pnode->addr, FULFILLED_SPORK_SYNC)) {
                 // always get sporks first, only request once from each peer
-                netfulfilledman.AddFulfilledRequest(pnode->addr, "spork-sync");
+                netfulfilledman.AddFulfilledRequest(pnode->addr, FULFILLED_SPORK_SYNC);
                 // get current network sporks
                 connman.PushMessage(pnode, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::GETSPORKS));
             }
 
-            // INITIAL TIMEOUT
-
-            if(nRequestedMasternodeAssets == MASTERNODE_SYNC_WAITING) {
-                if(GetTime() - nTimeLastBumped > MASTERNODE_SYNC_TIMEOUT_SECONDS) {
-                    // At this point we know that:
-                    // a) there are peers (because we are looping on at least one of them);
-                    // b) we waited for at least MASTERNODE_SYNC_TIMEOUT_SECONDS since we reached
-                    //    the headers tip the last time (i.e. since we switched from
-                    //     MASTERNODE_SYNC_INITIAL to MASTERNODE_SYNC_WAITING and bumped time);
-                    // c) there were no blocks (UpdatedBlockTip, NotifyHeaderTip) or headers (AcceptedBlockHeader)
-                    //    for at least MASTERNODE_SYNC_TIMEOUT_SECONDS.
-                    // We must be at the tip already, let's move to the next asset.
-                    SwitchToNextAsset(connman);
-                }
-            }
+            if(IsSynced()) continue;
 
-            // MNLIST : SYNC MASTERNODE LIST FROM OTHER CONNECTED CLIENTS
+            fHavePeers = true;
+            if (pnode->nStartingHeight > nBestHeight) fPeersAhead = true;
 
-            if(nRequestedMasternodeAssets == MASTERNODE_SYNC_LIST) {
-                // check for timeout first
-                if(GetTime() - nTimeLastBumped > MASTERNODE_SYNC_TIMEOUT_SECONDS) {
-                    if (nRequestedMasternodeAttempt == 0) {
-                        // there is no way we can continue without masternode list, fail here and try later
-                        Fail();
-                        connman.ReleaseNodeVector(vNodesCopy);
-                        return;
-                    }
+            // MNLIST / MNW : SYNC MASTERNODE LIST OR PAYMENT VOTES FROM OTHER CONNECTED CLIENTS
+            RequestAsset(pnode, connman);
+        }
+        connman.ReleaseNodeVector(vNodesCopy);
+    };
 
-                    SwitchToNextAsset(connman);
-                    connman.ReleaseNodeVector(vNodesCopy);
-                    return;
-                }
+    requestFromPeers();
 
-                // only request once from each peer
-                if(netfulfilledman.HasFulfilledRequest(pnode->addr, "masternode-list-sync")) {
-                    continue;
-                }
+    // Nothing to wait for without peers to sync from
+    if (!fHavePeers || IsSynced()) return;
 
-                netfulfilledman.AddFulfilledRequest(pnode->addr, "masternode-list-sync");
+    // INITIAL TIMEOUT
 
-                if (pnode->nVersion < mnpayments.GetMinMasternodePaymentsProto()) continue;
+    if(nRequestedMasternodeAssets == MASTERNODE_SYNC_WAITING) {
+        int64_t nQuietTime = GetTime() - nTimeLastBumped;
+        // No blocks (UpdatedBlockTip, NotifyHeaderTip) or headers (AcceptedBlockHeader) arrived
+        // since we reached the headers tip, either for MASTERNODE_SYNC_TIMEOUT_SECONDS or for
+        // MASTERNODE_SYNC_QUIET_SECONDS with no peer announcing a longer chain.
+        // We must be at the tip already, let's move to the next asset.
+        if(nQuietTime > MASTERNODE_SYNC_TIMEOUT_SECONDS || (nQuietTime >= MASTERNODE_SYNC_QUIET_SECONDS && !fPeersAhead)) {
+            SwitchToNextAsset(connman);
+            requestFromPeers();
+        }
+        return;
+    }
 
-                nRequestedMasternodeAttempt++;
+    // MNLIST / MNW : MOVE ON ONCE THE PEERS ARE DONE SENDING
 
-                mnodeman.DsegUpdate(pnode, connman);
+    while(nRequestedMasternodeAssets == MASTERNODE_SYNC_LIST || nRequestedMasternodeAssets == MASTERNODE_SYNC_MNW) {
+        // if mnpayments already has enough blocks and votes, don't wait for more
+        bool fEnoughData = nRequestedMasternodeAssets == MASTERNODE_SYNC_MNW && mnpayments.IsEnoughData();
+        CMasternodeSyncAsset::Status status;
+        bool fAsked;
+        {
+            LOCK(cs_assets);
+            const CMasternodeSyncAsset& asset = mapAssets[nRequestedMasternodeAssets];
+            status = asset.GetStatus(GetTime(), fEnoughData);
+            fAsked = !asset.setPeersAsked.empty();
+        }
 
-                connman.ReleaseNodeVector(vNodesCopy);
-                return; //this will cause each peer to get one request each six seconds for the various assets we need
-            }
+        if (status == CMasternodeSyncAsset::SYNC_PENDING) return;
 
-            // MNW : SYNC MASTERNODE PAYMENT VOTES FROM OTHER CONNECTED CLIENTS
-
-            if(nRequestedMasternodeAssets == MASTERNODE_SYNC_MNW) {
-                // check for timeout first
-                // This might take a lot longer than MASTERNODE_SYNC_TIMEOUT_SECONDS due to new blocks,
-                // but that should be OK and it should timeout eventually.
-                if(GetTime() - nTimeLastBumped > MASTERNODE_SYNC_TIMEOUT_SECONDS) {
-                    if (nRequestedMasternodeAttempt == 0) {
-                        LogPrintf("CMasternodeSync::ProcessTick -- ERROR: failed to sync %s\n", GetAssetName());
-                        // probably not a good idea to proceed without winner list
-                        Fail();
-                        connman.ReleaseNodeVector(vNodesCopy);
-                        return;
-                    }
-                    SwitchToNextAsset(connman);
-                    connman.ReleaseNodeVector(vNodesCopy);
-                    return;
-                }
-
-                // check for data
-                // if mnpayments already has enough blocks and votes, switch to the next asset
-                // try to fetch data from at least two peers though
-                if(nRequestedMasternodeAttempt > 1 && mnpayments.IsEnoughData()) {
-                    SwitchToNextAsset(connman);
-                    connman.ReleaseNodeVector(vNodesCopy);
-                    return;
-                }
-
-                // only request once from each peer
-                if(netfulfilledman.HasFulfilledRequest(pnode->addr, "masternode-payment-sync")) continue;
-                netfulfilledman.AddFulfilledRequest(pnode->addr, "masternode-payment-sync");
-
-                if(pnode->nVersion < mnpayments.GetMinMasternodePaymentsProto()) continue;
-                nRequestedMasternodeAttempt++;
-
-                // ask node for all payment votes it has (new nodes will only return votes for future payments)
-                connman.PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::MASTERNODEPAYMENTSYNC, mnpayments.GetStorageLimit()));
-                // ask node for missing pieces only (old nodes will not be asked)
-                mnpayments.RequestLowDataPaymentBlocks(pnode, connman);
-
-                connman.ReleaseNodeVector(vNodesCopy);
-                return; //this will cause each peer to get one request each six seconds for the various assets we need
-            }
+        if (status == CMasternodeSyncAsset::SYNC_TIMEOUT && !fAsked) {
+            // there is no way we can continue without masternode list or winner list, fail here and try later
+            LogPrintf("CMasternodeSync::ProcessTick -- ERROR: failed to sync %s\n", GetAssetName());
+            Fail();
+            return;
+        }
 
+        if (status == CMasternodeSyncAsset::SYNC_TIMEOUT) {
+            LogPrintf("CMasternodeSync::ProcessTick -- %s timed out waiting for peers, moving on\n", GetAssetName());
         }
+        SwitchToNextAsset(connman);
+        // start on the next asset right away instead of on the next tick
+        requestFromPeers();
     }
-    // looped through all nodes, release them
-    connman.ReleaseNodeVector(vNodesCopy);
 }
 
 void CMasternodeSync::AcceptedBlockHeader(const CBlockIndex *pindexNew)
@@ -9,9 +9,13 @@
 
 #include <chain.h>
 #include <net.h>
+#include <sync.h>
 
 #include <univalue.h>
 
+#include <map>
+#include <set>
+
 class CMasternodeSync;
 
 static const int MASTERNODE_SYNC_FAILED          = -1;
@@ -21,13 +25,71 @@ static const int MASTERNODE_SYNC_LIST            = 2;
 static const int MASTERNODE_SYNC_MNW             = 3;
 static const int MASTERNODE_SYNC_FINISHED        = 999;
 
-static const int MASTERNODE_SYNC_TICK_SECONDS    = 6;
 static const int MASTERNODE_SYNC_TIMEOUT_SECONDS = 30; // our blocks are 2.5 minutes so 30 seconds should be fine
+static const int MASTERNODE_SYNC_QUIET_SECONDS   = 5; // an answered asset is complete once nothing new arrived for that long
 
-static const int MASTERNODE_SYNC_ENOUGH_PEERS    = 6;
+static const int MASTERNODE_SYNC_PARALLEL_PEERS  = 4; // peers with a request for the current asset in flight
+static const int MASTERNODE_SYNC_ENOUGH_ANSWERS  = 2; // peers which should have sent their inventory before moving on
+static const int MASTERNODE_SYNC_ENOUGH_PEERS    = 6; // peers an asset is requested from at most
 
 extern CMasternodeSync masternodeSync;
 
+//
+// CMasternodeSyncAsset : Progress of the sync of one asset
+//
+// The asset is requested from several peers at once and is complete when
+// enough of them reported their inventory count (SYNCSTATUSCOUNT) and no new
+// item arrived for MASTERNODE_SYNC_QUIET_SECONDS. Peers which do not answer
+// are given up on after MASTERNODE_SYNC_TIMEOUT_SECONDS without progress.
+//
+
+class CMasternodeSyncAsset
+{
+public:
+    enum Status { SYNC_PENDING, SYNC_COMPLETE, SYNC_TIMEOUT };
+
+    int nAsset;
+    // peers with a request in flight at most, -masternodesyncpeers
+    int nParallelPeers;
+    int64_t nTimeStarted;
+    // last new item or answer
+    int64_t nTimeLastProgress;
+    int64_t nTimeFinished;
+    std::set<NodeId> setPeersAsked;
+    std::set<NodeId> setPeersAnswered;
+    // sum of the inventory counts reported by the peers
+    int nItemsAnnounced;
+    int nItemsReceived;
+
+    CMasternodeSyncAsset() : CMasternodeSyncAsset(MASTERNODE_SYNC_INITIAL, 0) {}
+    CMasternodeSyncAsset(int nAssetIn, int64_t nTimeStartedIn, int nParallelPeersIn = MASTERNODE_SYNC_PARALLEL_PEERS) :
+        nAsset(nAssetIn),
+        nParallelPeers(nParallelPeersIn),
+        nTimeStarted(nTimeStartedIn),
+        nTimeLastProgress(nTimeStartedIn),
+        nTimeFinished(0),
+        nItemsAnnounced(0),
+        nItemsReceived(0)
+    {}
+
+    bool IsFinished() const { return nTimeFinished != 0; }
+    /// Whether one more peer should be asked for the asset
+    bool NeedMorePeers() const;
+    bool WasAsked(NodeId nodeid) const { return setPeersAsked.count(nodeid) != 0; }
+
+    void Asked(NodeId nodeid, int64_t nNow);
+    /// Returns false when the peer was not asked or already answered
+    bool Answered(NodeId nodeid, int nCount, int64_t nNow);
+    void Received(int64_t nNow);
+    void Finish(int64_t nNow) { nTimeFinished = nNow; }
+
+    /// fEnoughData: the asset already has enough data, no need to wait for more
+    Status GetStatus(int64_t nNow, bool fEnoughData = false) const;
+    /// 0 to 1, for GUI notification
+    double GetProgress() const;
+    UniValue ToJSON() const;
+};
+
 //
 // CMasternodeSync : Sync masternode assets in stages
 //
@@ -47,8 +109,16 @@ private:
     // ... or failed
     int64_t nTimeLastFailure;
 
+    // Protects the progress of the assets, never held while calling out
+    mutable CCriticalSection cs_assets;
+    // Progress of the current asset and of the ones completed since Reset
+    std::map<int, CMasternodeSyncAsset> mapAssets;
+
     void Fail();
     void ClearFulfilledRequests(CConnman& connman);
+    void StartAsset(int nAsset);
+    /// Request the current asset from pnode if more peers are needed, returns true when asked
+    bool RequestAsset(CNode* pnode, CConnman& connman);
 
 public:
     CMasternodeSync() { Reset(); }
@@ -64,7 +134,10 @@ public:
     void BumpAssetLastTime(std::string strFuncName);
     int64_t GetAssetStartTime() { return nTimeAssetSyncStarted; }
     std::string GetAssetName();
+    static std::string GetAssetName(int nAsset);
     std::string GetSyncStatus();
+    /// Progress of the assets requested from peers since the last reset
+    UniValue GetAssetsProgress();
 
     void Reset();
     void SwitchToNextAsset(CConnman& connman);
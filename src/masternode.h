@@ -76,7 +76,10 @@ public:
     }
 
     bool IsExpired() const { return GetAdjustedTime() - sigTime > MASTERNODE_NEW_START_REQUIRED_SECONDS; }
+    /// Adjusted time after which IsExpired
+    int64_t GetExpireTime() const { return sigTime + MASTERNODE_NEW_START_REQUIRED_SECONDS; }
 
+    std::string GetSignatureMessage() const;
     bool Sign(const CKey& keyMasternode, const CPubKey& pubKeyMasternode);
     bool CheckSignature(CPubKey& pubKeyMasternode, int &nDos);
     bool SimpleCheck(int& nDos);
@@ -188,6 +191,8 @@ public:
     std::vector<SinType> vSinTypeCanVote = {QSTEESNODE_5, QSTEESNODE_10};
 
     uint256 nCollateralMinConfBlockHash{};
+    // height of the collateral output (0 = unknown), refreshed by Check
+    int nCollateralHeight{};
     int nBlockLastPaid{};
     int nPoSeBanScore{};
     int nPoSeBanHeight{};
@@ -222,6 +227,7 @@ public:
         READWRITE(nTimeLastWatchdogVote);
         READWRITE(nActiveState);
         READWRITE(nCollateralMinConfBlockHash);
+        READWRITE(nCollateralHeight);
         READWRITE(nBlockLastPaid);
         READWRITE(nProtocolVersion);
         READWRITE(nPoSeBanScore);
@@ -314,8 +320,8 @@ public:
     std::string GetBurnFundTxInfo() const;
 
     int GetLastPaidTime() { return nTimeLastPaid; }
-    int GetLastPaidBlock() { return nBlockLastPaid; }
-    void UpdateLastPaid(const CBlockIndex *pindex, int nMaxBlocksToScanBack);
+    int GetLastPaidBlock() const { return nBlockLastPaid; }
+    void UpdateLastPaid(int nBlockLastPaidIn, int64_t nTimeLastPaidIn);
 
     void UpdateWatchdogVoteTime(uint64_t nVoteTime = 0);
 
@@ -325,6 +331,7 @@ public:
         lastPing = from.lastPing;
         vchSig = from.vchSig;
         nCollateralMinConfBlockHash = from.nCollateralMinConfBlockHash;
+        nCollateralHeight = from.nCollateralHeight;
         nBlockLastPaid = from.nBlockLastPaid;
         nPoSeBanScore = from.nPoSeBanScore;
         nPoSeBanHeight = from.nPoSeBanHeight;
@@ -391,6 +398,7 @@ public:
     bool SimpleCheck(int& nDos);
     bool Update(CMasternode* pmn, int& nDos, CConnman& connman);
     bool CheckOutpoint(int& nDos);
+    std::string GetSignatureMessage() const;
     bool Sign(const CKey& keyCollateralAddress);
     bool CheckSignature(int& nDos);
     void Relay(CConnman& connman);
@@ -0,0 +1,182 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternodejobs.h>
+
+#include <activemasternode.h>
+#include <chainparams.h>
+#include <infinitynodeman.h>
+#include <instantx.h>
+#include <masternode.h>
+#include <masternode-payments.h>
+#include <masternode-sync.h>
+#include <masternodeman.h>
+#include <net.h>
+#include <netfulfilledman.h>
+#include <shutdown.h>
+#include <util.h>
+
+CMasternodeJobs mnjobs;
+
+void CMasternodeJobs::Start(CConnman& connmanIn)
+{
+    if (fStarted) return;
+    fStarted = true;
+    connman = &connmanIn;
+
+    Every("sync", 1, &CMasternodeJobs::SyncTick);
+    Every("check", 1, &CMasternodeJobs::CheckMasternodes);
+    Every("managestate", MASTERNODE_MIN_MNP_SECONDS, &CMasternodeJobs::ManageActiveMasternode);
+    Every("fulfilled", 60, &CMasternodeJobs::CleanFulfilledRequests);
+    Every("connections", 60, &CMasternodeJobs::ProcessMasternodeConnections);
+    Every("mncheckandremove", 60, &CMasternodeJobs::CheckAndRemoveMasternodes);
+    Every("payments", 60, &CMasternodeJobs::CheckAndRemovePayments);
+    Every("instantsend", 60, &CMasternodeJobs::CheckAndRemoveInstantSend);
+    Every("orphanlockvotes", 1, &CMasternodeJobs::ProcessOrphanLockVotes);
+    Every("verify", 60 * 5, &CMasternodeJobs::VerifyMasternodes);
+    Every("infinitynodes", 60 * 5, &CMasternodeJobs::UpdateInfinitynodes);
+
+    for (int i = 0; i < MNJOBS_THREADS; i++) {
+        threadGroup.create_thread([this] {
+            RenameThread("qstees-mnjobs");
+            scheduler.serviceQueue();
+        });
+    }
+    LogPrintf("CMasternodeJobs::Start -- %d masternode job threads\n", MNJOBS_THREADS);
+}
+
+void CMasternodeJobs::Stop()
+{
+    if (!fStarted) return;
+    scheduler.stop(false);
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    fStarted = false;
+}
+
+void CMasternodeJobs::UpdatedBlockTip()
+{
+    if (!fStarted || fTipJobPending.exchange(true)) return;
+    scheduler.scheduleFromNow([this] {
+        fTipJobPending = false;
+        Run("infinitynodes-tip", std::bind(&CMasternodeJobs::UpdateInfinitynodesForTip, this));
+    }, MNJOBS_TIP_DELAY_MSECONDS);
+}
+
+bool CMasternodeJobs::Schedule(const std::string& strName, std::function<void()> job)
+{
+    if (!fStarted) return false;
+    scheduler.schedule([this, strName, job] { Run(strName, job); });
+    return true;
+}
+
+void CMasternodeJobs::Every(const std::string& strName, int64_t nSeconds, void (CMasternodeJobs::*job)())
+{
+    scheduler.scheduleEvery([this, strName, job] { Run(strName, std::bind(job, this)); }, nSeconds * 1000);
+}
+
+void CMasternodeJobs::Run(const std::string& strName, const std::function<void()>& job)
+{
+    if (ShutdownRequested()) return;
+    // a job throwing must not stop the thread servicing the queue, nor its own rescheduling
+    try {
+        int64_t nTimeStart = GetTimeMillis();
+        job();
+        LogPrint(BCLog::MASTERNODE, "CMasternodeJobs::Run -- %s done in %dms\n", strName, GetTimeMillis() - nTimeStart);
+    } catch (const std::exception& e) {
+        PrintExceptionContinue(&e, ("CMasternodeJobs::Run " + strName).c_str());
+    } catch (...) {
+        PrintExceptionContinue(nullptr, ("CMasternodeJobs::Run " + strName).c_str());
+    }
+}
+
+void CMasternodeJobs::SyncTick()
+{
+    // try to sync from all available nodes
+    masternodeSync.ProcessTick(*connman);
+}
+
+void CMasternodeJobs::CheckMasternodes()
+{
+    if (!masternodeSync.IsSynced()) return;
+    mnodeman.Check();
+}
+
+void CMasternodeJobs::ManageActiveMasternode()
+{
+    // finishing the sync also runs it, this only renews the ping
+    if (!masternodeSync.IsSynced()) return;
+    activeMasternode.ManageState(*connman);
+}
+
+void CMasternodeJobs::CleanFulfilledRequests()
+{
+    if (!masternodeSync.IsSynced()) return;
+    netfulfilledman.CheckAndRemove();
+}
+
+void CMasternodeJobs::ProcessMasternodeConnections()
+{
+    if (!masternodeSync.IsSynced()) return;
+    mnodeman.ProcessMasternodeConnections(*connman);
+}
+
+void CMasternodeJobs::CheckAndRemoveMasternodes()
+{
+    if (!masternodeSync.IsSynced()) return;
+    mnodeman.CheckAndRemove(*connman);
+}
+
+void CMasternodeJobs::CheckAndRemovePayments()
+{
+    if (!masternodeSync.IsSynced()) return;
+    mnpayments.CheckAndRemove();
+}
+
+void CMasternodeJobs::CheckAndRemoveInstantSend()
+{
+    if (!masternodeSync.IsSynced()) return;
+    instantsend.CheckAndRemove();
+}
+
+void CMasternodeJobs::ProcessOrphanLockVotes()
+{
+    // orphan lock votes whose masternode or lock request showed up
+    instantsend.ProcessPendingOrphanTxLockVotes(*connman);
+}
+
+void CMasternodeJobs::VerifyMasternodes()
+{
+    if (!fMasterNode || !masternodeSync.IsSynced()) return;
+    mnodeman.DoFullVerificationStep(*connman);
+}
+
+void CMasternodeJobs::UpdateInfinitynodes()
+{
+    RunInfinitynodeUpdate(false);
+}
+
+void CMasternodeJobs::UpdateInfinitynodesForTip()
+{
+    RunInfinitynodeUpdate(true);
+}
+
+void CMasternodeJobs::RunInfinitynodeUpdate(bool fNewTip)
+{
+    if (!masternodeSync.IsSynced()) return;
+
+    std::lock_guard<std::mutex> lock(mutexInfinitynodeUpdate);
+
+    infnodeman.CheckAndRemove(*connman);
+
+    // the limits depend on the list and on the height, nothing to do when neither changed
+    int64_t nListVersion = mnodeman.GetListVersion();
+    if (!fNewTip && nListVersion == nLimitsListVersion) return;
+
+    mnodeman.CheckAndRemoveBurnFundNotUniqueNode(*connman);
+    mnodeman.CheckAndRemoveLimitNumberNode(*connman, 1, Params().GetConsensus().nLimitQSTEESNODE_1);
+    mnodeman.CheckAndRemoveLimitNumberNode(*connman, 5, Params().GetConsensus().nLimitQSTEESNODE_5);
+    mnodeman.CheckAndRemoveLimitNumberNode(*connman, 10, Params().GetConsensus().nLimitQSTEESNODE_10);
+    nLimitsListVersion = mnodeman.GetListVersion();
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QSTEES_MASTERNODEJOBS_H
+#define QSTEES_MASTERNODEJOBS_H
+
+#include <scheduler.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include <boost/thread.hpp>
+
+class CConnman;
+
+/** Threads running the masternode jobs */
+static const int MNJOBS_THREADS = 3;
+/** Delay before a job triggered by a new tip runs, so a burst of blocks triggers it once */
+static const int MNJOBS_TIP_DELAY_MSECONDS = 2000;
+
+/**
+ * Periodic masternode and infinity node maintenance.
+ *
+ * Every job is registered on a scheduler serviced by a small pool of
+ * threads, with its own interval, so a slow job (an infinity node list
+ * rebuild, the node limit checks) no longer delays the sync, the checks or
+ * the pings. A repeating job is rescheduled once it is done and never runs
+ * twice at the same time. Jobs other than the sync only do something once
+ * the masternode sync is finished.
+ *
+ * The infinity node update and the node limit checks also run shortly after
+ * a new tip, and the limit checks are skipped while the masternode list did
+ * not change.
+ */
+class CMasternodeJobs
+{
+private:
+    CScheduler scheduler;
+    boost::thread_group threadGroup;
+    CConnman* connman;
+    bool fStarted;
+
+    // an update after a new tip is already scheduled
+    std::atomic<bool> fTipJobPending;
+    // serializes the tip-triggered and the periodic infinity node update
+    std::mutex mutexInfinitynodeUpdate;
+    // masternode list version at the last limit check
+    int64_t nLimitsListVersion;
+
+    void Every(const std::string& strName, int64_t nSeconds, void (CMasternodeJobs::*job)());
+    void Run(const std::string& strName, const std::function<void()>& job);
+
+    void SyncTick();
+    void CheckMasternodes();
+    void ManageActiveMasternode();
+    void CleanFulfilledRequests();
+    void ProcessMasternodeConnections();
+    void CheckAndRemoveMasternodes();
+    void CheckAndRemovePayments();
+    void CheckAndRemoveInstantSend();
+    void ProcessOrphanLockVotes();
+    void VerifyMasternodes();
+    void UpdateInfinitynodes();
+    void UpdateInfinitynodesForTip();
+    void RunInfinitynodeUpdate(bool fNewTip);
+
+public:
+    CMasternodeJobs() : connman(nullptr), fStarted(false), fTipJobPending(false), nLimitsListVersion(-1) {}
+    ~CMasternodeJobs() { Stop(); }
+
+    /** Register the jobs and start the threads */
+    void Start(CConnman& connmanIn);
+    /** Stop the threads, jobs not started yet are dropped */
+    void Stop();
+
+    /** Schedule the infinity node update and the limit checks for the new tip */
+    void UpdatedBlockTip();
+    /** Run job once on the job threads, false when they are not running */
+    bool Schedule(const std::string& strName, std::function<void()> job);
+};
+
+extern CMasternodeJobs mnjobs;
+
+#endif // QSTEES_MASTERNODEJOBS_H
@@ -6,28 +6,24 @@
 
 #include <activemasternode.h>
 #include <addrman.h>
+#include <blockscanner.h>
+#include <instantx.h>
 #include <masternode-payments.h>
+#include <masternodejobs.h>
 #include <masternode-sync.h>
 #include <masternodeman.h>
 #include <messagesigner.h>
 #include <netfulfilledman.h>
 #include <netmessagemaker.h>
 #include <script/standard.h>
+#include <sigverifyqueue.h>
+#include <ui_interface.h>
 #include <util.h>
 
 /** Masternode manager */
 CMasternodeMan mnodeman;
 
-const std::string CMasternodeMan::SERIALIZATION_VERSION_STRING = "CMasternodeMan-Version-7";
-
-struct CompareLastPaidBlock
-{
-    bool operator()(const std::pair<int, CMasternode*>& t1,
-                    const std::pair<int, CMasternode*>& t2) const
-    {
-        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
-    }
-};
+const std::string CMasternodeMan::SERIALIZATION_VERSION_STRING = "CMasternodeMan-Version-10";
 
 struct CompareSigTime
 {
@@ -47,19 +43,15 @@ struct CompareScoreMN
     }
 };
 
-struct CompareByAddr
-
-{
-    bool operator()(const CMasternode* t1,
-                    const CMasternode* t2) const
-    {
-        return t1->addr < t2->addr;
-    }
-};
-
 CMasternodeMan::CMasternodeMan()
 : cs(),
   mapMasternodes(),
+  mapRankCache(RANK_CACHE_SIZE),
+  nListVersion(0),
+  listSnapshot(),
+  mapReportedStates(),
+  fReportChanges(false),
+  fChangesNotified(false),
   mAskedUsForMasternodeList(),
   mWeAskedForMasternodeList(),
   mWeAskedForMasternodeListEntry(),
@@ -71,18 +63,121 @@ CMasternodeMan::CMasternodeMan()
   fMasternodesRemoved(false),
   vecDirtyGovernanceObjectHashes(),
   nLastWatchdogVoteTime(0),
+  nLastPaidHeight(0),
+  hashLastPaidBlock(),
+  pindexLastPaidTip(nullptr),
+  fLastPaidCatchUpScheduled(false),
   mapSeenMasternodeBroadcast(),
   mapSeenMasternodePing(),
   nDsqCount(0)
 {}
 
+SaltedMasternodeKeyHasher::SaltedMasternodeKeyHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+size_t SaltedMasternodeKeyHasher::operator()(const CPubKey& pubKey) const
+{
+    return CSipHasher(k0, k1).Write(pubKey.begin(), pubKey.size()).Finalize();
+}
+
+size_t SaltedMasternodeKeyHasher::operator()(const CScript& script) const
+{
+    return CSipHasher(k0, k1).Write(script.data(), script.size()).Finalize();
+}
+
+size_t SaltedMasternodeKeyHasher::operator()(const CService& addr) const
+{
+    std::vector<unsigned char> vchKey = addr.GetKey();
+    return CSipHasher(k0, k1).Write(vchKey.data(), vchKey.size()).Finalize();
+}
+
+size_t SaltedMasternodeKeyHasher::operator()(const CNetAddr& addr) const
+{
+    return CSipHasher(k0, k1).Write(addr.GetHash()).Finalize();
+}
+
+size_t SaltedMasternodeKeyHasher::operator()(const uint256& hash) const
+{
+    return SipHashUint256(k0, k1, hash);
+}
+
+size_t SaltedMasternodeKeyHasher::operator()(const std::pair<COutPoint, CNetAddr>& entry) const
+{
+    return SipHashUint256Extra(k0, k1, entry.first.hash, entry.first.n) ^ entry.second.GetHash();
+}
+
+const std::vector<unsigned char>* CMasternodeListSnapshot::Find(const CInv& inv) const
+{
+    auto it = mapByHash.find(inv.hash);
+    if (it == mapByHash.end()) return nullptr;
+    if (inv.type == MSG_MASTERNODE_ANNOUNCE && it->second->hashMNB == inv.hash) return &it->second->vchMNB;
+    if (inv.type == MSG_MASTERNODE_PING && it->second->hashMNP == inv.hash) return &it->second->vchMNP;
+    return nullptr;
+}
+
+void CMasternodeMan::IndexMasternode(const CMasternode& mn)
+{
+    AssertLockHeld(cs);
+    mapIndexByPubKey[mn.pubKeyMasternode].insert(mn.vin.prevout);
+    mapIndexByPayee[GetScriptForDestination(mn.pubKeyCollateralAddress.GetID())].insert(mn.vin.prevout);
+    mapIndexByAddr[mn.addr].insert(mn.vin.prevout);
+    setPaymentQueue.emplace(mn.GetLastPaidBlock(), mn.vin.prevout);
+    nListVersion++;
+    NotifyListChanged();
+}
+
+template <typename K>
+static void EraseIndexEntry(std::unordered_map<K, std::set<COutPoint>, SaltedMasternodeKeyHasher>& mapIndex, const K& key, const COutPoint& outpoint)
+{
+    auto it = mapIndex.find(key);
+    if (it == mapIndex.end()) return;
+    it->second.erase(outpoint);
+    if (it->second.empty()) mapIndex.erase(it);
+}
+
+void CMasternodeMan::UnindexMasternode(const CMasternode& mn)
+{
+    AssertLockHeld(cs);
+    EraseIndexEntry(mapIndexByPubKey, mn.pubKeyMasternode, mn.vin.prevout);
+    EraseIndexEntry(mapIndexByPayee, GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()), mn.vin.prevout);
+    EraseIndexEntry(mapIndexByAddr, mn.addr, mn.vin.prevout);
+    setPaymentQueue.erase(std::make_pair(mn.GetLastPaidBlock(), mn.vin.prevout));
+    nListVersion++;
+    NotifyListChanged();
+}
+
+void CMasternodeMan::RebuildIndexes()
+{
+    AssertLockHeld(cs);
+    mapIndexByPubKey.clear();
+    mapIndexByPayee.clear();
+    mapIndexByAddr.clear();
+    setPaymentQueue.clear();
+    for (auto& mnpair : mapMasternodes) {
+        IndexMasternode(mnpair.second);
+    }
+}
+
+template <typename K>
+CMasternode* CMasternodeMan::FindIndexed(const std::unordered_map<K, std::set<COutPoint>, SaltedMasternodeKeyHasher>& mapIndex, const K& key)
+{
+    AssertLockHeld(cs);
+    auto it = mapIndex.find(key);
+    if (it == mapIndex.end()) return NULL;
+    // lowest outpoint, the one a scan of mapMasternodes would have found first
+    auto itMn = mapMasternodes.find(*it->second.begin());
+    return itMn == mapMasternodes.end() ? NULL : &itMn->second;
+}
+
 bool CMasternodeMan::Add(CMasternode &mn)
 {
     LOCK(cs);
     if (Has(mn.vin.prevout)) return false;
     LogPrint(BCLog::MASTERNODE, "CMasternodeMan::Add -- Adding new Masternode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
     mapMasternodes[mn.vin.prevout] = mn;
+    IndexMasternode(mn);
+    mapRankCache.Clear();
     fMasternodesAdded = true;
+    instantsend.NotifyMasternodeAdded(mn.vin.prevout);
     return true;
 }
 
@@ -92,25 +187,19 @@ void CMasternodeMan::AskForMN(CNode* pnode, const COutPoint& outpoint, CConnman&
 
     LOCK(cs);
 
-    std::map<COutPoint, std::map<CNetAddr, int64_t> >::iterator it1 = mWeAskedForMasternodeListEntry.find(outpoint);
-    if (it1 != mWeAskedForMasternodeListEntry.end()) {
-        std::map<CNetAddr, int64_t>::iterator it2 = it1->second.find(pnode->addr);
-        if (it2 != it1->second.end()) {
-            if (GetTime() < it2->second) {
-                // we've asked recently, should not repeat too often or we could get banned
-                return;
-            }
-            // we asked this node for this outpoint but it's ok to ask again already
-            LogPrintf("CMasternodeMan::AskForMN -- Asking same peer %s for missing masternode entry again: %s\n", pnode->addr.ToString(), outpoint.ToStringShort());
-        } else {
-            // we already asked for this outpoint but not this node
-            LogPrintf("CMasternodeMan::AskForMN -- Asking new peer %s for missing masternode entry: %s\n", pnode->addr.ToString(), outpoint.ToStringShort());
+    std::pair<COutPoint, CNetAddr> entry(outpoint, pnode->addr);
+    int64_t nAskAgain = mWeAskedForMasternodeListEntry.GetExpireTime(entry);
+    if (nAskAgain != 0) {
+        if (GetTime() < nAskAgain) {
+            // we've asked recently, should not repeat too often or we could get banned
+            return;
         }
+        // we asked this node for this outpoint but it's ok to ask again already
+        LogPrintf("CMasternodeMan::AskForMN -- Asking same peer %s for missing masternode entry again: %s\n", pnode->addr.ToString(), outpoint.ToStringShort());
     } else {
-        // we never asked any node for this outpoint
-        LogPrintf("CMasternodeMan::AskForMN -- Asking peer %s for missing masternode entry for the first time: %s\n", pnode->addr.ToString(), outpoint.ToStringShort());
+        LogPrintf("CMasternodeMan::AskForMN -- Asking peer %s for missing masternode entry: %s\n", pnode->addr.ToString(), outpoint.ToStringShort());
     }
-    mWeAskedForMasternodeListEntry[outpoint][pnode->addr] = GetTime() + DSEG_UPDATE_SECONDS;
+    mWeAskedForMasternodeListEntry.Set(entry, GetTime(), GetTime() + DSEG_UPDATE_SECONDS);
 
     connman.PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::DSEG, CTxIn(outpoint)));
 }
@@ -159,26 +248,74 @@ void CMasternodeMan::Check()
 
     LogPrint(BCLog::MASTERNODE, "CMasternodeMan::Check -- nLastWatchdogVoteTime=%d, IsWatchdogActive()=%d\n", nLastWatchdogVoteTime, IsWatchdogActive());
 
+    bool fStateChanged = false;
     std::map<COutPoint, CMasternode>::iterator it = mapMasternodes.begin();
     while (it != mapMasternodes.end()) {
+        int nActiveStatePrev = it->second.nActiveState;
         it->second.updateInfinityNodeInfo(true);
         it->second.Check();
+        fStateChanged |= it->second.nActiveState != nActiveStatePrev;
         ++it;
     }
+    // states also change on the checks of announces and pings, the GUI finds them with these
+    if (fStateChanged) {
+        nListVersion++;
+        NotifyListChanged();
+    }
 }
 
-int CMasternodeMan::IsPayeeAValidMasternode(CScript payee)
+void CMasternodeMan::NotifyListChanged()
 {
-    if(!masternodeSync.IsMasternodeListSynced()) return 1;
+    AssertLockHeld(cs);
+    if (!fReportChanges || fChangesNotified) return;
+    fChangesNotified = true;
+    uiInterface.NotifyMasternodeListChanged();
+}
 
-    LOCK2(cs_main, cs);
+void CMasternodeMan::GetMasternodeChanges(bool fFull, std::vector<masternode_info_t>& vecChangedRet, std::vector<COutPoint>& vecRemovedRet)
+{
+    vecChangedRet.clear();
+    vecRemovedRet.clear();
+
+    LOCK(cs);
+    if (fFull) mapReportedStates.clear();
+    fReportChanges = true;
+    fChangesNotified = false;
+
+    // both maps are sorted by outpoint, walk them side by side
+    auto itReported = mapReportedStates.begin();
     for (auto& mnpair : mapMasternodes) {
-        CMasternodeBroadcast mnb = CMasternodeBroadcast(mnpair.second);
-        CScript currentMasternode = GetScriptForDestination(mnb.pubKeyCollateralAddress.GetID());
-        if(payee == currentMasternode)
-           return 2;
+        while (itReported != mapReportedStates.end() && itReported->first < mnpair.first) {
+            vecRemovedRet.push_back(itReported->first);
+            itReported = mapReportedStates.erase(itReported);
+        }
+        const CMasternode& mn = mnpair.second;
+        ReportedState state{mn.nActiveState, mn.nProtocolVersion, mn.sigTime, mn.lastPing.sigTime, mn.addr};
+        if (itReported != mapReportedStates.end() && itReported->first == mnpair.first) {
+            ReportedState& reported = itReported->second;
+            ++itReported;
+            if (reported.nActiveState == state.nActiveState && reported.nProtocolVersion == state.nProtocolVersion &&
+                reported.sigTime == state.sigTime && reported.nTimeLastPing == state.nTimeLastPing && reported.addr == state.addr) {
+                continue;
+            }
+            reported = state;
+        } else {
+            mapReportedStates.emplace_hint(itReported, mnpair.first, state);
+        }
+        vecChangedRet.push_back(mnpair.second.GetInfo());
     }
-    return 0;
+    while (itReported != mapReportedStates.end()) {
+        vecRemovedRet.push_back(itReported->first);
+        itReported = mapReportedStates.erase(itReported);
+    }
+}
+
+int CMasternodeMan::IsPayeeAValidMasternode(CScript payee)
+{
+    if(!masternodeSync.IsMasternodeListSynced()) return 1;
+
+    LOCK(cs);
+    return mapIndexByPayee.count(payee) ? 2 : 0;
 }
 
 void CMasternodeMan::CheckAndRemoveBurnFundNotUniqueNode(CConnman& connman)
@@ -233,8 +370,9 @@ void CMasternodeMan::CheckAndRemoveBurnFundNotUniqueNode(CConnman& connman)
                     uint256 hash = mnb.GetHash();
                     // erase all of the broadcasts we've seen from this txin, ...
                     mapSeenMasternodeBroadcast.erase(hash);
-                    mWeAskedForMasternodeListEntry.erase(pmn.vin.prevout);
+                    UnindexMasternode(it->second);
                     mapMasternodes.erase(it);
+                    mapRankCache.Clear();
 
                     LogPrint(BCLog::MASTERNODE, "CMasternodeMan::CheckAndRemoveBurnFundNotUniqueNode -- banning...%s\n", pmn.addr.ToString());
                     CAddress add = CAddress(pmn.addr, NODE_NETWORK);
@@ -259,6 +397,8 @@ void CMasternodeMan::CheckAndRemoveLimitNumberNode(CConnman& connman, int nSinTy
 {
     if(!masternodeSync.IsMasternodeListSynced()) return;
 
+    LOCK2(cs_main, cs);
+
     std::vector<std::pair<int64_t, CMasternode*> > vecSigTimeType;
     std::vector<CMasternode> vpMasternodesToBan; //list node will be banned
 
@@ -291,7 +431,6 @@ void CMasternodeMan::CheckAndRemoveLimitNumberNode(CConnman& connman, int nSinTy
 
     if ((int)vpMasternodesToBan.size() > 0) {
         LogPrint(BCLog::MASTERNODE, "CMasternodeMan::CheckAndRemoveBurnFundNotUniqueNode -- removing...\n");
-        std::vector<CNode*> vNodesCopy = connman.CopyNodeVector();
         for (auto pmn : vpMasternodesToBan) {
             std::map<COutPoint, CMasternode>::iterator it;
             it = mapMasternodes.find(pmn.vin.prevout);
@@ -300,8 +439,9 @@ void CMasternodeMan::CheckAndRemoveLimitNumberNode(CConnman& connman, int nSinTy
             uint256 hash = mnb.GetHash();
             // erase all of the broadcasts we've seen from this txin, ...
             mapSeenMasternodeBroadcast.erase(hash);
-            mWeAskedForMasternodeListEntry.erase(pmn.vin.prevout);
+            UnindexMasternode(it->second);
             mapMasternodes.erase(it);
+            mapRankCache.Clear();
         }
 
         NotifyMasternodeUpdates(connman);
@@ -334,10 +474,11 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
             if (it->second.IsOutpointSpent()) {
                 LogPrint(BCLog::MASTERNODE, "CMasternodeMan::CheckAndRemove -- Removing Masternode: %s  addr=%s  %i now\n", it->second.GetStateString(), it->second.addr.ToString(), size() - 1);
 
-                // erase all of the broadcasts we've seen from this txin, ...
+                // erase all of the broadcasts we've seen from this txin, the entries we asked for expire on their own
                 mapSeenMasternodeBroadcast.erase(hash);
-                mWeAskedForMasternodeListEntry.erase(it->first);
+                UnindexMasternode(it->second);
                 mapMasternodes.erase(it++);
+                mapRankCache.Clear();
                 fMasternodesRemoved = true;
             } else {
                 bool fAsk = (nAskForMnbRecovery > 0) &&
@@ -356,7 +497,7 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
                     // ask first MNB_RECOVERY_QUORUM_TOTAL masternodes we can connect to and we haven't asked recently
                     for(int i = 0; setRequested.size() < MNB_RECOVERY_QUORUM_TOTAL && i < (int)vecMasternodeRanks.size(); i++) {
                         // avoid banning
-                        if(mWeAskedForMasternodeListEntry.count(it->first) && mWeAskedForMasternodeListEntry[it->first].count(vecMasternodeRanks[i].second.addr)) continue;
+                        if(mWeAskedForMasternodeListEntry.Contains(std::make_pair(it->first, (CNetAddr)vecMasternodeRanks[i].second.addr))) continue;
                         // didn't ask recently, ok to ask now
                         CService addr = vecMasternodeRanks[i].second.addr;
                         setRequested.insert(addr);
@@ -368,7 +509,10 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
                         nAskForMnbRecovery--;
                     }
                     // wait for mnb recovery replies for MNB_RECOVERY_WAIT_SECONDS seconds
-                    mMnbRecoveryRequests[hash] = std::make_pair(GetTime() + MNB_RECOVERY_WAIT_SECONDS, setRequested);
+                    // and allow this mnb to be re-verified again after MNB_RECOVERY_RETRY_SECONDS seconds
+                    // if mn is still in MASTERNODE_NEW_START_REQUIRED state
+                    int64_t nWaitUntil = GetTime() + MNB_RECOVERY_WAIT_SECONDS;
+                    mMnbRecoveryRequests.Set(hash, std::make_pair(nWaitUntil, setRequested), nWaitUntil + MNB_RECOVERY_RETRY_SECONDS);
                 }
                 ++it;
             }
@@ -378,7 +522,8 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
         LogPrint(BCLog::MASTERNODE, "CMasternodeMan::CheckAndRemove -- mMnbRecoveryGoodReplies size=%d\n", (int)mMnbRecoveryGoodReplies.size());
         std::map<uint256, std::vector<CMasternodeBroadcast> >::iterator itMnbReplies = mMnbRecoveryGoodReplies.begin();
         while(itMnbReplies != mMnbRecoveryGoodReplies.end()){
-            if(mMnbRecoveryRequests[itMnbReplies->first].first < GetTime()) {
+            const auto* pRequest = mMnbRecoveryRequests.Find(itMnbReplies->first);
+            if(!pRequest || pRequest->first < GetTime()) {
                 // all nodes we asked should have replied now
                 if(itMnbReplies->second.size() >= MNB_RECOVERY_QUORUM_REQUIRED) {
                     // majority of nodes we asked agrees that this mn doesn't require new mnb, reprocess one of new mnbs
@@ -399,54 +544,12 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
         // no need for cm_main below
         LOCK(cs);
 
-        std::map<uint256, std::pair< int64_t, std::set<CNetAddr> > >::iterator itMnbRequest = mMnbRecoveryRequests.begin();
-        while(itMnbRequest != mMnbRecoveryRequests.end()){
-            // Allow this mnb to be re-verified again after MNB_RECOVERY_RETRY_SECONDS seconds
-            // if mn is still in MASTERNODE_NEW_START_REQUIRED state.
-            if(GetTime() - itMnbRequest->second.first > MNB_RECOVERY_RETRY_SECONDS) {
-                mMnbRecoveryRequests.erase(itMnbRequest++);
-            } else {
-                ++itMnbRequest;
-            }
-        }
-
-        // check who's asked for the Masternode list
-        std::map<CNetAddr, int64_t>::iterator it1 = mAskedUsForMasternodeList.begin();
-        while(it1 != mAskedUsForMasternodeList.end()){
-            if((*it1).second < GetTime()) {
-                mAskedUsForMasternodeList.erase(it1++);
-            } else {
-                ++it1;
-            }
-        }
-
-        // check who we asked for the Masternode list
-        it1 = mWeAskedForMasternodeList.begin();
-        while(it1 != mWeAskedForMasternodeList.end()){
-            if((*it1).second < GetTime()){
-                mWeAskedForMasternodeList.erase(it1++);
-            } else {
-                ++it1;
-            }
-        }
-
-        // check which Masternodes we've asked for
-        std::map<COutPoint, std::map<CNetAddr, int64_t> >::iterator it2 = mWeAskedForMasternodeListEntry.begin();
-        while(it2 != mWeAskedForMasternodeListEntry.end()){
-            std::map<CNetAddr, int64_t>::iterator it3 = it2->second.begin();
-            while(it3 != it2->second.end()){
-                if(it3->second < GetTime()){
-                    it2->second.erase(it3++);
-                } else {
-                    ++it3;
-                }
-            }
-            if(it2->second.empty()) {
-                mWeAskedForMasternodeListEntry.erase(it2++);
-            } else {
-                ++it2;
-            }
-        }
+        // mnb recoveries which can be asked again, who can ask us and whom we can ask for the list or entries again
+        int64_t nNow = GetTime();
+        mMnbRecoveryRequests.Expire(nNow);
+        mAskedUsForMasternodeList.Expire(nNow);
+        mWeAskedForMasternodeList.Expire(nNow);
+        mWeAskedForMasternodeListEntry.Expire(nNow);
 
         std::map<CNetAddr, CMasternodeVerification>::iterator it3 = mWeAskedForVerification.begin();
         while(it3 != mWeAskedForVerification.end()){
@@ -460,15 +563,9 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
         // NOTE: do not expire mapSeenMasternodeBroadcast entries here, clean them on mnb updates!
 
         // remove expired mapSeenMasternodePing
-        std::map<uint256, CMasternodePing>::iterator it4 = mapSeenMasternodePing.begin();
-        while(it4 != mapSeenMasternodePing.end()){
-            if((*it4).second.IsExpired()) {
-                LogPrint(BCLog::MASTERNODE, "CMasternodeMan::CheckAndRemove -- Removing expired Masternode ping: hash=%s\n", (*it4).second.GetHash().ToString());
-                mapSeenMasternodePing.erase(it4++);
-            } else {
-                ++it4;
-            }
-        }
+        mapSeenMasternodePing.Expire(GetAdjustedTime(), [](const uint256& hash, CMasternodePing& mnp) {
+            LogPrint(BCLog::MASTERNODE, "CMasternodeMan::CheckAndRemove -- Removing expired Masternode ping: hash=%s\n", hash.ToString());
+        });
 
         // remove expired mapSeenMasternodeVerification
         std::map<uint256, CMasternodeVerification>::iterator itv2 = mapSeenMasternodeVerification.begin();
@@ -493,13 +590,27 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     mapMasternodes.clear();
-    mAskedUsForMasternodeList.clear();
-    mWeAskedForMasternodeList.clear();
-    mWeAskedForMasternodeListEntry.clear();
+    mapIndexByPubKey.clear();
+    mapIndexByPayee.clear();
+    mapIndexByAddr.clear();
+    setPaymentQueue.clear();
+    mapRankCache.Clear();
+    nListVersion++;
+    NotifyListChanged();
+    listSnapshot.reset();
+    mAskedUsForMasternodeList.Clear();
+    mWeAskedForMasternodeList.Clear();
+    mWeAskedForMasternodeListEntry.Clear();
     mapSeenMasternodeBroadcast.clear();
-    mapSeenMasternodePing.clear();
+    mapSeenMasternodePing.Clear();
     nDsqCount = 0;
     nLastWatchdogVoteTime = 0;
+
+    LOCK(cs_LastPaid);
+    mapPayeeLastPaid.clear();
+    mapLastPaidUndo.clear();
+    nLastPaidHeight = 0;
+    hashLastPaidBlock.SetNull();
 }
 
 int CMasternodeMan::CountMasternodes(int nProtocolVersion)
@@ -560,25 +671,25 @@ int CMasternodeMan::CountByIP(int nNetworkType)
 }
 */
 
-void CMasternodeMan::DsegUpdate(CNode* pnode, CConnman& connman)
+bool CMasternodeMan::DsegUpdate(CNode* pnode, CConnman& connman)
 {
     LOCK(cs);
 
     if(Params().NetworkIDString() == CBaseChainParams::MAIN) {
         if(!(pnode->addr.IsRFC1918() || pnode->addr.IsLocal())) {
-            std::map<CNetAddr, int64_t>::iterator it = mWeAskedForMasternodeList.find(pnode->addr);
-            if(it != mWeAskedForMasternodeList.end() && GetTime() < (*it).second) {
+            if(GetTime() < mWeAskedForMasternodeList.GetExpireTime(pnode->addr)) {
                 LogPrintf("CMasternodeMan::DsegUpdate -- we already asked %s for the list; skipping...\n", pnode->addr.ToString());
-                return;
+                return false;
             }
         }
     }
 
     connman.PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::DSEG, CTxIn()));
     int64_t askAgain = GetTime() + DSEG_UPDATE_SECONDS;
-    mWeAskedForMasternodeList[pnode->addr] = askAgain;
+    mWeAskedForMasternodeList.Set(pnode->addr, GetTime(), askAgain);
 
     LogPrint(BCLog::MASTERNODE, "CMasternodeMan::DsegUpdate -- asked %s for the list\n", pnode->addr.ToString());
+    return true;
 }
 
 CMasternode* CMasternodeMan::Find(const COutPoint &outpoint)
@@ -615,26 +726,23 @@ bool CMasternodeMan::GetMasternodeInfo(const COutPoint& outpoint, masternode_inf
 bool CMasternodeMan::GetMasternodeInfo(const CPubKey& pubKeyMasternode, masternode_info_t& mnInfoRet)
 {
     LOCK(cs);
-    for (auto& mnpair : mapMasternodes) {
-        if (mnpair.second.pubKeyMasternode == pubKeyMasternode) {
-            mnInfoRet = mnpair.second.GetInfo();
-            return true;
-        }
+    CMasternode* pmn = FindIndexed(mapIndexByPubKey, pubKeyMasternode);
+    if (!pmn) {
+        return false;
     }
-    return false;
+    mnInfoRet = pmn->GetInfo();
+    return true;
 }
 
 bool CMasternodeMan::GetMasternodeInfo(const CScript& payee, masternode_info_t& mnInfoRet)
 {
     LOCK(cs);
-    for (auto& mnpair : mapMasternodes) {
-        CScript scriptCollateralAddress = GetScriptForDestination(mnpair.second.pubKeyCollateralAddress.GetID());
-        if (scriptCollateralAddress == payee) {
-            mnInfoRet = mnpair.second.GetInfo();
-            return true;
-        }
+    CMasternode* pmn = FindIndexed(mapIndexByPayee, payee);
+    if (!pmn) {
+        return false;
     }
-    return false;
+    mnInfoRet = pmn->GetInfo();
+    return true;
 }
 
 bool CMasternodeMan::Has(const COutPoint& outpoint)
@@ -690,33 +798,50 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
 
     if ( vSinType == CMasternode::SinType::QSTEESNODE_UNKNOWN ) { return false; }
 
-    // Need LOCK2 here to ensure consistent locking order because the GetBlockHash call below locks cs_main
-    LOCK2(cs_main,cs);
+    // the chain is only needed for the tip and the score hash, read them first so
+    // that the list is walked without holding cs_main
+    int nTipHeight;
+    uint256 blockHash;
+    bool fBlockHash;
+    {
+        LOCK(cs_main);
+        nTipHeight = chainActive.Height();
+        fBlockHash = GetBlockHash(blockHash, nBlockHeight - 101);
+    }
+
+    // payees voted for in the next blocks (up to 8 entries ahead of current block to allow propagation)
+    std::set<std::pair<int, CScript> > setScheduled;
+    mnpayments.GetScheduledPayees(nBlockHeight, setScheduled);
+
+    LOCK(cs);
 
     std::vector<std::pair<int, CMasternode*> > vecMasternodeLastPaid;
 
     /*
-        Make a vector with all of the last paid times
+        Walk the payment queue, it is already sorted low to high by last paid block
     */
 
     int nMnCount = CountMasternodes();
+    int nMinProto = mnpayments.GetMinMasternodePaymentsProto();
 
-    for (auto& mnpair : mapMasternodes) {
-        if(!mnpair.second.IsValidForPayment()) continue;
+    for (const auto& entry : setPaymentQueue) {
+        CMasternode& mn = mapMasternodes.at(entry.second);
+        if(!mn.IsValidForPayment()) continue;
 
         //check protocol version
-        if(mnpair.second.nProtocolVersion < mnpayments.GetMinMasternodePaymentsProto()) continue;
+        if(mn.nProtocolVersion < nMinProto) continue;
 
-        //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
-        if(mnpayments.IsScheduled(mnpair.second, nBlockHeight)) continue;
+        //it's in the list -- so let's skip it
+        if(!setScheduled.empty() &&
+           setScheduled.count(std::make_pair(mn.GetSinTypeInt(), GetScriptForDestination(mn.pubKeyCollateralAddress.GetID())))) continue;
 
         //it's too new, wait for a cycle
-        if(fFilterSigTime && mnpair.second.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
+        if(fFilterSigTime && mn.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
 
         //make sure it has at least as many confirmations as there are masternodes
-        if(GetUTXOConfirmations(mnpair.first) < nMnCount) continue;
+        if(mn.nCollateralHeight <= 0 || nTipHeight - mn.nCollateralHeight + 1 < nMnCount) continue;
 
-        vecMasternodeLastPaid.push_back(std::make_pair(mnpair.second.GetLastPaidBlock(), &mnpair.second));
+        vecMasternodeLastPaid.push_back(std::make_pair(entry.first, &mn));
     }
 
     nCountRet = (int)vecMasternodeLastPaid.size();
@@ -727,11 +852,7 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
         return GetNextMasternodeInQueueForPayment(nBlockHeight, false, nCountRet, mnInfoRet, vSinType);
     }
 
-    // Sort them low to high
-    sort(vecMasternodeLastPaid.begin(), vecMasternodeLastPaid.end(), CompareLastPaidBlock());
-
-    uint256 blockHash;
-    if(!GetBlockHash(blockHash, nBlockHeight - 101)) {
+    if(!fBlockHash) {
         LogPrintf("CMasternode::GetNextMasternodeInQueueForPayment -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", nBlockHeight - 101);
         return false;
     }
@@ -825,6 +946,35 @@ bool CMasternodeMan::GetMasternodeScores(const uint256& nBlockHash, CMasternodeM
     return !vecMasternodeScoresRet.empty();
 }
 
+bool CMasternodeMan::GetRankedOutpoints(const uint256& nBlockHash, CMasternodeMan::rank_outpoints_t& vecOutpointsRet, int nMinProtocol)
+{
+    AssertLockHeld(cs);
+
+    // like GetMasternodeScores, nothing is ranked while the list syncs, not even from the cache
+    if (!masternodeSync.IsMasternodeListSynced())
+        return false;
+
+    // every vote of a block asks for the same few block hashes, score them once
+    std::pair<uint256, int> key = std::make_pair(nBlockHash, nMinProtocol);
+    if (mapRankCache.Get(key, vecOutpointsRet)) {
+        mapRankCache.Touch(key);
+        return true;
+    }
+
+    score_pair_vec_t vecMasternodeScores;
+    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+        return false;
+
+    std::shared_ptr<std::vector<COutPoint> > vecOutpoints = std::make_shared<std::vector<COutPoint> >();
+    vecOutpoints->reserve(vecMasternodeScores.size());
+    for (auto& scorePair : vecMasternodeScores) {
+        vecOutpoints->push_back(scorePair.second->vin.prevout);
+    }
+    vecOutpointsRet = vecOutpoints;
+    mapRankCache.Insert(key, vecOutpointsRet);
+    return true;
+}
+
 bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet, int nBlockHeight, int nMinProtocol)
 {
     nRankRet = -1;
@@ -841,14 +991,14 @@ bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet,
 
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    rank_outpoints_t vecOutpoints;
+    if (!GetRankedOutpoints(nBlockHash, vecOutpoints, nMinProtocol))
         return false;
 
     int nRank = 0;
-    for (auto& scorePair : vecMasternodeScores) {
+    for (const COutPoint& outpointRanked : *vecOutpoints) {
         nRank++;
-        if(scorePair.second->vin.prevout == outpoint) {
+        if(outpointRanked == outpoint) {
             nRankRet = nRank;
             return true;
         }
@@ -873,14 +1023,14 @@ bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMast
 
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    rank_outpoints_t vecOutpoints;
+    if (!GetRankedOutpoints(nBlockHash, vecOutpoints, nMinProtocol))
         return false;
 
     int nRank = 0;
-    for (auto& scorePair : vecMasternodeScores) {
+    for (const COutPoint& outpoint : *vecOutpoints) {
         nRank++;
-        vecMasternodeRanksRet.push_back(std::make_pair(nRank, *scorePair.second));
+        vecMasternodeRanksRet.push_back(std::make_pair(nRank, mapMasternodes.at(outpoint)));
     }
 
     return true;
@@ -926,6 +1076,67 @@ std::pair<CService, std::set<uint256> > CMasternodeMan::PopScheduledMnbRequestCo
 }
 
 
+std::shared_ptr<const CMasternodeListSnapshot> CMasternodeMan::GetListSnapshot()
+{
+    AssertLockHeld(cs);
+
+    int64_t nNow = GetTime();
+    if (listSnapshot) {
+        int64_t nAge = nNow - listSnapshot->nTime;
+        if (nAge < LIST_SNAPSHOT_MIN_SECONDS || (listSnapshot->nListVersion == nListVersion && nAge < LIST_SNAPSHOT_MAX_SECONDS)) {
+            return listSnapshot;
+        }
+    }
+
+    std::shared_ptr<CMasternodeListSnapshot> snapshot = std::make_shared<CMasternodeListSnapshot>();
+    snapshot->nListVersion = nListVersion;
+    snapshot->nTime = nNow;
+    int nSerialized = 0;
+
+    for (auto& mnpair : mapMasternodes) {
+        if (mnpair.second.addr.IsRFC1918() || mnpair.second.addr.IsLocal()) continue; // do not send local network masternode
+        if (mnpair.second.IsUpdateRequired()) continue; // do not send outdated masternodes
+
+        CMasternodeBroadcast mnb = CMasternodeBroadcast(mnpair.second);
+        const CMasternodePing& mnp = mnpair.second.lastPing;
+        uint256 hashMNB = mnb.GetHash();
+        uint256 hashMNP = mnp.GetHash();
+
+        // the announce carries the last ping, an entry is still good if neither changed
+        CMasternodeListSnapshot::entry_t entry;
+        if (listSnapshot) {
+            auto it = listSnapshot->mapEntries.find(mnpair.first);
+            if (it != listSnapshot->mapEntries.end() && it->second->hashMNB == hashMNB && it->second->hashMNP == hashMNP) {
+                entry = it->second;
+            }
+        }
+        if (!entry) {
+            std::shared_ptr<CMasternodeListSnapshot::Entry> entryNew = std::make_shared<CMasternodeListSnapshot::Entry>();
+            entryNew->hashMNB = hashMNB;
+            entryNew->hashMNP = hashMNP;
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << mnb;
+            entryNew->vchMNB.assign(ss.begin(), ss.end());
+            ss.clear();
+            ss << mnp;
+            entryNew->vchMNP.assign(ss.begin(), ss.end());
+            entry = entryNew;
+            nSerialized++;
+
+            mapSeenMasternodeBroadcast.insert(std::make_pair(hashMNB, std::make_pair(nNow, mnb)));
+            mapSeenMasternodePing.Insert(hashMNP, mnp, mnp.GetExpireTime());
+        }
+
+        snapshot->mapEntries.emplace(mnpair.first, entry);
+        snapshot->mapByHash.emplace(hashMNB, entry);
+        snapshot->mapByHash.emplace(hashMNP, entry);
+    }
+
+    LogPrint(BCLog::MASTERNODE, "CMasternodeMan::GetListSnapshot -- %d masternodes, %d serialized\n", snapshot->mapEntries.size(), nSerialized);
+    listSnapshot = snapshot;
+    return listSnapshot;
+}
+
 void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
 {
     if(fLiteMode) return; // disable all Dash specific functionality
@@ -941,19 +1152,28 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
 
         LogPrint(BCLog::MASTERNODE, "MNANNOUNCE -- Masternode announce, masternode=%s\n", mnb.vin.prevout.ToStringShort());
 
-        int nDos = 0;
-
-        if (CheckMnbAndUpdateMasternodeList(pfrom, mnb, nDos, connman)) {
-            // use announced Masternode as a peer
-            connman.AddNewAddress(CAddress(mnb.addr, NODE_NETWORK), pfrom->addr, 2*60*60);
-        } else if(nDos > 0) {
-            LOCK(cs_main);
-            Misbehaving(pfrom->GetId(), nDos);
+        // the announce signs with the collateral key and carries a ping signed with the masternode key
+        CSigVerifyQueue::SigChecks vChecks;
+        vChecks.emplace_back(CMessageSigner::GetMessageHash(mnb.GetSignatureMessage()), mnb.vchSig);
+        if (!mnb.lastPing.vchSig.empty()) {
+            vChecks.emplace_back(CMessageSigner::GetMessageHash(mnb.lastPing.GetSignatureMessage()), mnb.lastPing.vchSig);
         }
 
-        if(fMasternodesAdded) {
-            NotifyMasternodeUpdates(connman);
-        }
+        sigverifyqueue.Push(pfrom, std::move(vChecks), [this, pfrom, mnb, &connman]() mutable {
+            int nDos = 0;
+
+            if (CheckMnbAndUpdateMasternodeList(pfrom, mnb, nDos, connman)) {
+                // use announced Masternode as a peer
+                connman.AddNewAddress(CAddress(mnb.addr, NODE_NETWORK), pfrom->addr, 2*60*60);
+            } else if(nDos > 0) {
+                LOCK(cs_main);
+                Misbehaving(pfrom->GetId(), nDos);
+            }
+
+            if(fMasternodesAdded) {
+                NotifyMasternodeUpdates(connman);
+            }
+        });
     } else if (strCommand == NetMsgType::MNPING) { //Masternode Ping
 
         CMasternodePing mnp;
@@ -967,41 +1187,55 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
 
         LogPrint(BCLog::MASTERNODE, "MNPING -- Masternode ping, masternode=%s\n", mnp.vin.prevout.ToStringShort());
 
-        // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
-        LOCK2(cs_main, cs);
-
-        if(mapSeenMasternodePing.count(nHash)) return; //seen
-        mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
+        {
+            LOCK(cs);
+            if(mapSeenMasternodePing.Contains(nHash)) return; //seen
+            mapSeenMasternodePing.Insert(nHash, mnp, mnp.GetExpireTime());
+        }
 
         LogPrint(BCLog::MASTERNODE, "MNPING -- Masternode ping, masternode=%s new\n", mnp.vin.prevout.ToStringShort());
 
-        // see if we have this Masternode
-        CMasternode* pmn = Find(mnp.vin.prevout);
+        CSigVerifyQueue::SigChecks vChecks;
+        vChecks.emplace_back(CMessageSigner::GetMessageHash(mnp.GetSignatureMessage()), mnp.vchSig);
 
-        // if masternode uses sentinel ping instead of watchdog
-        // we shoud update nTimeLastWatchdogVote here if sentinel
-        // ping flag is actual
-        if(pmn && mnp.fSentinelIsCurrent)
-            UpdateWatchdogVoteTime(mnp.vin.prevout, mnp.sigTime);
-
-        // too late, new MNANNOUNCE is required
-        // allow ping processing after NSR to recover node automatically if not totally expired
-        if(pmn && pmn->IsExpired()) return;
+        sigverifyqueue.Push(pfrom, std::move(vChecks), [this, pfrom, mnp, &connman]() mutable {
+            // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
+            LOCK2(cs_main, cs);
 
-        int nDos = 0;
-        if(mnp.CheckAndUpdate(pmn, false, nDos, connman)) return;
+            // see if we have this Masternode
+            CMasternode* pmn = Find(mnp.vin.prevout);
+
+            // if masternode uses sentinel ping instead of watchdog
+            // we shoud update nTimeLastWatchdogVote here if sentinel
+            // ping flag is actual
+            if(pmn && mnp.fSentinelIsCurrent)
+                UpdateWatchdogVoteTime(mnp.vin.prevout, mnp.sigTime);
+
+            // too late, new MNANNOUNCE is required
+            // allow ping processing after NSR to recover node automatically if not totally expired
+            if(pmn && pmn->IsExpired()) return;
+
+            int nDos = 0;
+            int nActiveStatePrev = pmn ? pmn->nActiveState : CMasternode::MASTERNODE_ENABLED;
+            if(mnp.CheckAndUpdate(pmn, false, nDos, connman)) {
+                // a new last ping alone is not a change of the list, the snapshot picks it up when it expires
+                if (pmn->nActiveState != nActiveStatePrev) nListVersion++;
+                NotifyListChanged();
+                return;
+            }
 
-        if(nDos > 0) {
-            // if anything significant failed, mark that node
-            Misbehaving(pfrom->GetId(), nDos);
-        } else if(pmn != NULL) {
-            // nothing significant failed, mn is a known one too
-            return;
-        }
+            if(nDos > 0) {
+                // if anything significant failed, mark that node
+                Misbehaving(pfrom->GetId(), nDos);
+            } else if(pmn != NULL) {
+                // nothing significant failed, mn is a known one too
+                return;
+            }
 
-        // something significant is broken or mn is unknown,
-        // we might have to ask for a masternode entry once
-        AskForMN(pfrom, mnp.vin.prevout, connman);
+            // something significant is broken or mn is unknown,
+            // we might have to ask for a masternode entry once
+            AskForMN(pfrom, mnp.vin.prevout, connman);
+        });
 
     } else if (strCommand == NetMsgType::DSEG) { //Get Masternode list or specific entry
         // Ignore such requests until we are fully synced.
@@ -1021,21 +1255,32 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
             bool isLocal = (pfrom->addr.IsRFC1918() || pfrom->addr.IsLocal());
 
             if(!isLocal && Params().NetworkIDString() == CBaseChainParams::MAIN) {
-                std::map<CNetAddr, int64_t>::iterator it = mAskedUsForMasternodeList.find(pfrom->addr);
-                if (it != mAskedUsForMasternodeList.end() && it->second > GetTime()) {
+                if (mAskedUsForMasternodeList.GetExpireTime(pfrom->addr) > GetTime()) {
                     Misbehaving(pfrom->GetId(), 34);
                     LogPrintf("DSEG -- peer already asked me for the list, peer=%d\n", pfrom->GetId());
                     return;
                 }
                 int64_t askAgain = GetTime() + DSEG_UPDATE_SECONDS;
-                mAskedUsForMasternodeList[pfrom->addr] = askAgain;
+                mAskedUsForMasternodeList.Set(pfrom->addr, GetTime(), askAgain);
             }
         } //else, asking for a specific node which is ok
 
-        int nInvCount = 0;
+        if(vin == CTxIn()) {
+            // the whole list is served from the shared snapshot, getdata for its invs is answered from it too
+            std::shared_ptr<const CMasternodeListSnapshot> snapshot = GetListSnapshot();
+            int nInvCount = 0;
+            for (const auto& entrypair : snapshot->mapEntries) {
+                pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, entrypair.second->hashMNB));
+                pfrom->PushInventory(CInv(MSG_MASTERNODE_PING, entrypair.second->hashMNP));
+                nInvCount++;
+            }
+            connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_LIST, nInvCount));
+            LogPrint(BCLog::MASTERNODE, "DSEG -- Sent %d Masternode invs to peer %d\n", nInvCount, pfrom->GetId());
+            return;
+        }
 
         for (auto& mnpair : mapMasternodes) {
-            if (vin != CTxIn() && vin != mnpair.second.vin) continue; // asked for specific vin but we are not there yet
+            if (vin != mnpair.second.vin) continue; // asked for specific vin but we are not there yet
             if (mnpair.second.addr.IsRFC1918() || mnpair.second.addr.IsLocal()) continue; // do not send local network masternode
             if (mnpair.second.IsUpdateRequired()) continue; // do not send outdated masternodes
 
@@ -1046,21 +1291,13 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
             uint256 hashMNP = mnp.GetHash();
             pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hashMNB));
             pfrom->PushInventory(CInv(MSG_MASTERNODE_PING, hashMNP));
-            nInvCount++;
 
             mapSeenMasternodeBroadcast.insert(std::make_pair(hashMNB, std::make_pair(GetTime(), mnb)));
-            mapSeenMasternodePing.insert(std::make_pair(hashMNP, mnp));
+            mapSeenMasternodePing.Insert(hashMNP, mnp, mnp.GetExpireTime());
 
-            if (vin.prevout == mnpair.first) {
-                return;
-            }
-        }
-
-        if(vin == CTxIn()) {
-            connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SYNCSTATUSCOUNT, MASTERNODE_SYNC_LIST, nInvCount));
-            /*LogPrintf("DSEG -- Sent %d Masternode invs to peer %d\n", nInvCount, pfrom->GetId());*/
             return;
         }
+
         // smth weird happen - someone asked us for vin we have no idea about?
         LogPrint(BCLog::MASTERNODE, "DSEG -- No invs sent to peer %d\n", pfrom->GetId());
 
@@ -1133,13 +1370,6 @@ void CMasternodeMan::DoFullVerificationStep(CConnman& connman)
     int nOffset = MAX_POSE_RANK + nMyRank - 1;
     if(nOffset >= (int)vecMasternodeRanks.size()) return;
 
-    std::vector<CMasternode*> vSortedByAddr;
-    for (auto& mnpair : mapMasternodes) {
-        vSortedByAddr.push_back(&mnpair.second);
-    }
-
-    sort(vSortedByAddr.begin(), vSortedByAddr.end(), CompareByAddr());
-
     it = vecMasternodeRanks.begin() + nOffset;
     while(it != vecMasternodeRanks.end()) {
         if(it->second.IsPoSeVerified() || it->second.IsPoSeBanned()) {
@@ -1155,7 +1385,7 @@ void CMasternodeMan::DoFullVerificationStep(CConnman& connman)
         }
         LogPrint(BCLog::MASTERNODE, "CMasternodeMan::DoFullVerificationStep -- Verifying masternode %s rank %d/%d address %s\n",
                     it->second.vin.prevout.ToStringShort(), it->first, nRanksTotal, it->second.addr.ToString());
-        if(SendVerifyRequest(CAddress(it->second.addr, NODE_NETWORK), vSortedByAddr, connman)) {
+        if(SendVerifyRequest(CAddress(it->second.addr, NODE_NETWORK), connman)) {
             nCount++;
             if(nCount >= MAX_POSE_CONNECTIONS) break;
         }
@@ -1177,31 +1407,28 @@ void CMasternodeMan::CheckSameAddr()
     if(!masternodeSync.IsSynced() || mapMasternodes.empty()) return;
 
     std::vector<CMasternode*> vBan;
-    std::vector<CMasternode*> vSortedByAddr;
 
     {
         LOCK(cs);
 
-        CMasternode* pprevMasternode = NULL;
-        CMasternode* pverifiedMasternode = NULL;
-
-        for (auto& mnpair : mapMasternodes) {
-            vSortedByAddr.push_back(&mnpair.second);
-        }
-
-        sort(vSortedByAddr.begin(), vSortedByAddr.end(), CompareByAddr());
-
-        for (auto* pmn : vSortedByAddr) {
-            // check only (pre)enabled masternodes
-            if(!pmn->IsEnabled() && !pmn->IsPreEnabled()) continue;
-            // initial step
-            if(!pprevMasternode) {
-                pprevMasternode = pmn;
-                pverifiedMasternode = pmn->IsPoSeVerified() ? pmn : NULL;
-                continue;
-            }
-            // second+ step
-            if(pmn->addr == pprevMasternode->addr) {
+        for (auto& addrpair : mapIndexByAddr) {
+            // a single masternode at this address
+            if(addrpair.second.size() < 2) continue;
+
+            CMasternode* pprevMasternode = NULL;
+            CMasternode* pverifiedMasternode = NULL;
+
+            for (const COutPoint& outpoint : addrpair.second) {
+                CMasternode* pmn = &mapMasternodes.at(outpoint);
+                // check only (pre)enabled masternodes
+                if(!pmn->IsEnabled() && !pmn->IsPreEnabled()) continue;
+                // initial step
+                if(!pprevMasternode) {
+                    pprevMasternode = pmn;
+                    pverifiedMasternode = pmn->IsPoSeVerified() ? pmn : NULL;
+                    continue;
+                }
+                // second+ step
                 if(pverifiedMasternode) {
                     // another masternode with the same ip is verified, ban this one
                     vBan.push_back(pmn);
@@ -1211,10 +1438,8 @@ void CMasternodeMan::CheckSameAddr()
                     // and keep a reference to be able to ban following masternodes with the same ip
                     pverifiedMasternode = pmn;
                 }
-            } else {
-                pverifiedMasternode = pmn->IsPoSeVerified() ? pmn : NULL;
+                pprevMasternode = pmn;
             }
-            pprevMasternode = pmn;
         }
     }
 
@@ -1225,9 +1450,9 @@ void CMasternodeMan::CheckSameAddr()
     }
 }
 
-bool CMasternodeMan::SendVerifyRequest(const CAddress& addr, const std::vector<CMasternode*>& vSortedByAddr, CConnman& connman)
+bool CMasternodeMan::SendVerifyRequest(const CAddress& addr, CConnman& connman)
 {
-    if(netfulfilledman.HasFulfilledRequest(addr, strprintf("%s", NetMsgType::MNVERIFY)+"-request")) {
+    if(netfulfilledman.HasFulfilledRequest(addr, FULFILLED_MNVERIFY_REQUEST)) {
         // we already asked for verification, not a good idea to do this too often, skip it
         LogPrint(BCLog::MASTERNODE, "CMasternodeMan::SendVerifyRequest -- too many requests, skipping... addr=%s\n", addr.ToString());
         return false;
@@ -1239,7 +1464,7 @@ bool CMasternodeMan::SendVerifyRequest(const CAddress& addr, const std::vector<C
         return false;
     }
 
-    netfulfilledman.AddFulfilledRequest(addr, strprintf("%s", NetMsgType::MNVERIFY)+"-request");
+    netfulfilledman.AddFulfilledRequest(addr, FULFILLED_MNVERIFY_REQUEST);
     // use random nonce, store it and require node to reply with correct one later
     CMasternodeVerification mnv(addr, GetRandInt(999999), nCachedBlockHeight - 1);
     mWeAskedForVerification[addr] = mnv;
@@ -1260,7 +1485,7 @@ void CMasternodeMan::SendVerifyReply(CNode* pnode, CMasternodeVerification& mnv,
         return;
     }
 
-    if(netfulfilledman.HasFulfilledRequest(pnode->addr, strprintf("%s", NetMsgType::MNVERIFY)+"-reply")) {
+    if(netfulfilledman.HasFulfilledRequest(pnode->addr, FULFILLED_MNVERIFY_REPLY)) {
         // peer should not ask us that often
         LogPrintf("MasternodeMan::SendVerifyReply -- ERROR: peer already asked me recently, peer=%d\n", pnode->GetId());
         Misbehaving(pnode->GetId(), 20);
@@ -1288,7 +1513,7 @@ void CMasternodeMan::SendVerifyReply(CNode* pnode, CMasternodeVerification& mnv,
     }
 
     connman.PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::MNVERIFY, mnv));
-    netfulfilledman.AddFulfilledRequest(pnode->addr, strprintf("%s", NetMsgType::MNVERIFY)+"-reply");
+    netfulfilledman.AddFulfilledRequest(pnode->addr, FULFILLED_MNVERIFY_REPLY);
 }
 
 void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& mnv)
@@ -1298,7 +1523,7 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
     std::string strError;
 
     // did we even ask for it? if that's the case we should have matching fulfilled request
-    if(!netfulfilledman.HasFulfilledRequest(pnode->addr, strprintf("%s", NetMsgType::MNVERIFY)+"-request")) {
+    if(!netfulfilledman.HasFulfilledRequest(pnode->addr, FULFILLED_MNVERIFY_REQUEST)) {
         LogPrintf("CMasternodeMan::ProcessVerifyReply -- ERROR: we didn't ask for verification of %s, peer=%d\n", pnode->addr.ToString(), pnode->GetId());
         Misbehaving(pnode->GetId(), 20);
         return;
@@ -1328,7 +1553,7 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
     }
 
     // we already verified this address, why node is spamming?
-    if(netfulfilledman.HasFulfilledRequest(pnode->addr, strprintf("%s", NetMsgType::MNVERIFY)+"-done")) {
+    if(netfulfilledman.HasFulfilledRequest(pnode->addr, FULFILLED_MNVERIFY_DONE)) {
         LogPrintf("CMasternodeMan::ProcessVerifyReply -- ERROR: already verified %s recently\n", pnode->addr.ToString());
         Misbehaving(pnode->GetId(), 20);
         return;
@@ -1340,21 +1565,23 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
         CMasternode* prealMasternode = NULL;
         std::vector<CMasternode*> vpMasternodesToBan;
         std::string strMessage1 = strprintf("%s%d%s", pnode->addr.ToString(false), mnv.nonce, blockHash.ToString());
-        for (auto& mnpair : mapMasternodes) {
-            if(CAddress(mnpair.second.addr, NODE_NETWORK) == pnode->addr) {
-                if(CMessageSigner::VerifyMessage(mnpair.second.pubKeyMasternode, mnv.vchSig1, strMessage1, strError)) {
+        auto itAddr = mapIndexByAddr.find(pnode->addr);
+        if (itAddr != mapIndexByAddr.end()) {
+            for (const COutPoint& outpoint : itAddr->second) {
+                CMasternode& mn = mapMasternodes.at(outpoint);
+                if(CMessageSigner::VerifyMessage(mn.pubKeyMasternode, mnv.vchSig1, strMessage1, strError)) {
                     // found it!
-                    prealMasternode = &mnpair.second;
-                    if(!mnpair.second.IsPoSeVerified()) {
-                        mnpair.second.DecreasePoSeBanScore();
+                    prealMasternode = &mn;
+                    if(!mn.IsPoSeVerified()) {
+                        mn.DecreasePoSeBanScore();
                     }
-                    netfulfilledman.AddFulfilledRequest(pnode->addr, strprintf("%s", NetMsgType::MNVERIFY)+"-done");
+                    netfulfilledman.AddFulfilledRequest(pnode->addr, FULFILLED_MNVERIFY_DONE);
 
                     // we can only broadcast it if we are an activated masternode
                     if(activeMasternode.outpoint == COutPoint()) continue;
                     // update ...
-                    mnv.addr = mnpair.second.addr;
-                    mnv.vin1 = mnpair.second.vin;
+                    mnv.addr = mn.addr;
+                    mnv.vin1 = mn.vin;
                     mnv.vin2 = CTxIn(activeMasternode.outpoint);
                     std::string strMessage2 = strprintf("%s%d%s%s%s", mnv.addr.ToString(false), mnv.nonce, blockHash.ToString(),
                                             mnv.vin1.prevout.ToStringShort(), mnv.vin2.prevout.ToStringShort());
@@ -1376,7 +1603,7 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
                     mnv.Relay();
 
                 } else {
-                    vpMasternodesToBan.push_back(&mnpair.second);
+                    vpMasternodesToBan.push_back(&mn);
                 }
             }
         }
@@ -1495,12 +1722,16 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
 
         // increase ban score for everyone else with the same addr
         int nCount = 0;
-        for (auto& mnpair : mapMasternodes) {
-            if(mnpair.second.addr != mnv.addr || mnpair.first == mnv.vin1.prevout) continue;
-            mnpair.second.IncreasePoSeBanScore();
-            nCount++;
-            LogPrint(BCLog::MASTERNODE, "CMasternodeMan::ProcessVerifyBroadcast -- increased PoSe ban score for %s addr %s, new score %d\n",
-                        mnpair.first.ToStringShort(), mnpair.second.addr.ToString(), mnpair.second.nPoSeBanScore);
+        auto itAddr = mapIndexByAddr.find(mnv.addr);
+        if (itAddr != mapIndexByAddr.end()) {
+            for (const COutPoint& outpoint : itAddr->second) {
+                if(outpoint == mnv.vin1.prevout) continue;
+                CMasternode& mn = mapMasternodes.at(outpoint);
+                mn.IncreasePoSeBanScore();
+                nCount++;
+                LogPrint(BCLog::MASTERNODE, "CMasternodeMan::ProcessVerifyBroadcast -- increased PoSe ban score for %s addr %s, new score %d\n",
+                            outpoint.ToStringShort(), mn.addr.ToString(), mn.nPoSeBanScore);
+            }
         }
         if(nCount)
             LogPrintf("CMasternodeMan::ProcessVerifyBroadcast -- PoSe score increased for %d fake masternodes, addr %s\n",
@@ -1524,7 +1755,7 @@ std::string CMasternodeMan::ToString() const
 void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman& connman)
 {
     LOCK2(cs_main, cs);
-    mapSeenMasternodePing.insert(std::make_pair(mnb.lastPing.GetHash(), mnb.lastPing));
+    mapSeenMasternodePing.Insert(mnb.lastPing.GetHash(), mnb.lastPing, mnb.lastPing.GetExpireTime());
     mapSeenMasternodeBroadcast.insert(std::make_pair(mnb.GetHash(), std::make_pair(GetTime(), mnb)));
 
     LogPrintf("CMasternodeMan::UpdateMasternodeList -- masternode=%s  addr=%s\n", mnb.vin.prevout.ToStringShort(), mnb.addr.ToString());
@@ -1536,7 +1767,10 @@ void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman& co
         }
     } else {
         CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-        if(pmn->UpdateFromNewBroadcast(mnb, connman)) {
+        UnindexMasternode(*pmn);
+        bool fUpdated = pmn->UpdateFromNewBroadcast(mnb, connman);
+        IndexMasternode(*pmn);
+        if(fUpdated) {
             masternodeSync.BumpAssetLastTime("CMasternodeMan::UpdateMasternodeList - seen");
             mapSeenMasternodeBroadcast.erase(mnbOld.GetHash());
         }
@@ -1563,12 +1797,13 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
                 masternodeSync.BumpAssetLastTime("CMasternodeMan::CheckMnbAndUpdateMasternodeList - seen");
             }
             // did we ask this node for it?
-            if(pfrom && IsMnbRecoveryRequested(hash) && GetTime() < mMnbRecoveryRequests[hash].first) {
+            auto* pRequest = mMnbRecoveryRequests.Find(hash);
+            if(pfrom && pRequest && GetTime() < pRequest->first) {
                 LogPrint(BCLog::MASTERNODE, "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- mnb=%s seen request\n", hash.ToString());
-                if(mMnbRecoveryRequests[hash].second.count(pfrom->addr)) {
+                if(pRequest->second.count(pfrom->addr)) {
                     LogPrint(BCLog::MASTERNODE, "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- mnb=%s seen request, addr=%s\n", hash.ToString(), pfrom->addr.ToString());
                     // do not allow node to send same mnb multiple times in recovery mode
-                    mMnbRecoveryRequests[hash].second.erase(pfrom->addr);
+                    pRequest->second.erase(pfrom->addr);
                     // does it have newer lastPing?
                     if(mnb.lastPing.sigTime > mapSeenMasternodeBroadcast[hash].second.lastPing.sigTime) {
                         // simulate Check
@@ -1598,7 +1833,11 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
         CMasternode* pmn = Find(mnb.vin.prevout);
         if(pmn) {
             CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-            if(!mnb.Update(pmn, nDos, connman)) {
+            // the broadcast may change the key and address of the masternode
+            UnindexMasternode(*pmn);
+            bool fUpdated = mnb.Update(pmn, nDos, connman);
+            IndexMasternode(*pmn);
+            if(!fUpdated) {
                 LogPrint(BCLog::MASTERNODE, "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- Update() failed, masternode=%s\n", mnb.vin.prevout.ToStringShort());
                 return false;
             }
@@ -1642,19 +1881,181 @@ void CMasternodeMan::UpdateLastPaid(const CBlockIndex* pindex)
 
     if(fLiteMode || !masternodeSync.IsWinnersListSynced() || mapMasternodes.empty()) return;
 
-    static bool IsFirstRun = true;
-    // Do full scan on first run or if we are not a masternode
-    // (MNs should update this info on every block, so limited scan should be enough for them)
-    int nMaxBlocksToScanBack = (IsFirstRun || !fMasterNode) ? mnpayments.GetStorageLimit() : LAST_PAID_SCAN_BLOCKS;
+    int nMaxBlocksToScanBack = mnpayments.GetStorageLimit();
 
-    // LogPrint("mnpayments", "CMasternodeMan::UpdateLastPaid -- nHeight=%d, nMaxBlocksToScanBack=%d, IsFirstRun=%s\n",
-    //                         nCachedBlockHeight, nMaxBlocksToScanBack, IsFirstRun ? "true" : "false");
+    LOCK(cs_mapMasternodeBlocks);
+    LOCK(cs_LastPaid);
 
     for (auto& mnpair: mapMasternodes) {
-        mnpair.second.UpdateLastPaid(pindex, nMaxBlocksToScanBack);
+        CScript mnpayee = GetScriptForDestination(mnpair.second.pubKeyCollateralAddress.GetID());
+        auto it = mapPayeeLastPaid.find(mnpayee);
+        if (it == mapPayeeLastPaid.end()) continue;
+
+        // only a payment of a block we know, recent enough to still have its votes, and which
+        // was voted for counts, the latest payment of the payee is the only one kept
+        int nHeight = it->second.first;
+        if (nHeight > pindex->nHeight || nHeight <= pindex->nHeight - nMaxBlocksToScanBack) continue;
+        if (!mnpayments.HasPayeeWithVotes(nHeight, mnpayee, 2)) continue;
+
+        if (nHeight <= mnpair.second.GetLastPaidBlock()) continue;
+        setPaymentQueue.erase(std::make_pair(mnpair.second.GetLastPaidBlock(), mnpair.first));
+        mnpair.second.UpdateLastPaid(nHeight, it->second.second);
+        setPaymentQueue.emplace(mnpair.second.GetLastPaidBlock(), mnpair.first);
+    }
+}
+
+/** Payees of the masternode payments in the coinbase of a block at nHeight */
+static void FindPaidPayees(const CBlock& block, int nHeight, std::vector<CScript>& vPayeesRet)
+{
+    if (block.vtx.empty() || !block.vtx[0]->IsCoinBase()) return;
+
+    CAmount nNodePaymentQSTEESNODE_1 = GetMasternodePayment(nHeight, 1);
+    CAmount nNodePaymentQSTEESNODE_5 = GetMasternodePayment(nHeight, 5);
+    CAmount nNodePaymentQSTEESNODE_10 = GetMasternodePayment(nHeight, 10);
+
+    for (const CTxOut& txout : block.vtx[0]->vout) {
+        if (txout.nValue == nNodePaymentQSTEESNODE_1 || txout.nValue == nNodePaymentQSTEESNODE_5 ||
+            txout.nValue == nNodePaymentQSTEESNODE_10) {
+            vPayeesRet.push_back(txout.scriptPubKey);
+        }
+    }
+}
+
+void CMasternodeMan::KeepKnownPayees(std::vector<CScript>& vPayees)
+{
+    LOCK(cs);
+    vPayees.erase(std::remove_if(vPayees.begin(), vPayees.end(), [this](const CScript& payee) {
+        return mapIndexByPayee.count(payee) == 0;
+    }), vPayees.end());
+}
+
+void CMasternodeMan::PruneLastPaid(int nLowHeight)
+{
+    AssertLockHeld(cs_LastPaid);
+    for (auto it = mapPayeeLastPaid.begin(); it != mapPayeeLastPaid.end();) {
+        if (it->second.first <= nLowHeight) it = mapPayeeLastPaid.erase(it);
+        else ++it;
+    }
+}
+
+bool CMasternodeMan::ConnectLastPaid(const std::vector<CScript>& vPayees, const CBlockIndex* pindex, bool fStart)
+{
+    AssertLockHeld(cs_LastPaid);
+    if (hashLastPaidBlock.IsNull() ? !fStart : (pindex->pprev == nullptr || pindex->pprev->GetBlockHash() != hashLastPaidBlock)) return false;
+
+    std::vector<std::pair<CScript, std::pair<int, int64_t> > > vUndo;
+    for (const CScript& payee : vPayees) {
+        auto it = mapPayeeLastPaid.find(payee);
+        vUndo.emplace_back(payee, it == mapPayeeLastPaid.end() ? std::make_pair(0, (int64_t)0) : it->second);
+        mapPayeeLastPaid[payee] = std::make_pair(pindex->nHeight, (int64_t)pindex->nTime);
+    }
+    mapLastPaidUndo[pindex->nHeight] = std::make_pair(pindex->GetBlockHash(), std::move(vUndo));
+    mapLastPaidUndo.erase(mapLastPaidUndo.begin(), mapLastPaidUndo.lower_bound(pindex->nHeight - LAST_PAID_UNDO_DEPTH));
+    nLastPaidHeight = pindex->nHeight;
+    hashLastPaidBlock = pindex->GetBlockHash();
+    return true;
+}
+
+/**
+ * Start again from the payments storage limit when the last applied block is not an
+ * ancestor of pindex or is older than that. The blocks are scanned without holding
+ * cs_LastPaid, each one is applied only if it still extends the index.
+ */
+bool CMasternodeMan::CatchUpLastPaid(const CBlockIndex* pindex)
+{
+    if (pindex == nullptr) return true;
+
+    int nLowHeight = std::max(1, pindex->nHeight - mnpayments.GetStorageLimit());
+    {
+        LOCK(cs_LastPaid);
+        if (pindex->GetBlockHash() == hashLastPaidBlock) return true;
+
+        const CBlockIndex* pindexLast = nLastPaidHeight > 0 ? pindex->GetAncestor(nLastPaidHeight) : nullptr;
+        if (pindexLast == nullptr || pindexLast->GetBlockHash() != hashLastPaidBlock || nLastPaidHeight < nLowHeight) {
+            if (nLastPaidHeight > 0) {
+                LogPrint(BCLog::MASTERNODE, "CMasternodeMan::CatchUpLastPaid -- last paid block %s is not in chain or too old, rebuild\n", hashLastPaidBlock.ToString());
+            }
+            mapPayeeLastPaid.clear();
+            mapLastPaidUndo.clear();
+            nLastPaidHeight = 0;
+            hashLastPaidBlock.SetNull();
+        } else {
+            nLowHeight = nLastPaidHeight + 1;
+        }
     }
 
-    IsFirstRun = false;
+    CBlockScanner<std::vector<CScript> > scanner(pindex, nLowHeight, false);
+    return scanner.Run(
+        [](const CBlock& block, const CBlockIndex* pindexBlock, std::vector<CScript>& vPayees) {
+            FindPaidPayees(block, pindexBlock->nHeight, vPayees);
+            return true;
+        },
+        [this, nLowHeight](const CBlockIndex* pindexBlock, std::vector<CScript>& vPayees) {
+            KeepKnownPayees(vPayees);
+            LOCK(cs_LastPaid);
+            return ConnectLastPaid(vPayees, pindexBlock, pindexBlock->nHeight == nLowHeight);
+        });
+}
+
+void CMasternodeMan::ScheduleCatchUpLastPaid()
+{
+    auto job = [this] {
+        const CBlockIndex* pindex;
+        {
+            LOCK(cs_LastPaid);
+            pindex = pindexLastPaidTip;
+            fLastPaidCatchUpScheduled = false;
+        }
+        CatchUpLastPaid(pindex);
+    };
+    // without the job threads (before they start) on this thread, still without holding cs_LastPaid
+    if (!mnjobs.Schedule("masternodelastpaid", job)) job();
+}
+
+void CMasternodeMan::BlockConnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    if (fLiteMode) return;
+
+    std::vector<CScript> vPayees;
+    FindPaidPayees(block, pindex->nHeight, vPayees);
+    KeepKnownPayees(vPayees);
+
+    {
+        LOCK(cs_LastPaid);
+        pindexLastPaidTip = pindex;
+        if (ConnectLastPaid(vPayees, pindex)) return;
+        // empty index or missed blocks, a catch up rescans up to this one
+        if (fLastPaidCatchUpScheduled) return;
+        fLastPaidCatchUpScheduled = true;
+    }
+    ScheduleCatchUpLastPaid();
+}
+
+void CMasternodeMan::BlockDisconnected(const CBlock& block, const CBlockIndex* pindex)
+{
+    LOCK(cs_LastPaid);
+    if (pindex == nullptr) return;
+    pindexLastPaidTip = pindex->pprev;
+    if (block.GetHash() != hashLastPaidBlock) return;
+
+    auto it = mapLastPaidUndo.find(pindex->nHeight);
+    if (it == mapLastPaidUndo.end() || it->second.first != hashLastPaidBlock) {
+        // undo data is gone, next connected block will rebuild
+        LogPrintf("CMasternodeMan::BlockDisconnected -- no last paid undo data at height %d\n", pindex->nHeight);
+        mapPayeeLastPaid.clear();
+        mapLastPaidUndo.clear();
+        nLastPaidHeight = 0;
+        hashLastPaidBlock.SetNull();
+        return;
+    }
+    const std::vector<std::pair<CScript, std::pair<int, int64_t> > >& vUndo = it->second.second;
+    for (auto itUndo = vUndo.rbegin(); itUndo != vUndo.rend(); ++itUndo) {
+        if (itUndo->second.first == 0) mapPayeeLastPaid.erase(itUndo->first);
+        else mapPayeeLastPaid[itUndo->first] = itUndo->second;
+    }
+    mapLastPaidUndo.erase(it);
+    nLastPaidHeight = pindex->nHeight - 1;
+    hashLastPaidBlock = block.hashPrevBlock;
 }
 
 void CMasternodeMan::UpdateWatchdogVoteTime(const COutPoint& outpoint, uint64_t nVoteTime)
@@ -1678,11 +2079,9 @@ bool CMasternodeMan::IsWatchdogActive()
 void CMasternodeMan::CheckMasternode(const CPubKey& pubKeyMasternode, bool fForce)
 {
     LOCK2(cs_main, cs);
-    for (auto& mnpair : mapMasternodes) {
-        if (mnpair.second.pubKeyMasternode == pubKeyMasternode) {
-            mnpair.second.Check(fForce);
-            return;
-        }
+    CMasternode* pmn = FindIndexed(mapIndexByPubKey, pubKeyMasternode);
+    if (pmn) {
+        pmn->Check(fForce);
     }
 }
 
@@ -1701,13 +2100,14 @@ void CMasternodeMan::SetMasternodeLastPing(const COutPoint& outpoint, const CMas
         return;
     }
     pmn->lastPing = mnp;
+    NotifyListChanged();
     // if masternode uses sentinel ping instead of watchdog
     // we shoud update nTimeLastWatchdogVote here if sentinel
     // ping flag is actual
     if(mnp.fSentinelIsCurrent) {
         UpdateWatchdogVoteTime(mnp.vin.prevout, mnp.sigTime);
     }
-    mapSeenMasternodePing.insert(std::make_pair(mnp.GetHash(), mnp));
+    mapSeenMasternodePing.Insert(mnp.GetHash(), mnp, mnp.GetExpireTime());
 
     CMasternodeBroadcast mnb(*pmn);
     uint256 hash = mnb.GetHash();
@@ -1723,6 +2123,13 @@ void CMasternodeMan::UpdatedBlockTip(const CBlockIndex *pindex)
 
     CheckSameAddr();
 
+    // payments UpdateLastPaid does not look at any more
+    int nLowHeight = pindex->nHeight - mnpayments.GetStorageLimit();
+    {
+        LOCK(cs_LastPaid);
+        PruneLastPaid(nLowHeight);
+    }
+
     if(fMasterNode) {
         // normal wallet does not need to update this every block, doing update on rpc call should be enough
         UpdateLastPaid(pindex);
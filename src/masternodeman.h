@@ -7,9 +7,15 @@
 #ifndef FXTC_MASTERNODEMAN_H
 #define FXTC_MASTERNODEMAN_H
 
+#include <cachemap.h>
+#include <expirymap.h>
 #include <masternode.h>
 #include <sync.h>
 
+#include <memory>
+#include <set>
+#include <unordered_map>
+
 using namespace std;
 
 class CMasternodeMan;
@@ -17,6 +23,50 @@ class CConnman;
 
 extern CMasternodeMan mnodeman;
 
+/** Salted hash of the keys the masternode list and payment votes are indexed by */
+class SaltedMasternodeKeyHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedMasternodeKeyHasher();
+
+    size_t operator()(const CPubKey& pubKey) const;
+    size_t operator()(const CScript& script) const;
+    size_t operator()(const CService& addr) const;
+    size_t operator()(const CNetAddr& addr) const;
+    size_t operator()(const uint256& hash) const;
+    size_t operator()(const std::pair<COutPoint, CNetAddr>& entry) const;
+};
+
+/**
+ * Announces and pings served to peers syncing the full masternode list,
+ * serialized once and shared by every DSEG until the list changes
+ */
+struct CMasternodeListSnapshot
+{
+    struct Entry
+    {
+        uint256 hashMNB;
+        uint256 hashMNP;
+        std::vector<unsigned char> vchMNB;
+        std::vector<unsigned char> vchMNP;
+    };
+    typedef std::shared_ptr<const Entry> entry_t;
+
+    // list version it was built from and when
+    int64_t nListVersion;
+    int64_t nTime;
+    // masternodes announced to DSEG and their entries by announce and ping hash
+    std::map<COutPoint, entry_t> mapEntries;
+    std::map<uint256, entry_t> mapByHash;
+
+    /// Serialized MNANNOUNCE or MNPING of an inv, NULL if the snapshot does not have it
+    const std::vector<unsigned char>* Find(const CInv& inv) const;
+};
+
 class CMasternodeMan
 {
 public:
@@ -24,13 +74,21 @@ public:
     typedef std::vector<score_pair_t> score_pair_vec_t;
     typedef std::pair<int, CMasternode> rank_pair_t;
     typedef std::vector<rank_pair_t> rank_pair_vec_t;
+    typedef std::shared_ptr<const std::vector<COutPoint> > rank_outpoints_t;
 
 private:
     static const std::string SERIALIZATION_VERSION_STRING;
 
     static const int DSEG_UPDATE_SECONDS        = 3 * 60 * 60;
 
-    static const int LAST_PAID_SCAN_BLOCKS      = 100;
+    static const int LAST_PAID_UNDO_DEPTH       = 100;
+
+    static const int RANK_CACHE_SIZE            = 16;
+
+    // a changed list is served from its previous snapshot for that long before rebuilding it
+    static const int LIST_SNAPSHOT_MIN_SECONDS  = 5;
+    // snapshot rebuilt at least that often, for changes not counted in nListVersion (new pings)
+    static const int LIST_SNAPSHOT_MAX_SECONDS  = 60;
 
     static const int MIN_POSE_PROTO_VERSION     = 70203;
     static const int MAX_POSE_CONNECTIONS       = 10;
@@ -52,17 +110,42 @@ private:
 
     // map to hold all MNs
     std::map<COutPoint, CMasternode> mapMasternodes;
-    // who's asked for the Masternode list and the last time
-    std::map<CNetAddr, int64_t> mAskedUsForMasternodeList;
-    // who we asked for the Masternode list and the last time
-    std::map<CNetAddr, int64_t> mWeAskedForMasternodeList;
-    // which Masternodes we've asked for
-    std::map<COutPoint, std::map<CNetAddr, int64_t> > mWeAskedForMasternodeListEntry;
+    // indexes of mapMasternodes by masternode key, collateral payee and address, see IndexMasternode
+    std::unordered_map<CPubKey, std::set<COutPoint>, SaltedMasternodeKeyHasher> mapIndexByPubKey;
+    std::unordered_map<CScript, std::set<COutPoint>, SaltedMasternodeKeyHasher> mapIndexByPayee;
+    std::unordered_map<CService, std::set<COutPoint>, SaltedMasternodeKeyHasher> mapIndexByAddr;
+    // payment queue, MNs sorted by (last paid block, outpoint) as GetNextMasternodeInQueueForPayment walks them
+    std::set<std::pair<int, COutPoint> > setPaymentQueue;
+    // MNs sorted by score for the last used (block hash, min protocol), cleared when the list changes
+    CacheMap<std::pair<uint256, int>, rank_outpoints_t> mapRankCache;
+    // bumped when masternodes are added, removed or change state, not on new pings, see GetListSnapshot
+    int64_t nListVersion;
+    std::shared_ptr<const CMasternodeListSnapshot> listSnapshot;
+    // what GetMasternodeChanges last reported of each masternode, empty until it is first called
+    struct ReportedState
+    {
+        int nActiveState;
+        int nProtocolVersion;
+        int64_t sigTime;
+        int64_t nTimeLastPing;
+        CService addr;
+    };
+    std::map<COutPoint, ReportedState> mapReportedStates;
+    bool fReportChanges;
+    // NotifyMasternodeListChanged was signaled and the changes not fetched yet
+    bool fChangesNotified;
+    // who's asked for the Masternode list and the last time, expiring when they can ask again
+    expirymap<CNetAddr, int64_t, SaltedMasternodeKeyHasher> mAskedUsForMasternodeList;
+    // who we asked for the Masternode list and the last time, expiring when we can ask again
+    expirymap<CNetAddr, int64_t, SaltedMasternodeKeyHasher> mWeAskedForMasternodeList;
+    // which Masternodes we've asked for to whom and the last time, expiring when we can ask again
+    expirymap<std::pair<COutPoint, CNetAddr>, int64_t, SaltedMasternodeKeyHasher> mWeAskedForMasternodeListEntry;
     // who we asked for the masternode verification
     std::map<CNetAddr, CMasternodeVerification> mWeAskedForVerification;
 
     // these maps are used for masternode recovery from MASTERNODE_NEW_START_REQUIRED state
-    std::map<uint256, std::pair< int64_t, std::set<CNetAddr> > > mMnbRecoveryRequests;
+    // mnb hash - (end of the wait for replies, masternodes asked), expiring when it can be asked again
+    expirymap<uint256, std::pair< int64_t, std::set<CNetAddr> >, SaltedMasternodeKeyHasher> mMnbRecoveryRequests;
     std::map<uint256, std::vector<CMasternodeBroadcast> > mMnbRecoveryGoodReplies;
     std::list< std::pair<CService, uint256> > listScheduledMnbRequestConnections;
 
@@ -76,15 +159,53 @@ private:
 
     int64_t nLastWatchdogVoteTime;
 
+    // last coinbase payment of each masternode payee as (height, time), see ConnectLastPaid
+    std::map<CScript, std::pair<int, int64_t> > mapPayeeLastPaid;
+    // last block applied to mapPayeeLastPaid and, for recent blocks, the previous last paid of their payees (height 0 = none)
+    int nLastPaidHeight;
+    uint256 hashLastPaidBlock;
+    std::map<int, std::pair<uint256, std::vector<std::pair<CScript, std::pair<int, int64_t> > > > > mapLastPaidUndo;
+    // last tip connected, what a scheduled catch up reads the blocks to
+    const CBlockIndex* pindexLastPaidTip;
+    bool fLastPaidCatchUpScheduled;
+    // protects the last paid index only, no other lock is taken while holding it
+    mutable CCriticalSection cs_LastPaid;
+
     friend class CMasternodeSync;
 
     bool GetMasternodeScores(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol = 0);
+    /// Add or remove a masternode of mapMasternodes in the indexes, around any change of its keys. cs must be held
+    void IndexMasternode(const CMasternode& mn);
+    void UnindexMasternode(const CMasternode& mn);
+    void RebuildIndexes();
+    /// First masternode of an index entry, NULL if none
+    template <typename K>
+    CMasternode* FindIndexed(const std::unordered_map<K, std::set<COutPoint>, SaltedMasternodeKeyHasher>& mapIndex, const K& key);
+
+    /// Signal the GUI that the list changed, once until it fetches the changes. cs must be held
+    void NotifyListChanged();
+
+    /// Snapshot of the list for DSEG, rebuilt when stale reusing the entries that did not change. cs must be held
+    std::shared_ptr<const CMasternodeListSnapshot> GetListSnapshot();
+
+    /// Outpoints of GetMasternodeScores, scored once per block hash and min protocol
+    bool GetRankedOutpoints(const uint256& nBlockHash, rank_outpoints_t& vecOutpointsRet, int nMinProtocol = 0);
+
+    /// Record the payees paid at pindex if it extends the last paid index (or starts an empty one
+    /// when fStart is set), cs_LastPaid must be held
+    bool ConnectLastPaid(const std::vector<CScript>& vPayees, const CBlockIndex* pindex, bool fStart = false);
+    /// Drop the payees which are not masternodes of the list, cs_LastPaid must not be held
+    void KeepKnownPayees(std::vector<CScript>& vPayees);
+    /// Forget the payments at or below nLowHeight, cs_LastPaid must be held
+    void PruneLastPaid(int nLowHeight);
+    /// Catch up to the last connected tip on the job threads
+    void ScheduleCatchUpLastPaid();
 
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, std::pair<int64_t, CMasternodeBroadcast> > mapSeenMasternodeBroadcast;
-    // Keep track of all pings I've seen
-    std::map<uint256, CMasternodePing> mapSeenMasternodePing;
+    // Keep track of all pings I've seen, until they expire (adjusted time)
+    expirymap<uint256, CMasternodePing, SaltedMasternodeKeyHasher> mapSeenMasternodePing;
     // Keep track of all verifications I've seen
     std::map<uint256, CMasternodeVerification> mapSeenMasternodeVerification;
     // keep track of dsq count to prevent masternodes from gaming darksend queue
@@ -95,7 +216,7 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
-        LOCK(cs);
+        LOCK2(cs, cs_LastPaid);
         std::string strVersion;
         if(ser_action.ForRead()) {
             READWRITE(strVersion);
@@ -116,6 +237,15 @@ public:
 
         READWRITE(mapSeenMasternodeBroadcast);
         READWRITE(mapSeenMasternodePing);
+
+        READWRITE(mapPayeeLastPaid);
+        READWRITE(nLastPaidHeight);
+        READWRITE(hashLastPaidBlock);
+        READWRITE(mapLastPaidUndo);
+        if(ser_action.ForRead()) {
+            mapRankCache.Clear();
+            RebuildIndexes();
+        }
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
@@ -163,7 +293,11 @@ public:
     /// Count InfinityNode by network type - NET_IPV4, NET_IPV6, NET_TOR
     // int CountByIP(int nNetworkType);
 
-    void DsegUpdate(CNode* pnode, CConnman& connman);
+    /// Bumped on any change of the masternodes or their last ping
+    int64_t GetListVersion() { LOCK(cs); return nListVersion; }
+
+    /// Ask pnode for the full list, false when it was asked recently
+    bool DsegUpdate(CNode* pnode, CConnman& connman);
 
     /// Versions of Find that are safe to use from outside the class
     bool Get(const COutPoint& outpoint, CMasternode& masternodeRet);
@@ -183,9 +317,19 @@ public:
     masternode_info_t FindRandomNotInVec(const std::vector<COutPoint> &vecToExclude, int nProtocolVersion = -1);
 
     std::map<COutPoint, CMasternode> GetFullMasternodeMap() { return mapMasternodes; }
+    /**
+     * Info of the masternodes added or changed since the last call and the
+     * outpoints of those removed, of all of them if fFull. Feeds the GUI
+     * masternode list, which calls it when NotifyMasternodeListChanged fires.
+     */
+    void GetMasternodeChanges(bool fFull, std::vector<masternode_info_t>& vecChangedRet, std::vector<COutPoint>& vecRemovedRet);
 
     bool GetMasternodeRanks(rank_pair_vec_t& vecMasternodeRanksRet, int nBlockHeight = -1, int nMinProtocol = 0);
     bool GetMasternodeRank(const COutPoint &outpoint, int& nRankRet, int nBlockHeight = -1, int nMinProtocol = 0);
+    /// Forget the cached ranks, to call when the score or the protocol of a listed masternode changes
+    void ClearRankCache() { LOCK(cs); mapRankCache.Clear(); }
+    /// Snapshot last served to DSEG, NULL if none
+    std::shared_ptr<const CMasternodeListSnapshot> GetLastListSnapshot() const { LOCK(cs); return listSnapshot; }
 
     void ProcessMasternodeConnections(CConnman& connman);
     std::pair<CService, std::set<uint256> > PopScheduledMnbRequestConnection();
@@ -194,7 +338,7 @@ public:
 
     void DoFullVerificationStep(CConnman& connman);
     void CheckSameAddr();
-    bool SendVerifyRequest(const CAddress& addr, const std::vector<CMasternode*>& vSortedByAddr, CConnman& connman);
+    bool SendVerifyRequest(const CAddress& addr, CConnman& connman);
     void SendVerifyReply(CNode* pnode, CMasternodeVerification& mnv, CConnman& connman);
     void ProcessVerifyReply(CNode* pnode, CMasternodeVerification& mnv);
     void ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerification& mnv);
@@ -208,9 +352,13 @@ public:
     void UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman& connman);
     /// Perform complete check and only then update list and maps
     bool CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBroadcast mnb, int& nDos, CConnman& connman);
-    bool IsMnbRecoveryRequested(const uint256& hash) { return mMnbRecoveryRequests.count(hash); }
+    bool IsMnbRecoveryRequested(const uint256& hash) { return mMnbRecoveryRequests.Contains(hash); }
 
     void UpdateLastPaid(const CBlockIndex* pindex);
+    /// Bring the last paid index to pindex, reading the missing blocks from disk
+    bool CatchUpLastPaid(const CBlockIndex* pindex);
+    void BlockConnected(const CBlock& block, const CBlockIndex* pindex);
+    void BlockDisconnected(const CBlock& block, const CBlockIndex* pindex);
 
     bool IsWatchdogActive();
     void UpdateWatchdogVoteTime(const COutPoint& outpoint, uint64_t nVoteTime = 0);
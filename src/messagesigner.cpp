@@ -4,13 +4,98 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <crypto/sha256.h>
+#include <cuckoocache.h>
 #include <hash.h>
 #include <key_io.h>
+#include <random.h>
+#include <script/sigcache.h>
 #include <validation.h> // For strMessageMagic
 #include <messagesigner.h>
 #include <tinyformat.h>
+#include <util.h>
 #include <utilstrencodings.h>
 
+#include <atomic>
+#include <map>
+#include <mutex>
+
+#include <boost/thread.hpp>
+
+namespace {
+
+/**
+ * Hash signatures already verified, so the copies of a masternode message
+ * relayed by many peers only recover the signing key once.
+ */
+class CHashSignatureCache
+{
+private:
+    //! Entries are SHA256(nonce || hash || key id || signature)
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    size_t nElements;
+    boost::shared_mutex cs_sigcache;
+
+public:
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+
+    CHashSignatureCache() : nHits(0), nMisses(0)
+    {
+        GetRandBytes(nonce.begin(), 32);
+        // usable before InitSignatureCache, with the minimum size
+        nElements = setValid.setup_bytes(0);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig) const
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(keyID.begin(), keyID.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        setValid.insert(entry);
+    }
+
+    size_t setup_bytes(size_t nBytes)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        nElements = setValid.setup_bytes(nBytes);
+        return nElements;
+    }
+
+    size_t size()
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        return nElements;
+    }
+};
+
+CHashSignatureCache hashSignatureCache;
+
+/** Keys recovered by CHashSigner::RecoverKey, with the number of pending users of each */
+std::mutex mutexRecoveredKeys;
+std::map<uint256, std::pair<CPubKey, int> > mapRecoveredKeys;
+
+uint256 GetRecoveredKeyId(const uint256& hash, const std::vector<unsigned char>& vchSig)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << hash;
+    ss << vchSig;
+    return ss.GetHash();
+}
+
+} // namespace
+
 bool CMessageSigner::GetKeysFromSecret(const std::string strSecret, CKey& keyRet, CPubKey& pubkeyRet)
 {
     keyRet = DecodeSecret(strSecret);
@@ -23,20 +108,20 @@ bool CMessageSigner::GetKeysFromSecret(const std::string strSecret, CKey& keyRet
 
 bool CMessageSigner::SignMessage(const std::string strMessage, std::vector<unsigned char>& vchSigRet, const CKey key)
 {
-    CHashWriter ss(SER_GETHASH, 0);
-    ss << strMessageMagic;
-    ss << strMessage;
-
-    return CHashSigner::SignHash(ss.GetHash(), key, vchSigRet);
+    return CHashSigner::SignHash(GetMessageHash(strMessage), key, vchSigRet);
 }
 
 bool CMessageSigner::VerifyMessage(const CPubKey pubkey, const std::vector<unsigned char>& vchSig, const std::string strMessage, std::string& strErrorRet)
+{
+    return CHashSigner::VerifyHash(GetMessageHash(strMessage), pubkey, vchSig, strErrorRet);
+}
+
+uint256 CMessageSigner::GetMessageHash(const std::string& strMessage)
 {
     CHashWriter ss(SER_GETHASH, 0);
     ss << strMessageMagic;
     ss << strMessage;
-
-    return CHashSigner::VerifyHash(ss.GetHash(), pubkey, vchSig, strErrorRet);
+    return ss.GetHash();
 }
 
 bool CHashSigner::SignHash(const uint256& hash, const CKey key, std::vector<unsigned char>& vchSigRet)
@@ -46,8 +131,25 @@ bool CHashSigner::SignHash(const uint256& hash, const CKey key, std::vector<unsi
 
 bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
 {
+    uint256 entry;
+    hashSignatureCache.ComputeEntry(entry, hash, pubkey.GetID(), vchSig);
+    if (hashSignatureCache.Get(entry)) {
+        hashSignatureCache.nHits++;
+        return true;
+    }
+    hashSignatureCache.nMisses++;
+
     CPubKey pubkeyFromSig;
-    if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
+    bool fRecovered = false;
+    {
+        std::lock_guard<std::mutex> lock(mutexRecoveredKeys);
+        auto it = mapRecoveredKeys.find(GetRecoveredKeyId(hash, vchSig));
+        if (it != mapRecoveredKeys.end()) {
+            pubkeyFromSig = it->second.first;
+            fRecovered = true;
+        }
+    }
+    if(fRecovered ? !pubkeyFromSig.IsValid() : !pubkeyFromSig.RecoverCompact(hash, vchSig)) {
         strErrorRet = "Error recovering public key.";
         return false;
     }
@@ -59,5 +161,44 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey pubkey, const st
         return false;
     }
 
+    hashSignatureCache.Set(entry);
     return true;
 }
+
+void CHashSigner::RecoverKey(const uint256& hash, const std::vector<unsigned char>& vchSig)
+{
+    CPubKey pubkeyFromSig;
+    if (!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
+        // kept invalid, VerifyHash reports it as a recovery error
+        pubkeyFromSig = CPubKey();
+    }
+
+    std::lock_guard<std::mutex> lock(mutexRecoveredKeys);
+    auto& entry = mapRecoveredKeys[GetRecoveredKeyId(hash, vchSig)];
+    entry.first = pubkeyFromSig;
+    entry.second++;
+}
+
+void CHashSigner::ForgetRecoveredKey(const uint256& hash, const std::vector<unsigned char>& vchSig)
+{
+    std::lock_guard<std::mutex> lock(mutexRecoveredKeys);
+    auto it = mapRecoveredKeys.find(GetRecoveredKeyId(hash, vchSig));
+    if (it != mapRecoveredKeys.end() && --it->second.second <= 0) {
+        mapRecoveredKeys.erase(it);
+    }
+}
+
+void CHashSigner::InitSignatureCache()
+{
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-mnsigcachesize", DEFAULT_MNSIG_CACHE_SIZE)), MAX_MNSIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = hashSignatureCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for masternode signature cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+}
+
+void CHashSigner::GetSignatureCacheStats(size_t& nElementsRet, uint64_t& nHitsRet, uint64_t& nMissesRet)
+{
+    nElementsRet = hashSignatureCache.size();
+    nHitsRet = hashSignatureCache.nHits;
+    nMissesRet = hashSignatureCache.nMisses;
+}
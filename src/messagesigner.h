@@ -9,6 +9,14 @@
 
 #include <key.h>
 
+#include <stdint.h>
+#include <vector>
+
+/** -mnsigcachesize default in MiB, recovered signatures of masternode messages */
+static const int64_t DEFAULT_MNSIG_CACHE_SIZE = 4;
+/** Maximum -mnsigcachesize in MiB */
+static const int64_t MAX_MNSIG_CACHE_SIZE = 1024;
+
 /** Helper class for signing messages and checking their signatures
  */
 class CMessageSigner
@@ -20,6 +28,8 @@ public:
     static bool SignMessage(const std::string strMessage, std::vector<unsigned char>& vchSigRet, const CKey key);
     /// Verify the message signature, returns true if succcessful
     static bool VerifyMessage(const CPubKey pubkey, const std::vector<unsigned char>& vchSig, const std::string strMessage, std::string& strErrorRet);
+    /// Hash actually signed for the message
+    static uint256 GetMessageHash(const std::string& strMessage);
 };
 
 /** Helper class for signing hashes and checking their signatures
@@ -31,6 +41,15 @@ public:
     static bool SignHash(const uint256& hash, const CKey key, std::vector<unsigned char>& vchSigRet);
     /// Verify the hash signature, returns true if succcessful
     static bool VerifyHash(const uint256& hash, const CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
+    /// Recover the key of the hash signature ahead of time, VerifyHash uses it until ForgetRecoveredKey
+    static void RecoverKey(const uint256& hash, const std::vector<unsigned char>& vchSig);
+    /// Drop a key kept by RecoverKey
+    static void ForgetRecoveredKey(const uint256& hash, const std::vector<unsigned char>& vchSig);
+
+    /// Size the cache of verified hash signatures from -mnsigcachesize
+    static void InitSignatureCache();
+    /// Cache capacity in elements and lookups which hit or missed it so far
+    static void GetSignatureCacheStats(size_t& nElementsRet, uint64_t& nHitsRet, uint64_t& nMissesRet);
 };
 
 #endif // FXTC_MESSAGESIGNER_H
@@ -97,4 +97,7 @@ struct CNodeStateStats {
 /** Get statistics from node state */
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 
+/** Locked transactions a peer may miss, sent in full in our compact blocks */
+bool IsLockedTxPeerMayMiss(const CTransaction& tx);
+
 #endif // BITCOIN_NET_PROCESQSTEESG_H
@@ -5,70 +5,56 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <hash.h>
 #include <netfulfilledman.h>
+#include <random.h>
 #include <util.h>
 
 CNetFulfilledRequestManager netfulfilledman;
 
-void CNetFulfilledRequestManager::AddFulfilledRequest(CAddress addr, std::string strRequest)
+const std::string CNetFulfilledRequestManager::SERIALIZATION_VERSION_STRING = "CNetFulfilledRequestManager-Version-2";
+
+SaltedFulfilledRequestHasher::SaltedFulfilledRequestHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+size_t SaltedFulfilledRequestHasher::operator()(const std::pair<CNetAddr, fulfilled_request_t>& request) const
 {
-    LOCK(cs_mapFulfilledRequests);
-    mapFulfilledRequests[addr][strRequest] = GetTime() + Params().FulfilledRequestExpireTime();
+    return CSipHasher(k0, k1).Write(request.first.GetHash()).Write(request.second).Finalize();
 }
 
-bool CNetFulfilledRequestManager::HasFulfilledRequest(CAddress addr, std::string strRequest)
+void CNetFulfilledRequestManager::AddFulfilledRequest(const CAddress& addr, fulfilled_request_t request)
 {
     LOCK(cs_mapFulfilledRequests);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addr);
-
-    return  it != mapFulfilledRequests.end() &&
-            it->second.find(strRequest) != it->second.end() &&
-            it->second[strRequest] > GetTime();
+    int64_t nNow = GetTime();
+    mapFulfilledRequests.Set(std::make_pair((CNetAddr)addr, request), nNow, nNow + Params().FulfilledRequestExpireTime());
 }
 
-void CNetFulfilledRequestManager::RemoveFulfilledRequest(CAddress addr, std::string strRequest)
+bool CNetFulfilledRequestManager::HasFulfilledRequest(const CAddress& addr, fulfilled_request_t request)
 {
     LOCK(cs_mapFulfilledRequests);
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.find(addr);
+    return mapFulfilledRequests.GetExpireTime(std::make_pair((CNetAddr)addr, request)) > GetTime();
+}
 
-    if (it != mapFulfilledRequests.end()) {
-        it->second.erase(strRequest);
-    }
+void CNetFulfilledRequestManager::RemoveFulfilledRequest(const CAddress& addr, fulfilled_request_t request)
+{
+    LOCK(cs_mapFulfilledRequests);
+    mapFulfilledRequests.Erase(std::make_pair((CNetAddr)addr, request));
 }
 
 void CNetFulfilledRequestManager::CheckAndRemove()
 {
     LOCK(cs_mapFulfilledRequests);
-
-    int64_t now = GetTime();
-    fulfilledreqmap_t::iterator it = mapFulfilledRequests.begin();
-
-    while(it != mapFulfilledRequests.end()) {
-        fulfilledreqmapentry_t::iterator it_entry = it->second.begin();
-        while(it_entry != it->second.end()) {
-            if(now > it_entry->second) {
-                it->second.erase(it_entry++);
-            } else {
-                ++it_entry;
-            }
-        }
-        if(it->second.size() == 0) {
-            mapFulfilledRequests.erase(it++);
-        } else {
-            ++it;
-        }
-    }
+    mapFulfilledRequests.Expire(GetTime());
 }
 
 void CNetFulfilledRequestManager::Clear()
 {
     LOCK(cs_mapFulfilledRequests);
-    mapFulfilledRequests.clear();
+    mapFulfilledRequests.Clear();
 }
 
 std::string CNetFulfilledRequestManager::ToString() const
 {
     std::ostringstream info;
-    info << "Nodes with fulfilled requests: " << (int)mapFulfilledRequests.size();
+    info << "Fulfilled requests: " << (int)mapFulfilledRequests.size();
     return info.str();
 }
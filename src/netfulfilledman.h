@@ -7,6 +7,7 @@
 #ifndef FXTC_NETFULFILLEDMAN_H
 #define FXTC_NETFULFILLEDMAN_H
 
+#include <expirymap.h>
 #include <netbase.h>
 #include <protocol.h>
 #include <serialize.h>
@@ -15,32 +16,83 @@
 class CNetFulfilledRequestManager;
 extern CNetFulfilledRequestManager netfulfilledman;
 
+// What a peer has asked us for, or we asked it for
+enum fulfilled_request_t {
+    FULFILLED_SPORK_SYNC,
+    FULFILLED_MASTERNODE_LIST_SYNC,
+    FULFILLED_MASTERNODE_PAYMENT_SYNC,
+    FULFILLED_FULL_SYNC,
+    // the peer asked us for the masternode payment votes (MASTERNODEPAYMENTSYNC)
+    FULFILLED_MASTERNODE_PAYMENT_VOTES,
+    FULFILLED_MNVERIFY_REQUEST,
+    FULFILLED_MNVERIFY_REPLY,
+    FULFILLED_MNVERIFY_DONE
+};
+
+/** Salted hash of a fulfilled request of an address */
+class SaltedFulfilledRequestHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedFulfilledRequestHasher();
+
+    size_t operator()(const std::pair<CNetAddr, fulfilled_request_t>& request) const;
+};
+
 // Fulfilled requests are used to prevent nodes from asking for the same data on sync
 // and from being banned for doing so too often.
 class CNetFulfilledRequestManager
 {
 private:
-    typedef std::map<std::string, int64_t> fulfilledreqmapentry_t;
-    typedef std::map<CNetAddr, fulfilledreqmapentry_t> fulfilledreqmap_t;
+    static const std::string SERIALIZATION_VERSION_STRING;
+
+    typedef std::pair<CNetAddr, fulfilled_request_t> fulfilledreq_t;
 
-    //keep track of what node has/was asked for and when
-    fulfilledreqmap_t mapFulfilledRequests;
-    CCriticalSection cs_mapFulfilledRequests;
+    //keep track of what node has/was asked for and when, expiring when it can be asked again
+    expirymap<fulfilledreq_t, int64_t, SaltedFulfilledRequestHasher> mapFulfilledRequests;
+    mutable CCriticalSection cs_mapFulfilledRequests;
 
 public:
     CNetFulfilledRequestManager() {}
 
-    ADD_SERIALIZE_METHODS;
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        LOCK(cs_mapFulfilledRequests);
+        s << SERIALIZATION_VERSION_STRING;
+        WriteCompactSize(s, mapFulfilledRequests.size());
+        mapFulfilledRequests.ForEach([&s](const fulfilledreq_t& request, const int64_t& nTime, int64_t nExpireTime) {
+            s << request.first << (uint8_t)request.second << nTime << nExpireTime;
+        });
+    }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
         LOCK(cs_mapFulfilledRequests);
-        READWRITE(mapFulfilledRequests);
+        std::string strVersion;
+        s >> strVersion;
+        if (strVersion != SERIALIZATION_VERSION_STRING) {
+            throw std::ios_base::failure("CNetFulfilledRequestManager: unknown version " + strVersion);
+        }
+
+        mapFulfilledRequests.Clear();
+        uint64_t nRequests = ReadCompactSize(s);
+        for (uint64_t i = 0; i < nRequests; i++) {
+            CNetAddr addr;
+            uint8_t nRequest;
+            int64_t nTime, nExpireTime;
+            s >> addr >> nRequest >> nTime >> nExpireTime;
+            mapFulfilledRequests.Set(std::make_pair(addr, (fulfilled_request_t)nRequest), nTime, nExpireTime);
+        }
     }
 
-    void AddFulfilledRequest(CAddress addr, std::string strRequest); // expire after 1 hour by default
-    bool HasFulfilledRequest(CAddress addr, std::string strRequest);
-    void RemoveFulfilledRequest(CAddress addr, std::string strRequest);
+    void AddFulfilledRequest(const CAddress& addr, fulfilled_request_t request); // expire after 1 hour by default
+    bool HasFulfilledRequest(const CAddress& addr, fulfilled_request_t request);
+    void RemoveFulfilledRequest(const CAddress& addr, fulfilled_request_t request);
 
     void CheckAndRemove();
     void Clear();
@@ -297,6 +297,11 @@ static void NotifyAdditionalDataSyncProgressChanged(ClientModel *clientmodel, do
                               Q_ARG(double, nSyncProgress));
 }
 
+static void NotifyInfinitynodeStatsChanged(ClientModel *clientmodel)
+{
+    QMetaObject::invokeMethod(clientmodel, "infinitynodeStatsChanged", Qt::QueuedConnection);
+}
+
 void ClientModel::subscribeToCoreSignals()
 {
     // Connect signals to client
@@ -310,6 +315,7 @@ void ClientModel::subscribeToCoreSignals()
     // Dash
     m_handler_notify_additional_data_sync_progress_changed = m_node.handleNotifyAdditionalDataSyncProgressChanged(boost::bind(NotifyAdditionalDataSyncProgressChanged, this, _1));
     //
+    m_handler_notify_infinitynode_stats_changed = m_node.handleNotifyInfinitynodeStatsChanged(boost::bind(NotifyInfinitynodeStatsChanged, this));
 }
 
 void ClientModel::unsubscribeFromCoreSignals()
@@ -325,6 +331,7 @@ void ClientModel::unsubscribeFromCoreSignals()
     // Dash
     m_handler_notify_additional_data_sync_progress_changed->disconnect();
     //
+    m_handler_notify_infinitynode_stats_changed->disconnect();
 }
 
 bool ClientModel::getProxyInfo(std::string& ip_port) const
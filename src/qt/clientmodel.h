@@ -92,6 +92,7 @@ private:
     // Dash
     std::unique_ptr<interfaces::Handler> m_handler_notify_additional_data_sync_progress_changed;
     //
+    std::unique_ptr<interfaces::Handler> m_handler_notify_infinitynode_stats_changed;
     OptionsModel *optionsModel;
     PeerTableModel *peerTableModel;
     // Dash
@@ -114,6 +115,8 @@ Q_SIGNALS:
     //
     void numBlocksChanged(int count, const QDateTime& blockDate, double nVerificationProgress, bool header);
     void additionalDataSyncProgressChanged(double nSyncProgress);
+    //! Infinitynode counts or ROIs changed, read them with CInfinitynodeMan::GetStats
+    void infinitynodeStatsChanged();
     void mempoolSizeChanged(long count, size_t mempoolSizeInBytes);
     void networkActiveChanged(bool networkActive);
     void alertsChanged(const QString &warnings);
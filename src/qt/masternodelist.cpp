@@ -11,6 +11,7 @@
 #include <interfaces/wallet.h>
 #include <qt/clientmodel.h>
 #include <qt/guiutil.h>
+#include <qt/masternodetablemodel.h>
 #include <init.h>
 #include <key_io.h>
 #include <core_io.h>
@@ -23,25 +24,17 @@
 
 #include <QDialog>
 #include <QInputDialog>
+#include <QSortFilterProxyModel>
 #include <QTimer>
 #include <QMessageBox>
 
-int GetOffsetFromUtc()
-{
-#if QT_VERSION < 0x050200
-    const QDateTime dateTime1 = QDateTime::currentDateTime();
-    const QDateTime dateTime2 = QDateTime(dateTime1.date(), dateTime1.time(), Qt::UTC);
-    return dateTime1.secsTo(dateTime2);
-#else
-    return QDateTime::currentDateTime().offsetFromUtc();
-#endif
-}
-
 MasternodeList::MasternodeList(const PlatformStyle *platformStyle, QWidget *parent) :
     QWidget(parent),
     ui(new Ui::MasternodeList),
     clientModel(0),
-    walletModel(0)
+    walletModel(0),
+    masternodeModel(0),
+    masternodeProxyModel(0)
 {
     ui->setupUi(this);
 
@@ -61,11 +54,21 @@ MasternodeList::MasternodeList(const PlatformStyle *platformStyle, QWidget *pare
     ui->tableWidgetMyMasternodes->setColumnWidth(4, columnActiveWidth);
     ui->tableWidgetMyMasternodes->setColumnWidth(5, columnLastSeenWidth);
 
-    ui->tableWidgetMasternodes->setColumnWidth(0, columnAddressWidth);
-    ui->tableWidgetMasternodes->setColumnWidth(1, columnProtocolWidth);
-    ui->tableWidgetMasternodes->setColumnWidth(2, columnStatusWidth);
-    ui->tableWidgetMasternodes->setColumnWidth(3, columnActiveWidth);
-    ui->tableWidgetMasternodes->setColumnWidth(4, columnLastSeenWidth);
+    // the source model needs the node, it is set with the client model
+    masternodeProxyModel = new QSortFilterProxyModel(this);
+    masternodeProxyModel->setSortRole(MasternodeTableModel::SortRole);
+    // every column has the whole row as filter key, one is enough
+    masternodeProxyModel->setFilterRole(MasternodeTableModel::FilterRole);
+    masternodeProxyModel->setFilterKeyColumn(MasternodeTableModel::Address);
+    masternodeProxyModel->setDynamicSortFilter(true);
+    ui->tableViewMasternodes->setModel(masternodeProxyModel);
+    ui->tableViewMasternodes->sortByColumn(MasternodeTableModel::Address, Qt::AscendingOrder);
+
+    ui->tableViewMasternodes->setColumnWidth(MasternodeTableModel::Address, columnAddressWidth);
+    ui->tableViewMasternodes->setColumnWidth(MasternodeTableModel::Protocol, columnProtocolWidth);
+    ui->tableViewMasternodes->setColumnWidth(MasternodeTableModel::Status, columnStatusWidth);
+    ui->tableViewMasternodes->setColumnWidth(MasternodeTableModel::Active, columnActiveWidth);
+    ui->tableViewMasternodes->setColumnWidth(MasternodeTableModel::LastSeen, columnLastSeenWidth);
 
     ui->tableWidgetMyMasternodes->setContextMenuPolicy(Qt::CustomContextMenu);
 
@@ -75,13 +78,16 @@ MasternodeList::MasternodeList(const PlatformStyle *platformStyle, QWidget *pare
     connect(ui->tableWidgetMyMasternodes, SIGNAL(customContextMenuRequested(const QPoint&)), this, SLOT(showContextMenu(const QPoint&)));
     connect(startAliasAction, SIGNAL(triggered()), this, SLOT(on_startButton_clicked()));
 
+    // the model updates itself, only the count follows it
+    connect(masternodeProxyModel, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(updateNodeList()));
+    connect(masternodeProxyModel, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(updateNodeList()));
+    connect(masternodeProxyModel, SIGNAL(modelReset()), this, SLOT(updateNodeList()));
+    connect(masternodeProxyModel, SIGNAL(layoutChanged()), this, SLOT(updateNodeList()));
+
     timer = new QTimer(this);
-    connect(timer, SIGNAL(timeout()), this, SLOT(updateNodeList()));
     connect(timer, SIGNAL(timeout()), this, SLOT(updateMyNodeList()));
     timer->start(1000);
 
-    fFilterUpdated = false;
-    nTimeFilterUpdated = GetTime();
     updateNodeList();
 }
 
@@ -93,9 +99,9 @@ MasternodeList::~MasternodeList()
 void MasternodeList::setClientModel(ClientModel *model)
 {
     this->clientModel = model;
-    if(model) {
-        // try to update list when masternode count changes
-        connect(clientModel, SIGNAL(strMasternodesChanged(QString)), this, SLOT(updateNodeList()));
+    if (model && !masternodeModel) {
+        masternodeModel = new MasternodeTableModel(model->node(), this);
+        masternodeProxyModel->setSourceModel(masternodeModel);
     }
 }
 
@@ -244,7 +250,6 @@ void MasternodeList::updateMyNodeList(bool fForce)
     if(nSecondsTillUpdate > 0 && !fForce) return;
     nTimeMyListUpdated = GetTime();
 
-    ui->tableWidgetMasternodes->setSortingEnabled(false);
     for (CMasternodeConfig::CMasternodeEntry mne : masternodeConfig.getEntries()) {
         int32_t nOutputIndex = 0;
         if(!ParseInt32(mne.getOutputIndex(), &nOutputIndex)) {
@@ -253,7 +258,6 @@ void MasternodeList::updateMyNodeList(bool fForce)
 
         updateMyMasternodeInfo(QString::fromStdString(mne.getAlias()), QString::fromStdString(mne.getIp()), COutPoint(uint256S(mne.getTxHash()), nOutputIndex));
     }
-    ui->tableWidgetMasternodes->setSortingEnabled(true);
 
     // reset "timer"
     ui->secondsLabel->setText("0");
@@ -261,75 +265,13 @@ void MasternodeList::updateMyNodeList(bool fForce)
 
 void MasternodeList::updateNodeList()
 {
-    TRY_LOCK(cs_mnlist, fLockAcquired);
-    if(!fLockAcquired) {
-        return;
-    }
-
-    static int64_t nTimeListUpdated = GetTime();
-
-    // to prevent high cpu usage update only once in MASTERNODELIST_UPDATE_SECONDS seconds
-    // or MASTERNODELIST_FILTER_COOLDOWN_SECONDS seconds after filter was last changed
-    int64_t nSecondsToWait = fFilterUpdated
-                            ? nTimeFilterUpdated - GetTime() + MASTERNODELIST_FILTER_COOLDOWN_SECONDS
-                            : nTimeListUpdated - GetTime() + MASTERNODELIST_UPDATE_SECONDS;
-
-    if(fFilterUpdated) ui->countLabel->setText(QString::fromStdString(strprintf("Please wait... %d", nSecondsToWait)));
-    if(nSecondsToWait > 0) return;
-
-    nTimeListUpdated = GetTime();
-    fFilterUpdated = false;
-
-    QString strToFilter;
-    ui->countLabel->setText("Updating...");
-    ui->tableWidgetMasternodes->setSortingEnabled(false);
-    ui->tableWidgetMasternodes->clearContents();
-    ui->tableWidgetMasternodes->setRowCount(0);
-    std::map<COutPoint, CMasternode> mapMasternodes = mnodeman.GetFullMasternodeMap();
-    int offsetFromUtc = GetOffsetFromUtc();
-
-    for(auto& mnpair : mapMasternodes)
-    {
-        CMasternode mn = mnpair.second;
-        // populate list
-        // Address, Protocol, Status, Active Seconds, Last Seen, Pub Key
-        QTableWidgetItem *addressItem = new QTableWidgetItem(QString::fromStdString(mn.addr.ToString()));
-        QTableWidgetItem *protocolItem = new QTableWidgetItem(QString::number(mn.nProtocolVersion));
-        QTableWidgetItem *statusItem = new QTableWidgetItem(QString::fromStdString(mn.GetStatus()));
-        QTableWidgetItem *activeSecondsItem = new QTableWidgetItem(QString::fromStdString(DurationToDHMS(mn.lastPing.sigTime - mn.sigTime)));
-        QTableWidgetItem *lastSeenItem = new QTableWidgetItem(QString::fromStdString(FormatISO8601DateTime(mn.lastPing.sigTime + offsetFromUtc)));
-        QTableWidgetItem *pubkeyItem = new QTableWidgetItem(QString::fromStdString(EncodeDestination(mn.pubKeyCollateralAddress.GetID())));
-
-        if (strCurrentFilter != "")
-        {
-            strToFilter =   addressItem->text() + " " +
-                            protocolItem->text() + " " +
-                            statusItem->text() + " " +
-                            activeSecondsItem->text() + " " +
-                            lastSeenItem->text() + " " +
-                            pubkeyItem->text();
-            if (!strToFilter.contains(strCurrentFilter)) continue;
-        }
-
-        ui->tableWidgetMasternodes->insertRow(0);
-        ui->tableWidgetMasternodes->setItem(0, 0, addressItem);
-        ui->tableWidgetMasternodes->setItem(0, 1, protocolItem);
-        ui->tableWidgetMasternodes->setItem(0, 2, statusItem);
-        ui->tableWidgetMasternodes->setItem(0, 3, activeSecondsItem);
-        ui->tableWidgetMasternodes->setItem(0, 4, lastSeenItem);
-        ui->tableWidgetMasternodes->setItem(0, 5, pubkeyItem);
-    }
-
-    ui->countLabel->setText(QString::number(ui->tableWidgetMasternodes->rowCount()));
-    ui->tableWidgetMasternodes->setSortingEnabled(true);
+    ui->countLabel->setText(QString::number(masternodeProxyModel->rowCount()));
 }
 
 void MasternodeList::on_filterLineEdit_textChanged(const QString &strFilterIn)
 {
-    strCurrentFilter = strFilterIn;
-    nTimeFilterUpdated = GetTime();
-    fFilterUpdated = true;
-    ui->countLabel->setText(QString::fromStdString(strprintf("Please wait... %d", MASTERNODELIST_FILTER_COOLDOWN_SECONDS)));
+    masternodeProxyModel->setFilterFixedString(strFilterIn);
+    updateNodeList();
 }
 
 void MasternodeList::on_startButton_clicked()
@@ -17,18 +17,18 @@
 #include <QWidget>
 
 #define MY_MASTERNODELIST_UPDATE_SECONDS                 60
-#define MASTERNODELIST_UPDATE_SECONDS                    15
-#define MASTERNODELIST_FILTER_COOLDOWN_SECONDS            3
 
 namespace Ui {
     class MasternodeList;
 }
 
 class ClientModel;
+class MasternodeTableModel;
 class WalletModel;
 
 QT_BEGIN_NAMESPACE
 class QModelIndex;
+class QSortFilterProxyModel;
 QT_END_NAMESPACE
 
 struct infinitynode_conf_t
@@ -59,8 +59,6 @@ public:
 
 private:
     QMenu *contextMenu;
-    int64_t nTimeFilterUpdated;
-    bool fFilterUpdated;
 
 public Q_SLOTS:
     void updateMyMasternodeInfo(QString strAlias, QString strAddr, const COutPoint& outpoint);
@@ -74,15 +72,12 @@ private:
     Ui::MasternodeList *ui;
     ClientModel *clientModel;
     WalletModel *walletModel;
-
-    // Protects tableWidgetMasternodes
-    CCriticalSection cs_mnlist;
+    MasternodeTableModel *masternodeModel;
+    QSortFilterProxyModel *masternodeProxyModel;
 
     // Protects tableWidgetMyMasternodes
     CCriticalSection cs_mymnlist;
 
-    QString strCurrentFilter;
-
 private Q_SLOTS:
     void showContextMenu(const QPoint &);
     void on_filterLineEdit_textChanged(const QString &strFilterIn);
@@ -0,0 +1,231 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qt/masternodetablemodel.h>
+
+#include <interfaces/handler.h>
+#include <interfaces/node.h>
+#include <key_io.h>
+#include <masternodeman.h>
+#include <utiltime.h>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include <QDateTime>
+#include <QTimer>
+
+int GetOffsetFromUtc()
+{
+#if QT_VERSION < 0x050200
+    const QDateTime dateTime1 = QDateTime::currentDateTime();
+    const QDateTime dateTime2 = QDateTime(dateTime1.date(), dateTime1.time(), Qt::UTC);
+    return dateTime1.secsTo(dateTime2);
+#else
+    return QDateTime::currentDateTime().offsetFromUtc();
+#endif
+}
+
+static void NotifyMasternodeListChanged(MasternodeTableModel *model)
+{
+    QMetaObject::invokeMethod(model, "listChanged", Qt::QueuedConnection);
+}
+
+MasternodeTableModel::MasternodeTableModel(interfaces::Node& node, QObject *parent) :
+    QAbstractTableModel(parent),
+    fLoaded(false),
+    offsetFromUtc(GetOffsetFromUtc()),
+    timer(0)
+{
+    columns << tr("Address") << tr("Protocol") << tr("Status") << tr("Active") << tr("Last Seen") << tr("Payee");
+
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setInterval(MASTERNODETABLE_REFRESH_DELAY);
+    connect(timer, SIGNAL(timeout()), SLOT(refresh()));
+
+    m_handler_notify_masternode_list_changed = node.handleNotifyMasternodeListChanged(boost::bind(NotifyMasternodeListChanged, this));
+
+    // load initial data
+    refresh();
+}
+
+MasternodeTableModel::~MasternodeTableModel()
+{
+    m_handler_notify_masternode_list_changed->disconnect();
+}
+
+void MasternodeTableModel::listChanged()
+{
+    if (!timer->isActive())
+        timer->start();
+}
+
+void MasternodeTableModel::refresh()
+{
+    std::vector<masternode_info_t> vecChanged;
+    std::vector<COutPoint> vecRemoved;
+    mnodeman.GetMasternodeChanges(!fLoaded, vecChanged, vecRemoved);
+
+    if (!fLoaded) {
+        beginResetModel();
+        vRows.clear();
+        mapRows.clear();
+        for (const masternode_info_t& info : vecChanged) {
+            mapRows[info.vin.prevout] = vRows.size();
+            vRows.push_back(Row{info, 0, {}});
+        }
+        endResetModel();
+        fLoaded = true;
+        return;
+    }
+
+    if (!vecRemoved.empty()) {
+        std::vector<int> vRemovedRows;
+        for (const COutPoint& outpoint : vecRemoved) {
+            auto it = mapRows.find(outpoint);
+            if (it != mapRows.end()) vRemovedRows.push_back(it->second);
+        }
+        // from the last row, the rows before keep their positions
+        std::sort(vRemovedRows.rbegin(), vRemovedRows.rend());
+        for (int nRow : vRemovedRows) {
+            beginRemoveRows(QModelIndex(), nRow, nRow);
+            vRows.erase(vRows.begin() + nRow);
+            endRemoveRows();
+        }
+        mapRows.clear();
+        for (size_t i = 0; i < vRows.size(); i++) {
+            mapRows[vRows[i].info.vin.prevout] = i;
+        }
+    }
+
+    std::vector<masternode_info_t> vecAdded;
+    for (const masternode_info_t& info : vecChanged) {
+        auto it = mapRows.find(info.vin.prevout);
+        if (it == mapRows.end()) {
+            vecAdded.push_back(info);
+            continue;
+        }
+        Row& row = vRows[it->second];
+        row.info = info;
+        row.nFormatted = 0;
+        Q_EMIT dataChanged(index(it->second, 0), index(it->second, columns.size() - 1));
+    }
+
+    if (!vecAdded.empty()) {
+        beginInsertRows(QModelIndex(), vRows.size(), vRows.size() + vecAdded.size() - 1);
+        for (const masternode_info_t& info : vecAdded) {
+            mapRows[info.vin.prevout] = vRows.size();
+            vRows.push_back(Row{info, 0, {}});
+        }
+        endInsertRows();
+    }
+}
+
+int MasternodeTableModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return vRows.size();
+}
+
+int MasternodeTableModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return columns.length();
+}
+
+QString MasternodeTableModel::formatCell(const Row& row, int column) const
+{
+    if (row.nFormatted & (1U << column))
+        return row.cells[column];
+
+    const masternode_info_t& info = row.info;
+    QString strCell;
+    switch (column)
+    {
+    case Address:
+        strCell = QString::fromStdString(info.addr.ToString());
+        break;
+    case Protocol:
+        strCell = QString::number(info.nProtocolVersion);
+        break;
+    case Status:
+        strCell = QString::fromStdString(CMasternode::StateToString(info.nActiveState));
+        break;
+    case Active:
+        strCell = QString::fromStdString(DurationToDHMS(info.nTimeLastPing - info.sigTime));
+        break;
+    case LastSeen:
+        strCell = QString::fromStdString(FormatISO8601DateTime(info.nTimeLastPing + offsetFromUtc));
+        break;
+    case Payee:
+        strCell = QString::fromStdString(EncodeDestination(info.pubKeyCollateralAddress.GetID()));
+        break;
+    }
+    row.cells[column] = strCell;
+    row.nFormatted |= 1U << column;
+    return strCell;
+}
+
+const QString& MasternodeTableModel::formatFilterKey(const Row& row) const
+{
+    const unsigned int nKeyBit = 1U << row.cells.size();
+    if (!(row.nFormatted & nKeyBit)) {
+        // what the list used to match the filter against
+        row.strFilterKey = formatCell(row, Address) + " " + formatCell(row, Protocol) + " " + formatCell(row, Status) + " " +
+                           formatCell(row, Active) + " " + formatCell(row, LastSeen) + " " + formatCell(row, Payee);
+        row.nFormatted |= nKeyBit;
+    }
+    return row.strFilterKey;
+}
+
+QVariant MasternodeTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= (int)vRows.size() || index.column() >= columns.size())
+        return QVariant();
+
+    const Row& row = vRows[index.row()];
+
+    if (role == Qt::DisplayRole) {
+        return formatCell(row, index.column());
+    } else if (role == SortRole) {
+        switch (index.column())
+        {
+        case Protocol:
+            return row.info.nProtocolVersion;
+        case Active:
+            return (qint64)(row.info.nTimeLastPing - row.info.sigTime);
+        case LastSeen:
+            return (qint64)row.info.nTimeLastPing;
+        default:
+            return formatCell(row, index.column());
+        }
+    } else if (role == FilterRole) {
+        return formatFilterKey(row);
+    }
+
+    return QVariant();
+}
+
+QVariant MasternodeTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(orientation == Qt::Horizontal)
+    {
+        if(role == Qt::DisplayRole && section < columns.size())
+        {
+            return columns[section];
+        }
+    }
+    return QVariant();
+}
+
+Qt::ItemFlags MasternodeTableModel::flags(const QModelIndex &index) const
+{
+    if(!index.isValid())
+        return 0;
+
+    Qt::ItemFlags retval = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+    return retval;
+}
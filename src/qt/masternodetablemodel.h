@@ -0,0 +1,103 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QSTEES_QT_MASTERNODETABLEMODEL_H
+#define QSTEES_QT_MASTERNODETABLEMODEL_H
+
+#include <masternode.h>
+
+#include <array>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QAbstractTableModel>
+#include <QStringList>
+
+namespace interfaces {
+class Handler;
+class Node;
+}
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
+/** Changes of the masternode list coming in within that delay are fetched together */
+static const int MASTERNODETABLE_REFRESH_DELAY = 1000;
+
+/** Offset of the local time from UTC in seconds, for the last seen times */
+int GetOffsetFromUtc();
+
+/**
+   Qt model of the masternode list, similar to the "masternode list" RPC
+   call. Used by the masternode page through a QSortFilterProxyModel.
+
+   CMasternodeMan signals when the list changes, the model then fetches
+   what changed since its last fetch and updates those rows only. Cells are
+   formatted when they are first shown and again after their row changed,
+   the filter key of a row (FilterRole) is made of its formatted cells.
+ */
+class MasternodeTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit MasternodeTableModel(interfaces::Node& node, QObject *parent = 0);
+    ~MasternodeTableModel();
+
+    enum ColumnIndex {
+        Address = 0,
+        Protocol = 1,
+        Status = 2,
+        Active = 3,
+        LastSeen = 4,
+        Payee = 5
+    };
+
+    enum RoleIndex {
+        /** Value to sort by, numbers for the numeric columns */
+        SortRole = Qt::UserRole,
+        /** All the cells of the row in one string, the same in every column */
+        FilterRole
+    };
+
+    /** @name Methods overridden from QAbstractTableModel
+        @{*/
+    int rowCount(const QModelIndex &parent) const;
+    int columnCount(const QModelIndex &parent) const;
+    QVariant data(const QModelIndex &index, int role) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    /*@}*/
+
+public Q_SLOTS:
+    /** Fetch the changes of the masternode list and update their rows */
+    void refresh();
+    /** The masternode list changed, refresh after MASTERNODETABLE_REFRESH_DELAY */
+    void listChanged();
+
+private:
+    struct Row
+    {
+        masternode_info_t info;
+        // cells formatted so far, bit per column, then one for the filter key
+        mutable unsigned int nFormatted;
+        mutable std::array<QString, 6> cells;
+        mutable QString strFilterKey;
+    };
+
+    QStringList columns;
+    std::vector<Row> vRows;
+    std::map<COutPoint, int> mapRows;
+    bool fLoaded;
+    int offsetFromUtc;
+    QTimer *timer;
+    std::unique_ptr<interfaces::Handler> m_handler_notify_masternode_list_changed;
+
+    QString formatCell(const Row& row, int column) const;
+    const QString& formatFilterKey(const Row& row) const;
+};
+
+#endif // QSTEES_QT_MASTERNODETABLEMODEL_H
@@ -29,7 +29,6 @@
 #include <QAbstractItemDelegate>
 #include <QPainter>
 #include <QSettings>
-#include <QTimer>
 #include <QDesktopServices>
 #include <QUrl>
 
@@ -131,7 +130,6 @@ public:
 
 OverviewPage::OverviewPage(const PlatformStyle *platformStyle, QWidget *parent) :
     QWidget(parent),
-    timer(nullptr),
     ui(new Ui::OverviewPage),
     clientModel(0),
     walletModel(0),
@@ -173,10 +171,6 @@ OverviewPage::OverviewPage(const PlatformStyle *platformStyle, QWidget *parent)
     showOutOfSyncWarning(true);
     connect(ui->labelWalletStatus, SIGNAL(clicked()), this, SLOT(handleOutOfSyncWarningClicks()));
     connect(ui->labelTransactionsStatus, SIGNAL(clicked()), this, SLOT(handleOutOfSyncWarningClicks()));
-
-    timer = new QTimer(this);
-    connect(timer, SIGNAL(timeout()), this, SLOT(infinityNodeStat()));
-    timer->start(3000);
 }
 
 void OverviewPage::handleTransactionClicked(const QModelIndex &index)
@@ -192,42 +186,26 @@ void OverviewPage::handleOutOfSyncWarningClicks()
 
 OverviewPage::~OverviewPage()
 {
-    if(timer) disconnect(timer, SIGNAL(timeout()), this, SLOT(privateSendStatus()));
     delete ui;
 }
 
 void OverviewPage::infinityNodeStat()
 {
-    std::map<COutPoint, CInfinitynode> mapInfinitynodes = infnodeman.GetFullInfinitynodeMap();
-    std::map<COutPoint, CInfinitynode> mapInfinitynodesNonMatured = infnodeman.GetFullInfinitynodeNonMaturedMap();
-    int total = 0, totalBIG = 0, totalMID = 0, totalLIL = 0, totalUnknown = 0;
-    for (auto& infpair : mapInfinitynodes) {
-        ++total;
-        CInfinitynode inf = infpair.second;
-        int qsteestype = inf.getQSTEESType();
-        if (qsteestype == 10) ++totalBIG;
-        else if (qsteestype == 5) ++totalMID;
-        else if (qsteestype == 1) ++totalLIL;
-    }
-
-    int totalNonMatured = 0, totalBIGNonMatured = 0, totalMIDNonMatured = 0, totalLILNonMatured = 0, totalUnknownNonMatured = 0;
-    for (auto& infpair : mapInfinitynodesNonMatured) {
-        ++totalNonMatured;
-        CInfinitynode inf = infpair.second;
-        int qsteestype = inf.getQSTEESType();
-        if (qsteestype == 10) ++totalBIGNonMatured;
-        else if (qsteestype == 5) ++totalMIDNonMatured;
-        else if (qsteestype == 1) ++totalLILNonMatured;
-    }
-
-    QString strTotalNodeText(tr("Total: %1 nodes (Last Scan: %2)").arg(total + totalNonMatured).arg(infnodeman.getLastScanWithLimit()));
-    QString strBIGNodeText(tr("%1").arg(totalBIG));
-    QString strMIDNodeText(tr("%1").arg(totalMID));
-    QString strLILNodeText(tr("%1").arg(totalLIL));
-
-    QString strBIGNodeQueuedText(tr("Queued %1").arg(totalBIGNonMatured));
-    QString strMIDNodeQueuedText(tr("Queued %1").arg(totalMIDNonMatured));
-    QString strLILNodeQueuedText(tr("Queued %1").arg(totalLILNonMatured));
+    CInfinitynodeMan::StatsRef stats = infnodeman.GetStats();
+    auto tier = [&stats](int nSinType) {
+        auto it = stats->mapTiers.find(nSinType);
+        return it != stats->mapTiers.end() ? it->second : CInfinitynodeMan::Stats::Tier();
+    };
+    const CInfinitynodeMan::Stats::Tier BIG = tier(10), MID = tier(5), LIL = tier(1);
+
+    QString strTotalNodeText(tr("Total: %1 nodes (Last Scan: %2)").arg(stats->nTotal).arg(stats->nLastScanHeight));
+    QString strBIGNodeText(tr("%1").arg(BIG.nCount));
+    QString strMIDNodeText(tr("%1").arg(MID.nCount));
+    QString strLILNodeText(tr("%1").arg(LIL.nCount));
+
+    QString strBIGNodeQueuedText(tr("Queued %1").arg(BIG.nCountNonMatured));
+    QString strMIDNodeQueuedText(tr("Queued %1").arg(MID.nCountNonMatured));
+    QString strLILNodeQueuedText(tr("Queued %1").arg(LIL.nCountNonMatured));
 
     ui->labelStatisticTotalNode->setText(strTotalNodeText);
     ui->labelBIGNode->setText(strBIGNodeText);
@@ -238,22 +216,21 @@ void OverviewPage::infinityNodeStat()
     ui->labelMIDNodeQueued->setText(strMIDNodeQueuedText);
     ui->labelLILNodeQueued->setText(strLILNodeQueuedText);
 
-    QString strBIGNodeROIText(tr("ROI %1 days").arg(infnodeman.getRoi(10, totalBIG)));
-    QString strMIDNodeROIText(tr("ROI %1 days").arg(infnodeman.getRoi(5, totalMID)));
-    QString strLILNodeROIText(tr("ROI %1 days").arg(infnodeman.getRoi(1, totalLIL)));
+    QString strBIGNodeROIText(tr("ROI %1 days").arg(BIG.nRoiDays));
+    QString strMIDNodeROIText(tr("ROI %1 days").arg(MID.nRoiDays));
+    QString strLILNodeROIText(tr("ROI %1 days").arg(LIL.nRoiDays));
 
     ui->labelBIGNodeRoi->setText(strBIGNodeROIText);
     ui->labelMIDNodeRoi->setText(strMIDNodeROIText);
     ui->labelLILNodeRoi->setText(strLILNodeROIText);
 
-    QString strBIGNodeSTMText(tr("Statement %1").arg(infnodeman.getLastStatement(10)));
-    QString strMIDNodeSTMText(tr("Statement %1").arg(infnodeman.getLastStatement(5)));
-    QString strLILNodeSTMText(tr("Statement %1").arg(infnodeman.getLastStatement(1)));
+    QString strBIGNodeSTMText(tr("Statement %1").arg(BIG.nLastStatement));
+    QString strMIDNodeSTMText(tr("Statement %1").arg(MID.nLastStatement));
+    QString strLILNodeSTMText(tr("Statement %1").arg(LIL.nLastStatement));
 
     ui->labelBIGNodeSTM->setText(strBIGNodeSTMText);
     ui->labelMIDNodeSTM->setText(strMIDNodeSTMText);
     ui->labelLILNodeSTM->setText(strLILNodeSTMText);
-
 }
 
 void OverviewPage::setBalance(const interfaces::WalletBalances& balances)
@@ -316,6 +293,10 @@ void OverviewPage::setClientModel(ClientModel *model)
         // Show warning if this is a prerelease version
         connect(model, SIGNAL(alertsChanged(QString)), this, SLOT(updateAlerts(QString)));
         updateAlerts(model->getStatusBarWarnings());
+
+        // infinitynode figures, pushed by the core when they change
+        connect(model, SIGNAL(infinitynodeStatsChanged()), this, SLOT(infinityNodeStat()));
+        infinityNodeStat();
     }
 }
 
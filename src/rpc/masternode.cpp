@@ -13,8 +13,10 @@
 #include <masternode-sync.h>
 #include <masternodeconfig.h>
 #include <masternodeman.h>
+#include <messagesigner.h>
 #include <infinitynodeman.h>
 #include <infinitynodersv.h>
+#include <sigverifyqueue.h>
 #ifdef ENABLE_WALLET
 #include <wallet/coincontrol.h>
 #endif // ENABLE_WALLET
@@ -58,7 +60,7 @@ UniValue masternode(const JSONRPCRequest& request)
 #endif // ENABLE_WALLET
          strCommand != "list" && strCommand != "list-conf" && strCommand != "count" &&
          strCommand != "debug" && strCommand != "current" && strCommand != "winner" && strCommand != "winners" && strCommand != "genkey" &&
-         strCommand != "connect" && strCommand != "status" && strCommand != "collateral"))
+         strCommand != "connect" && strCommand != "status" && strCommand != "collateral" && strCommand != "sigcache"))
             throw std::runtime_error(
                 "masternode \"command\"...\n"
                 "Set of commands to execute masternode related actions\n"
@@ -76,6 +78,7 @@ UniValue masternode(const JSONRPCRequest& request)
                 "  status       - Print masternode status information\n"
                 "  list         - Print list of all known masternodes (see masternodelist for more info)\n"
                 "  list-conf    - Print masternode.conf in JSON format\n"
+                "  sigcache     - Print masternode message signature cache and verification queue statistics\n"
                 "  winner       - Print info on next masternode winner to vote for\n"
                 "  winners      - Print list of masternode winners\n"
                 );
@@ -111,6 +114,20 @@ UniValue masternode(const JSONRPCRequest& request)
         return "successfully connected";
     }
 
+    if (strCommand == "sigcache")
+    {
+        size_t nElements;
+        uint64_t nHits, nMisses;
+        CHashSigner::GetSignatureCacheStats(nElements, nHits, nMisses);
+
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("capacity", (uint64_t)nElements);
+        obj.pushKV("hits", nHits);
+        obj.pushKV("misses", nMisses);
+        obj.pushKV("queued", (uint64_t)sigverifyqueue.size());
+        return obj;
+    }
+
     if (strCommand == "count")
     {
         if (request.params.size() > 2)
@@ -818,7 +835,7 @@ UniValue infinitynode(const JSONRPCRequest& request)
         (strCommand != "build-list" && strCommand != "show-lastscan" && strCommand != "show-infos" && strCommand != "stats"
                                     && strCommand != "show-lastpaid" && strCommand != "build-stm" && strCommand != "show-stm"
                                     && strCommand != "show-candidate" && strCommand != "show-script" && strCommand != "show-proposal"
-                                    && strCommand != "scan-vote" && strCommand != "show-proposals"
+                                    && strCommand != "scan-vote" && strCommand != "show-proposals" && strCommand != "show-schedule"
         ))
             throw std::runtime_error(
                 "infinitynode \"command\"...\n"
@@ -833,6 +850,7 @@ UniValue infinitynode(const JSONRPCRequest& request)
                 "  build-stm                   - Build statement list from genesis parameter\n"
                 "  show-stm                    - Last statement of each SinType\n"
                 "  show-candidate nHeight      - Last statement of each SinType\n"
+                "  show-schedule nFrom nTo     - Payee of each SinType for every height from nFrom to nTo\n"
                 );
 
     UniValue obj(UniValue::VOBJ);
@@ -888,6 +906,37 @@ UniValue infinitynode(const JSONRPCRequest& request)
         return obj;
     }
 
+    if (strCommand == "show-schedule")
+    {
+        if (request.params.size() != 3)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Correct usage is 'infinitynode show-schedule \"nFrom\" \"nTo\"'");
+        int nFromHeight = atoi(strFilter);
+        int nToHeight = atoi(strOption);
+
+        if (nFromHeight < Params().GetConsensus().nInfinityNodeGenesisStatement)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "nFrom must superior than Genesis Statement param");
+        if (nToHeight < nFromHeight || nToHeight - nFromHeight >= MAX_INFINITYNODE_SCHEDULE_RANGE)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("nTo must be between nFrom and nFrom + %d", MAX_INFINITYNODE_SCHEDULE_RANGE - 1));
+
+        std::map<int, CInfinitynode> mapBIG = infnodeman.getScheduleForRange(nFromHeight, nToHeight, 10);
+        std::map<int, CInfinitynode> mapMID = infnodeman.getScheduleForRange(nFromHeight, nToHeight, 5);
+        std::map<int, CInfinitynode> mapLIL = infnodeman.getScheduleForRange(nFromHeight, nToHeight, 1);
+
+        UniValue arr(UniValue::VARR);
+        for (int nHeight = nFromHeight; nHeight <= nToHeight; nHeight++) {
+            UniValue entry(UniValue::VOBJ);
+            entry.push_back(Pair("height", nHeight));
+            auto it = mapBIG.find(nHeight);
+            if (it != mapBIG.end()) entry.push_back(Pair("BIG", it->second.getCollateralAddress()));
+            it = mapMID.find(nHeight);
+            if (it != mapMID.end()) entry.push_back(Pair("MID", it->second.getCollateralAddress()));
+            it = mapLIL.find(nHeight);
+            if (it != mapLIL.end()) entry.push_back(Pair("LIL", it->second.getCollateralAddress()));
+            arr.push_back(entry);
+        }
+        return arr;
+    }
+
     if (strCommand == "show-lastscan")
     {
             return infnodeman.getLastScan();
@@ -895,8 +944,8 @@ UniValue infinitynode(const JSONRPCRequest& request)
 
     if (strCommand == "show-lastpaid")
     {
-        std::map<CScript, int>  mapLastPaid = infnodeman.GetFullLastPaidMap();
-        for (auto& pair : mapLastPaid) {
+        CInfinitynodeMan::StateRef state = infnodeman.GetSnapshot();
+        for (auto& pair : state->mapLastPaid) {
             std::string scriptPublicKey = pair.first.ToString();
             obj.push_back(Pair(scriptPublicKey, pair.second));
         }
@@ -905,10 +954,10 @@ UniValue infinitynode(const JSONRPCRequest& request)
 
     if (strCommand == "show-infos")
     {
-        std::map<COutPoint, CInfinitynode> mapInfinitynodes = infnodeman.GetFullInfinitynodeMap();
-        for (auto& infpair : mapInfinitynodes) {
+        CInfinitynodeMan::StateRef state = infnodeman.GetSnapshot();
+        for (auto& infpair : state->mapInfinitynodes) {
             std::string strOutpoint = infpair.first.ToStringShort();
-            CInfinitynode inf = infpair.second;
+            const CInfinitynode& inf = infpair.second;
                 std::ostringstream streamInfo;
                 streamInfo << std::setw(8) <<
                                inf.getCollateralAddress() << " " <<
@@ -927,10 +976,10 @@ UniValue infinitynode(const JSONRPCRequest& request)
 
     if (strCommand == "show-script")
     {
-        std::map<COutPoint, CInfinitynode> mapInfinitynodes = infnodeman.GetFullInfinitynodeMap();
-        for (auto& infpair : mapInfinitynodes) {
+        CInfinitynodeMan::StateRef state = infnodeman.GetSnapshot();
+        for (auto& infpair : state->mapInfinitynodes) {
             std::string strOutpoint = infpair.first.ToStringShort();
-            CInfinitynode inf = infpair.second;
+            const CInfinitynode& inf = infpair.second;
                 std::ostringstream streamInfo;
                         std::vector<std::vector<unsigned char>> vSolutions;
                         txnouttype whichType;
@@ -953,10 +1002,10 @@ UniValue infinitynode(const JSONRPCRequest& request)
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Correct usage is 'infinitynode show-proposal \"ProposalId\" \"(Optional)Mode\" '");
 
         std::string proposalId  = strFilter;
-        std::vector<CVote>* vVote = infnodersv.Find(proposalId);
+        std::map<CScript, CVote> mapVotes = infnodersv.GetProposalVotes(proposalId);
         obj.push_back(Pair("ProposalId", proposalId));
-        if(vVote != NULL){
-            obj.push_back(Pair("Votes", (int)vVote->size()));
+        if(!mapVotes.empty()){
+            obj.push_back(Pair("Votes", (int)mapVotes.size()));
         }else{
             obj.push_back(Pair("Votes", "0"));
         }
@@ -966,20 +1015,20 @@ UniValue infinitynode(const JSONRPCRequest& request)
         if (strOption == "all"){mode=2;}
         obj.push_back(Pair("Yes", infnodersv.getResult(proposalId, true, mode)));
         obj.push_back(Pair("No", infnodersv.getResult(proposalId, false, mode)));
-        for (auto& v : *vVote){
+        for (auto& v : mapVotes){
             CTxDestination addressVoter;
-            ExtractDestination(v.getVoter(), addressVoter);
-            obj.push_back(Pair(EncodeDestination(addressVoter), v.getOpinion()));
+            ExtractDestination(v.second.getVoter(), addressVoter);
+            obj.push_back(Pair(EncodeDestination(addressVoter), v.second.getOpinion()));
         }
         return obj;
     }
 
     if (strCommand == "show-proposals")
     {
-        std::map<std::string, std::vector<CVote>> mapCopy = infnodersv.GetFullProposalVotesMap();
-        obj.push_back(Pair("Proposal", (int)mapCopy.size()));
-        for (auto& infpair : mapCopy) {
-            obj.push_back(Pair(infpair.first, (int)infpair.second.size()));
+        std::map<std::string, int> mapCounts = infnodersv.GetProposalVoteCounts();
+        obj.push_back(Pair("Proposal", (int)mapCounts.size()));
+        for (auto& infpair : mapCounts) {
+            obj.push_back(Pair(infpair.first, infpair.second));
         }
 
         return obj;
@@ -1053,11 +1102,11 @@ static UniValue infinitynodeburnfund(const JSONRPCRequest& request)
     if (!IsValidDestination(BKaddress))
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid QSTEES address for Backup");
 
-    std::map<COutPoint, CInfinitynode> mapInfinitynodes = infnodeman.GetFullInfinitynodeMap();
+    CInfinitynodeMan::StateRef state = infnodeman.GetSnapshot();
     int totalNode = 0, totalBIG = 0, totalMID = 0, totalLIL = 0, totalUnknown = 0;
-    for (auto& infpair : mapInfinitynodes) {
+    for (auto& infpair : state->mapInfinitynodes) {
         ++totalNode;
-        CInfinitynode inf = infpair.second;
+        const CInfinitynode& inf = infpair.second;
         int qsteestype = inf.getQSTEESType();
         if (qsteestype == 10) ++totalBIG;
         else if (qsteestype == 5) ++totalMID;
@@ -1116,8 +1165,8 @@ static UniValue infinitynodeburnfund(const JSONRPCRequest& request)
         entry.pushKV("safe", out.fSafe);
         if (out.tx->tx->vout[out.i].nValue >= nAmount && out.nDepth >= 2) {
             /*check address is unique*/
-            for (auto& infpair : mapInfinitynodes) {
-                CInfinitynode inf = infpair.second;
+            for (auto& infpair : state->mapInfinitynodes) {
+                const CInfinitynode& inf = infpair.second;
                 if(inf.getCollateralAddress() == EncodeDestination(address)){
                     strError = strprintf("Error: Address %s exist in list. Please use another address to make sure it is unique.", EncodeDestination(address));
                     throw JSONRPCError(RPC_TYPE_ERROR, strError);
@@ -27,6 +27,7 @@
 #include <warnings.h>
 
 // Dash
+#include <instantx.h>
 #include <masternode-sync.h>
 #include <spork.h>
 //
@@ -60,6 +61,7 @@ UniValue mnsync(const JSONRPCRequest& request)
         objStatus.push_back(Pair("IsWinnersListSynced", masternodeSync.IsWinnersListSynced()));
         objStatus.push_back(Pair("IsSynced", masternodeSync.IsSynced()));
         objStatus.push_back(Pair("IsFailed", masternodeSync.IsFailed()));
+        objStatus.push_back(Pair("Assets", masternodeSync.GetAssetsProgress()));
         return objStatus;
     }
 
@@ -78,6 +80,35 @@ UniValue mnsync(const JSONRPCRequest& request)
     return "failure";
 }
 
+UniValue getinstantsendstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getinstantsendstats\n"
+            "Returns InstantSend lock latency and vote statistics.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"requests\": n,       (numeric) lock requests received since start\n"
+            "  \"locks\": n,          (numeric) locks completed since start\n"
+            "  \"failed\": n,         (numeric) lock requests removed without completing\n"
+            "  \"pending\": n,        (numeric) locks tracked right now\n"
+            "  \"votes\": n,          (numeric) votes counted for a lock since start\n"
+            "  \"orphanvotes\": n,    (numeric) votes which waited for their masternode or lock request\n"
+            "  \"latency\": {         (object) milliseconds from the lock request, over the last locks\n"
+            "    \"firstvote\"|\"lock\"|\"mempool\": {\"samples\": n, \"p50\": x.x, \"p90\": x.x, \"p99\": x.x, \"max\": x.x}\n"
+            "  },\n"
+            "  \"votesperlock\": {    (object) number of locks by the votes they got\n"
+            "    \"locked\"|\"failed\"|\"orphans\": {\"votes\": n, ...}\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getinstantsendstats", "")
+            + HelpExampleRpc("getinstantsendstats", "")
+        );
+
+    return instantsend.GetStats();
+}
+
 /*
     Used for updating/reading spork settings on the network
 */
@@ -593,6 +624,7 @@ static const CRPCCommand commands[] =
     // Dash
     { "dash",               "mnsync",                 &mnsync,                 {"status-next-reset"}  },
     { "dash",               "spork",                  &spork,                  {"name", "value"}  },
+    { "dash",               "getinstantsendstats",    &getinstantsendstats,    {}  },
     //
 };
 
@@ -0,0 +1,106 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QSTEES_SHARDEDMAP_H
+#define QSTEES_SHARDEDMAP_H
+
+#include <array>
+#include <stddef.h>
+#include <unordered_map>
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+/**
+ * Hash map split into N shards, each behind its own reader/writer lock.
+ *
+ * Meant for read-mostly indexes queried from many threads: lookups of keys
+ * in different shards never wait for each other, lookups in the same shard
+ * share its lock and only a write blocks the readers of its own shard.
+ * Values are returned by copy, there is no iteration.
+ */
+template <typename K, typename V, typename Hash, size_t N = 16>
+class shardedmap
+{
+private:
+    struct Shard
+    {
+        mutable boost::shared_mutex mutex;
+        std::unordered_map<K, V, Hash> map;
+    };
+
+    Hash hasher;
+    std::array<Shard, N> shards;
+
+    Shard& GetShard(const K& key) { return shards[hasher(key) % N]; }
+    const Shard& GetShard(const K& key) const { return shards[hasher(key) % N]; }
+
+public:
+    typedef boost::shared_lock<boost::shared_mutex> ReadLock;
+    typedef boost::unique_lock<boost::shared_mutex> WriteLock;
+
+    shardedmap() : shards() {}
+
+    /** Copy the value of key into valueRet, false if there is none */
+    bool Get(const K& key, V& valueRet) const
+    {
+        const Shard& shard = GetShard(key);
+        ReadLock lock(shard.mutex);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end()) return false;
+        valueRet = it->second;
+        return true;
+    }
+
+    bool Contains(const K& key) const
+    {
+        const Shard& shard = GetShard(key);
+        ReadLock lock(shard.mutex);
+        return shard.map.count(key) != 0;
+    }
+
+    /** Add key unless it is there already, like std::map::insert */
+    bool Insert(const K& key, const V& value)
+    {
+        Shard& shard = GetShard(key);
+        WriteLock lock(shard.mutex);
+        return shard.map.emplace(key, value).second;
+    }
+
+    /** Add key or replace its value */
+    void Set(const K& key, const V& value)
+    {
+        Shard& shard = GetShard(key);
+        WriteLock lock(shard.mutex);
+        shard.map[key] = value;
+    }
+
+    bool Erase(const K& key)
+    {
+        Shard& shard = GetShard(key);
+        WriteLock lock(shard.mutex);
+        return shard.map.erase(key) != 0;
+    }
+
+    /** Number of entries, only consistent while nothing writes to the map */
+    size_t size() const
+    {
+        size_t nSize = 0;
+        for (const Shard& shard : shards) {
+            ReadLock lock(shard.mutex);
+            nSize += shard.map.size();
+        }
+        return nSize;
+    }
+
+    void Clear()
+    {
+        for (Shard& shard : shards) {
+            WriteLock lock(shard.mutex);
+            shard.map.clear();
+        }
+    }
+};
+
+#endif // QSTEES_SHARDEDMAP_H
@@ -0,0 +1,149 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <sigverifyqueue.h>
+
+#include <messagesigner.h>
+#include <net.h>
+#include <util.h>
+
+#include <algorithm>
+
+CSigVerifyQueue sigverifyqueue;
+
+int GetSigVerifyThreads()
+{
+    int nThreads = gArgs.GetArg("-mnsigthreads", DEFAULT_MNSIG_THREADS);
+    if (nThreads <= 0)
+        nThreads += GetNumCores();
+    return std::max(1, std::min(nThreads, MAX_MNSIG_THREADS));
+}
+
+void CSigVerifyQueue::Start(int nThreads)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fRunning) return;
+    fRunning = true;
+    fStopping = false;
+    for (int i = 0; i < std::max(1, nThreads); i++) {
+        vWorkers.emplace_back([this] {
+            RenameThread("qstees-sigverify");
+            Recover();
+        });
+    }
+    threadDispatcher = std::thread([this] {
+        RenameThread("qstees-sigdispatch");
+        Dispatch();
+    });
+    LogPrintf("CSigVerifyQueue::Start -- %d signature verification threads\n", nThreads);
+}
+
+void CSigVerifyQueue::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!fRunning) return;
+        fStopping = true;
+    }
+    condWorker.notify_all();
+    condDispatcher.notify_all();
+    condPusher.notify_all();
+    for (std::thread& worker : vWorkers) worker.join();
+    threadDispatcher.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    vWorkers.clear();
+    for (const auto& job : queue) {
+        if (job->fRecovered) {
+            for (const auto& check : job->vChecks) CHashSigner::ForgetRecoveredKey(check.first, check.second);
+        }
+        if (job->pfrom) job->pfrom->Release();
+    }
+    queue.clear();
+    nNextRecover = 0;
+    fRunning = false;
+}
+
+void CSigVerifyQueue::Push(CNode* pfrom, SigChecks&& vChecks, Handler&& handler)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        // back pressure on the message handler, processing the message now would overtake the waiting ones
+        condPusher.wait(lock, [this] { return !fRunning || fStopping || queue.size() < nMaxSize; });
+        if (fStopping) return;
+        if (fRunning) {
+            // keep the peer around until its message is processed
+            if (pfrom) pfrom->AddRef();
+            queue.emplace_back(new Job{pfrom, std::move(vChecks), std::move(handler), false});
+            condWorker.notify_one();
+            return;
+        }
+    }
+
+    // not started, no message is waiting
+    Job job{pfrom, SigChecks(), std::move(handler), false};
+    Run(job);
+}
+
+size_t CSigVerifyQueue::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+}
+
+void CSigVerifyQueue::Recover()
+{
+    while (true) {
+        Job* pjob;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condWorker.wait(lock, [this] { return fStopping || nNextRecover < queue.size(); });
+            if (fStopping) return;
+            pjob = queue[nNextRecover++].get();
+        }
+
+        // the job stays in the queue until it is marked recovered, so pjob is safe to use here
+        for (const auto& check : pjob->vChecks) {
+            CHashSigner::RecoverKey(check.first, check.second);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pjob->fRecovered = true;
+        }
+        condDispatcher.notify_one();
+    }
+}
+
+void CSigVerifyQueue::Dispatch()
+{
+    while (true) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condDispatcher.wait(lock, [this] { return fStopping || (!queue.empty() && queue.front()->fRecovered); });
+            if (fStopping) return;
+            job = std::move(queue.front());
+            queue.pop_front();
+            nNextRecover--;
+        }
+        condPusher.notify_one();
+
+        Run(*job);
+
+        for (const auto& check : job->vChecks) CHashSigner::ForgetRecoveredKey(check.first, check.second);
+        if (job->pfrom) job->pfrom->Release();
+    }
+}
+
+void CSigVerifyQueue::Run(Job& job)
+{
+    try {
+        job.handler();
+    } catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "CSigVerifyQueue::Run");
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "CSigVerifyQueue::Run");
+    }
+}
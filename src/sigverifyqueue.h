@@ -0,0 +1,106 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef QSTEES_SIGVERIFYQUEUE_H
+#define QSTEES_SIGVERIFYQUEUE_H
+
+#include <uint256.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class CNode;
+
+/** -mnsigthreads default, 0 = one thread per core */
+static const int DEFAULT_MNSIG_THREADS = 0;
+/** Maximum number of signature verification threads */
+static const int MAX_MNSIG_THREADS = 16;
+/** Messages waiting for their signatures above which Push waits for room */
+static const int MAX_MNSIG_QUEUE_SIZE = 20000;
+
+/** Number of signature verification threads, from -mnsigthreads */
+int GetSigVerifyThreads();
+
+/**
+ * Verification stage for signed masternode network messages.
+ *
+ * The message handler pre-parses a message, pushes the hashes and signatures
+ * it carries together with the rest of its processing, and goes on serving
+ * other peers. Worker threads recover the public keys of the signatures in
+ * parallel (CHashSigner::RecoverKey) and a dispatcher thread then runs the
+ * processing of the messages in the order they were pushed, so the managers
+ * see them in the same order as before. The signature checks done by that
+ * processing only compare key ids with the recovered keys.
+ *
+ * The processing runs without any lock held, like ProcessMessage. When the
+ * queue is full, Push waits for the dispatcher to make room rather than
+ * overtaking the waiting messages. When the queue is not started, nothing
+ * waits and Push runs the processing inline.
+ */
+class CSigVerifyQueue
+{
+public:
+    /** Signed hashes and their signatures */
+    typedef std::vector<std::pair<uint256, std::vector<unsigned char> > > SigChecks;
+    /** Processing of a message */
+    typedef std::function<void()> Handler;
+
+private:
+    struct Job
+    {
+        CNode* pfrom;
+        SigChecks vChecks;
+        Handler handler;
+        bool fRecovered;
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable condWorker;
+    std::condition_variable condDispatcher;
+    std::condition_variable condPusher;
+    // jobs in push order, the dispatcher pops them from the front
+    std::deque<std::unique_ptr<Job> > queue;
+    // position in the queue of the next job handed to a worker
+    size_t nNextRecover;
+    // messages waiting above which Push blocks
+    size_t nMaxSize;
+    bool fRunning;
+    bool fStopping;
+    std::vector<std::thread> vWorkers;
+    std::thread threadDispatcher;
+
+    void Recover();
+    void Dispatch();
+    static void Run(Job& job);
+
+public:
+    explicit CSigVerifyQueue(size_t nMaxSizeIn = MAX_MNSIG_QUEUE_SIZE) : nNextRecover(0), nMaxSize(nMaxSizeIn), fRunning(false), fStopping(false) {}
+    ~CSigVerifyQueue() { Stop(); }
+
+    /** Start nThreads recovering threads and the dispatcher */
+    void Start(int nThreads);
+    /** Join the threads, messages still waiting are dropped */
+    void Stop();
+
+    /**
+     * Queue a message from pfrom (can be null) carrying the signatures vChecks,
+     * handler processes it. pfrom is kept referenced until then. Blocks while
+     * the queue is full; a message pushed while the queue stops is dropped
+     * like the ones still waiting.
+     */
+    void Push(CNode* pfrom, SigChecks&& vChecks, Handler&& handler);
+
+    /** Messages waiting to be processed */
+    size_t size() const;
+};
+
+extern CSigVerifyQueue sigverifyqueue;
+
+#endif // QSTEES_SIGVERIFYQUEUE_H
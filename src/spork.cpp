@@ -21,11 +21,49 @@ class CSporkManager;
 
 CSporkManager sporkManager;
 
-std::map<uint256, CSporkMessage> mapSporks;
-
 std::unique_ptr<CSporkDB> pSporkDB = NULL;
 
 // PIVX: on startup load spork values from previous session if they exist in the sporkDB
+CSporkManager::CSporkManager()
+{
+    for (int nSporkID = SPORK_START; nSporkID <= SPORK_END; nSporkID++) {
+        arrSporkValues[nSporkID - SPORK_START].store(GetSporkDefaultValue(nSporkID), std::memory_order_relaxed);
+    }
+}
+
+bool CSporkManager::AddSpork(const CSporkMessage& spork, bool fWriteToDB)
+{
+    LOCK(cs);
+    auto it = mapSporksActive.find(spork.nSporkID);
+    if (it != mapSporksActive.end() && it->second.nTimeSigned >= spork.nTimeSigned) return false;
+
+    mapSporks[spork.GetHash()] = spork;
+    mapSporksActive[spork.nSporkID] = spork;
+    // PIVX: add to spork database.
+    if (fWriteToDB) pSporkDB->WriteSpork(spork.nSporkID, spork);
+
+    // readers only see the value once it is persisted
+    if (spork.nSporkID >= SPORK_START && spork.nSporkID <= SPORK_END) {
+        arrSporkValues[spork.nSporkID - SPORK_START].store(spork.nValue, std::memory_order_release);
+    }
+    return true;
+}
+
+bool CSporkManager::HasSpork(const uint256& hash)
+{
+    LOCK(cs);
+    return mapSporks.count(hash) != 0;
+}
+
+bool CSporkManager::GetSpork(const uint256& hash, CSporkMessage& sporkRet)
+{
+    LOCK(cs);
+    auto it = mapSporks.find(hash);
+    if (it == mapSporks.end()) return false;
+    sporkRet = it->second;
+    return true;
+}
+
 void CSporkManager::LoadSporksFromDB()
 {
 
@@ -42,8 +80,7 @@ void CSporkManager::LoadSporksFromDB()
         }
 
         // add spork to memory
-        mapSporks[spork.GetHash()] = spork;
-        mapSporksActive[spork.nSporkID] = spork;
+        AddSpork(spork, false);
         std::time_t result = spork.nValue;
         // If SPORK Value is greater than 1,000,000 assume it's actually a Date and then convert to a more readable format
         if (spork.nValue > 1000000) {
@@ -76,15 +113,19 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
             strLogMsg = strprintf("SPORK -- hash: %s id: %d value: %10d bestHeight: %d peer=%d", hash.ToString(), spork.nSporkID, spork.nValue, chainActive.Height(), pfrom->GetId());
         }
 
-        if(mapSporksActive.count(spork.nSporkID)) {
-            if (mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned) {
-                LogPrint(BCLog::SPORK, "%s seen\n", strLogMsg);
-                return;
+        {
+            LOCK(cs);
+            auto it = mapSporksActive.find(spork.nSporkID);
+            if (it != mapSporksActive.end()) {
+                if (it->second.nTimeSigned >= spork.nTimeSigned) {
+                    LogPrint(BCLog::SPORK, "%s seen\n", strLogMsg);
+                    return;
+                } else {
+                    LogPrintf("%s updated\n", strLogMsg);
+                }
             } else {
-                LogPrintf("%s updated\n", strLogMsg);
+                LogPrintf("%s new\n", strLogMsg);
             }
-        } else {
-            LogPrintf("%s new\n", strLogMsg);
         }
 
         if(!spork.CheckSignature()) {
@@ -94,23 +135,25 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
             return;
         }
 
-        mapSporks[hash] = spork;
-        mapSporksActive[spork.nSporkID] = spork;
+        // a newer one might have been accepted from another peer meanwhile
+        if (!AddSpork(spork, true)) return;
         spork.Relay(connman);
 
         //does a task if needed
         ExecuteSpork(spork.nSporkID, spork.nValue);
 
-        // PIVX: add to spork database.
-        pSporkDB->WriteSpork(spork.nSporkID, spork);
-
     } else if (strCommand == NetMsgType::GETSPORKS) {
 
-        std::map<int, CSporkMessage>::iterator it = mapSporksActive.begin();
+        std::vector<CSporkMessage> vSporks;
+        {
+            LOCK(cs);
+            for (const auto& pair : mapSporksActive) {
+                vSporks.push_back(pair.second);
+            }
+        }
 
-        while(it != mapSporksActive.end()) {
-            connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SPORK, it->second));
-            it++;
+        for (const auto& spork : vSporks) {
+            connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SPORK, spork));
         }
     }
 
@@ -150,51 +193,16 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue, CConnman& connman)
 
     CSporkMessage spork = CSporkMessage(nSporkID, nValue, GetAdjustedTime());
 
-    if(spork.Sign(strMasterPrivKey)) {
+    if(spork.Sign(strMasterPrivKey) && AddSpork(spork, true)) {
         spork.Relay(connman);
-        mapSporks[spork.GetHash()] = spork;
-        mapSporksActive[nSporkID] = spork;
         return true;
     }
 
     return false;
 }
 
-// grab the spork, otherwise say it's off
-bool CSporkManager::IsSporkActive(int nSporkID)
+int64_t CSporkManager::GetSporkDefaultValue(int nSporkID)
 {
-    int64_t r = -1;
-
-    if(mapSporksActive.count(nSporkID)){
-        r = mapSporksActive[nSporkID].nValue;
-    } else {
-        switch (nSporkID) {
-            case SPORK_2_INSTANTSEND_ENABLED:               r = SPORK_2_INSTANTSEND_ENABLED_DEFAULT; break;
-            case SPORK_3_INSTANTSEND_BLOCK_FILTERING:       r = SPORK_3_INSTANTSEND_BLOCK_FILTERING_DEFAULT; break;
-            case SPORK_5_INSTANTSEND_MAX_VALUE:             r = SPORK_5_INSTANTSEND_MAX_VALUE_DEFAULT; break;
-            case SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT:    r = SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT_DEFAULT; break;
-            case SPORK_9_SUPERBLOCKS_ENABLED:               r = SPORK_9_SUPERBLOCKS_ENABLED_DEFAULT; break;
-            case SPORK_10_MASTERNODE_PAY_UPDATED_NODES:     r = SPORK_10_MASTERNODE_PAY_UPDATED_NODES_DEFAULT; break;
-            case SPORK_12_RECONSIDER_BLOCKS:                r = SPORK_12_RECONSIDER_BLOCKS_DEFAULT; break;
-            case SPORK_13_OLD_SUPERBLOCK_FLAG:              r = SPORK_13_OLD_SUPERBLOCK_FLAG_DEFAULT; break;
-            case SPORK_14_REQUIRE_SENTINEL_FLAG:            r = SPORK_14_REQUIRE_SENTINEL_FLAG_DEFAULT; break;
-
-            default:
-                LogPrint(BCLog::SPORK, "CSporkManager::IsSporkActive -- Unknown Spork ID %d\n", nSporkID);
-                r = 4070908800ULL; // 2099-1-1 i.e. off by default
-                break;
-        }
-    }
-
-    return r < GetAdjustedTime();
-}
-
-// grab the value of the spork on the network, or the default
-int64_t CSporkManager::GetSporkValue(int nSporkID)
-{
-    if (mapSporksActive.count(nSporkID))
-        return mapSporksActive[nSporkID].nValue;
-
     switch (nSporkID) {
         case SPORK_2_INSTANTSEND_ENABLED:               return SPORK_2_INSTANTSEND_ENABLED_DEFAULT;
         case SPORK_3_INSTANTSEND_BLOCK_FILTERING:       return SPORK_3_INSTANTSEND_BLOCK_FILTERING_DEFAULT;
@@ -206,11 +214,32 @@ int64_t CSporkManager::GetSporkValue(int nSporkID)
         case SPORK_13_OLD_SUPERBLOCK_FLAG:              return SPORK_13_OLD_SUPERBLOCK_FLAG_DEFAULT;
         case SPORK_14_REQUIRE_SENTINEL_FLAG:            return SPORK_14_REQUIRE_SENTINEL_FLAG_DEFAULT;
 
-        default:
-            LogPrint(BCLog::SPORK, "CSporkManager::GetSporkValue -- Unknown Spork ID %d\n", nSporkID);
-            return -1;
+        // IDs not in use yet
+        default:                                        return 4070908800ULL; // 2099-1-1 i.e. off by default
+    }
+}
+
+// grab the spork, otherwise say it's off
+bool CSporkManager::IsSporkActive(int nSporkID)
+{
+    if (nSporkID < SPORK_START || nSporkID > SPORK_END) {
+        LogPrint(BCLog::SPORK, "CSporkManager::IsSporkActive -- Unknown Spork ID %d\n", nSporkID);
+        return false;
+    }
+
+    int64_t r = arrSporkValues[nSporkID - SPORK_START].load(std::memory_order_acquire);
+    return r < GetAdjustedTime();
+}
+
+// grab the value of the spork on the network, or the default
+int64_t CSporkManager::GetSporkValue(int nSporkID)
+{
+    if (nSporkID < SPORK_START || nSporkID > SPORK_END) {
+        LogPrint(BCLog::SPORK, "CSporkManager::GetSporkValue -- Unknown Spork ID %d\n", nSporkID);
+        return -1;
     }
 
+    return arrSporkValues[nSporkID - SPORK_START].load(std::memory_order_acquire);
 }
 
 int CSporkManager::GetSporkIDByName(std::string strName)
@@ -9,8 +9,12 @@
 
 #include <hash.h>
 #include <net.h>
+#include <sync.h>
 #include <utilstrencodings.h>
 
+#include <array>
+#include <atomic>
+
 class CSporkDB;
 
 /** Global variable that points to the spork database (protected by cs_main) */
@@ -46,7 +50,6 @@ static const int64_t SPORK_12_RECONSIDER_BLOCKS_DEFAULT                 = 0;
 static const int64_t SPORK_13_OLD_SUPERBLOCK_FLAG_DEFAULT               = 4070908800ULL;// OFF
 static const int64_t SPORK_14_REQUIRE_SENTINEL_FLAG_DEFAULT             = 4070908800ULL;// OFF
 
-extern std::map<uint256, CSporkMessage> mapSporks;
 extern CSporkManager sporkManager;
 
 //
@@ -102,16 +105,32 @@ public:
 };
 
 
+/**
+ * The spork values are read on hot paths from any thread (block payee checks,
+ * InstantSend, mempool acceptance), they are published in a fixed array of
+ * atomics indexed by spork ID so reading one is a single atomic load. The
+ * messages themselves are protected by cs, a new value is published once
+ * its message is accepted and written to the spork database.
+ */
 class CSporkManager
 {
 private:
     std::vector<unsigned char> vchSig;
     std::string strMasterPrivKey;
-    std::map<int, CSporkMessage> mapSporksActive;
+
+    CCriticalSection cs;
+    std::map<uint256, CSporkMessage> mapSporks; // spork hash - spork
+    std::map<int, CSporkMessage> mapSporksActive; // spork ID - latest spork
+
+    std::array<std::atomic<int64_t>, SPORK_END - SPORK_START + 1> arrSporkValues;
+
+    static int64_t GetSporkDefaultValue(int nSporkID);
+    /// Store spork as the latest for its ID and publish its value, false if it is not newer
+    bool AddSpork(const CSporkMessage& spork, bool fWriteToDB);
 
 public:
 
-    CSporkManager() {}
+    CSporkManager();
 
 
     void LoadSporksFromDB();
@@ -122,6 +141,8 @@ public:
 
     bool IsSporkActive(int nSporkID);
     int64_t GetSporkValue(int nSporkID);
+    bool HasSpork(const uint256& hash);
+    bool GetSpork(const uint256& hash, CSporkMessage& sporkRet);
     int GetSporkIDByName(std::string strName);
     std::string GetSporkNameByID(int nSporkID);
 
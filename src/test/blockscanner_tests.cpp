@@ -0,0 +1,97 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockscanner.h>
+#include <validation.h>
+
+#include <test/test_qstees.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockscanner_tests, TestChain100Setup)
+
+static std::vector<uint256> ScanHashes(const CBlockIndex* pindexTip, int nLowHeight, bool fDescending, int nThreads)
+{
+    std::vector<uint256> vHashes;
+    CBlockScanner<uint256> scanner(pindexTip, nLowHeight, fDescending, nThreads);
+    bool fOk = scanner.Run(
+        [](const CBlock& block, const CBlockIndex* pindex, uint256& hash) {
+            hash = block.GetHash();
+            return true;
+        },
+        [&vHashes](const CBlockIndex* pindex, uint256& hash) {
+            BOOST_CHECK(hash == pindex->GetBlockHash());
+            vHashes.push_back(hash);
+            return true;
+        });
+    BOOST_CHECK(fOk);
+    return vHashes;
+}
+
+BOOST_AUTO_TEST_CASE(blockscanner_order)
+{
+    const CBlockIndex* pindexTip;
+    std::vector<uint256> vExpected;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+        for (int nHeight = 10; nHeight <= chainActive.Height(); nHeight++) {
+            vExpected.push_back(chainActive[nHeight]->GetBlockHash());
+        }
+    }
+
+    // same order whatever the number of threads
+    for (int nThreads : {1, 2, 4, 16}) {
+        BOOST_CHECK(ScanHashes(pindexTip, 10, false, nThreads) == vExpected);
+        std::vector<uint256> vDescending = ScanHashes(pindexTip, 10, true, nThreads);
+        std::reverse(vDescending.begin(), vDescending.end());
+        BOOST_CHECK(vDescending == vExpected);
+    }
+
+    // empty range
+    BOOST_CHECK(ScanHashes(pindexTip, pindexTip->nHeight + 1, false, 4).empty());
+}
+
+BOOST_AUTO_TEST_CASE(blockscanner_stop)
+{
+    const CBlockIndex* pindexTip;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+    }
+    int nStopHeight = pindexTip->nHeight - 20;
+
+    // a failing extractor stops the scan, blocks before it are committed
+    std::vector<int> vCommitted;
+    CBlockScanner<int> scanner(pindexTip, 0, true, 4);
+    bool fOk = scanner.Run(
+        [nStopHeight](const CBlock& block, const CBlockIndex* pindex, int& nHeight) {
+            nHeight = pindex->nHeight;
+            return pindex->nHeight != nStopHeight;
+        },
+        [&vCommitted](const CBlockIndex* pindex, int& nHeight) {
+            vCommitted.push_back(nHeight);
+            return true;
+        });
+    BOOST_CHECK(!fOk);
+    BOOST_CHECK_EQUAL(vCommitted.size(), 20U);
+    BOOST_CHECK_EQUAL(vCommitted.back(), nStopHeight + 1);
+
+    // a failing committer stops the scan too
+    vCommitted.clear();
+    CBlockScanner<int> scanner2(pindexTip, 0, false, 4);
+    fOk = scanner2.Run(
+        [](const CBlock& block, const CBlockIndex* pindex, int& nHeight) {
+            nHeight = pindex->nHeight;
+            return true;
+        },
+        [&vCommitted](const CBlockIndex* pindex, int& nHeight) {
+            vCommitted.push_back(nHeight);
+            return nHeight < 50;
+        });
+    BOOST_CHECK(!fOk);
+    BOOST_CHECK_EQUAL(vCommitted.size(), 51U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,123 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <expirymap.h>
+#include <clientversion.h>
+#include <random.h>
+#include <streams.h>
+#include <txmempool.h>
+
+#include <test/test_qstees.h>
+
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(expirymap_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(expirymap_basic)
+{
+    expirymap<int, std::string> map;
+    const int64_t nNow = 1500000000;
+    // nothing in it, the wheel just starts at nNow
+    BOOST_CHECK_EQUAL(map.Expire(nNow), 0U);
+
+    BOOST_CHECK(map.Insert(1, "one", nNow + 10));
+    BOOST_CHECK(!map.Insert(1, "uno", nNow + 20));
+    BOOST_CHECK_EQUAL(*map.Find(1), "one");
+    BOOST_CHECK_EQUAL(map.GetExpireTime(1), nNow + 10);
+    BOOST_CHECK_EQUAL(map.GetExpireTime(2), 0);
+    BOOST_CHECK(map.Find(2) == nullptr);
+
+    // Set replaces the value and reschedules
+    map.Set(1, "uno", nNow + 20);
+    BOOST_CHECK_EQUAL(*map.Find(1), "uno");
+    BOOST_CHECK_EQUAL(map.GetExpireTime(1), nNow + 20);
+
+    map.Insert(2, "two", nNow + 5);
+    map.Insert(3, "three", nNow + 5);
+    BOOST_CHECK(map.Erase(3));
+    BOOST_CHECK(!map.Erase(3));
+    BOOST_CHECK_EQUAL(map.size(), 2U);
+
+    // expired once the time is past the expiry time, not at it
+    std::vector<int> vExpired;
+    auto fnExpired = [&vExpired](const int& key, std::string& value) { vExpired.push_back(key); };
+    BOOST_CHECK_EQUAL(map.Expire(nNow + 5, fnExpired), 0U);
+    BOOST_CHECK_EQUAL(map.Expire(nNow + 6, fnExpired), 1U);
+    BOOST_CHECK(vExpired == std::vector<int>{2});
+    BOOST_CHECK(!map.Contains(2));
+
+    // an entry already due goes with the next call
+    map.Insert(4, "four", nNow);
+    BOOST_CHECK_EQUAL(map.Expire(nNow + 7, fnExpired), 1U);
+    BOOST_CHECK(!map.Contains(4));
+
+    BOOST_CHECK_EQUAL(map.Expire(nNow + 21, fnExpired), 1U);
+    BOOST_CHECK(map.empty());
+}
+
+BOOST_AUTO_TEST_CASE(expirymap_random)
+{
+    // same operations on the map and on a plain map swept entry by entry
+    expirymap<uint32_t, uint32_t> map;
+    std::map<uint32_t, std::pair<uint32_t, int64_t> > mapReference;
+    int64_t nNow = 1500000000;
+    map.Expire(nNow);
+
+    for (int nRound = 0; nRound < 2000; nRound++) {
+        for (int i = 0; i < 20; i++) {
+            uint32_t nKey = InsecureRandRange(5000);
+            // from already due to further than the wheel turns
+            int64_t nExpireTime = nNow - 10 + (int64_t)(InsecureRandRange(i % 4 == 0 ? 20000000 : 5000));
+            if (InsecureRandRange(8) == 0) {
+                BOOST_CHECK_EQUAL(map.Erase(nKey), mapReference.erase(nKey) != 0);
+            } else {
+                map.Set(nKey, nRound, nExpireTime);
+                mapReference[nKey] = std::make_pair(nRound, nExpireTime);
+            }
+        }
+
+        // mostly small steps, now and then a long one
+        nNow += InsecureRandRange(100) == 0 ? InsecureRandRange(20000000) : InsecureRandRange(200);
+        std::map<uint32_t, uint32_t> mapExpired;
+        map.Expire(nNow, [&mapExpired](const uint32_t& nKey, uint32_t& nValue) { mapExpired.emplace(nKey, nValue); });
+
+        for (auto it = mapReference.begin(); it != mapReference.end();) {
+            if (it->second.second < nNow) {
+                BOOST_CHECK(mapExpired.count(it->first) && mapExpired[it->first] == it->second.first);
+                mapExpired.erase(it->first);
+                mapReference.erase(it++);
+            } else {
+                BOOST_CHECK(map.Find(it->first) && *map.Find(it->first) == it->second.first);
+                BOOST_CHECK_EQUAL(map.GetExpireTime(it->first), it->second.second);
+                ++it;
+            }
+        }
+        BOOST_CHECK(mapExpired.empty());
+        BOOST_CHECK_EQUAL(map.size(), mapReference.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(expirymap_serialize)
+{
+    expirymap<uint256, int64_t, SaltedTxidHasher> map;
+    for (int i = 0; i < 100; i++) {
+        map.Insert(GetRandHash(), i, 1500000000 + i);
+    }
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << map;
+    expirymap<uint256, int64_t, SaltedTxidHasher> mapLoaded;
+    ss >> mapLoaded;
+
+    BOOST_CHECK_EQUAL(mapLoaded.size(), map.size());
+    map.ForEach([&mapLoaded](const uint256& hash, const int64_t& nValue, int64_t nExpireTime) {
+        BOOST_CHECK(mapLoaded.Find(hash) && *mapLoaded.Find(hash) == nValue);
+        BOOST_CHECK_EQUAL(mapLoaded.GetExpireTime(hash), nExpireTime);
+    });
+    BOOST_CHECK_EQUAL(mapLoaded.Expire(1500000050), 50U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
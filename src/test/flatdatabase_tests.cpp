@@ -0,0 +1,91 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <flat-database.h>
+#include <flatdbwriter.h>
+#include <util.h>
+
+#include <test/test_qstees.h>
+
+#include <boost/test/unit_test.hpp>
+
+// the part of a cache CFlatDB uses
+struct CTestCache
+{
+    std::vector<uint32_t> vData;
+    int nCleaned = 0;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(vData);
+    }
+
+    void Clear() { vData.clear(); }
+    void CheckAndRemove() { nCleaned++; }
+    std::string ToString() const { return strprintf("Entries: %d", vData.size()); }
+};
+
+BOOST_FIXTURE_TEST_SUITE(flatdatabase_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(flatdatabase_dump_load)
+{
+    fs::path pathDir = SetDataDir("flatdatabase_dump_load");
+    ClearDatadirCache();
+
+    CTestCache cache;
+    for (uint32_t i = 0; i < 10000; i++) cache.vData.push_back(i * 7);
+    CFlatDB<CTestCache> flatdb("testcache.dat", "magicTestCache");
+    BOOST_CHECK(flatdb.Dump(cache));
+    BOOST_CHECK(fs::exists(pathDir / "testcache.dat"));
+    BOOST_CHECK(!fs::exists(pathDir / "testcache.dat.new"));
+
+    CTestCache cacheLoaded;
+    BOOST_CHECK(flatdb.Load(cacheLoaded));
+    BOOST_CHECK(cacheLoaded.vData == cache.vData);
+    BOOST_CHECK_EQUAL(cacheLoaded.nCleaned, 1);
+
+    // the same file written by the writer thread
+    flatdbwriter.Start();
+    cache.vData.resize(5000);
+    BOOST_CHECK(flatdb.DumpAsync(cache));
+    cache.vData.push_back(42);
+    BOOST_CHECK(flatdb.DumpAsync(cache));
+    flatdbwriter.Flush();
+    flatdbwriter.Stop();
+
+    CTestCache cacheAsync;
+    BOOST_CHECK(flatdb.Load(cacheAsync));
+    BOOST_CHECK(cacheAsync.vData == cache.vData);
+
+    // a file of another type is left alone
+    CFlatDB<CTestCache> flatdbOther("testcache.dat", "magicOtherCache");
+    BOOST_CHECK(!flatdbOther.DumpAsync(cache));
+    BOOST_CHECK(!flatdbOther.Dump(cache));
+    BOOST_CHECK(flatdb.Load(cacheLoaded));
+}
+
+BOOST_AUTO_TEST_CASE(flatdatabase_corrupted)
+{
+    fs::path pathDir = SetDataDir("flatdatabase_corrupted");
+    ClearDatadirCache();
+
+    CTestCache cache;
+    cache.vData.assign(100, 1);
+    CFlatDB<CTestCache> flatdb("testcache.dat", "magicTestCache");
+    BOOST_CHECK(flatdb.Dump(cache));
+
+    // flip a byte of the data, the checksum no longer matches
+    FILE* file = fsbridge::fopen(pathDir / "testcache.dat", "rb+");
+    BOOST_REQUIRE(file);
+    fseek(file, -40, SEEK_END);
+    fputc(0xff, file);
+    fclose(file);
+
+    CTestCache cacheLoaded;
+    BOOST_CHECK(!flatdb.Load(cacheLoaded));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,56 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <infinitynodeman.h>
+#include <chain.h>
+#include <infinitynodersv.h>
+
+#include <test/test_qstees.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(infinitynodeman_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(infinitynodeman_roi)
+{
+    // burn divided by the reward a node gets a day, 720 blocks shared by the nodes of the tier
+    BOOST_CHECK_EQUAL(CInfinitynodeMan::CalculateRoi(10, 720, 200000), 1000000 / 1752);
+    BOOST_CHECK_EQUAL(CInfinitynodeMan::CalculateRoi(5, 720, 200000), 500000 / 838);
+    BOOST_CHECK_EQUAL(CInfinitynodeMan::CalculateRoi(1, 1440, 200000), 2 * 100000 / 160);
+
+    // an empty tier, or a height without reward
+    BOOST_CHECK_EQUAL(CInfinitynodeMan::CalculateRoi(10, 0, 200000), 0);
+    BOOST_CHECK_EQUAL(CInfinitynodeMan::CalculateRoi(10, -1, 200000), 0);
+    BOOST_CHECK_EQUAL(CInfinitynodeMan::CalculateRoi(10, 720, 0), 0);
+    BOOST_CHECK_EQUAL(CInfinitynodeMan::CalculateRoi(0, 720, 200000), 0);
+}
+
+BOOST_AUTO_TEST_CASE(infinitynodeman_stats_empty_tiers)
+{
+    CInfinitynodeMan man;
+    // publish the empty list, before any tip
+    man.CheckAndRemove();
+    CInfinitynodeMan::StatsRef stats = man.GetStats();
+    BOOST_CHECK_EQUAL(stats->nTotal, 0);
+    BOOST_CHECK_EQUAL(stats->mapTiers.size(), 3U);
+    for (const auto& pair : stats->mapTiers) {
+        BOOST_CHECK_EQUAL(pair.second.nCount, 0);
+        BOOST_CHECK_EQUAL(pair.second.nRoiDays, 0);
+    }
+
+    // the ROIs are recomputed at the tip, the tiers are still empty
+    CBlockIndex index;
+    index.nHeight = 200000;
+    man.UpdatedBlockTip(&index);
+    stats = man.GetStats();
+    for (const auto& pair : stats->mapTiers) {
+        BOOST_CHECK_EQUAL(pair.second.nRoiDays, 0);
+    }
+
+    // publishing gave the weights of this list to the global tally, give it back those of the global list
+    CInfinitynodeMan::StateRef state = infnodeman.GetSnapshot();
+    infnodersv.UpdateNodeWeights(state ? state->mapInfinitynodes : std::map<COutPoint, CInfinitynode>());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
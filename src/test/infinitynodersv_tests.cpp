@@ -0,0 +1,185 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <infinitynodersv.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <txmempool.h>
+
+#include <test/test_qstees.h>
+
+#include <deque>
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+const std::vector<std::string> vProposals = {"00000001", "00000002"};
+
+/**
+ * A chain of block indexes with the blocks, votes funded by transactions in
+ * the mempool so that the voters are found without a transaction index.
+ */
+struct VoteChain
+{
+    std::deque<uint256> vHashes;
+    std::deque<CBlockIndex> vIndexes;
+    std::map<const CBlockIndex*, CBlock> mapBlocks;
+    std::vector<CScript> vVoters;
+    std::vector<COutPoint> vFunds;
+    CKeyID keyGovernance;
+    CKeyID keyOther;
+
+    VoteChain()
+    {
+        // regtest has no governance address
+        CKey key;
+        key.MakeNewKey(true);
+        keyGovernance = key.GetPubKey().GetID();
+        UpdateGovernanceAddressParameters(EncodeDestination(keyGovernance));
+        key.MakeNewKey(true);
+        keyOther = key.GetPubKey().GetID();
+
+        for (int i = 0; i < 4; i++) {
+            CKey key;
+            key.MakeNewKey(true);
+            vVoters.push_back(GetScriptForDestination(key.GetPubKey().GetID()));
+
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+            tx.vout.resize(1);
+            tx.vout[0].nValue = COIN;
+            tx.vout[0].scriptPubKey = vVoters.back();
+            LOCK(mempool.cs);
+            mempool.addUnchecked(tx.GetHash(), TestMemPoolEntryHelper().FromTx(tx));
+            vFunds.push_back(COutPoint(tx.GetHash(), 0));
+        }
+    }
+
+    ~VoteChain() { mempool.clear(); }
+
+    const CBlockIndex* Extend(const CBlockIndex* pprev, const CBlock& block)
+    {
+        vHashes.push_back(InsecureRand256());
+        vIndexes.emplace_back();
+        CBlockIndex& index = vIndexes.back();
+        index.phashBlock = &vHashes.back();
+        index.pprev = const_cast<CBlockIndex*>(pprev);
+        index.nHeight = pprev ? pprev->nHeight + 1 : 0;
+        index.BuildSkip();
+        if (!block.vtx.empty()) mapBlocks[&index] = block;
+        return &index;
+    }
+
+    // a block with random votes, most of them to the governance address
+    CBlock RandomVotes() const
+    {
+        CBlock block;
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vout.resize(1);
+        block.vtx.push_back(MakeTransactionRef(coinbase));
+
+        for (int i = InsecureRandRange(3); i > 0; i--) {
+            int nVoter = InsecureRandRange(vVoters.size());
+            std::string strVote = vProposals[InsecureRandRange(vProposals.size())] + (InsecureRandBool() ? "1" : "0");
+            const CKeyID& keyID = InsecureRandRange(4) ? keyGovernance : keyOther;
+
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout = vFunds[nVoter];
+            tx.vout.resize(1);
+            tx.vout[0].nValue = Params().GetConsensus().nInfinityNodeVoteValue * COIN;
+            tx.vout[0].scriptPubKey = CScript() << ToByteVector(keyID) << OP_RETURN << std::vector<unsigned char>(strVote.begin(), strVote.end());
+            block.vtx.push_back(MakeTransactionRef(tx));
+        }
+        return block;
+    }
+};
+
+/** What a rescan of the chain to pindexTip counts: the governance votes deeper than a reorganization */
+std::map<CScript, CVote> Rescan(const VoteChain& chain, const CBlockIndex* pindexTip, const std::string& strProposal)
+{
+    std::map<CScript, CVote> mapVotes;
+    for (int nHeight = CInfinitynodersv::GetBeginHeight(); nHeight < pindexTip->nHeight - Params().MaxReorganizationDepth(); nHeight++) {
+        const CBlock& block = chain.mapBlocks.at(pindexTip->GetAncestor(nHeight));
+        std::vector<std::pair<CVote, COutPoint>> vVotes;
+        CInfinitynodersv::FindVotes(block, nHeight, vVotes);
+        for (const auto& pair : vVotes) {
+            if (pair.first.getProposalId() != strProposal) continue;
+            CScript voter;
+            BOOST_REQUIRE(CInfinitynodersv::GetVoter(pair.second, voter));
+            auto it = mapVotes.find(voter);
+            if (it != mapVotes.end() && it->second.getHeight() >= nHeight) continue;
+            mapVotes[voter] = CVote(strProposal, voter, nHeight, pair.first.getOpinion());
+        }
+    }
+    return mapVotes;
+}
+
+void CheckTally(CInfinitynodersv& rsv, const VoteChain& chain, const CBlockIndex* pindexTip)
+{
+    for (const std::string& strProposal : vProposals) {
+        std::map<CScript, CVote> mapExpected = Rescan(chain, pindexTip, strProposal);
+        std::map<CScript, CVote> mapVotes = rsv.GetProposalVotes(strProposal);
+        BOOST_REQUIRE_EQUAL(mapVotes.size(), mapExpected.size());
+        int nYes = 0;
+        for (const auto& pair : mapExpected) {
+            const CVote& vote = mapVotes.at(pair.first);
+            BOOST_CHECK_EQUAL(vote.getHeight(), pair.second.getHeight());
+            BOOST_CHECK_EQUAL(vote.getOpinion(), pair.second.getOpinion());
+            nYes += pair.second.getOpinion();
+        }
+        BOOST_CHECK_EQUAL(rsv.getResult(strProposal, true), nYes);
+        BOOST_CHECK_EQUAL(rsv.getResult(strProposal, false), (int)mapExpected.size() - nYes);
+    }
+}
+
+} // namespace
+
+struct RegtestingSetup : public BasicTestingSetup {
+    RegtestingSetup() : BasicTestingSetup(CBaseChainParams::REGTEST) {}
+};
+
+BOOST_FIXTURE_TEST_SUITE(infinitynodersv_tests, RegtestingSetup)
+
+BOOST_AUTO_TEST_CASE(infinitynodersv_incremental_tally)
+{
+    VoteChain chain;
+    CInfinitynodersv rsv;
+    int nBeginHeight = CInfinitynodersv::GetBeginHeight();
+    int nDepth = Params().MaxReorganizationDepth();
+
+    // no vote before the beginning, nothing to read from disk to start there
+    const CBlockIndex* pindexTip = nullptr;
+    while (pindexTip == nullptr || pindexTip->nHeight < nBeginHeight - 1) {
+        pindexTip = chain.Extend(pindexTip, CBlock());
+    }
+    rsv.UpdatedBlockTip(pindexTip);
+
+    // the votes count once they are deeper than a reorganization
+    for (int i = 0; i < 20 * nDepth; i++) {
+        pindexTip = chain.Extend(pindexTip, chain.RandomVotes());
+        rsv.BlockConnected(chain.mapBlocks.at(pindexTip), pindexTip);
+        CheckTally(rsv, chain, pindexTip);
+    }
+    BOOST_CHECK(rsv.getVoteCount(vProposals[0]) + rsv.getVoteCount(vProposals[1]) > 0);
+
+    // a reorganization takes back the votes which are not deep enough any more
+    const CBlockIndex* pindexFork = pindexTip->GetAncestor(pindexTip->nHeight - nDepth);
+    while (pindexTip != pindexFork) {
+        rsv.BlockDisconnected(chain.mapBlocks.at(pindexTip), pindexTip);
+        pindexTip = pindexTip->pprev;
+        CheckTally(rsv, chain, pindexTip);
+    }
+    for (int i = 0; i < 2 * nDepth; i++) {
+        pindexTip = chain.Extend(pindexTip, chain.RandomVotes());
+        rsv.BlockConnected(chain.mapBlocks.at(pindexTip), pindexTip);
+        CheckTally(rsv, chain, pindexTip);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,203 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <instantsendstats.h>
+#include <random.h>
+#include <utiltime.h>
+
+#include <test/test_qstees.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+struct CInstantSendStatsTest
+{
+    static void AddSample(std::deque<int64_t>& deque, int64_t nLatency) { CInstantSendStats::AddSample(deque, nLatency); }
+    static UniValue LatencyToJSON(const std::deque<int64_t>& deque) { return CInstantSendStats::LatencyToJSON(deque); }
+
+    // move every event of the lock nSeconds in the past
+    static void Age(CInstantSendStats& stats, const uint256& txHash, int64_t nSeconds)
+    {
+        LOCK(stats.cs);
+        CTxLockTiming& timing = stats.mapTimings.at(txHash);
+        for (int64_t* pnTime : {&timing.nTimeFirstSeen, &timing.nTimeRequest, &timing.nTimeFirstVote,
+                                &timing.nTimeLastVote, &timing.nTimeLocked, &timing.nTimeMempool}) {
+            if (*pnTime != 0) *pnTime -= nSeconds * 1000000;
+        }
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(instantsendstats_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(instantsendstats_percentiles)
+{
+    std::deque<int64_t> deque;
+    UniValue obj = CInstantSendStatsTest::LatencyToJSON(deque);
+    BOOST_CHECK_EQUAL(obj["samples"].get_int64(), 0);
+    BOOST_CHECK(obj["p50"].isNull());
+
+    // 1ms to 100ms, in any order
+    std::vector<int64_t> vLatencies;
+    for (int64_t i = 1; i <= 100; i++) vLatencies.push_back(i * 1000);
+    std::reverse(vLatencies.begin(), vLatencies.end());
+    std::swap(vLatencies[10], vLatencies[70]);
+    for (int64_t nLatency : vLatencies) CInstantSendStatsTest::AddSample(deque, nLatency);
+
+    obj = CInstantSendStatsTest::LatencyToJSON(deque);
+    BOOST_CHECK_EQUAL(obj["samples"].get_int64(), 100);
+    BOOST_CHECK_EQUAL(obj["p50"].get_real(), 50.0);
+    BOOST_CHECK_EQUAL(obj["p90"].get_real(), 90.0);
+    BOOST_CHECK_EQUAL(obj["p99"].get_real(), 99.0);
+    BOOST_CHECK_EQUAL(obj["max"].get_real(), 100.0);
+
+    // a single sample is every percentile
+    deque.assign(1, 2500);
+    obj = CInstantSendStatsTest::LatencyToJSON(deque);
+    BOOST_CHECK_EQUAL(obj["p50"].get_real(), 2.5);
+    BOOST_CHECK_EQUAL(obj["p99"].get_real(), 2.5);
+}
+
+BOOST_AUTO_TEST_CASE(instantsendstats_max_samples)
+{
+    std::deque<int64_t> deque;
+    for (size_t i = 0; i < INSTANTSEND_STATS_MAX_SAMPLES + 10; i++) {
+        CInstantSendStatsTest::AddSample(deque, i);
+    }
+    // the oldest ones are dropped
+    BOOST_CHECK_EQUAL(deque.size(), INSTANTSEND_STATS_MAX_SAMPLES);
+    BOOST_CHECK_EQUAL(deque.front(), 10);
+    BOOST_CHECK_EQUAL(deque.back(), (int64_t)INSTANTSEND_STATS_MAX_SAMPLES + 9);
+
+    // the clock going back does not give negative latencies
+    CInstantSendStatsTest::AddSample(deque, -5);
+    BOOST_CHECK_EQUAL(deque.size(), INSTANTSEND_STATS_MAX_SAMPLES);
+    BOOST_CHECK_EQUAL(deque.back(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(instantsendstats_votes_per_lock)
+{
+    CInstantSendStats stats;
+    CTxLockTiming timing;
+
+    // locked with 3 votes, one of them an orphan first
+    uint256 txLocked = InsecureRand256();
+    stats.RequestReceived(txLocked);
+    stats.VoteOrphaned(txLocked);
+    stats.VoteCounted(txLocked, true);
+    stats.VoteCounted(txLocked, false);
+    stats.VoteCounted(txLocked, false);
+    stats.MempoolAccepted(txLocked);
+    BOOST_CHECK(stats.LockCompleted(txLocked, timing));
+    BOOST_CHECK(!stats.LockCompleted(txLocked, timing));
+    BOOST_CHECK(timing.txHash == txLocked);
+    BOOST_CHECK_EQUAL(timing.nVotes, 3);
+    BOOST_CHECK_EQUAL(timing.nOrphanVotes, 1);
+    BOOST_CHECK(timing.nTimeLocked >= timing.nTimeRequest && timing.nTimeRequest != 0);
+
+    // failed with 2 votes
+    uint256 txFailed = InsecureRand256();
+    stats.RequestReceived(txFailed);
+    stats.VoteCounted(txFailed, false);
+    stats.VoteCounted(txFailed, false);
+
+    UniValue obj = stats.ToJSON();
+    BOOST_CHECK_EQUAL(obj["requests"].get_int64(), 2);
+    BOOST_CHECK_EQUAL(obj["locks"].get_int64(), 1);
+    BOOST_CHECK_EQUAL(obj["votes"].get_int64(), 5);
+    BOOST_CHECK_EQUAL(obj["latency"]["lock"]["samples"].get_int64(), 1);
+    BOOST_CHECK_EQUAL(obj["latency"]["firstvote"]["samples"].get_int64(), 2);
+    BOOST_CHECK_EQUAL(obj["latency"]["mempool"]["samples"].get_int64(), 1);
+
+    stats.CandidateRemoved(txFailed);
+    stats.CandidateRemoved(txLocked);
+    BOOST_CHECK_EQUAL(stats.size(), 0U);
+
+    obj = stats.ToJSON();
+    BOOST_CHECK_EQUAL(obj["failed"].get_int64(), 1);
+    BOOST_CHECK_EQUAL(obj["pending"].get_int64(), 0);
+    const UniValue& objVotes = obj["votesperlock"];
+    BOOST_CHECK_EQUAL(objVotes["locked"].size(), 1U);
+    BOOST_CHECK_EQUAL(objVotes["locked"]["3"].get_int64(), 1);
+    BOOST_CHECK_EQUAL(objVotes["failed"].size(), 1U);
+    BOOST_CHECK_EQUAL(objVotes["failed"]["2"].get_int64(), 1);
+    BOOST_CHECK_EQUAL(objVotes["orphans"]["1"].get_int64(), 1);
+
+    // removing an unknown or already removed lock changes nothing
+    stats.CandidateRemoved(txFailed);
+    BOOST_CHECK_EQUAL(stats.ToJSON()["failed"].get_int64(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(instantsendstats_orphan_votes)
+{
+    CInstantSendStats stats;
+
+    // votes arriving before the request wait as orphans
+    uint256 txHash = InsecureRand256();
+    stats.VoteOrphaned(txHash);
+    stats.VoteOrphaned(txHash);
+    BOOST_CHECK_EQUAL(stats.size(), 1U);
+
+    UniValue obj = stats.ToJSON();
+    BOOST_CHECK_EQUAL(obj["orphanvotes"].get_int64(), 2);
+    BOOST_CHECK_EQUAL(obj["votes"].get_int64(), 0);
+
+    stats.VoteCounted(txHash, true);
+    stats.VoteCounted(txHash, true);
+    // the votes were there when the request came, a first vote latency of 0
+    stats.RequestReceived(txHash);
+    stats.RequestReceived(txHash);
+
+    obj = stats.ToJSON();
+    BOOST_CHECK_EQUAL(obj["requests"].get_int64(), 1);
+    BOOST_CHECK_EQUAL(obj["votes"].get_int64(), 2);
+    BOOST_CHECK_EQUAL(obj["orphanvotes"].get_int64(), 2);
+    BOOST_CHECK_EQUAL(obj["latency"]["firstvote"]["samples"].get_int64(), 1);
+    BOOST_CHECK_EQUAL(obj["latency"]["firstvote"]["max"].get_real(), 0.0);
+
+    CTxLockTiming timing;
+    BOOST_CHECK(stats.LockCompleted(txHash, timing));
+    BOOST_CHECK_EQUAL(timing.nVotes, 2);
+    BOOST_CHECK_EQUAL(timing.nOrphanVotes, 2);
+    BOOST_CHECK_EQUAL(stats.ToJSON()["votesperlock"]["orphans"]["2"].get_int64(), 1);
+
+    // orphan votes only, the lock never had a candidate: not a failed lock
+    uint256 txOrphan = InsecureRand256();
+    stats.VoteOrphaned(txOrphan);
+    stats.CandidateRemoved(txOrphan);
+    BOOST_CHECK_EQUAL(stats.ToJSON()["failed"].get_int64(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(instantsendstats_timeout)
+{
+    CInstantSendStats stats;
+
+    uint256 txOld = InsecureRand256();
+    uint256 txRecent = InsecureRand256();
+    uint256 txOrphan = InsecureRand256();
+    stats.RequestReceived(txOld);
+    stats.VoteCounted(txOld, false);
+    stats.RequestReceived(txRecent);
+    stats.VoteOrphaned(txOrphan);
+
+    // just within the timeout, kept
+    CInstantSendStatsTest::Age(stats, txOld, INSTANTSEND_STATS_TIMEOUT_SECONDS - 60);
+    stats.CheckAndRemove();
+    BOOST_CHECK_EQUAL(stats.size(), 3U);
+
+    // no progress for longer than the timeout, dropped
+    CInstantSendStatsTest::Age(stats, txOld, 120);
+    CInstantSendStatsTest::Age(stats, txOrphan, INSTANTSEND_STATS_TIMEOUT_SECONDS + 1);
+    stats.CheckAndRemove();
+    BOOST_CHECK_EQUAL(stats.size(), 1U);
+
+    // dropped, not failed
+    stats.CandidateRemoved(txOld);
+    BOOST_CHECK_EQUAL(stats.ToJSON()["failed"].get_int64(), 0);
+    stats.CandidateRemoved(txRecent);
+    BOOST_CHECK_EQUAL(stats.ToJSON()["failed"].get_int64(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
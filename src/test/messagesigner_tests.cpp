@@ -0,0 +1,45 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <messagesigner.h>
+#include <key.h>
+
+#include <test/test_qstees.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(messagesigner_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(messagesigner_cache)
+{
+    CKey key, keyOther;
+    key.MakeNewKey(true);
+    keyOther.MakeNewKey(true);
+
+    std::vector<unsigned char> vchSig;
+    std::string strMessage = "masternode ping";
+    BOOST_CHECK(CMessageSigner::SignMessage(strMessage, vchSig, key));
+
+    size_t nElements;
+    uint64_t nHits, nMisses, nHitsBefore, nMissesBefore;
+    CHashSigner::GetSignatureCacheStats(nElements, nHitsBefore, nMissesBefore);
+
+    // the first check recovers the key, the next ones are cache hits
+    std::string strError;
+    BOOST_CHECK(CMessageSigner::VerifyMessage(key.GetPubKey(), vchSig, strMessage, strError));
+    BOOST_CHECK(CMessageSigner::VerifyMessage(key.GetPubKey(), vchSig, strMessage, strError));
+    BOOST_CHECK(CMessageSigner::VerifyMessage(key.GetPubKey(), vchSig, strMessage, strError));
+    CHashSigner::GetSignatureCacheStats(nElements, nHits, nMisses);
+    BOOST_CHECK_EQUAL(nMisses - nMissesBefore, 1U);
+    BOOST_CHECK_EQUAL(nHits - nHitsBefore, 2U);
+
+    // a cached signature does not verify for another key or message
+    BOOST_CHECK(!CMessageSigner::VerifyMessage(keyOther.GetPubKey(), vchSig, strMessage, strError));
+    BOOST_CHECK(!CMessageSigner::VerifyMessage(key.GetPubKey(), vchSig, strMessage + " ", strError));
+    CHashSigner::GetSignatureCacheStats(nElements, nHits, nMisses);
+    BOOST_CHECK_EQUAL(nMisses - nMissesBefore, 3U);
+    BOOST_CHECK_EQUAL(nHits - nHitsBefore, 2U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <shardedmap.h>
+#include <arith_uint256.h>
+#include <coins.h>
+#include <random.h>
+
+#include <test/test_qstees.h>
+
+#include <atomic>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(shardedmap_tests, BasicTestingSetup)
+
+typedef shardedmap<COutPoint, uint256, SaltedOutpointHasher> LockedOutpointsMap;
+
+BOOST_AUTO_TEST_CASE(shardedmap_basic)
+{
+    LockedOutpointsMap map;
+    COutPoint outpoint(GetRandHash(), 1);
+    uint256 hash1 = GetRandHash();
+    uint256 hash2 = GetRandHash();
+    uint256 hashRet;
+
+    BOOST_CHECK(!map.Get(outpoint, hashRet));
+    BOOST_CHECK(!map.Contains(outpoint));
+
+    // Insert keeps the first value, Set replaces it
+    BOOST_CHECK(map.Insert(outpoint, hash1));
+    BOOST_CHECK(!map.Insert(outpoint, hash2));
+    BOOST_CHECK(map.Get(outpoint, hashRet));
+    BOOST_CHECK(hashRet == hash1);
+    map.Set(outpoint, hash2);
+    BOOST_CHECK(map.Get(outpoint, hashRet));
+    BOOST_CHECK(hashRet == hash2);
+    BOOST_CHECK_EQUAL(map.size(), 1U);
+
+    BOOST_CHECK(map.Erase(outpoint));
+    BOOST_CHECK(!map.Erase(outpoint));
+    BOOST_CHECK(!map.Contains(outpoint));
+
+    for (uint32_t n = 0; n < 100; n++) {
+        map.Insert(COutPoint(hash1, n), hash2);
+    }
+    BOOST_CHECK_EQUAL(map.size(), 100U);
+    map.Clear();
+    BOOST_CHECK_EQUAL(map.size(), 0U);
+}
+
+// outpoints the threads lock and unlock are made of this plus the thread number
+static const uint64_t nOwnHashBase = 1000000;
+
+// Every thread looks up nLookups outpoints, the first half of them locked by
+// the hash of their index, while it locks or unlocks one outpoint of its own
+// every 64 lookups. The throughput is measured by the ShardedMapLookups bench.
+BOOST_AUTO_TEST_CASE(shardedmap_concurrent)
+{
+    const int nThreads = 8;
+    const int nLookups = 20000;
+    const uint32_t nOutpoints = 4096;
+
+    std::vector<COutPoint> vOutpoints;
+    for (uint32_t n = 0; n < nOutpoints; n++) {
+        vOutpoints.emplace_back(n < nOutpoints / 2 ? ArithToUint256(arith_uint256(n)) : GetRandHash(), n);
+    }
+    LockedOutpointsMap map;
+    for (uint32_t n = 0; n < nOutpoints / 2; n++) {
+        map.Insert(vOutpoints[n], vOutpoints[n].hash);
+    }
+
+    std::atomic<int> nWrong(0);
+    std::vector<std::thread> vThreads;
+    for (int t = 0; t < nThreads; t++) {
+        vThreads.emplace_back([&, t] {
+            uint256 hashOwn = ArithToUint256(arith_uint256(nOwnHashBase + t));
+            for (int i = 0; i < nLookups; i++) {
+                const COutPoint& outpoint = vOutpoints[(i * 7919 + t) % vOutpoints.size()];
+                uint256 hashLocked;
+                bool fLocked = map.Get(outpoint, hashLocked);
+                if (outpoint.n < nOutpoints / 2 ? !fLocked || hashLocked != outpoint.hash : fLocked) nWrong++;
+                if (i % 64 == 0) {
+                    COutPoint outpointOwn(hashOwn, i / 64 % 16);
+                    if (!map.Erase(outpointOwn)) map.Insert(outpointOwn, hashOwn);
+                }
+            }
+        });
+    }
+    for (auto& thread : vThreads) {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(nWrong, 0);
+
+    // what each thread added is still there, what it removed is gone: outpoint n
+    // was toggled once for every multiple of 64 below nLookups with i / 64 % 16 == n
+    int nToggles = (nLookups + 63) / 64;
+    size_t nAdded = 0;
+    for (int t = 0; t < nThreads; t++) {
+        uint256 hashOwn = ArithToUint256(arith_uint256(nOwnHashBase + t));
+        for (uint32_t n = 0; n < 16; n++) {
+            bool fAdded = (nToggles / 16 + (n < (uint32_t)(nToggles % 16) ? 1 : 0)) % 2 == 1;
+            uint256 hashRet;
+            BOOST_CHECK_EQUAL(map.Get(COutPoint(hashOwn, n), hashRet), fAdded);
+            if (fAdded) nAdded++;
+        }
+    }
+    BOOST_CHECK_EQUAL(map.size(), nOutpoints / 2 + nAdded);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,131 @@
+// Copyright (c) 2018-2020 SIN developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <sigverifyqueue.h>
+#include <key.h>
+#include <messagesigner.h>
+#include <random.h>
+#include <utiltime.h>
+
+#include <test/test_qstees.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(sigverifyqueue_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sigverifyqueue_inline)
+{
+    // a queue which was not started processes the messages in Push
+    CSigVerifyQueue queue;
+    bool fProcessed = false;
+    queue.Push(nullptr, CSigVerifyQueue::SigChecks(), [&fProcessed] { fProcessed = true; });
+    BOOST_CHECK(fProcessed);
+    BOOST_CHECK_EQUAL(queue.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(sigverifyqueue_order)
+{
+    const int nMessages = 200;
+
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<int> vOrder;
+    int nWrong = 0;
+
+    CSigVerifyQueue queue;
+    queue.Start(4);
+    for (int i = 0; i < nMessages; i++) {
+        uint256 hash = GetRandHash();
+        std::vector<unsigned char> vchSig;
+        BOOST_CHECK(CHashSigner::SignHash(hash, key, vchSig));
+        // every third signature is broken
+        bool fValid = i % 3 != 0;
+        if (!fValid) vchSig[10] ^= 1;
+
+        CSigVerifyQueue::SigChecks vChecks;
+        vChecks.emplace_back(hash, vchSig);
+        queue.Push(nullptr, std::move(vChecks), [&, i, hash, vchSig, fValid] {
+            std::string strError;
+            bool fVerified = CHashSigner::VerifyHash(hash, pubkey, vchSig, strError);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (fVerified != fValid) nWrong++;
+            vOrder.push_back(i);
+            cond.notify_one();
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&] { return (int)vOrder.size() == nMessages; });
+    }
+    queue.Stop();
+
+    BOOST_CHECK_EQUAL(nWrong, 0);
+    for (int i = 0; i < nMessages; i++) {
+        BOOST_CHECK_EQUAL(vOrder[i], i);
+    }
+    BOOST_CHECK_EQUAL(queue.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(sigverifyqueue_full)
+{
+    // a full queue holds the pusher back instead of processing its message first
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool fRelease = false;
+    std::vector<int> vOrder;
+
+    CSigVerifyQueue queue(2);
+    queue.Start(1);
+    queue.Push(nullptr, CSigVerifyQueue::SigChecks(), [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&] { return fRelease; });
+        vOrder.push_back(0);
+    });
+    for (int i = 1; i <= 2; i++) {
+        queue.Push(nullptr, CSigVerifyQueue::SigChecks(), [&, i] {
+            std::lock_guard<std::mutex> lock(mutex);
+            vOrder.push_back(i);
+        });
+    }
+
+    bool fPushed = false;
+    std::thread pusher([&] {
+        queue.Push(nullptr, CSigVerifyQueue::SigChecks(), [&] {
+            std::lock_guard<std::mutex> lock(mutex);
+            vOrder.push_back(3);
+            cond.notify_all();
+        });
+        std::lock_guard<std::mutex> lock(mutex);
+        fPushed = true;
+    });
+    MilliSleep(100);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        BOOST_CHECK(!fPushed);
+        BOOST_CHECK(vOrder.empty());
+        fRelease = true;
+    }
+    cond.notify_all();
+    pusher.join();
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&] { return vOrder.size() == 4; });
+    }
+    queue.Stop();
+    for (int i = 0; i < 4; i++) {
+        BOOST_CHECK_EQUAL(vOrder[i], i);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -93,6 +93,12 @@ public:
     /** Number of masternodes changed. */
     // FXTC TODO: boost::signals2::signal<void (int newNumMasternodes)> NotifyStrMasternodeCountChanged; 
 
+    /** Masternodes were added, removed or changed, see CMasternodeMan::GetMasternodeChanges. */
+    boost::signals2::signal<void ()> NotifyMasternodeListChanged;
+
+    /** Infinitynode counts or ROIs changed, see CInfinitynodeMan::GetStats. */
+    boost::signals2::signal<void ()> NotifyInfinitynodeStatsChanged;
+
     /**
      * Status bar alerts changed.
      */
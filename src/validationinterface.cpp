@@ -8,6 +8,7 @@
 
 #include <validationinterface.h>
 
+#include <instantsendstats.h>
 #include <primitives/block.h>
 #include <scheduler.h>
 #include <sync.h>
@@ -41,6 +42,7 @@ struct MainSignalsInstance {
 
     // Dash
     boost::signals2::signal<void (const CTransaction &)> NotifyTransactionLock;
+    boost::signals2::signal<void (const CTxLockTiming &)> NotifyTransactionLockTiming;
     //
 
     boost::signals2::signal<void (const CBlockLocator &)> ChainStateFlushed;
@@ -114,6 +116,7 @@ void RegisterValidationInterface(CValidationInterface* pwalletIn) {
 
     // Dash
     g_signals.m_internals->NotifyTransactionLock.connect(boost::bind(&CValidationInterface::NotifyTransactionLock, pwalletIn, _1));
+    g_signals.m_internals->NotifyTransactionLockTiming.connect(boost::bind(&CValidationInterface::NotifyTransactionLockTiming, pwalletIn, _1));
     //
 
     g_signals.m_internals->ChainStateFlushed.connect(boost::bind(&CValidationInterface::ChainStateFlushed, pwalletIn, _1));
@@ -132,6 +135,7 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
 
     // Dash
     g_signals.m_internals->NotifyTransactionLock.disconnect(boost::bind(&CValidationInterface::NotifyTransactionLock, pwalletIn, _1));
+    g_signals.m_internals->NotifyTransactionLockTiming.disconnect(boost::bind(&CValidationInterface::NotifyTransactionLockTiming, pwalletIn, _1));
     //
 
     g_signals.m_internals->ChainStateFlushed.disconnect(boost::bind(&CValidationInterface::ChainStateFlushed, pwalletIn, _1));
@@ -166,6 +170,7 @@ void UnregisterAllValidationInterfaces() {
 
     // Dash
     g_signals.m_internals->NotifyTransactionLock.disconnect_all_slots();
+    g_signals.m_internals->NotifyTransactionLockTiming.disconnect_all_slots();
     //
 
     g_signals.m_internals->ChainStateFlushed.disconnect_all_slots();
@@ -270,6 +275,12 @@ void CMainSignals::NotifyTransactionLock(const CTransaction &tx) {
         m_internals->NotifyTransactionLock(tx);
     });
 }
+
+void CMainSignals::NotifyTransactionLockTiming(const CTxLockTiming &timing) {
+    m_internals->m_schedulerClient.AddToProcessQueue([timing, this] {
+        m_internals->NotifyTransactionLockTiming(timing);
+    });
+}
 //
 
 void CMainSignals::ChainStateFlushed(const CBlockLocator &locator) {
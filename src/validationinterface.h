@@ -17,6 +17,7 @@
 class CBlock;
 class CBlockIndex;
 struct CBlockLocator;
+struct CTxLockTiming;
 class CBlockIndex;
 class CConnman;
 class CReserveScript;
@@ -133,6 +134,8 @@ protected:
 
     // Dash
     virtual void NotifyTransactionLock(const CTransaction &tx) {}
+    /** Notifies listeners of the timing and votes of a completed transaction lock */
+    virtual void NotifyTransactionLockTiming(const CTxLockTiming &timing) {}
     //
 
     /**
@@ -220,6 +223,7 @@ public:
     // Dash
     /** Notifies listeners of an updated transaction lock without new data. */
     void NotifyTransactionLock(const CTransaction &);
+    void NotifyTransactionLockTiming(const CTxLockTiming &);
     //
 
     void ChainStateFlushed(const CBlockLocator &);
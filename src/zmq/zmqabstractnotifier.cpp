@@ -26,6 +26,11 @@ bool CZMQAbstractNotifier::NotifyTransactionLock(const CTransaction &/*transacti
     return true;
 }
 
+bool CZMQAbstractNotifier::NotifyTransactionLockTiming(const CTxLockTiming &/*timing*/)
+{
+    return true;
+}
+
 bool CZMQAbstractNotifier::NotifyInstantSendDoubleSpendAttempt(const CTransaction& /*currentTx*/, const CTransaction& /*previousTx*/)
 {
     return true;
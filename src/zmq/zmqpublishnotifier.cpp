@@ -4,6 +4,7 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <instantsendstats.h>
 #include <streams.h>
 #include <zmq/zmqpublishnotifier.h>
 #include <validation.h>
@@ -19,6 +20,7 @@ static const char *MSG_HASHISCON     = "hashinstantsenddoublespend";
 static const char *MSG_RAWBLOCK      = "rawblock";
 static const char *MSG_RAWTX         = "rawtx";
 static const char *MSG_RAWTXLOCK     = "rawtxlock";
+static const char *MSG_RAWTXLOCKTIMING = "rawtxlocktiming";
 static const char *MSG_RAWISCON      = "rawinstantsenddoublespend";
 
 // Internal function to send multipart message
@@ -234,6 +236,14 @@ bool CZMQPublishRawTransactionLockNotifier::NotifyTransactionLock(const CTransac
     return SendMessage(MSG_RAWTXLOCK, &(*ss.begin()), ss.size());
 }
 
+bool CZMQPublishRawTransactionLockTimingNotifier::NotifyTransactionLockTiming(const CTxLockTiming &timing)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish rawtxlocktiming %s\n", timing.txHash.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << timing;
+    return SendMessage(MSG_RAWTXLOCKTIMING, &(*ss.begin()), ss.size());
+}
+
 bool CZMQPublishRawInstantSendDoubleSpendNotifier::NotifyInstantSendDoubleSpendAttempt(const CTransaction &currentTx, const CTransaction &previousTx)
 {
     LogPrint(BCLog::ZMQ, "zmq: Publish rawinstantsenddoublespend %s conflicts with %s\n", currentTx.GetHash().ToString(), previousTx.GetHash().ToString());
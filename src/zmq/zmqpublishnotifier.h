@@ -70,6 +70,12 @@ public:
     bool NotifyTransactionLock(const CTransaction &transaction) override;
 };
 
+class CZMQPublishRawTransactionLockTimingNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyTransactionLockTiming(const CTxLockTiming &timing) override;
+};
+
 class CZMQPublishRawInstantSendDoubleSpendNotifier : public CZMQAbstractPublishNotifier
 {
 public: